@@ -0,0 +1,200 @@
+/**
+ * @file ingest.bench.c
+ * @author Carl Mattatall (cmattatall2@gmail.com)
+ * @brief Throughput benchmark for batched NDJSON file ingestion
+ * @version 0.1
+ * @date 2021-05-16
+ *
+ * @copyright Copyright (c) 2021 Carl Mattatall
+ *
+ * usage: JTOK_ingest.bench [megabytes] [queue depth] [chunk KB]
+ *
+ * Every run starts by asking the kernel to drop the file from the page cache,
+ * which it may or may not honour. Run as root after
+ * "echo 3 > /proc/sys/vm/drop_caches" for properly cold numbers.
+ */
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#if defined(JTOK_HAVE_POSIX)
+#include <fcntl.h>
+#include <unistd.h>
+#endif /* #if defined(JTOK_HAVE_POSIX) */
+
+#include "jtok.h"
+#include "jtok_ingest.h"
+#include "jtok_lines.h"
+
+#define POOL_SIZE 256
+#define CARRY 4096
+
+static jtok_tkn_t pool[POOL_SIZE];
+static char       carry[CARRY];
+
+
+static int count_ok(void *ctx, const jtok_line_t *line, jtok_tkn_t *tkns)
+{
+    (void)tkns;
+    *(size_t *)ctx += (line->status == JTOK_PARSE_STATUS_OK);
+    return 0;
+}
+
+
+static int count_doc(void *ctx, size_t file, const jtok_line_t *line,
+                     jtok_tkn_t *tkns)
+{
+    (void)file;
+    return count_ok(ctx, line, tkns);
+}
+
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+
+static char *make_input(size_t target, size_t *len)
+{
+    char * buf = malloc(target + 256);
+    size_t pos = 0;
+    size_t id  = 0;
+    while (buf != NULL && pos < target)
+    {
+        pos += (size_t)sprintf(&buf[pos],
+                               "{\"id\":%zu,\"user\":\"user-%zu\",\"tags\":"
+                               "[\"a\",\"b\",\"c\"],\"score\":%zu.5,"
+                               "\"active\":%s}\n",
+                               id, id % 1000, id % 97,
+                               (id & 1) ? "true" : "false");
+        id++;
+    }
+    *len = pos;
+    return buf;
+}
+
+
+#if defined(JTOK_HAVE_POSIX)
+static void drop_cache(const char *path)
+{
+    int fd = open(path, O_RDONLY);
+    if (fd >= 0)
+    {
+        posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+        close(fd);
+    }
+}
+
+
+/* The baseline: read() the whole file into one buffer, then parse it */
+static size_t read_and_parse(const char *path, char *buf, size_t len)
+{
+    size_t  docs = 0;
+    size_t  got  = 0;
+    ssize_t n    = 1;
+    int     fd   = open(path, O_RDONLY);
+    if (fd < 0)
+    {
+        return 0;
+    }
+    while (got < len && n > 0)
+    {
+        n = read(fd, &buf[got], len - got);
+        got += (n > 0) ? (size_t)n : 0;
+    }
+    close(fd);
+    jtok_parse_lines(buf, got, pool, POOL_SIZE, count_ok, &docs);
+    return docs;
+}
+#endif /* #if defined(JTOK_HAVE_POSIX) */
+
+
+int main(int argc, char **argv)
+{
+#if defined(JTOK_HAVE_POSIX)
+    size_t      megabytes = (argc > 1) ? strtoul(argv[1], NULL, 10) : 256;
+    unsigned    depth     = (argc > 2) ? (unsigned)atoi(argv[2]) : 8;
+    size_t      chunk_kb  = (argc > 3) ? strtoul(argv[3], NULL, 10) : 256;
+    size_t      len;
+    char *      input = make_input(megabytes << 20, &len);
+    char *      buffers;
+    char        path[] = "/tmp/jtok_ingest_bench_XXXXXX";
+    const char *paths[1];
+    jtok_ingest_config_t config;
+    FILE *               file;
+    int                  fd;
+    double               start;
+    double               elapsed;
+    size_t               docs;
+    unsigned             flags;
+
+    if (input == NULL || depth == 0 || depth > JTOK_INGEST_MAX_DEPTH ||
+        chunk_kb == 0)
+    {
+        printf("bad arguments\n");
+        return 1;
+    }
+    buffers = malloc((size_t)depth * (chunk_kb << 10));
+    fd      = mkstemp(path);
+    if (buffers == NULL || fd < 0)
+    {
+        printf("could not allocate buffers or the input file\n");
+        return 1;
+    }
+    close(fd);
+    file = fopen(path, "wb");
+    if (file == NULL || fwrite(input, 1, len, file) != len ||
+        fclose(file) != 0)
+    {
+        printf("could not write %s\n", path);
+        unlink(path);
+        return 1;
+    }
+
+    drop_cache(path);
+    start   = now();
+    docs    = read_and_parse(path, input, len);
+    elapsed = now() - start;
+    printf("read + jtok_parse_lines:  %7.1f MB/s  (%zu docs)\n",
+           (double)len / 1e6 / elapsed, docs);
+
+    paths[0]         = path;
+    config.depth     = depth;
+    config.chunk_len = chunk_kb << 10;
+    config.buffers   = buffers;
+    config.carry     = carry;
+    config.carry_len = CARRY;
+    config.tkns      = pool;
+    config.size      = POOL_SIZE;
+    for (flags = 0; flags <= JTOK_INGEST_NO_URING; flags++)
+    {
+        config.flags = flags;
+        docs         = 0;
+        drop_cache(path);
+        start = now();
+        jtok_ingest_files(paths, 1, &config, count_doc, &docs);
+        elapsed = now() - start;
+        printf("jtok_ingest_files %-7s %7.1f MB/s  (%zu docs, %u x %zu KB)\n",
+               flags ? "pread:" : "uring:", (double)len / 1e6 / elapsed, docs,
+               depth, chunk_kb);
+    }
+
+    unlink(path);
+    free(buffers);
+    free(input);
+    return 0;
+#else
+    (void)argc;
+    (void)argv;
+    (void)count_doc;
+    (void)make_input;
+    (void)now;
+    printf("file ingestion needs JTOK_HAVE_POSIX\n");
+    return 1;
+#endif /* #if defined(JTOK_HAVE_POSIX) */
+}
@@ -0,0 +1,107 @@
+/**
+ * @file lines_mt.bench.c
+ * @author Carl Mattatall (cmattatall2@gmail.com)
+ * @brief Scaling benchmark for multi-threaded NDJSON parsing
+ * @version 0.1
+ * @date 2021-05-09
+ *
+ * @copyright Copyright (c) 2021 Carl Mattatall
+ *
+ * usage: JTOK_lines_mt.bench [megabytes] [max threads]
+ */
+#define _POSIX_C_SOURCE 199309L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "jtok.h"
+#include "jtok_lines.h"
+
+#define POOL_SIZE 256
+
+static jtok_tkn_t pools[JTOK_LINES_MAX_THREADS * POOL_SIZE];
+
+
+static int count_ok(void *ctx, const jtok_line_t *line, jtok_tkn_t *tkns)
+{
+    (void)ctx;
+    (void)tkns;
+    return line->status != JTOK_PARSE_STATUS_OK;
+}
+
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+
+static char *make_input(size_t target, size_t *len)
+{
+    char * buf = malloc(target + 256);
+    size_t pos = 0;
+    size_t id  = 0;
+    while (buf != NULL && pos < target)
+    {
+        pos += (size_t)sprintf(&buf[pos],
+                               "{\"id\":%zu,\"user\":\"user-%zu\",\"tags\":"
+                               "[\"a\",\"b\",\"c\"],\"score\":%zu.5,"
+                               "\"active\":%s}\n",
+                               id, id % 1000, id % 97,
+                               (id & 1) ? "true" : "false");
+        id++;
+    }
+    *len = pos;
+    return buf;
+}
+
+
+int main(int argc, char **argv)
+{
+    size_t              megabytes   = (argc > 1) ? strtoul(argv[1], NULL, 10) : 64;
+    unsigned            max_threads = (argc > 2) ? (unsigned)atoi(argv[2]) : 8;
+    size_t              len;
+    char *              input = make_input(megabytes << 20, &len);
+    jtok_lines_config_t config;
+    double              start;
+    double              serial;
+    double              elapsed;
+    size_t              docs;
+    unsigned            threads;
+    int                 ordered;
+
+    if (input == NULL || max_threads == 0 ||
+        max_threads > JTOK_LINES_MAX_THREADS)
+    {
+        printf("bad arguments\n");
+        return 1;
+    }
+
+    start = now();
+    jtok_parse_lines(input, len, pools, POOL_SIZE, count_ok, NULL);
+    serial = now() - start;
+    printf("jtok_parse_lines:    %7.1f MB/s\n", (double)len / 1e6 / serial);
+
+    config.chunk_len = 0;
+    config.pools     = pools;
+    config.pool_size = POOL_SIZE;
+    for (ordered = 0; ordered <= 1; ordered++)
+    {
+        config.ordered = ordered;
+        for (threads = 1; threads <= max_threads; threads *= 2)
+        {
+            config.threads = threads;
+            start          = now();
+            docs    = jtok_parse_lines_mt(input, len, &config, count_ok, NULL);
+            elapsed = now() - start;
+            printf("%-9s %2u threads: %7.1f MB/s  %5.2fx  (%zu docs)\n",
+                   ordered ? "ordered" : "unordered", threads,
+                   (double)len / 1e6 / elapsed, serial / elapsed, docs);
+        }
+    }
+    free(input);
+    return 0;
+}
@@ -0,0 +1,109 @@
+/**
+ * @file parse_mt.bench.c
+ * @author Carl Mattatall (cmattatall2@gmail.com)
+ * @brief Scaling benchmark for parsing one large document on several threads
+ * @version 0.1
+ * @date 2021-05-10
+ *
+ * @copyright Copyright (c) 2021 Carl Mattatall
+ *
+ * usage: JTOK_parse_mt.bench [megabytes] [max threads]
+ */
+#define _POSIX_C_SOURCE 199309L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "jtok.h"
+#include "jtok_parallel.h"
+
+/* Upper bound on tokens per input byte for the generated records */
+#define TOKENS_PER_BYTE_DIV 4
+
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+
+static char *make_input(size_t target, size_t *len)
+{
+    char * buf = malloc(target + 256);
+    size_t pos = 0;
+    size_t id  = 0;
+    if (buf == NULL)
+    {
+        return NULL;
+    }
+    pos += (size_t)sprintf(buf, "{\"records\":[");
+    while (pos < target)
+    {
+        pos += (size_t)sprintf(&buf[pos],
+                               "%s{\"id\":%zu,\"user\":\"user-%zu\",\"tags\":"
+                               "[\"a\",\"b\",\"c\"],\"score\":%zu.5,"
+                               "\"active\":%s}",
+                               (id == 0) ? "" : ",", id, id % 1000, id % 97,
+                               (id & 1) ? "true" : "false");
+        id++;
+    }
+    pos += (size_t)sprintf(&buf[pos], "]}");
+    *len = pos;
+    return buf;
+}
+
+
+int main(int argc, char **argv)
+{
+    size_t                 megabytes   = (argc > 1) ? strtoul(argv[1], NULL, 10) : 64;
+    unsigned               max_threads = (argc > 2) ? (unsigned)atoi(argv[2]) : 8;
+    size_t                 len;
+    char *                 input = make_input(megabytes << 20, &len);
+    size_t                 size  = len / TOKENS_PER_BYTE_DIV;
+    jtok_tkn_t *           tkns  = malloc(size * sizeof(*tkns));
+    jtok_tkn_t *           pools = malloc(size * sizeof(*pools));
+    jtok_parse_mt_config_t config;
+    JTOK_PARSE_STATUS_t    status;
+    double                 start;
+    double                 serial;
+    double                 elapsed;
+    unsigned               threads;
+
+    if (input == NULL || tkns == NULL || pools == NULL || max_threads == 0 ||
+        max_threads > JTOK_PARSE_MT_MAX_THREADS)
+    {
+        printf("bad arguments\n");
+        return 1;
+    }
+
+    /* Fault in every page first so that only parsing is timed */
+    memset(pools, 0, size * sizeof(*pools));
+    jtok_parsen(input, len, tkns, size);
+
+    start  = now();
+    status = jtok_parsen(input, len, tkns, size);
+    serial = now() - start;
+    printf("jtok_parsen:     %7.1f MB/s  (%s)\n", (double)len / 1e6 / serial,
+           jtok_jtokerr_messages(status));
+
+    config.pools = pools;
+    for (threads = 1; threads <= max_threads; threads *= 2)
+    {
+        /* The helper pools share one allocation as big as the result */
+        config.threads   = threads;
+        config.pool_size = (threads > 1) ? size / (threads - 1) : 0;
+        start            = now();
+        status           = jtok_parse_mt(input, len, tkns, size, &config);
+        elapsed          = now() - start;
+        printf("%2u threads:      %7.1f MB/s  %5.2fx  (%s)\n", threads,
+               (double)len / 1e6 / elapsed, serial / elapsed,
+               jtok_jtokerr_messages(status));
+    }
+    free(pools);
+    free(tkns);
+    free(input);
+    return 0;
+}
@@ -23,6 +23,39 @@ extern "C" {
 #define JTOK_MAX_RECURSE_DEPTH 25
 #endif /* #ifndef JTOK_MAX_RECURSE_DEPTH */
 
+/* Number of entries of stack scratch jtok_toktokcmp uses for hash tables of
+ * object keys, shared by all levels of nesting. An object with as many
+ * members as the scratch left falls back to an O(n^2) linear search: use
+ * jtok_toktokcmp_scratch for those */
+#ifndef JTOK_TOKCMP_SCRATCH_SIZE
+#define JTOK_TOKCMP_SCRATCH_SIZE 128
+#endif /* #ifndef JTOK_TOKCMP_SCRATCH_SIZE */
+
+/* Width in bits of token offsets and token pool indices: 16, 32 or 64.
+ * It caps the size of a document and of a token pool at JTOK_OFF_MAX.
+ * Offsets are signed so that -1 can mean "none", which halves the range:
+ * with 16 bits documents are limited to 32767 bytes, not 65535, and longer
+ * ones are rejected with JTOK_PARSE_STATUS_INVAL. 16 makes tokens smaller on
+ * small targets, 64 lets documents and pools grow past 2 GB. The library and
+ * everything using it must agree on the width, which the build passes on
+ * with the library's public definitions. */
+#ifndef JTOK_OFFSET_WIDTH
+#define JTOK_OFFSET_WIDTH 32
+#endif /* #ifndef JTOK_OFFSET_WIDTH */
+
+#if JTOK_OFFSET_WIDTH == 16
+typedef int16_t jtok_off_t;
+#define JTOK_OFF_MAX INT16_MAX
+#elif JTOK_OFFSET_WIDTH == 32
+typedef int32_t jtok_off_t;
+#define JTOK_OFF_MAX INT32_MAX
+#elif JTOK_OFFSET_WIDTH == 64
+typedef int64_t jtok_off_t;
+#define JTOK_OFF_MAX INT64_MAX
+#else
+#error "JTOK_OFFSET_WIDTH must be 16, 32 or 64"
+#endif /* #if JTOK_OFFSET_WIDTH == 16 */
+
 /**
  * JTOK type identifier. Basic types are:
  *  - Object
@@ -114,32 +147,80 @@ typedef enum
 
     JTOK_PARSE_STATUS_NEST_DEPTH_EXCEEDED,
 
+    /* a file could not be opened, read or mapped */
+    JTOK_PARSE_STATUS_IO_ERROR,
+
 } JTOK_PARSE_STATUS_t;
 
 
+typedef enum
+{
+    /* Output written successfully */
+    JTOK_WRITE_STATUS_OK,
+
+    /* Caller passed null parameter */
+    JTOK_WRITE_STATUS_NULL_PARAM,
+
+    /* Output (or internal path) buffer is too small */
+    JTOK_WRITE_STATUS_NOMEM,
+
+    /* The caller's write callback reported a failure */
+    JTOK_WRITE_STATUS_SINK_ERROR,
+
+    JTOK_WRITE_STATUS_NEST_DEPTH_EXCEEDED,
+
+    /* Malformed token tree, or output calls made out of order */
+    JTOK_WRITE_STATUS_INVAL,
+
+} JTOK_WRITE_STATUS_t;
+
+
+/**
+ * @brief Output callback used by everything that emits json text
+ *
+ * @param ctx caller context
+ * @param data bytes to write
+ * @param len number of bytes
+ * @return int 0 on success, nonzero to abort the output
+ */
+typedef int (*jtok_write_fn)(void *ctx, const char *data, size_t len);
+
+
 typedef struct jtok_tkn_struct jtok_tkn_t;
 struct jtok_tkn_struct
 {
-    int         start;   /* start position in JTOK data string */
-    int         end;     /* end position in JTOK data string */
-    int         size;    /* number of child tokens */
-    int         parent;  /* index of parent token in the token pool */
-    int         sibling; /* index of next token that shares the same parent */
+    jtok_off_t  start;   /* start position in JTOK data string */
+    jtok_off_t  end;     /* end position in JTOK data string */
+    jtok_off_t  size;    /* number of child tokens */
+    jtok_off_t  parent;  /* index of parent token in the token pool */
+    jtok_off_t  sibling; /* index of next token that shares the same parent */
+    JTOK_TYPE_t type;    /* type (object, array, string etc.) */
     char *      json;    /* json string into which the data structure inserts */
     jtok_tkn_t *pool;    /* Token pool */
-    JTOK_TYPE_t type;    /* type (object, array, string etc.) */
 };
 
+/* Replaces the source text of one token during jtok_serialize */
 typedef struct
 {
-    int          json_len; /* max length of json string   */
-    int          pos;      /* current parsing index in json string */
-    int          toknext;  /* index of next token to allocate */
-    int          toksuper; /* superior token node, e.g parent object or array */
-    int          last_child; /* index of last sibling parsed */
-    unsigned int pool_size;  /* pool size */
-    jtok_tkn_t * tkn_pool;   /* token pool */
-    char *       json;       /* ptr to start of json string */
+    const jtok_tkn_t *target; /* token whose text is replaced */
+    const char *      text;   /* replacement json value (strings quoted) */
+    size_t            len;    /* length of text */
+} jtok_splice_t;
+
+
+struct jtok_stitch;
+
+typedef struct
+{
+    jtok_off_t  json_len;   /* max length of json string   */
+    jtok_off_t  pos;        /* current parsing index in json string */
+    jtok_off_t  toknext;    /* index of next token to allocate */
+    jtok_off_t  toksuper;   /* superior token node, e.g parent object/array */
+    jtok_off_t  last_child; /* index of last sibling parsed */
+    jtok_off_t  pool_size;  /* pool size */
+    jtok_tkn_t *tkn_pool;   /* token pool */
+    char *      json;       /* ptr to start of json string */
+    struct jtok_stitch *stitch; /* elements parsed ahead of time, or NULL */
 } jtok_parser_t;
 
 
@@ -155,13 +236,31 @@ typedef struct
 JTOK_PARSE_STATUS_t jtok_parse(const char *json, jtok_tkn_t *tkns, size_t size);
 
 
+/**
+ * @brief Parse the first len bytes of a json string. The text does not need
+ * to be nul-terminated and nothing past len is read.
+ *
+ * @param json json text to parse
+ * @param len length of json in bytes
+ * @param tkns caller-provided pool of tokens
+ * @param size number of tokens in the token pool
+ * @return JTOK_PARSE_STATUS_t parse status. JTOK_PARSE_STATUS_OK == success
+ *
+ * @note The token after the last one parsed (if the pool has room) is set to
+ * JTOK_UNASSIGNED_TOKEN. The rest of the pool is left untouched, so one pool
+ * can be reused across many documents at no extra cost.
+ */
+JTOK_PARSE_STATUS_t jtok_parsen(const char *json, size_t len, jtok_tkn_t *tkns,
+                                size_t size);
+
+
 /**
  * @brief get the token length of a jtok_tkn_t;
  *
  * @param tok
- * @return uint32_t the length of the token
+ * @return size_t the length of the token
  */
-uint_least16_t jtok_toklen(const jtok_tkn_t *tok);
+size_t jtok_toklen(const jtok_tkn_t *tok);
 
 
 /**
@@ -184,7 +283,7 @@ bool jtok_tokcmp(const char *str, const jtok_tkn_t *tok);
  * @return true if equal within bytecount
  * @return false if not equal within bytecount
  */
-bool jtok_tokncmp(const char *str, const jtok_tkn_t *tok, uint_least16_t n);
+bool jtok_tokncmp(const char *str, const jtok_tkn_t *tok, size_t n);
 
 
 /**
@@ -195,7 +294,7 @@ bool jtok_tokncmp(const char *str, const jtok_tkn_t *tok, uint_least16_t n);
  * @param tkn jtok token to copy
  * @return char* NULL on error, otherwise, address of destination
  */
-char *jtok_tokcpy(char *dst, uint_least16_t bufsize, const jtok_tkn_t *tkn);
+char *jtok_tokcpy(char *dst, size_t bufsize, const jtok_tkn_t *tkn);
 
 
 /**
@@ -206,8 +305,69 @@ char *jtok_tokcpy(char *dst, uint_least16_t bufsize, const jtok_tkn_t *tkn);
  * @param tkn jtok token to copy
  * @return char* NULL on error, otherwise, address of destination
  */
-char *jtok_tokncpy(char *dst, uint_least16_t bufsize, const jtok_tkn_t *tkn,
-                   uint_least16_t n);
+char *jtok_tokncpy(char *dst, size_t bufsize, const jtok_tkn_t *tkn,
+                   size_t n);
+
+
+/**
+ * @brief Get the full source text of a token, including string quotes
+ *
+ * @param tkn the token
+ * @param len output location for the number of bytes in the span
+ * @return const char* start of the span, or NULL if the token has no text
+ */
+const char *jtok_tokspan(const jtok_tkn_t *tkn, size_t *len);
+
+
+/**
+ * @brief Serialize a token subtree by copying its original source text
+ *
+ * @param tkn root of the subtree to emit
+ * @param splices optional replacements for tokens inside the subtree
+ * @param count number of splices
+ * @param write output callback
+ * @param ctx context passed to write
+ * @return JTOK_WRITE_STATUS_t JTOK_WRITE_STATUS_OK on success
+ *
+ * @note Without splices the subtree is emitted with a single write of its
+ * [start, end) span. With splices, the text between replaced tokens is
+ * still copied in whole spans. A splice nested inside another spliced token
+ * is ignored. Output keeps the formatting (and quote style) of the source.
+ */
+JTOK_WRITE_STATUS_t jtok_serialize(const jtok_tkn_t *tkn,
+                                   const jtok_splice_t *splices, size_t count,
+                                   jtok_write_fn write, void *ctx);
+
+
+/**
+ * @brief Strip insignificant whitespace from json text in place
+ *
+ * @param buf the json text. Minified output is written back over it
+ * @param len number of bytes in buf. A nul byte before len ends the text
+ * @return size_t length of the minified text. buf is nul-terminated when
+ * the result is shorter than len
+ *
+ * @note Strings (double or single quoted, as accepted by jtok_parse) are
+ * copied unchanged, escapes included. Whitespace is anything isspace()
+ * accepts, as for jtok_parse. No validation is performed.
+ */
+size_t jtok_minify(char *buf, size_t len);
+
+
+/**
+ * @brief Minify json text in place while checking its structure
+ *
+ * @param buf the json text
+ * @param len in: bytes in buf, out: length of the minified text
+ * @return JTOK_PARSE_STATUS_t JTOK_PARSE_STATUS_OK if the text is a single
+ * object with terminated strings, valid escapes and matched brackets no
+ * deeper than jtok_parse allows. On error buf is left partially minified
+ * and len is unchanged.
+ *
+ * @note The grammar between brackets (keys, commas, colons, primitives) is
+ * still only checked by jtok_parse.
+ */
+JTOK_PARSE_STATUS_t jtok_minify_validate(char *buf, size_t *len);
 
 
 /**
@@ -262,10 +422,103 @@ int jtok_token_tostr(char *buf, unsigned int size, const char *json,
  * @return false if not equal.
  *
  * @note Tokens with different types are never equal
+ *
+ * @note Objects and arrays are first compared by jtok_hash, so most unequal
+ * documents are rejected in linear time. Equal documents are then walked
+ * member by member, finding keys through a hash table in
+ * JTOK_TOKCMP_SCRATCH_SIZE entries of stack scratch. Only an object with at
+ * least as many members as the scratch left (127 at the top level by
+ * default) is matched by linear search, in O(n^2), as a last resort; pass
+ * enough scratch to jtok_toktokcmp_scratch to avoid that.
+ *
+ * @note Duplicate keys are significant: objects are equal when their
+ * members pair up one to one. Members with the same key pair up by the hash
+ * of their values, so {"a":1,"a":2} equals {"a":2,"a":1} but neither
+ * {"a":1} nor {"a":1,"a":1}, whichever token is passed first.
  */
 bool jtok_toktokcmp(const jtok_tkn_t *tkn1, const jtok_tkn_t *tkn2);
 
 
+/**
+ * @brief Compare two jtok tokens for equality using caller-provided scratch
+ *
+ * @param tkn1 first token
+ * @param tkn2 second token
+ * @param scratch scratch used to sort object keys. May be NULL.
+ * @param scratch_len number of entries in scratch
+ * @return true if tokens are equal
+ * @return false if not equal.
+ *
+ * @note Comparing objects with n members in O(n) takes 2n entries of
+ * scratch per level of nesting (at least n + 1). Use this instead of
+ * jtok_toktokcmp when comparing objects with more members than
+ * JTOK_TOKCMP_SCRATCH_SIZE.
+ */
+bool jtok_toktokcmp_scratch(const jtok_tkn_t *tkn1, const jtok_tkn_t *tkn2,
+                            jtok_off_t *scratch, size_t scratch_len);
+
+
+/**
+ * @brief Compute a 64-bit structural hash of a token and all of its children
+ *
+ * @param tkn the root of the subtree to hash
+ * @return uint64_t the hash. 0 if tkn is NULL or the subtree is malformed.
+ *
+ * @note Hashes follow the equality rules of jtok_toktokcmp: subtrees that
+ * compare equal always hash equal (object member order is ignored and
+ * numbers are hashed by value, so 1.0 and 1e0 hash the same). Different
+ * hashes therefore prove inequality without calling jtok_toktokcmp.
+ */
+uint64_t jtok_hash(const jtok_tkn_t *tkn);
+
+
+/**
+ * @brief Stream an RFC 6902 JSON Patch that turns one document into another
+ *
+ * @param from the original token (usually the root of a parsed pool)
+ * @param to the modified token
+ * @param scratch token indices used to sort object keys so members are
+ * matched in O(n log n). May be NULL, in which case keys are matched
+ * linearly.
+ * @param scratch_len number of entries in scratch
+ * @param write output callback. The patch is emitted as a json array.
+ * @param ctx context passed to write
+ * @return JTOK_WRITE_STATUS_t JTOK_WRITE_STATUS_OK on success,
+ * JTOK_WRITE_STATUS_INVAL if a key on a changed path has a malformed escape
+ * or utf-8
+ *
+ * @note Subtrees whose source text is byte-identical are skipped without
+ * being walked. Values in add/replace operations are copied verbatim from
+ * the source text of the "to" document. Keys in paths are decoded before
+ * '~' and '/' are escaped, so "\/" and "\u002f" both become "~1".
+ */
+JTOK_WRITE_STATUS_t jtok_diff(const jtok_tkn_t *from, const jtok_tkn_t *to,
+                              jtok_off_t *scratch, size_t scratch_len,
+                              jtok_write_fn write, void *ctx);
+
+
+/**
+ * @brief Stream the RFC 8785 (JCS) canonical form of a token subtree
+ *
+ * @param tkn the token (usually the root of a parsed pool)
+ * @param scratch token indices used to sort object keys in O(n log n). May
+ * be NULL, in which case each object's keys are selected in order in O(n^2).
+ * @param scratch_len number of entries in scratch
+ * @param write output callback
+ * @param ctx context passed to write
+ * @return JTOK_WRITE_STATUS_t JTOK_WRITE_STATUS_OK on success,
+ * JTOK_WRITE_STATUS_INVAL for duplicate keys, malformed escapes or utf-8,
+ * and numbers outside the range of a double
+ *
+ * @note Members are ordered by the UTF-16 code units of their unescaped
+ * keys, numbers use ECMAScript formatting and strings are re-escaped
+ * minimally. Output may be emitted before an error is detected.
+ */
+JTOK_WRITE_STATUS_t jtok_canonical(const jtok_tkn_t *tkn, jtok_off_t *scratch,
+                                   size_t scratch_len, jtok_write_fn write,
+                                   void *ctx);
+
+
 /**
  * @brief check if a json object has a given key
  *
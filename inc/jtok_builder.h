@@ -0,0 +1,168 @@
+#ifndef JTOK_BUILDER_H_
+#define JTOK_BUILDER_H_
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "jtok.h"
+#include "jtok_writer.h"
+
+/*
+ * Builds a document in code. Every call appends both the json text (into a
+ * caller-provided text arena) and the matching token (into a caller-provided
+ * pool), linked exactly as jtok_parse would link them. The finished pool can
+ * be used with every jtok_* function and the text is ready to send as-is.
+ */
+typedef struct
+{
+    jtok_tkn_t *        pool;      /* caller-provided token pool */
+    size_t              pool_size; /* capacity of pool */
+    jtok_off_t          count;     /* tokens appended so far */
+    jtok_off_t          super;     /* open container or key awaiting a value */
+    jtok_off_t          last_child[JTOK_WRITER_MAX_DEPTH]; /* per container */
+    jtok_writer_t       writer;    /* appends to the text arena */
+    JTOK_WRITE_STATUS_t status;    /* first error encountered (sticky) */
+} jtok_builder_t;
+
+
+/**
+ * @brief Initialize a document builder
+ *
+ * @param builder the builder
+ * @param pool caller-provided token pool
+ * @param pool_size number of tokens in pool
+ * @param text caller-provided text arena (one byte is kept for a nul)
+ * @param text_size size of text
+ */
+void jtok_builder_init(jtok_builder_t *builder, jtok_tkn_t *pool,
+                       size_t pool_size, char *text, size_t text_size);
+
+
+/**
+ * @brief Open an object. The first call must open the root object.
+ *
+ * @param builder the builder
+ * @return JTOK_WRITE_STATUS_t builder status
+ */
+JTOK_WRITE_STATUS_t jtok_builder_begin_object(jtok_builder_t *builder);
+
+
+/**
+ * @brief Close the current object
+ *
+ * @param builder the builder
+ * @return JTOK_WRITE_STATUS_t builder status
+ */
+JTOK_WRITE_STATUS_t jtok_builder_end_object(jtok_builder_t *builder);
+
+
+/**
+ * @brief Open an array
+ *
+ * @param builder the builder
+ * @return JTOK_WRITE_STATUS_t builder status
+ */
+JTOK_WRITE_STATUS_t jtok_builder_begin_array(jtok_builder_t *builder);
+
+
+/**
+ * @brief Close the current array
+ *
+ * @param builder the builder
+ * @return JTOK_WRITE_STATUS_t builder status
+ */
+JTOK_WRITE_STATUS_t jtok_builder_end_array(jtok_builder_t *builder);
+
+
+/**
+ * @brief Append an object key. Must be followed by exactly one value.
+ *
+ * @param builder the builder
+ * @param key unescaped key bytes
+ * @param len length of key
+ * @return JTOK_WRITE_STATUS_t builder status
+ */
+JTOK_WRITE_STATUS_t jtok_builder_key(jtok_builder_t *builder, const char *key,
+                                     size_t len);
+
+
+/**
+ * @brief Append a string value
+ *
+ * @param builder the builder
+ * @param str unescaped string bytes
+ * @param len length of str
+ * @return JTOK_WRITE_STATUS_t builder status
+ */
+JTOK_WRITE_STATUS_t jtok_builder_string(jtok_builder_t *builder,
+                                        const char *str, size_t len);
+
+
+/**
+ * @brief Append a signed integer value
+ *
+ * @param builder the builder
+ * @param value the value
+ * @return JTOK_WRITE_STATUS_t builder status
+ */
+JTOK_WRITE_STATUS_t jtok_builder_int(jtok_builder_t *builder, int64_t value);
+
+
+/**
+ * @brief Append an unsigned integer value
+ *
+ * @param builder the builder
+ * @param value the value
+ * @return JTOK_WRITE_STATUS_t builder status
+ */
+JTOK_WRITE_STATUS_t jtok_builder_uint(jtok_builder_t *builder, uint64_t value);
+
+
+/**
+ * @brief Append a floating point value (see jtok_writer_double)
+ *
+ * @param builder the builder
+ * @param value the value
+ * @return JTOK_WRITE_STATUS_t builder status
+ */
+JTOK_WRITE_STATUS_t jtok_builder_double(jtok_builder_t *builder, double value);
+
+
+/**
+ * @brief Append true or false
+ *
+ * @param builder the builder
+ * @param value the value
+ * @return JTOK_WRITE_STATUS_t builder status
+ */
+JTOK_WRITE_STATUS_t jtok_builder_bool(jtok_builder_t *builder, bool value);
+
+
+/**
+ * @brief Append null
+ *
+ * @param builder the builder
+ * @return JTOK_WRITE_STATUS_t builder status
+ */
+JTOK_WRITE_STATUS_t jtok_builder_null(jtok_builder_t *builder);
+
+
+/**
+ * @brief Finish the document and nul-terminate the text
+ *
+ * @param builder the builder
+ * @return JTOK_WRITE_STATUS_t JTOK_WRITE_STATUS_OK if a complete document
+ * was built. builder->pool[0] is then its root and builder->writer.len the
+ * length of its text.
+ */
+JTOK_WRITE_STATUS_t jtok_builder_finish(jtok_builder_t *builder);
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* JTOK_BUILDER_H_ */
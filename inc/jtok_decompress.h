@@ -0,0 +1,103 @@
+#ifndef JTOK_DECOMPRESS_H_
+#define JTOK_DECOMPRESS_H_
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "jtok.h"
+#include "jtok_events.h"
+
+/*
+ * Event parsing of compressed json. The compressed stream is read in
+ * pieces into a caller-provided input buffer and decompressed straight into
+ * a caller-provided window, which the event parser consumes as it fills.
+ * Only the value the parser is in the middle of is kept when the window is
+ * refilled, so memory use is the two buffers and the decoder state, however
+ * large the decompressed document. Each stretch of decompressed text is
+ * parsed while it is still in cache.
+ *
+ * gzip (and zlib) streams need the library built with JTOK_HAVE_ZLIB, zstd
+ * streams with JTOK_HAVE_ZSTD. Both are optional; plain json is always
+ * accepted. The decoder libraries allocate their own state, and a zstd
+ * frame may ask for a history of up to 128 MB.
+ */
+
+/* Smallest input buffer: enough to tell the codecs apart */
+#define JTOK_DECOMPRESS_MIN_IN 4
+
+typedef enum
+{
+    JTOK_CODEC_AUTO, /* gzip, zstd or plain json, from the first bytes */
+    JTOK_CODEC_NONE, /* plain json */
+    JTOK_CODEC_GZIP, /* gzip or zlib, concatenated members allowed */
+    JTOK_CODEC_ZSTD, /* zstd, concatenated frames allowed */
+} JTOK_CODEC_t;
+
+typedef struct
+{
+    JTOK_CODEC_t codec;
+    char *       in;          /* compressed bytes as read */
+    size_t       in_len;      /* size of in, JTOK_DECOMPRESS_MIN_IN or more */
+    char *       window;      /* decompressed bytes being parsed. Must hold
+                                 the longest key or scalar: a longer one is
+                                 reported as JTOK_PARSE_STATUS_NOMEM. */
+    size_t       window_len;  /* size of window */
+    char *       scratch;     /* for decoding escaped strings, or NULL */
+    size_t       scratch_len; /* size of scratch */
+} jtok_decompress_config_t;
+
+
+/**
+ * @brief Read more of the compressed stream
+ *
+ * @param ctx context passed to jtok_decompress_events
+ * @param buf where to put the data
+ * @param len most bytes to read
+ * @return size_t bytes read, 0 at the end of the stream
+ */
+typedef size_t (*jtok_decompress_read_fn)(void *ctx, char *buf, size_t len);
+
+
+/**
+ * @brief Check whether a codec was built into the library
+ *
+ * @param codec the codec
+ * @return true if streams in it can be parsed
+ */
+bool jtok_codec_available(JTOK_CODEC_t codec);
+
+
+/**
+ * @brief Decompress a stream and parse it, calling fn for every event
+ *
+ * @param config codec and buffers
+ * @param read reads the compressed stream
+ * @param read_ctx context passed to read
+ * @param fn called for every event up to and including JTOK_EVENT_END. The
+ * event's text points into the window and event offsets are offsets in the
+ * decompressed stream.
+ * @param ctx context passed to fn
+ * @return JTOK_PARSE_STATUS_t JTOK_PARSE_STATUS_OK once the document is
+ * complete or fn stopped the parse, the parse error, JTOK_PARSE_STATUS_NOMEM
+ * if a value does not fit in the window, JTOK_PARSE_STATUS_IO_ERROR if the
+ * compressed stream is corrupt or cut short, JTOK_PARSE_STATUS_NULL_PARAM,
+ * or JTOK_PARSE_STATUS_INVAL for buffers that are too small or a codec
+ * that was not built in (with JTOK_CODEC_AUTO, one that the stream turns
+ * out to need).
+ *
+ * @note Decompression stops as soon as the root object is complete; the
+ * rest of the stream is not read.
+ */
+JTOK_PARSE_STATUS_t jtok_decompress_events(
+    const jtok_decompress_config_t *config, jtok_decompress_read_fn read,
+    void *read_ctx, jtok_event_fn fn, void *ctx);
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* JTOK_DECOMPRESS_H_ */
@@ -0,0 +1,175 @@
+#ifndef JTOK_EVENTS_H_
+#define JTOK_EVENTS_H_
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "jtok.h"
+
+/*
+ * Event (SAX-style) parsing. Instead of filling a token pool, the parser
+ * reports each value as it passes: the start and end of every object and
+ * array, every key and every scalar, with its byte span and decoded value.
+ * Memory use is the parser struct alone, whatever the size of the document.
+ *
+ * The parser is a pull parser that can be fed a stream in pieces. When
+ * jtok_events_next runs out of input it returns
+ * JTOK_PARSE_STATUS_PARTIAL_TOKEN without consuming the value it was in the
+ * middle of; pass it the stream again from jtok_events_offset onwards, with
+ * more bytes appended, and carry on. jtok_events_parse wraps this for a
+ * document that is already in memory.
+ *
+ * The grammar is the one jtok_parse accepts: the root must be an object,
+ * strings may use single or double quotes, keys may not be empty, numbers
+ * may have a leading '+', an array may not mix primitives with other
+ * values, and nesting is limited to JTOK_MAX_RECURSE_DEPTH. Primitives are
+ * checked by the same scanner jtok_parse uses, so a lone sign is accepted as
+ * a NUMBER (with a NaN value). Whitespace inside the root object is space,
+ * tab, CR and LF only; around it, anything isspace accepts. Errors report
+ * the status jtok_parse would, with two exceptions, both of which
+ * jtok_parse lets through and events rejects: a trailing comma before '}'
+ * (JTOK_PARSE_STATUS_COMMA_NO_KEY), and a stray character inside an array
+ * (JTOK_PARSE_STATUS_INVAL).
+ */
+
+typedef enum
+{
+    JTOK_EVENT_NONE,
+    JTOK_EVENT_OBJECT_START,
+    JTOK_EVENT_OBJECT_END,
+    JTOK_EVENT_ARRAY_START,
+    JTOK_EVENT_ARRAY_END,
+    JTOK_EVENT_KEY,
+    JTOK_EVENT_STRING,
+    JTOK_EVENT_NUMBER,
+    JTOK_EVENT_TRUE,
+    JTOK_EVENT_FALSE,
+    JTOK_EVENT_NULL,
+    JTOK_EVENT_END, /* the root object is complete */
+} JTOK_EVENT_t;
+
+typedef struct
+{
+    JTOK_EVENT_t type;
+    int          depth; /* containers around the value (0 for the root) */
+    size_t       start; /* stream offset of the value. Strings exclude their
+                           quotes, as tokens do. */
+    size_t       end;   /* stream offset one past the value. For OBJECT_END
+                           and ARRAY_END the span is the whole container. */
+    const char * text;  /* the span in the current input, or NULL if it
+                           starts before the current input */
+    const char * value; /* KEY and STRING: text with escapes decoded, or NULL
+                           if that did not fit in the scratch buffer */
+    size_t       value_len; /* length of value */
+    double       number;    /* NUMBER: the decoded value, or NaN if it is
+                               too long to decode or a lone sign */
+} jtok_event_t;
+
+/* One open object or array (internal) */
+typedef struct
+{
+    size_t  start;     /* stream offset of the opening bracket */
+    uint8_t type;      /* JTOK_OBJECT or JTOK_ARRAY */
+    uint8_t expecting; /* what may come next */
+    uint8_t elements;  /* kind of the array's elements so far */
+} jtok_events_frame_t;
+
+typedef struct
+{
+    const char *        data;        /* current input */
+    size_t              len;         /* length of data */
+    size_t              base;        /* stream offset of data[0] */
+    size_t              pos;         /* stream offset of the next byte */
+    bool                last;        /* nothing follows data */
+    int                 depth;       /* open containers */
+    bool                done;        /* the root object is complete */
+    JTOK_PARSE_STATUS_t status;      /* first error, kept */
+    char *              scratch;     /* where escaped strings are decoded */
+    size_t              scratch_len; /* size of scratch */
+    jtok_events_frame_t frames[JTOK_MAX_RECURSE_DEPTH + 1];
+} jtok_events_t;
+
+
+/**
+ * @brief Called for every event by jtok_events_parse
+ *
+ * @param ctx caller context
+ * @param ev the event. Its text and value are only valid during the call.
+ * @return int 0 to continue, anything else to stop parsing
+ */
+typedef int (*jtok_event_fn)(void *ctx, const jtok_event_t *ev);
+
+
+/**
+ * @brief Set up an event parser at the start of a stream
+ *
+ * @param parser the parser
+ * @param scratch caller-provided buffer for decoding strings that contain
+ * escapes, or NULL. Strings without escapes are never copied.
+ * @param scratch_len size of scratch
+ */
+void jtok_events_init(jtok_events_t *parser, char *scratch, size_t scratch_len);
+
+
+/**
+ * @brief Give the parser (more of) the stream
+ *
+ * @param parser the parser
+ * @param data the stream from offset jtok_events_offset(parser) onwards.
+ * Must stay valid until the next call to jtok_events_input.
+ * @param len length of data
+ * @param last true if the stream ends after data
+ * @return JTOK_PARSE_STATUS_t JTOK_PARSE_STATUS_OK or
+ * JTOK_PARSE_STATUS_NULL_PARAM
+ */
+JTOK_PARSE_STATUS_t jtok_events_input(jtok_events_t *parser, const char *data,
+                                      size_t len, bool last);
+
+
+/**
+ * @brief Stream offset of the first byte the parser still needs
+ *
+ * @param parser the parser
+ * @return size_t the offset. Bytes before it may be discarded.
+ */
+size_t jtok_events_offset(const jtok_events_t *parser);
+
+
+/**
+ * @brief Get the next event
+ *
+ * @param parser the parser
+ * @param ev where the event is stored
+ * @return JTOK_PARSE_STATUS_t JTOK_PARSE_STATUS_OK with an event (the last
+ * being JTOK_EVENT_END), JTOK_PARSE_STATUS_PARTIAL_TOKEN if more input is
+ * needed, or the parse error. An error, or running out of input after
+ * last, is returned again by every later call.
+ */
+JTOK_PARSE_STATUS_t jtok_events_next(jtok_events_t *parser, jtok_event_t *ev);
+
+
+/**
+ * @brief Parse a document in memory, calling fn for every event
+ *
+ * @param json the document. Does not need to be nul-terminated.
+ * @param len length of json
+ * @param fn called for every event up to and including JTOK_EVENT_END
+ * @param ctx context passed to fn
+ * @param scratch buffer for decoding escaped strings, or NULL
+ * @param scratch_len size of scratch
+ * @return JTOK_PARSE_STATUS_t parse status. JTOK_PARSE_STATUS_OK if the
+ * document is complete or fn stopped the parse.
+ */
+JTOK_PARSE_STATUS_t jtok_events_parse(const char *json, size_t len,
+                                      jtok_event_fn fn, void *ctx,
+                                      char *scratch, size_t scratch_len);
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* JTOK_EVENTS_H_ */
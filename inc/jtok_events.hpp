@@ -0,0 +1,286 @@
+#ifndef JTOK_EVENTS_HPP_
+#define JTOK_EVENTS_HPP_
+
+#include "jtok_events.h"
+
+/*
+ * C++20 coroutine front end for event parsing. jtok::events() returns an
+ * asynchronous generator that pulls a document from a stream and yields
+ * its jtok_events_next events one at a time:
+ *
+ *     jtok::event_stream events = jtok::events(stream, buffer);
+ *     while (const jtok_event_t *ev = co_await events.next())
+ *     {
+ *         ...
+ *     }
+ *     if (events.status() != JTOK_PARSE_STATUS_OK) ...
+ *
+ * The stream is anything with a read(std::span<char>) member returning an
+ * awaitable that produces the number of bytes read (0 at the end of the
+ * stream). When the parser needs more bytes the generator co_awaits that
+ * read, so it is suspended, not blocked, until the stream resumes it.
+ *
+ * Only the bytes of the value being parsed are kept, in the caller's
+ * buffer, which must hold the longest string or number in the document.
+ * The generator's coroutine frame is the only allocation, made once per
+ * document from the given memory resource.
+ *
+ * Needs a compiler with C++20 coroutines; otherwise this header is empty.
+ */
+
+#if defined(__cpp_impl_coroutine) && __cpp_impl_coroutine >= 201902L
+
+#include <coroutine>
+#include <cstddef>
+#include <cstring>
+#include <exception>
+#include <memory_resource>
+#include <span>
+#include <utility>
+
+namespace jtok
+{
+
+template <typename Stream>
+concept byte_stream = requires(Stream &stream, std::span<char> buf)
+{
+    stream.read(buf);
+};
+
+
+class event_stream
+{
+  public:
+    struct promise_type
+    {
+        const jtok_event_t *    current = nullptr;
+        JTOK_PARSE_STATUS_t     status  = JTOK_PARSE_STATUS_OK;
+        std::coroutine_handle<> consumer;
+
+        /* Hands control back to whoever is waiting in next() */
+        struct to_consumer
+        {
+            bool await_ready() const noexcept
+            {
+                return false;
+            }
+            std::coroutine_handle<>
+            await_suspend(std::coroutine_handle<promise_type> self) noexcept
+            {
+                return self.promise().consumer;
+            }
+            void await_resume() const noexcept
+            {
+            }
+        };
+
+        event_stream get_return_object() noexcept
+        {
+            return event_stream(
+                std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+        std::suspend_always initial_suspend() const noexcept
+        {
+            return {};
+        }
+        to_consumer final_suspend() const noexcept
+        {
+            return {};
+        }
+        to_consumer yield_value(const jtok_event_t &ev) noexcept
+        {
+            current = &ev;
+            return {};
+        }
+        void return_value(JTOK_PARSE_STATUS_t result) noexcept
+        {
+            current = nullptr;
+            status  = result;
+        }
+        void unhandled_exception() const noexcept
+        {
+            std::terminate();
+        }
+
+        /* The frame comes from the memory resource passed to events(), which
+         * is remembered just past the frame so that delete can find it */
+        template <typename Stream>
+        static void *operator new(std::size_t size, Stream &, std::span<char>,
+                                  std::span<char>,
+                                  std::pmr::memory_resource *resource)
+        {
+            void *frame = resource->allocate(size + sizeof(resource),
+                                             alignof(std::max_align_t));
+            std::memcpy(static_cast<char *>(frame) + size, &resource,
+                        sizeof(resource));
+            return frame;
+        }
+        static void operator delete(void *frame, std::size_t size)
+        {
+            std::pmr::memory_resource *resource;
+            std::memcpy(&resource, static_cast<char *>(frame) + size,
+                        sizeof(resource));
+            resource->deallocate(frame, size + sizeof(resource),
+                                 alignof(std::max_align_t));
+        }
+    };
+
+    /* Resumes the parser until its next event */
+    struct next_event
+    {
+        std::coroutine_handle<promise_type> parser;
+
+        bool await_ready() const noexcept
+        {
+            return !parser || parser.done();
+        }
+        std::coroutine_handle<>
+        await_suspend(std::coroutine_handle<> consumer) noexcept
+        {
+            parser.promise().consumer = consumer;
+            return parser;
+        }
+        const jtok_event_t *await_resume() const noexcept
+        {
+            return (parser && !parser.done()) ? parser.promise().current
+                                              : nullptr;
+        }
+    };
+
+    event_stream(event_stream &&other) noexcept
+        : handle(std::exchange(other.handle, nullptr))
+    {
+    }
+    event_stream &operator=(event_stream &&other) noexcept
+    {
+        if (this != &other)
+        {
+            if (handle)
+            {
+                handle.destroy();
+            }
+            handle = std::exchange(other.handle, nullptr);
+        }
+        return *this;
+    }
+    event_stream(const event_stream &) = delete;
+    event_stream &operator=(const event_stream &) = delete;
+    ~event_stream()
+    {
+        if (handle)
+        {
+            handle.destroy();
+        }
+    }
+
+    /**
+     * @brief co_await the next event
+     *
+     * @return the event, valid until the next call, or nullptr once the
+     * document is complete or has failed to parse
+     */
+    next_event next() noexcept
+    {
+        return next_event{handle};
+    }
+
+    /**
+     * @brief Result of the parse once next() has returned nullptr
+     *
+     * @return JTOK_PARSE_STATUS_OK if the whole document was read,
+     * JTOK_PARSE_STATUS_NOMEM if a value did not fit in the buffer, or the
+     * parse error
+     */
+    JTOK_PARSE_STATUS_t status() const noexcept
+    {
+        return handle ? handle.promise().status
+                      : JTOK_PARSE_STATUS_NULL_PARAM;
+    }
+
+  private:
+    explicit event_stream(std::coroutine_handle<promise_type> h) noexcept
+        : handle(h)
+    {
+    }
+
+    std::coroutine_handle<promise_type> handle;
+};
+
+
+/* GCC pairs the frame's placement operator new with the usual operator
+ * delete the coroutine is required to use, and warns that they mismatch */
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+/**
+ * @brief Parse a document from an asynchronous stream as a lazy sequence of
+ * events
+ *
+ * @param stream the stream (see byte_stream). Must outlive the generator.
+ * @param buffer holds the unparsed part of the stream. Must outlive the
+ * generator.
+ * @param scratch where escaped strings are decoded, or empty
+ * @param resource where the coroutine frame is allocated
+ * @return event_stream the generator. Nothing is read until the first
+ * next().
+ */
+template <byte_stream Stream>
+event_stream
+events(Stream &stream, std::span<char> buffer, std::span<char> scratch = {},
+       [[maybe_unused]] std::pmr::memory_resource *resource =
+           std::pmr::get_default_resource())
+{
+    jtok_events_t       parser;
+    jtok_event_t        ev;
+    JTOK_PARSE_STATUS_t status;
+    std::size_t         held = 0; /* bytes in buffer */
+    std::size_t         base = 0; /* stream offset of buffer[0] */
+    std::size_t         used;
+    std::size_t         got;
+    bool                last = false;
+
+    jtok_events_init(&parser, scratch.data(), scratch.size());
+    jtok_events_input(&parser, buffer.data(), 0, false);
+    for (;;)
+    {
+        status = jtok_events_next(&parser, &ev);
+        if (status == JTOK_PARSE_STATUS_OK)
+        {
+            if (ev.type == JTOK_EVENT_END)
+            {
+                co_return status;
+            }
+            co_yield ev;
+        }
+        else if (status == JTOK_PARSE_STATUS_PARTIAL_TOKEN && !last)
+        {
+            /* Keep only what the parser still needs, then wait for more */
+            used = jtok_events_offset(&parser) - base;
+            std::memmove(buffer.data(), buffer.data() + used, held - used);
+            held -= used;
+            base += used;
+            if (held == buffer.size())
+            {
+                co_return JTOK_PARSE_STATUS_NOMEM;
+            }
+
+            got  = co_await stream.read(buffer.subspan(held));
+            last = (got == 0);
+            held += got;
+            jtok_events_input(&parser, buffer.data(), held, last);
+        }
+        else
+        {
+            co_return status;
+        }
+    }
+}
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+} /* namespace jtok */
+
+#endif /* __cpp_impl_coroutine */
+#endif /* JTOK_EVENTS_HPP_ */
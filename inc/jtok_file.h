@@ -0,0 +1,65 @@
+#ifndef JTOK_FILE_H_
+#define JTOK_FILE_H_
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "jtok.h"
+
+/*
+ * Parsing a file in place. jtok_parse_file maps the file read-only and
+ * parses the mapping directly, so the document is never copied and never
+ * needs a nul terminator. Tokens point into the mapping, which stays valid
+ * until jtok_file_close.
+ *
+ * The kernel is told to read ahead aggressively while the parse walks the
+ * file front to back, then to go back to its normal policy for the random
+ * accesses that follow.
+ */
+
+#define JTOK_FILE_HUGEPAGES (1u << 0) /* back the mapping with huge pages
+                                         where the kernel can */
+
+typedef struct
+{
+    const char *json;    /* the document */
+    size_t      len;     /* length of json */
+    void *      map;     /* the mapping (NULL for an empty file) */
+    size_t      map_len; /* length of map */
+} jtok_file_t;
+
+
+/**
+ * @brief Memory-map a file and parse it
+ *
+ * @param file the file handle
+ * @param path path of the json file
+ * @param tkns token pool
+ * @param size number of tokens in the pool
+ * @param flags JTOK_FILE_* flags, or 0
+ * @return JTOK_PARSE_STATUS_t the parse status, or JTOK_PARSE_STATUS_IO_ERROR
+ * if the file cannot be mapped (always, when built without JTOK_HAVE_POSIX).
+ * Unless JTOK_PARSE_STATUS_OK is returned the file is already closed.
+ */
+JTOK_PARSE_STATUS_t jtok_parse_file(jtok_file_t *file, const char *path,
+                                    jtok_tkn_t *tkns, size_t size,
+                                    unsigned int flags);
+
+
+/**
+ * @brief Release a file parsed with jtok_parse_file. Its tokens can no
+ * longer be used.
+ *
+ * @param file the file handle
+ */
+void jtok_file_close(jtok_file_t *file);
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* JTOK_FILE_H_ */
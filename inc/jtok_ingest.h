@@ -0,0 +1,92 @@
+#ifndef JTOK_INGEST_H_
+#define JTOK_INGEST_H_
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "jtok.h"
+#include "jtok_lines.h"
+
+/*
+ * Bulk ingestion of newline-delimited json files. The files are read in
+ * chunks into a set of caller-provided buffers, with several reads in
+ * flight at once, and every chunk is handed to jtok_parse_lines as soon as
+ * it and the chunks before it have arrived. Disk reads of later chunks
+ * overlap with parsing of earlier ones.
+ *
+ * On Linux the reads go through io_uring, with the buffers registered with
+ * the kernel when it allows. Where io_uring is missing or refused (old
+ * kernels, seccomp filters) the same chunks are read with pread instead.
+ *
+ * A line that spans two chunks is gathered in a caller-provided carry
+ * buffer. Every other line is parsed in place in the chunk buffers.
+ */
+
+/* Most reads in flight */
+#ifndef JTOK_INGEST_MAX_DEPTH
+#define JTOK_INGEST_MAX_DEPTH 64
+#endif /* #ifndef JTOK_INGEST_MAX_DEPTH */
+
+#define JTOK_INGEST_NO_URING (1u << 0) /* always read with pread */
+
+typedef struct
+{
+    unsigned    depth;     /* reads in flight, 1 to JTOK_INGEST_MAX_DEPTH */
+    size_t      chunk_len; /* bytes per read */
+    char *      buffers;   /* depth * chunk_len bytes */
+    char *      carry;     /* holds a line that spans two chunks */
+    size_t      carry_len; /* size of carry: longer lines that span chunks
+                              are reported as JTOK_PARSE_STATUS_NOMEM */
+    jtok_tkn_t *tkns;      /* token pool, reused for every document */
+    size_t      size;      /* number of tokens in tkns */
+    unsigned    flags;     /* JTOK_INGEST_* */
+} jtok_ingest_config_t;
+
+
+/**
+ * @brief Called for every parsed document, in file and line order
+ *
+ * @param ctx context passed to jtok_ingest_files
+ * @param file index of the file in paths
+ * @param line where the document is in the file and how it parsed. The
+ * index and line count from 0 in each file; offset is the file offset.
+ * @param tkns the token pool. Only valid until the callback returns, and
+ * only meaningful if line->status is JTOK_PARSE_STATUS_OK.
+ * @return int 0 to continue, anything else to stop after this document
+ */
+typedef int (*jtok_ingest_fn)(void *ctx, size_t file, const jtok_line_t *line,
+                              jtok_tkn_t *tkns);
+
+
+/**
+ * @brief Read and parse every line of a list of NDJSON files
+ *
+ * @param paths the files, parsed one after the other
+ * @param count number of paths
+ * @param config buffers and read settings
+ * @param fn called once per document
+ * @param ctx context passed to fn
+ * @return JTOK_PARSE_STATUS_t JTOK_PARSE_STATUS_OK once every file was read
+ * or fn stopped early, JTOK_PARSE_STATUS_IO_ERROR if a file could not be
+ * opened or read (every document before it has been delivered),
+ * JTOK_PARSE_STATUS_NULL_PARAM or JTOK_PARSE_STATUS_INVAL for a bad
+ * configuration.
+ *
+ * @note As with jtok_parse_lines, a document that fails to parse does not
+ * stop the batch.
+ *
+ * @note Built without JTOK_HAVE_POSIX, returns JTOK_PARSE_STATUS_IO_ERROR.
+ */
+JTOK_PARSE_STATUS_t jtok_ingest_files(const char *const *paths, size_t count,
+                                      const jtok_ingest_config_t *config,
+                                      jtok_ingest_fn fn, void *ctx);
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* JTOK_INGEST_H_ */
@@ -0,0 +1,82 @@
+#ifndef JTOK_IOV_H_
+#define JTOK_IOV_H_
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "jtok.h"
+
+/*
+ * Scatter-gather parsing. jtok_parse_iov parses a document that arrives as
+ * a list of segments (network buffers, pages of a log, ...) without first
+ * gathering it into one buffer.
+ *
+ * A token records where its text is through its json pointer: the base of
+ * the segment that holds it, with start and end relative to that segment.
+ * Only a key or scalar that straddles a boundary is copied, in steps that
+ * double in size, into a caller-provided stitch buffer, and points there
+ * instead. A primitive that merely ends on a boundary is not copied.
+ * An object or array that straddles a boundary has no single span: its
+ * json is NULL and its start and end are offsets in the whole stream.
+ * jtok_iov_locate maps any token back to a segment and offset.
+ *
+ * The grammar is the one jtok_events accepts.
+ */
+
+#ifndef JTOK_IOV_STITCH_STEP
+#define JTOK_IOV_STITCH_STEP 64 /* first bytes copied past a boundary */
+#endif /* #ifndef JTOK_IOV_STITCH_STEP */
+
+/* One segment. Laid out like a POSIX struct iovec. */
+typedef struct
+{
+    const void *base; /* first byte of the segment */
+    size_t      len;  /* bytes in the segment. May be 0. */
+} jtok_iov_t;
+
+
+/**
+ * @brief Parse a document split across segments
+ *
+ * @param iov the segments, in stream order. They must stay valid for as
+ * long as the tokens are used.
+ * @param count number of segments
+ * @param tkns caller-provided pool of tokens
+ * @param size number of tokens in the token pool
+ * @param stitch caller-provided buffer for tokens that straddle a boundary,
+ * or NULL if no token may. It must also stay valid while tokens are used.
+ * @param stitch_len size of stitch
+ * @return JTOK_PARSE_STATUS_t parse status. JTOK_PARSE_STATUS_NOMEM if the
+ * pool or the stitch buffer is too small, JTOK_PARSE_STATUS_INVAL if the
+ * stream is longer than a token can index.
+ *
+ * @note As with jtok_parsen, the token after the last one parsed (if the
+ * pool has room) is set to JTOK_UNASSIGNED_TOKEN.
+ */
+JTOK_PARSE_STATUS_t jtok_parse_iov(const jtok_iov_t *iov, size_t count,
+                                   jtok_tkn_t *tkns, size_t size,
+                                   char *stitch, size_t stitch_len);
+
+
+/**
+ * @brief Find the segment that holds the start of a token
+ *
+ * @param iov the segments the token was parsed from
+ * @param count number of segments
+ * @param tkn the token
+ * @param segment where the index of the segment is stored
+ * @param offset where the offset of tkn->start in that segment is stored
+ * @return true if found. false if the token was stitched.
+ */
+bool jtok_iov_locate(const jtok_iov_t *iov, size_t count,
+                     const jtok_tkn_t *tkn, size_t *segment, size_t *offset);
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* JTOK_IOV_H_ */
@@ -0,0 +1,132 @@
+#ifndef JTOK_LINES_H_
+#define JTOK_LINES_H_
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "jtok.h"
+
+/*
+ * Batch parsing of newline-delimited json (NDJSON / JSON Lines). Every line
+ * of a buffer is parsed in place into the same token pool and handed to a
+ * callback before the next line overwrites it. Lines end at '\n' (a '\r'
+ * before it is ignored), the last line may be unterminated and lines
+ * holding only whitespace are skipped.
+ *
+ * jtok_parse_lines_mt splits the buffer into chunks at line boundaries and
+ * parses them on several threads, each with its own token pool. Documents
+ * are delivered either in input order or as soon as they are parsed.
+ */
+
+/* Most worker threads jtok_parse_lines_mt will use */
+#ifndef JTOK_LINES_MAX_THREADS
+#define JTOK_LINES_MAX_THREADS 64
+#endif /* #ifndef JTOK_LINES_MAX_THREADS */
+
+/* Input bytes per unit of work when the caller does not choose */
+#ifndef JTOK_LINES_CHUNK_DEFAULT
+#define JTOK_LINES_CHUNK_DEFAULT (256 * 1024)
+#endif /* #ifndef JTOK_LINES_CHUNK_DEFAULT */
+
+/* Parsed documents a worker holds back while waiting for its turn to
+ * deliver them in order */
+#ifndef JTOK_LINES_MAX_PENDING
+#define JTOK_LINES_MAX_PENDING 64
+#endif /* #ifndef JTOK_LINES_MAX_PENDING */
+
+/* Value of jtok_line_t.index and .line when they are not known */
+#define JTOK_LINES_UNKNOWN SIZE_MAX
+
+typedef struct
+{
+    size_t              index;  /* document number, counting from 0 */
+    size_t              line;   /* line number, counting from 0 */
+    size_t              offset; /* offset of the line in the buffer */
+    size_t              len;    /* length of the line without its newline */
+    JTOK_PARSE_STATUS_t status; /* result of parsing the line */
+} jtok_line_t;
+
+
+/**
+ * @brief Called for every parsed document
+ *
+ * @param ctx context passed to jtok_parse_lines
+ * @param line where the document is and how it parsed
+ * @param tkns the token pool. Only valid until the callback returns, and
+ * only meaningful if line->status is JTOK_PARSE_STATUS_OK.
+ * @return int 0 to continue, anything else to stop after this document
+ */
+typedef int (*jtok_line_fn)(void *ctx, const jtok_line_t *line,
+                            jtok_tkn_t *tkns);
+
+
+/**
+ * @brief Parse every line of a buffer of newline-delimited json documents
+ *
+ * @param buf the documents. Does not need to be nul-terminated.
+ * @param len length of buf
+ * @param tkns caller-provided token pool, reused for every document
+ * @param size number of tokens in tkns
+ * @param fn called once per document
+ * @param ctx context passed to fn
+ * @return size_t number of bytes consumed: len, unless fn stopped early, in
+ * which case the offset just past the line it stopped on. 0 if a parameter
+ * is NULL.
+ *
+ * @note A document that fails to parse does not stop the batch. Its status
+ * is reported to fn and parsing continues with the next line.
+ */
+size_t jtok_parse_lines(const char *buf, size_t len, jtok_tkn_t *tkns,
+                        size_t size, jtok_line_fn fn, void *ctx);
+
+
+typedef struct
+{
+    unsigned     threads;   /* workers, counting the calling thread */
+    size_t       chunk_len; /* input bytes per unit of work. 0 for default */
+    bool         ordered;   /* deliver documents in input order */
+    jtok_tkn_t * pools;     /* threads * pool_size tokens */
+    size_t       pool_size; /* tokens in each worker's pool */
+} jtok_lines_config_t;
+
+
+/**
+ * @brief Parse a buffer of newline-delimited json documents on several
+ * threads
+ *
+ * @param buf the documents. Does not need to be nul-terminated.
+ * @param len length of buf
+ * @param config worker and delivery settings
+ * @param fn called once per document
+ * @param ctx context passed to fn
+ * @return size_t number of documents delivered to fn. 0 if a parameter is
+ * NULL or config is invalid.
+ *
+ * @note If config->ordered is set, fn sees documents in input order, one
+ * call at a time, exactly as jtok_parse_lines would deliver them (possibly
+ * from different threads), each document's tokens ending in the same
+ * JTOK_UNASSIGNED_TOKEN marker. Each worker then parses up to
+ * JTOK_LINES_MAX_PENDING documents into its pool while it waits for its
+ * turn, so a larger pool_size lets workers run further ahead.
+ *
+ * @note Otherwise fn is called concurrently from every worker as soon as a
+ * document is parsed, line->index and line->line are JTOK_LINES_UNKNOWN,
+ * and after fn asks to stop other workers may still deliver the documents
+ * they are already handling.
+ *
+ * @note Built without JTOK_HAVE_THREADS, the calling thread does all the
+ * work with the first pool.
+ */
+size_t jtok_parse_lines_mt(const char *buf, size_t len,
+                           const jtok_lines_config_t *config, jtok_line_fn fn,
+                           void *ctx);
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* JTOK_LINES_H_ */
@@ -0,0 +1,139 @@
+#ifndef JTOK_OVERLAY_H_
+#define JTOK_OVERLAY_H_
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+
+#include "jtok.h"
+
+typedef enum
+{
+    JTOK_EDIT_SET,    /* replace the value of target */
+    JTOK_EDIT_DELETE, /* remove an object member (by key) or array element */
+    JTOK_EDIT_INSERT, /* add a member to the object target */
+    JTOK_EDIT_APPEND, /* add an element to the end of the array target */
+} JTOK_EDIT_t;
+
+
+typedef struct
+{
+    JTOK_EDIT_t       op;
+    const jtok_tkn_t *target;
+    const char *      key;   /* JTOK_EDIT_INSERT only */
+    size_t            key_len;
+    const char *      value; /* serialized json value (not for DELETE) */
+    size_t            value_len;
+} jtok_edit_t;
+
+
+/*
+ * Copy-on-write edits on top of a parsed token pool. The source text and the
+ * pool are never modified; edits reference caller-owned strings which must
+ * outlive the overlay.
+ */
+typedef struct
+{
+    const jtok_tkn_t *root;  /* document the edits apply to */
+    jtok_edit_t *     edits; /* caller-provided edit table */
+    size_t            max;   /* capacity of edits */
+    size_t            count; /* edits recorded so far */
+} jtok_overlay_t;
+
+
+/**
+ * @brief Initialize an edit overlay
+ *
+ * @param overlay the overlay
+ * @param root root token of the parsed document. Edits to an overlay without
+ * one are rejected with JTOK_WRITE_STATUS_NULL_PARAM
+ * @param edits caller-provided side table for the edits
+ * @param max number of entries in edits
+ */
+void jtok_overlay_init(jtok_overlay_t *overlay, const jtok_tkn_t *root,
+                       jtok_edit_t *edits, size_t max);
+
+
+/**
+ * @brief Replace a value
+ *
+ * @param overlay the overlay
+ * @param value the value token to replace (not an object key)
+ * @param json serialized replacement value
+ * @param len length of json
+ * @return JTOK_WRITE_STATUS_t JTOK_WRITE_STATUS_NOMEM if the table is full
+ */
+JTOK_WRITE_STATUS_t jtok_overlay_set(jtok_overlay_t *overlay,
+                                     const jtok_tkn_t *value, const char *json,
+                                     size_t len);
+
+
+/**
+ * @brief Delete an object member or array element
+ *
+ * @param overlay the overlay
+ * @param tkn the member's key token, or the array element token
+ * @return JTOK_WRITE_STATUS_t JTOK_WRITE_STATUS_NOMEM if the table is full
+ */
+JTOK_WRITE_STATUS_t jtok_overlay_delete(jtok_overlay_t *overlay,
+                                        const jtok_tkn_t *tkn);
+
+
+/**
+ * @brief Add a member to the end of an object
+ *
+ * @param overlay the overlay
+ * @param object the object token
+ * @param key unescaped key bytes. They are quoted and escaped on output
+ * @param key_len length of key
+ * @param json serialized value
+ * @param len length of json
+ * @return JTOK_WRITE_STATUS_t JTOK_WRITE_STATUS_NOMEM if the table is full
+ *
+ * @note If the object already has the key (escapes resolved), and the
+ * member was not deleted, its value is replaced instead. Inserting the same
+ * key twice keeps the last value.
+ */
+JTOK_WRITE_STATUS_t jtok_overlay_insert(jtok_overlay_t *overlay,
+                                        const jtok_tkn_t *object,
+                                        const char *key, size_t key_len,
+                                        const char *json, size_t len);
+
+
+/**
+ * @brief Add an element to the end of an array
+ *
+ * @param overlay the overlay
+ * @param array the array token
+ * @param json serialized value
+ * @param len length of json
+ * @return JTOK_WRITE_STATUS_t JTOK_WRITE_STATUS_NOMEM if the table is full
+ */
+JTOK_WRITE_STATUS_t jtok_overlay_append(jtok_overlay_t *overlay,
+                                        const jtok_tkn_t *array,
+                                        const char *json, size_t len);
+
+
+/**
+ * @brief Serialize the edited document
+ *
+ * @param overlay the overlay
+ * @param write output callback
+ * @param ctx context passed to write
+ * @return JTOK_WRITE_STATUS_t JTOK_WRITE_STATUS_OK on success
+ *
+ * @note Only containers that hold an edit are re-emitted, and even those
+ * keep the source text around their surviving items, so the output has the
+ * layout of the original as jtok_serialize does. Added items copy the
+ * spacing of their neighbours. Everything else is copied in whole spans,
+ * so the work beyond copying grows with the number of edits.
+ */
+JTOK_WRITE_STATUS_t jtok_overlay_serialize(const jtok_overlay_t *overlay,
+                                           jtok_write_fn write, void *ctx);
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* JTOK_OVERLAY_H_ */
@@ -0,0 +1,72 @@
+#ifndef JTOK_PARALLEL_H_
+#define JTOK_PARALLEL_H_
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+
+#include "jtok.h"
+
+/*
+ * Parallel parsing of one large document. The text is cut into chunks that
+ * are scanned concurrently for commas between the elements of arrays that
+ * are direct members of the root object. Because a chunk may start inside
+ * a string, every chunk is scanned three ways (outside any string, inside a
+ * "string" and inside a 'string') and the right scan is chosen once the
+ * state at the end of the previous chunk is known. The runs of elements
+ * between consecutive commas are then parsed by helper threads into their
+ * own token pools while the calling thread parses the document from the
+ * start. When it reaches the first comma it splices the helpers' tokens
+ * into the caller's pool, rebasing their parent and sibling indices, and
+ * carries on after the last spliced element.
+ *
+ * A run that does not parse as whole elements of the same array (because
+ * the split guessed wrong, or the json is invalid) is not spliced, and the
+ * calling thread parses that part itself. The tokens and status are always
+ * the same as those of jtok_parsen.
+ */
+
+/* Most threads jtok_parse_mt will use */
+#ifndef JTOK_PARSE_MT_MAX_THREADS
+#define JTOK_PARSE_MT_MAX_THREADS 32
+#endif /* #ifndef JTOK_PARSE_MT_MAX_THREADS */
+
+/* Fewest input bytes per thread. Smaller documents use fewer threads. */
+#ifndef JTOK_PARSE_MT_MIN_CHUNK
+#define JTOK_PARSE_MT_MIN_CHUNK (16 * 1024)
+#endif /* #ifndef JTOK_PARSE_MT_MIN_CHUNK */
+
+typedef struct
+{
+    unsigned     threads;   /* threads, counting the calling thread */
+    jtok_tkn_t * pools;     /* (threads - 1) * pool_size tokens */
+    size_t       pool_size; /* tokens in each helper thread's pool */
+} jtok_parse_mt_config_t;
+
+
+/**
+ * @brief Parse a json document using several threads
+ *
+ * @param json json string to parse. Does not need to be nul-terminated.
+ * @param len length of json
+ * @param tkns caller-provided token pool for the result
+ * @param size number of tokens in tkns
+ * @param config thread settings and helper pools. Each helper pool must
+ * hold the tokens of 1/threads of the document to be useful.
+ * @return JTOK_PARSE_STATUS_t what jtok_parsen would return for the same
+ * arguments. JTOK_PARSE_STATUS_NULL_PARAM if config is NULL,
+ * JTOK_PARSE_STATUS_INVAL if config is invalid.
+ *
+ * @note Built without JTOK_HAVE_THREADS, or with config->threads of 1, this
+ * is jtok_parsen.
+ */
+JTOK_PARSE_STATUS_t jtok_parse_mt(const char *json, size_t len,
+                                  jtok_tkn_t *tkns, size_t size,
+                                  const jtok_parse_mt_config_t *config);
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* JTOK_PARALLEL_H_ */
@@ -0,0 +1,186 @@
+#ifndef JTOK_PIPELINE_H_
+#define JTOK_PIPELINE_H_
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "jtok.h"
+#include "jtok_pool.h"
+
+/*
+ * Streaming ingest pipeline. The calling thread reads a stream into a
+ * caller-provided byte buffer and frames it into documents, either one per
+ * line or each preceded by its length. Documents go through a bounded
+ * lock-free ring to parser threads, which parse them with contexts from a
+ * jtok_ctx_pool_t and pass the results through a second ring to a consumer
+ * thread that hands them to a callback. Every stage waits when the next one
+ * falls behind, so memory use is fixed by the configuration however fast the
+ * stream is. A waiting stage yields the CPU JTOK_PIPE_SPIN times, then
+ * sleeps until another stage makes progress.
+ *
+ * Built without JTOK_HAVE_THREADS or JTOK_HAVE_ATOMICS, the calling thread
+ * reads, parses and delivers each document in turn.
+ */
+
+/* Times a waiting stage yields before it sleeps */
+#ifndef JTOK_PIPE_SPIN
+#define JTOK_PIPE_SPIN 64
+#endif /* #ifndef JTOK_PIPE_SPIN */
+
+/* Most parser threads */
+#ifndef JTOK_PIPE_MAX_WORKERS
+#define JTOK_PIPE_MAX_WORKERS 64
+#endif /* #ifndef JTOK_PIPE_MAX_WORKERS */
+
+/* Most documents a parser thread takes from the input ring at once */
+#ifndef JTOK_PIPE_MAX_BATCH
+#define JTOK_PIPE_MAX_BATCH 64
+#endif /* #ifndef JTOK_PIPE_MAX_BATCH */
+
+/* Most documents between being framed and being released by the consumer.
+ * The reader waits when this many are in flight. */
+#ifndef JTOK_PIPE_MAX_INFLIGHT
+#define JTOK_PIPE_MAX_INFLIGHT 1024
+#endif /* #ifndef JTOK_PIPE_MAX_INFLIGHT */
+
+typedef enum
+{
+    JTOK_PIPE_NEWLINE,      /* one document per line, as jtok_parse_lines */
+    JTOK_PIPE_LENGTH_PREFIX /* 4-byte big-endian length, then the document */
+} JTOK_PIPE_FRAMING_t;
+
+typedef struct
+{
+    size_t              index;  /* document number, counting from 0 */
+    size_t              offset; /* offset of the document in the stream */
+    const char *        data;   /* the document, NULL if it was dropped */
+    size_t              len;    /* length of data */
+    jtok_ctx_t *        ctx;    /* parsed tokens, NULL if not parsed */
+    JTOK_PARSE_STATUS_t status; /* result of parsing the document */
+} jtok_pipe_item_t;
+
+
+/*
+ * Bounded multi-producer multi-consumer ring. Each cell carries a sequence
+ * number that tells producers and consumers whose turn it is, so pushes and
+ * pops only contend on their own end of the ring.
+ */
+typedef struct
+{
+    size_t           seq; /* (internal) */
+    jtok_pipe_item_t item;
+} jtok_ring_cell_t;
+
+typedef struct
+{
+    jtok_ring_cell_t *cells;
+    size_t            mask;
+    unsigned char     pad0[JTOK_CACHE_LINE];
+    size_t            head; /* next cell to push (internal) */
+    unsigned char     pad1[JTOK_CACHE_LINE];
+    size_t            tail; /* next cell to pop (internal) */
+    unsigned char     pad2[JTOK_CACHE_LINE];
+} jtok_ring_t;
+
+
+/**
+ * @brief Set up an empty ring
+ *
+ * @param ring the ring
+ * @param cells caller-provided cells
+ * @param count number of cells. Must be a power of 2, at least 2.
+ * @return JTOK_PARSE_STATUS_t JTOK_PARSE_STATUS_OK,
+ * JTOK_PARSE_STATUS_NULL_PARAM or JTOK_PARSE_STATUS_INVAL
+ */
+JTOK_PARSE_STATUS_t jtok_ring_init(jtok_ring_t *ring, jtok_ring_cell_t *cells,
+                                   size_t count);
+
+
+/**
+ * @brief Add an item to a ring. Safe to call from any thread.
+ *
+ * @param ring the ring
+ * @param item the item, copied into the ring
+ * @return true if added, false if the ring is full
+ */
+bool jtok_ring_push(jtok_ring_t *ring, const jtok_pipe_item_t *item);
+
+
+/**
+ * @brief Take the oldest item from a ring. Safe to call from any thread.
+ *
+ * @param ring the ring
+ * @param item where the item is copied
+ * @return true if an item was taken, false if the ring is empty
+ */
+bool jtok_ring_pop(jtok_ring_t *ring, jtok_pipe_item_t *item);
+
+
+/**
+ * @brief Read more of the stream
+ *
+ * @param ctx context passed to jtok_pipe_run
+ * @param buf where to put the data
+ * @param len most bytes to read
+ * @return size_t bytes read, 0 at the end of the stream
+ */
+typedef size_t (*jtok_pipe_read_fn)(void *ctx, char *buf, size_t len);
+
+
+/**
+ * @brief Called on the consumer thread for every document
+ *
+ * @param ctx context passed to jtok_pipe_run
+ * @param doc the document and its tokens (doc->ctx->tkns), which are only
+ * valid until the callback returns
+ * @return int 0 to continue, anything else to stop the pipeline
+ */
+typedef int (*jtok_pipe_fn)(void *ctx, const jtok_pipe_item_t *doc);
+
+
+typedef struct
+{
+    JTOK_PIPE_FRAMING_t framing;
+    unsigned            workers;   /* parser threads */
+    size_t              batch;     /* documents a parser takes at once */
+    char *              buf;       /* stream buffer. Must hold the largest
+                                      document; larger ones are dropped. */
+    size_t              buf_size;  /* size of buf */
+    jtok_ring_cell_t *  in_cells;  /* ring of framed documents */
+    size_t              in_count;  /* power of 2 */
+    jtok_ring_cell_t *  out_cells; /* ring of parsed documents */
+    size_t              out_count; /* power of 2 */
+    jtok_ctx_pool_t *   contexts;  /* one per document being parsed or
+                                      delivered. More lets parsers run
+                                      further ahead of the consumer. */
+} jtok_pipe_config_t;
+
+
+/**
+ * @brief Read, frame, parse and deliver every document of a stream
+ *
+ * @param config pipeline settings
+ * @param read reads the stream
+ * @param read_ctx context passed to read
+ * @param fn called once per document, in no particular order
+ * @param fn_ctx context passed to fn
+ * @return size_t number of documents delivered to fn. 0 if a parameter is
+ * NULL or config is invalid.
+ *
+ * @note Blank lines are skipped. A document too large for the buffer is
+ * delivered with a NULL data pointer and JTOK_PARSE_STATUS_NOMEM, and an
+ * incomplete length-prefixed document at the end of the stream with
+ * JTOK_PARSE_STATUS_PARTIAL_TOKEN. Neither is parsed.
+ */
+size_t jtok_pipe_run(const jtok_pipe_config_t *config, jtok_pipe_read_fn read,
+                     void *read_ctx, jtok_pipe_fn fn, void *fn_ctx);
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* JTOK_PIPELINE_H_ */
@@ -0,0 +1,128 @@
+#ifndef JTOK_POOL_H_
+#define JTOK_POOL_H_
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "jtok.h"
+
+/*
+ * A pool of parser contexts for threads that parse many documents. The
+ * caller provides one block of contexts, one token arena and (optionally)
+ * one block of scratch memory, and the pool carves them into equal
+ * per-context slices. A thread acquires a context, parses into its arena as
+ * often as it likes and releases it for another thread to reuse. Nothing is
+ * allocated or freed after jtok_ctx_pool_init.
+ *
+ * Free contexts are kept on a lock-free stack, so acquiring and releasing
+ * never blocks. Built without JTOK_HAVE_ATOMICS the pool is not thread
+ * safe.
+ */
+
+/* Bytes kept between neighbouring contexts so that threads updating their
+ * own context do not share a cache line */
+#ifndef JTOK_CACHE_LINE
+#define JTOK_CACHE_LINE 64
+#endif /* #ifndef JTOK_CACHE_LINE */
+
+typedef struct
+{
+    size_t parses;   /* documents parsed */
+    size_t failures; /* documents that did not parse */
+    size_t nomem;    /* of those, how many ran out of tokens */
+    size_t bytes;    /* json bytes parsed */
+} jtok_ctx_stats_t;
+
+typedef struct jtok_ctx_pool jtok_ctx_pool_t;
+
+typedef struct
+{
+    jtok_tkn_t *     tkns;        /* token arena, reused by every parse */
+    size_t           size;        /* number of tokens in tkns */
+    void *           scratch;     /* scratch memory for the holder, or NULL */
+    size_t           scratch_len; /* size of scratch */
+    jtok_ctx_stats_t stats;       /* totals for every parse in this context */
+    jtok_ctx_pool_t *pool;        /* pool the context belongs to */
+    uint32_t         next;        /* free-list link (internal) */
+    unsigned char    pad[JTOK_CACHE_LINE]; /* see JTOK_CACHE_LINE */
+} jtok_ctx_t;
+
+struct jtok_ctx_pool
+{
+    jtok_ctx_t *ctxs;  /* every context */
+    size_t      count; /* number of contexts */
+    uint64_t    head;  /* free-list head and ABA tag (internal) */
+};
+
+
+/**
+ * @brief Set up a pool of parser contexts
+ *
+ * @param pool the pool
+ * @param ctxs caller-provided storage for count contexts
+ * @param count number of contexts
+ * @param tkns caller-provided token arena of count * tokens_per_ctx tokens
+ * @param tokens_per_ctx tokens in each context's slice of tkns
+ * @param scratch caller-provided scratch memory of count * scratch_per_ctx
+ * bytes, or NULL
+ * @param scratch_per_ctx bytes in each context's slice of scratch
+ * @return JTOK_PARSE_STATUS_t JTOK_PARSE_STATUS_OK,
+ * JTOK_PARSE_STATUS_NULL_PARAM or JTOK_PARSE_STATUS_INVAL if a size is 0 or
+ * too large
+ */
+JTOK_PARSE_STATUS_t jtok_ctx_pool_init(jtok_ctx_pool_t *pool, jtok_ctx_t *ctxs,
+                                       size_t count, jtok_tkn_t *tkns,
+                                       size_t tokens_per_ctx, void *scratch,
+                                       size_t scratch_per_ctx);
+
+
+/**
+ * @brief Take a free context from the pool. Safe to call from any thread.
+ *
+ * @param pool the pool
+ * @return jtok_ctx_t* the context, or NULL if every context is in use
+ */
+jtok_ctx_t *jtok_ctx_acquire(jtok_ctx_pool_t *pool);
+
+
+/**
+ * @brief Give a context back to its pool. Safe to call from any thread.
+ *
+ * @param ctx the context. Its arena and scratch are kept for the next
+ * holder and its last document is cleared.
+ */
+void jtok_ctx_release(jtok_ctx_t *ctx);
+
+
+/**
+ * @brief Parse a json document into a context's token arena
+ *
+ * @param ctx the context
+ * @param json json string to parse. Does not need to be nul-terminated.
+ * @param len length of json
+ * @return JTOK_PARSE_STATUS_t the jtok_parsen status
+ */
+JTOK_PARSE_STATUS_t jtok_ctx_parse(jtok_ctx_t *ctx, const char *json,
+                                   size_t len);
+
+
+/**
+ * @brief Add up the statistics of every context in a pool
+ *
+ * @param pool the pool
+ * @param total where the totals are stored
+ *
+ * @note Counts from contexts that are parsing at the same time may be
+ * slightly out of date.
+ */
+void jtok_ctx_pool_stats(const jtok_ctx_pool_t *pool, jtok_ctx_stats_t *total);
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* JTOK_POOL_H_ */
@@ -0,0 +1,83 @@
+#ifndef JTOK_PRETTY_H_
+#define JTOK_PRETTY_H_
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdbool.h>
+
+#include "jtok.h"
+#include "jtok_writer.h"
+
+/*
+ * Both printers produce the same layout: one member or element per line,
+ * "key": value with a single space after the colon, and empty containers
+ * kept on one line as {} or []. Strings and primitives are copied verbatim.
+ */
+
+typedef struct
+{
+    jtok_writer_t *writer;  /* output */
+    unsigned int   indent;  /* spaces per nesting level */
+    size_t         depth;   /* current container nesting */
+    char           quote;   /* open quote character, or 0 outside strings */
+    bool           escape;  /* previous string byte was a backslash */
+    bool           pending; /* container just opened, may still be empty */
+} jtok_pretty_t;
+
+
+/**
+ * @brief Pretty-print a token subtree by walking the token pool
+ *
+ * @param writer output writer. Bytes are written raw (see jtok_writer_raw)
+ * @param tkn root of the subtree to print
+ * @param indent spaces per nesting level
+ * @return JTOK_WRITE_STATUS_t JTOK_WRITE_STATUS_OK on success
+ */
+JTOK_WRITE_STATUS_t jtok_pretty_tokens(jtok_writer_t *writer,
+                                       const jtok_tkn_t *tkn,
+                                       unsigned int indent);
+
+
+/**
+ * @brief Initialize a streaming pretty-printer that works on raw json bytes
+ * without tokenizing them
+ *
+ * @param pretty the printer
+ * @param writer output writer
+ * @param indent spaces per nesting level
+ */
+void jtok_pretty_init(jtok_pretty_t *pretty, jtok_writer_t *writer,
+                      unsigned int indent);
+
+
+/**
+ * @brief Feed the next chunk of json text to a streaming pretty-printer
+ *
+ * @param pretty the printer
+ * @param data the bytes. Chunks may split tokens anywhere.
+ * @param len number of bytes
+ * @return JTOK_WRITE_STATUS_t writer status
+ *
+ * @note Memory use is constant regardless of document size or depth. The
+ * input is not validated; malformed json produces malformed output.
+ */
+JTOK_WRITE_STATUS_t jtok_pretty_feed(jtok_pretty_t *pretty, const char *data,
+                                     size_t len);
+
+
+/**
+ * @brief Finish a streaming pretty-print and flush the writer
+ *
+ * @param pretty the printer
+ * @return JTOK_WRITE_STATUS_t writer status, or JTOK_WRITE_STATUS_INVAL if
+ * the input ended inside a string or an unclosed container
+ */
+JTOK_WRITE_STATUS_t jtok_pretty_finish(jtok_pretty_t *pretty);
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* JTOK_PRETTY_H_ */
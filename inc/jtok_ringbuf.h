@@ -0,0 +1,108 @@
+#ifndef JTOK_RINGBUF_H_
+#define JTOK_RINGBUF_H_
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "jtok.h"
+
+/*
+ * Parsing in a ring buffer. A message received by DMA or a UART interrupt
+ * into a circular buffer often wraps around its end. jtok_parse_ringbuf
+ * parses it where it lies, without copying it out first.
+ *
+ * Tokens point at the ring's storage and their offsets are ring positions.
+ * A token whose text wraps has an end past the capacity: its text runs from
+ * start to the end of the storage, then on from its beginning. Every jtok_*
+ * function can be used on tokens with end <= capacity; for the text of the
+ * others, use jtok_ringbuf_tokcmp and jtok_ringbuf_tokcpy, which work on any
+ * token of the ring.
+ *
+ * The one value that straddles the wrap is parsed through a buffer of
+ * JTOK_RINGBUF_WINDOW bytes on the stack, or through caller scratch with
+ * jtok_parse_ringbuf_scratch when keys or values may be longer. The tokens
+ * never point into either.
+ */
+
+#ifndef JTOK_RINGBUF_WINDOW
+#define JTOK_RINGBUF_WINDOW 256 /* longest value that may straddle the wrap */
+#endif /* #ifndef JTOK_RINGBUF_WINDOW */
+
+typedef struct
+{
+    const char *base;     /* the ring's storage */
+    size_t      capacity; /* size of base */
+    size_t      head;     /* position of the message's first byte */
+    size_t      tail;     /* position one past its last byte. head == tail
+                             is an empty ring. */
+} jtok_ringbuf_t;
+
+
+/**
+ * @brief Parse the message between a ring's head and tail
+ *
+ * @param ring the ring. Its storage must not change while tokens are used.
+ * @param tkns caller-provided pool of tokens
+ * @param size number of tokens in the token pool
+ * @return JTOK_PARSE_STATUS_t parse status. JTOK_PARSE_STATUS_PARTIAL_TOKEN
+ * if the message is not all there yet, JTOK_PARSE_STATUS_NOMEM if the value
+ * that wraps is longer than JTOK_RINGBUF_WINDOW, JTOK_PARSE_STATUS_INVAL if
+ * the ring is too large for token offsets or head or tail lie outside it.
+ * Tokens only point into the ring when JTOK_PARSE_STATUS_OK is returned.
+ */
+JTOK_PARSE_STATUS_t jtok_parse_ringbuf(const jtok_ringbuf_t *ring,
+                                       jtok_tkn_t *tkns, size_t size);
+
+
+/**
+ * @brief Parse the message between a ring's head and tail using caller
+ * scratch for the value that wraps
+ *
+ * @param ring the ring. Its storage must not change while tokens are used.
+ * @param tkns caller-provided pool of tokens
+ * @param size number of tokens in the token pool
+ * @param scratch buffer the value that wraps is copied into. May be NULL.
+ * @param scratch_len size of scratch. A value that wraps must fit in the
+ * larger of scratch_len and JTOK_RINGBUF_WINDOW; scratch as large as the
+ * ring always suffices.
+ * @return JTOK_PARSE_STATUS_t parse status, as for jtok_parse_ringbuf
+ */
+JTOK_PARSE_STATUS_t jtok_parse_ringbuf_scratch(const jtok_ringbuf_t *ring,
+                                               jtok_tkn_t *tkns, size_t size,
+                                               char *scratch,
+                                               size_t scratch_len);
+
+
+/**
+ * @brief Compare a string with the text of a token, as jtok_tokcmp does
+ *
+ * @param ring the ring the token was parsed from
+ * @param str nul-terminated string
+ * @param tok the token
+ * @return true if equal
+ */
+bool jtok_ringbuf_tokcmp(const jtok_ringbuf_t *ring, const char *str,
+                         const jtok_tkn_t *tok);
+
+
+/**
+ * @brief Copy the text of a token into a buffer, as jtok_tokcpy does
+ *
+ * @param ring the ring the token was parsed from
+ * @param dst the destination byte buffer
+ * @param bufsize size of destination buffer
+ * @param tkn the token
+ * @return char* NULL on error, otherwise, address of destination
+ */
+char *jtok_ringbuf_tokcpy(const jtok_ringbuf_t *ring, char *dst,
+                          size_t bufsize, const jtok_tkn_t *tkn);
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* JTOK_RINGBUF_H_ */
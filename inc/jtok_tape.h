@@ -0,0 +1,202 @@
+#ifndef JTOK_TAPE_H_
+#define JTOK_TAPE_H_
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "jtok.h"
+
+/*
+ * A tape is a parsed document saved in a relocatable form: every reference
+ * is an offset or an index, never a pointer. Layout (all sections 8-byte
+ * aligned, integers in the producer's byte order):
+ *
+ *   jtok_tape_header_t
+ *   jtok_tape_tkn_t  tokens[token_count]   (same order as the parsed pool)
+ *   double           numbers[number_count] (decoded numeric primitives)
+ *   char             text[text_len + 1]    (original json, nul-terminated)
+ *
+ * A reader checks the header in O(1) and navigates the tokens in place, so
+ * a memory-mapped tape is usable immediately and its pages are shared by
+ * every process that maps it.
+ */
+
+#define JTOK_TAPE_MAGIC "JTKT"
+#define JTOK_TAPE_VERSION 1
+#define JTOK_TAPE_ENDIAN 0x01020304u /* reads differently if byte-swapped */
+#define JTOK_TAPE_NONE UINT32_MAX    /* no such token or number */
+
+typedef struct
+{
+    char     magic[4];      /* JTOK_TAPE_MAGIC (not nul-terminated) */
+    uint32_t version;       /* JTOK_TAPE_VERSION */
+    uint32_t endian;        /* JTOK_TAPE_ENDIAN */
+    uint32_t token_count;   /* number of tokens */
+    uint32_t number_count;  /* number of decoded numbers */
+    uint32_t text_len;      /* length of text, excluding its nul */
+    uint64_t token_offset;  /* file offset of tokens */
+    uint64_t number_offset; /* file offset of numbers */
+    uint64_t text_offset;   /* file offset of text */
+    uint64_t file_size;     /* total size of the tape */
+} jtok_tape_header_t;
+
+
+typedef struct
+{
+    uint32_t start;   /* offset into text (strings exclude their quotes) */
+    uint32_t end;     /* offset into text, one past the last byte */
+    int32_t  size;    /* same meaning as jtok_tkn_t.size */
+    int32_t  parent;  /* token index or JTOK_NO_PARENT_IDX */
+    int32_t  sibling; /* token index or JTOK_NO_SIBLING_IDX */
+    uint32_t next;    /* index of the first token after this subtree */
+    uint32_t number;  /* index into numbers, or JTOK_TAPE_NONE */
+    uint8_t  type;    /* JTOK_TYPE_t */
+    uint8_t  reserved[3];
+} jtok_tape_tkn_t;
+
+
+typedef struct
+{
+    const jtok_tape_header_t *header;
+    const jtok_tape_tkn_t *   tokens;
+    const double *            numbers;
+    const char *              text;
+    void *                    map;     /* set by jtok_tape_map */
+    size_t                    map_len; /* set by jtok_tape_map */
+} jtok_tape_t;
+
+
+/**
+ * @brief Write a parsed document as a tape
+ *
+ * @param pool token pool filled by jtok_parse. pool[0] must be the root.
+ * @param count number of tokens in pool. Tokens after the root's subtree
+ * (or the first unassigned token) are ignored.
+ * @param write output callback
+ * @param ctx context passed to write
+ * @return JTOK_WRITE_STATUS_t JTOK_WRITE_STATUS_OK on success
+ */
+JTOK_WRITE_STATUS_t jtok_tape_write(const jtok_tkn_t *pool, size_t count,
+                                    jtok_write_fn write, void *ctx);
+
+
+/**
+ * @brief Open a tape that is already in memory
+ *
+ * @param tape the tape handle
+ * @param data start of the tape. Must be 8-byte aligned.
+ * @param len number of bytes available at data
+ * @return JTOK_PARSE_STATUS_t JTOK_PARSE_STATUS_OK, or JTOK_PARSE_STATUS_INVAL
+ * if the header does not describe a tape that fits in len
+ *
+ * @note Only the header is checked. Every accessor bounds-checks the
+ * indices it follows, so a corrupt tape cannot cause reads outside data.
+ */
+JTOK_PARSE_STATUS_t jtok_tape_open(jtok_tape_t *tape, const void *data,
+                                   size_t len);
+
+
+/**
+ * @brief Memory-map a tape file read-only and open it
+ *
+ * @param tape the tape handle
+ * @param path path of the tape file
+ * @return JTOK_PARSE_STATUS_t JTOK_PARSE_STATUS_IO_ERROR if the file cannot
+ * be mapped (always, when built without JTOK_HAVE_POSIX)
+ */
+JTOK_PARSE_STATUS_t jtok_tape_map(jtok_tape_t *tape, const char *path);
+
+
+/**
+ * @brief Release a tape opened with jtok_tape_map
+ *
+ * @param tape the tape handle
+ */
+void jtok_tape_unmap(jtok_tape_t *tape);
+
+
+/**
+ * @brief Get a token from a tape
+ *
+ * @param tape the tape
+ * @param idx token index
+ * @return const jtok_tape_tkn_t* the token, or NULL if idx or the token's
+ * text offsets are out of range
+ */
+const jtok_tape_tkn_t *jtok_tape_token(const jtok_tape_t *tape, uint32_t idx);
+
+
+/**
+ * @brief Get the text of a token
+ *
+ * @param tape the tape
+ * @param idx token index
+ * @param len output location for the length of the text
+ * @return const char* the text (strings without quotes), or NULL
+ */
+const char *jtok_tape_text(const jtok_tape_t *tape, uint32_t idx, size_t *len);
+
+
+/**
+ * @brief Get the decoded value of a numeric primitive
+ *
+ * @param tape the tape
+ * @param idx token index
+ * @param value output location for the number
+ * @return true if the token is a number
+ * @return false otherwise
+ */
+bool jtok_tape_number(const jtok_tape_t *tape, uint32_t idx, double *value);
+
+
+/**
+ * @brief Look up the value of an object member
+ *
+ * @param tape the tape
+ * @param obj index of an object token
+ * @param key key bytes, compared exactly with the raw key text
+ * @param key_len length of key
+ * @return uint32_t index of the member's value, or JTOK_TAPE_NONE
+ */
+uint32_t jtok_tape_obj_get(const jtok_tape_t *tape, uint32_t obj,
+                           const char *key, size_t key_len);
+
+
+/**
+ * @brief Look up an array element
+ *
+ * @param tape the tape
+ * @param arr index of an array token
+ * @param n element number
+ * @return uint32_t index of the element, or JTOK_TAPE_NONE
+ */
+uint32_t jtok_tape_array_get(const jtok_tape_t *tape, uint32_t arr, size_t n);
+
+
+/**
+ * @brief Rebuild an ordinary token pool that points into the tape's text,
+ * for use with the rest of the jtok API (no parsing is done)
+ *
+ * @param tape the tape
+ * @param tkns caller-provided token pool
+ * @param size number of tokens in tkns
+ * @return JTOK_PARSE_STATUS_t JTOK_PARSE_STATUS_NOMEM if the pool is too
+ * small, JTOK_PARSE_STATUS_INVAL if a token is corrupt: an unknown type, a
+ * span outside the text, a parent or sibling out of order or out of range,
+ * or a size that differs from its number of children
+ *
+ * @note The tokens' json pointers refer to the tape, so they are only valid
+ * while it stays open. They must not be used to modify the text.
+ */
+JTOK_PARSE_STATUS_t jtok_tape_to_pool(const jtok_tape_t *tape, jtok_tkn_t *tkns,
+                                      size_t size);
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* JTOK_TAPE_H_ */
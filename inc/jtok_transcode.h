@@ -0,0 +1,88 @@
+#ifndef JTOK_TRANSCODE_H_
+#define JTOK_TRANSCODE_H_
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "jtok.h"
+#include "jtok_writer.h"
+
+/*
+ * Binary transcoders. Encoding walks a parsed token pool once and writes
+ * MessagePack (https://msgpack.org/) or CBOR (RFC 8949) straight to a sink:
+ *
+ *   - objects and arrays become maps and arrays of the same size
+ *   - strings are unescaped to utf-8 (unescaped strings are copied as-is)
+ *   - integers that fit in 64 bits use the smallest integer encoding, every
+ *     other number becomes a 64-bit float
+ *   - true, false and null map to the matching simple values
+ *
+ * Decoding reads one binary item and feeds it to a jtok_writer_t, so it
+ * inherits the writer's escaping, number formatting and depth limit. Only
+ * the subset that has a json equivalent is accepted: byte strings,
+ * extension types, non-string map keys and (for CBOR) indefinite lengths
+ * are rejected with JTOK_WRITE_STATUS_INVAL. CBOR tags are skipped.
+ */
+
+
+/**
+ * @brief Encode a token and its subtree as MessagePack
+ *
+ * @param tkn the token (usually the root of a parsed pool)
+ * @param write output callback
+ * @param ctx context passed to write
+ * @return JTOK_WRITE_STATUS_t JTOK_WRITE_STATUS_INVAL if a string holds a
+ * bad escape or a number cannot be decoded
+ */
+JTOK_WRITE_STATUS_t jtok_to_msgpack(const jtok_tkn_t *tkn, jtok_write_fn write,
+                                    void *ctx);
+
+
+/**
+ * @brief Encode a token and its subtree as CBOR
+ *
+ * @param tkn the token (usually the root of a parsed pool)
+ * @param write output callback
+ * @param ctx context passed to write
+ * @return JTOK_WRITE_STATUS_t JTOK_WRITE_STATUS_INVAL if a string holds a
+ * bad escape or a number cannot be decoded
+ */
+JTOK_WRITE_STATUS_t jtok_to_cbor(const jtok_tkn_t *tkn, jtok_write_fn write,
+                                 void *ctx);
+
+
+/**
+ * @brief Decode one MessagePack item into a json writer
+ *
+ * @param data encoded bytes
+ * @param len number of bytes at data
+ * @param used output location for the number of bytes decoded. May be NULL.
+ * @param writer json writer the item is emitted to
+ * @return JTOK_WRITE_STATUS_t JTOK_WRITE_STATUS_INVAL if the input is
+ * truncated or has no json equivalent, otherwise the writer status
+ */
+JTOK_WRITE_STATUS_t jtok_msgpack_to_json(const void *data, size_t len,
+                                         size_t *used, jtok_writer_t *writer);
+
+
+/**
+ * @brief Decode one CBOR item into a json writer
+ *
+ * @param data encoded bytes
+ * @param len number of bytes at data
+ * @param used output location for the number of bytes decoded. May be NULL.
+ * @param writer json writer the item is emitted to
+ * @return JTOK_WRITE_STATUS_t JTOK_WRITE_STATUS_INVAL if the input is
+ * truncated or has no json equivalent, otherwise the writer status
+ */
+JTOK_WRITE_STATUS_t jtok_cbor_to_json(const void *data, size_t len,
+                                      size_t *used, jtok_writer_t *writer);
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* JTOK_TRANSCODE_H_ */
@@ -0,0 +1,213 @@
+#ifndef JTOK_WRITER_H_
+#define JTOK_WRITER_H_
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "jtok.h"
+
+/* Deepest container nesting the writer can track */
+#ifndef JTOK_WRITER_MAX_DEPTH
+#define JTOK_WRITER_MAX_DEPTH (JTOK_MAX_RECURSE_DEPTH + 1)
+#endif /* #ifndef JTOK_WRITER_MAX_DEPTH */
+
+typedef struct
+{
+    char *              buf;   /* caller-provided output buffer */
+    size_t              size;  /* capacity of buf */
+    size_t              len;   /* bytes currently held in buf */
+    size_t              total; /* bytes emitted so far (buffered + flushed) */
+    jtok_write_fn       flush; /* receives buf when it fills. May be NULL */
+    void *              ctx;   /* context passed to flush */
+    int                 depth; /* current container nesting */
+    bool                root_done; /* a complete top-level value exists */
+    uint8_t             stack[JTOK_WRITER_MAX_DEPTH]; /* container states */
+    JTOK_WRITE_STATUS_t status; /* first error encountered (sticky) */
+} jtok_writer_t;
+
+
+/**
+ * @brief Initialize a streaming json writer
+ *
+ * @param writer the writer
+ * @param buf caller-provided output buffer. May be NULL (or size 0) if flush
+ * is given, in which case every write goes straight to flush unbuffered.
+ * @param size size of buf
+ * @param flush called with the buffered bytes whenever buf fills and on
+ * jtok_writer_flush. If NULL, all output must fit in buf.
+ * @param ctx context passed to flush
+ */
+void jtok_writer_init(jtok_writer_t *writer, char *buf, size_t size,
+                      jtok_write_fn flush, void *ctx);
+
+
+/**
+ * @brief Hand any buffered output to the flush callback
+ *
+ * @param writer the writer
+ * @return JTOK_WRITE_STATUS_t writer status
+ *
+ * @note Without a flush callback the output simply stays in buf.
+ */
+JTOK_WRITE_STATUS_t jtok_writer_flush(jtok_writer_t *writer);
+
+
+/**
+ * @brief Start a json object ('{')
+ *
+ * @param writer the writer
+ * @return JTOK_WRITE_STATUS_t writer status
+ */
+JTOK_WRITE_STATUS_t jtok_writer_begin_object(jtok_writer_t *writer);
+
+
+/**
+ * @brief End the current json object ('}')
+ *
+ * @param writer the writer
+ * @return JTOK_WRITE_STATUS_t writer status
+ */
+JTOK_WRITE_STATUS_t jtok_writer_end_object(jtok_writer_t *writer);
+
+
+/**
+ * @brief Start a json array ('[')
+ *
+ * @param writer the writer
+ * @return JTOK_WRITE_STATUS_t writer status
+ */
+JTOK_WRITE_STATUS_t jtok_writer_begin_array(jtok_writer_t *writer);
+
+
+/**
+ * @brief End the current json array (']')
+ *
+ * @param writer the writer
+ * @return JTOK_WRITE_STATUS_t writer status
+ */
+JTOK_WRITE_STATUS_t jtok_writer_end_array(jtok_writer_t *writer);
+
+
+/**
+ * @brief Write an object key. Must be followed by exactly one value.
+ *
+ * @param writer the writer
+ * @param key unescaped key bytes
+ * @param len length of key
+ * @return JTOK_WRITE_STATUS_t writer status
+ */
+JTOK_WRITE_STATUS_t jtok_writer_key(jtok_writer_t *writer, const char *key,
+                                    size_t len);
+
+
+/**
+ * @brief Write a string value, escaping it as needed
+ *
+ * @param writer the writer
+ * @param str unescaped string bytes
+ * @param len length of str
+ * @return JTOK_WRITE_STATUS_t writer status
+ */
+JTOK_WRITE_STATUS_t jtok_writer_string(jtok_writer_t *writer, const char *str,
+                                       size_t len);
+
+
+/**
+ * @brief Write a signed integer value
+ *
+ * @param writer the writer
+ * @param value the value
+ * @return JTOK_WRITE_STATUS_t writer status
+ */
+JTOK_WRITE_STATUS_t jtok_writer_int(jtok_writer_t *writer, int64_t value);
+
+
+/**
+ * @brief Write an unsigned integer value
+ *
+ * @param writer the writer
+ * @param value the value
+ * @return JTOK_WRITE_STATUS_t writer status
+ */
+JTOK_WRITE_STATUS_t jtok_writer_uint(jtok_writer_t *writer, uint64_t value);
+
+
+/**
+ * @brief Write a floating point value using the fewest digits that still
+ * parse back to exactly the same double
+ *
+ * @param writer the writer
+ * @param value the value. NaN and infinity are rejected (not valid json)
+ * @return JTOK_WRITE_STATUS_t writer status
+ *
+ * @note The text is what ECMAScript's Number.prototype.toString gives, so
+ * 1e21 is written "1e+21" and 1e-7 "1e-7".
+ */
+JTOK_WRITE_STATUS_t jtok_writer_double(jtok_writer_t *writer, double value);
+
+
+/**
+ * @brief Write true or false
+ *
+ * @param writer the writer
+ * @param value the value
+ * @return JTOK_WRITE_STATUS_t writer status
+ */
+JTOK_WRITE_STATUS_t jtok_writer_bool(jtok_writer_t *writer, bool value);
+
+
+/**
+ * @brief Write null
+ *
+ * @param writer the writer
+ * @return JTOK_WRITE_STATUS_t writer status
+ */
+JTOK_WRITE_STATUS_t jtok_writer_null(jtok_writer_t *writer);
+
+
+/**
+ * @brief Write an already-serialized json value (separators are still
+ * inserted by the writer)
+ *
+ * @param writer the writer
+ * @param json serialized value
+ * @param len length of json
+ * @return JTOK_WRITE_STATUS_t writer status
+ */
+JTOK_WRITE_STATUS_t jtok_writer_value(jtok_writer_t *writer, const char *json,
+                                      size_t len);
+
+
+/**
+ * @brief Write bytes verbatim, bypassing all structure tracking
+ *
+ * @param writer the writer
+ * @param data the bytes
+ * @param len number of bytes
+ * @return JTOK_WRITE_STATUS_t writer status
+ */
+JTOK_WRITE_STATUS_t jtok_writer_raw(jtok_writer_t *writer, const char *data,
+                                    size_t len);
+
+
+/**
+ * @brief jtok_write_fn adapter so any jtok emitter can stream into a writer
+ *
+ * @param writer the jtok_writer_t (as void *)
+ * @param data the bytes
+ * @param len number of bytes
+ * @return int 0 on success
+ *
+ * @note example: jtok_diff(from, to, NULL, 0, jtok_writer_sink, &writer);
+ */
+int jtok_writer_sink(void *writer, const char *data, size_t len);
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* JTOK_WRITER_H_ */
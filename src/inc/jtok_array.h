@@ -19,6 +19,21 @@ extern "C"
  */
 JTOK_PARSE_STATUS_t jtok_parse_array(jtok_parser_t *parser, int depth);
 
+/**
+ * @brief Parse the elements of an array whose token already exists
+ *
+ * @param parser the json parser, positioned just inside the array
+ * @param depth the parse nesting depth of the array
+ * @param array_token_index index of the array token
+ * @param segment if true, the text is a run of elements each followed by a
+ * comma (as cut out of a larger array) and parsing succeeds when it ends
+ * right after such a comma. A closing ']' is then an error.
+ * @return JTOK_PARSE_STATUS_t parser status
+ */
+JTOK_PARSE_STATUS_t jtok_parse_array_elements(jtok_parser_t *parser, int depth,
+                                              jtok_off_t array_token_index,
+                                              bool segment);
+
 /**
  * @brief Compare two jtok tokens with type JTOK_ARRAY for equality
  *
@@ -0,0 +1,40 @@
+#ifndef __JTOK_COMPARE_H__
+#define __JTOK_COMPARE_H__
+#ifdef __cplusplus
+/* clang-format off */
+extern "C"
+{
+/* clang-format on */
+#endif /* Start C linkage */
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "jtok.h"
+
+/**
+ * @brief Deep-compare two token subtrees without recursion
+ *
+ * @param tkn1 first token
+ * @param tkn2 second token
+ * @param scratch index scratch for hash tables of object keys
+ * @param scratch_len number of entries available in scratch
+ * @return true if equal
+ * @return false if not equal
+ *
+ * @note Aggregates are first compared by jtok_hash, which rejects most
+ * unequal pairs in one linear pass. Objects with fewer members than the
+ * remaining scratch are then matched through a hash table of their keys in
+ * O(n). Objects that do not fit fall back to a linear key search, O(n^2),
+ * so the result is always correct.
+ */
+bool jtok_deepcmp(const jtok_tkn_t *tkn1, const jtok_tkn_t *tkn2,
+                  jtok_off_t *scratch, size_t scratch_len);
+
+
+#ifdef __cplusplus
+/* clang-format off */
+}
+/* clang-format on */
+#endif /* End C linkage */
+#endif /* __JTOK_COMPARE_H__ */
@@ -0,0 +1,53 @@
+#ifndef __JTOK_DTOA_H__
+#define __JTOK_DTOA_H__
+#ifdef __cplusplus
+/* clang-format off */
+extern "C"
+{
+/* clang-format on */
+#endif /* Start C linkage */
+
+#include <stddef.h>
+
+/* Significant digits that always round-trip a double */
+#define JTOK_DTOA_DIGITS_MAX 17
+
+/* Longest text jtok_dtoa_format writes, "-1.2345678901234567e-308" */
+#define JTOK_DTOA_FORMAT_MAX 32
+
+/**
+ * @brief Fewest significant decimal digits that read back as value
+ *
+ * @param value a finite double greater than zero
+ * @param digits output location for JTOK_DTOA_DIGITS_MAX digits. Not
+ * nul-terminated and without trailing zeros
+ * @param point output location for the position of the decimal point:
+ * value is 0.<digits> times 10^point
+ * @return int number of digits written
+ *
+ * @note Of several shortest forms the one closest to value is chosen, as
+ * ECMAScript Number serialization requires. Grisu3 settles almost every
+ * double with integer arithmetic; the few it cannot prove shortest are
+ * found with snprintf and strtod.
+ */
+int jtok_dtoa_shortest(double value, char *digits, int *point);
+
+
+/**
+ * @brief Write a finite double the way ECMAScript Number.prototype.toString
+ * does, which is also valid json
+ *
+ * @param value the double. -0 is written as 0
+ * @param out output location for up to JTOK_DTOA_FORMAT_MAX bytes. Not
+ * nul-terminated
+ * @return size_t number of bytes written
+ */
+size_t jtok_dtoa_format(double value, char *out);
+
+
+#ifdef __cplusplus
+/* clang-format off */
+}
+/* clang-format on */
+#endif /* End C linkage */
+#endif /* __JTOK_DTOA_H__ */
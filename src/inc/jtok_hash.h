@@ -0,0 +1,40 @@
+#ifndef __JTOK_HASH_H__
+#define __JTOK_HASH_H__
+#ifdef __cplusplus
+/* clang-format off */
+extern "C"
+{
+/* clang-format on */
+#endif /* Start C linkage */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "jtok.h"
+
+/**
+ * @brief Hash a run of bytes
+ *
+ * @param data the bytes to hash
+ * @param len number of bytes
+ * @param seed initial hash state (use to separate hash domains)
+ * @return uint64_t the hash
+ */
+uint64_t jtok_hash_bytes(const void *data, size_t len, uint64_t seed);
+
+
+/**
+ * @brief Final avalanche step applied to combined hashes
+ *
+ * @param x value to mix
+ * @return uint64_t mixed value
+ */
+uint64_t jtok_hash_mix(uint64_t x);
+
+
+#ifdef __cplusplus
+/* clang-format off */
+}
+/* clang-format on */
+#endif /* End C linkage */
+#endif /* __JTOK_HASH_H__ */
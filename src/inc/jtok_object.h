@@ -32,6 +32,8 @@ JTOK_PARSE_STATUS_t jtok_parse_object(jtok_parser_t *parser, int depth);
  *
  * @note Objects are equal if all of their children are equal.
  *       This does not mean the children are ordered the same.
+ *       Keys are matched through a hash table in
+ *       JTOK_TOKCMP_SCRATCH_SIZE entries of stack scratch.
  */
 bool jtok_toktokcmp_object(const jtok_tkn_t *obj1, const jtok_tkn_t *obj2);
 
@@ -10,6 +10,12 @@ extern "C"
 
 #include "jtok.h"
 
+/* Longest numeric primitive that can be decoded. Longer tokens still parse,
+ * but cannot be compared by value */
+#ifndef JTOK_PRIMITIVE_MAX_NUMBER_LEN
+#define JTOK_PRIMITIVE_MAX_NUMBER_LEN 64
+#endif /* #ifndef JTOK_PRIMITIVE_MAX_NUMBER_LEN */
+
 
 /**
  * @brief Parse and fill next available jtok token as a jtok primitive
@@ -19,6 +25,22 @@ extern "C"
  */
 JTOK_PARSE_STATUS_t jtok_parse_primitive(jtok_parser_t *parser);
 
+/**
+ * @brief Scan a primitive against the grammar jtok_parse accepts
+ *
+ * @param js the json text
+ * @param len length of js
+ * @param pos in: index of the first primitive character. out: index of the
+ * terminating character on success
+ * @return JTOK_PARSE_STATUS_t JTOK_PARSE_STATUS_OK if the primitive is valid
+ * and terminated before len, JTOK_PARSE_STATUS_PARTIAL_TOKEN if it is
+ * unterminated or runs into an unexpected character
+ *
+ * @note Shared with the events parser so both accept the same primitives
+ */
+JTOK_PARSE_STATUS_t jtok_primitive_scan(const char *js, jtok_off_t len,
+                                        jtok_off_t *pos);
+
 /**
  * @brief Compare two jtok tokens with type JTOK_PRIMITIVE for equality
  *
@@ -29,6 +51,41 @@ JTOK_PARSE_STATUS_t jtok_parse_primitive(jtok_parser_t *parser);
  */
 bool jtok_toktokcmp_primitive(const jtok_tkn_t *tkn1, const jtok_tkn_t *tkn2);
 
+
+/**
+ * @brief Check if a primitive token holds a number (rather than a literal)
+ *
+ * @param tkn the token
+ * @return true if the token text starts like a number
+ * @return false if token is true, false, null or invalid
+ */
+bool jtok_primitive_is_number(const jtok_tkn_t *tkn);
+
+
+/**
+ * @brief Decode a numeric primitive token as a double
+ *
+ * @param tkn the token
+ * @param value output location for the decoded value
+ * @return true if the entire token was a valid number
+ * @return false otherwise (value is then unspecified)
+ */
+bool jtok_primitive_todouble(const jtok_tkn_t *tkn, double *value);
+
+
+/**
+ * @brief Decode a numeric primitive token as an exact integer
+ *
+ * @param tkn the token
+ * @param negative output location for the sign
+ * @param magnitude output location for the absolute value
+ * @return true if the token is an integer (no fraction or exponent) whose
+ * magnitude fits in 64 bits
+ * @return false otherwise. Use jtok_primitive_todouble instead.
+ */
+bool jtok_primitive_tointeger(const jtok_tkn_t *tkn, bool *negative,
+                              uint64_t *magnitude);
+
 #ifdef __cplusplus
 /* clang-format off */
 }
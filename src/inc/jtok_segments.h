@@ -0,0 +1,41 @@
+#ifndef __JTOK_SEGMENTS_H__
+#define __JTOK_SEGMENTS_H__
+#ifdef __cplusplus
+/* clang-format off */
+extern "C"
+{
+/* clang-format on */
+#endif /* Start C linkage */
+
+#include <stddef.h>
+#include <stdbool.h>
+
+#include "jtok.h"
+#include "jtok_iov.h"
+
+/**
+ * @brief jtok_parse_iov, optionally leaving every token at its stream offset
+ *
+ * @param iov the segments
+ * @param count number of segments
+ * @param tkns token pool
+ * @param size number of tokens in tkns
+ * @param stitch buffer that values straddling a boundary are parsed in
+ * @param stitch_len size of stitch
+ * @param stream_offsets if true, every token gets json NULL and offsets in
+ * the whole stream, and stitch is only needed for one value at a time
+ * @param written if not NULL, set to the number of tokens written to tkns,
+ * whatever the status (0 when the parse did not start)
+ * @return JTOK_PARSE_STATUS_t parse status
+ */
+JTOK_PARSE_STATUS_t jtok_parse_segments(const jtok_iov_t *iov, size_t count,
+                                        jtok_tkn_t *tkns, size_t size,
+                                        char *stitch, size_t stitch_len,
+                                        bool stream_offsets, size_t *written);
+
+#ifdef __cplusplus
+/* clang-format off */
+}
+/* clang-format on */
+#endif /* End C linkage */
+#endif /* __JTOK_SEGMENTS_H__ */
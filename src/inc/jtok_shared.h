@@ -37,7 +37,32 @@ jtok_tkn_t *jtok_alloc_token(jtok_parser_t *parser);
  *
  * @return 0 on success, 1 on failure
  */
-int jtok_fill_token(jtok_tkn_t *token, JTOK_TYPE_t type, int start, int end);
+int jtok_fill_token(jtok_tkn_t *token, JTOK_TYPE_t type, jtok_off_t start,
+                    jtok_off_t end);
+
+
+/**
+ * @brief Order two key tokens by length, then by their raw bytes
+ *
+ * @param key1 first key
+ * @param key2 second key
+ * @return int <0, 0 or >0 in the manner of memcmp
+ */
+int jtok_keycmp(const jtok_tkn_t *key1, const jtok_tkn_t *key2);
+
+
+/**
+ * @brief Heapsort an array of token pool indices in place
+ *
+ * @param pool token pool that the indices refer to
+ * @param idx array of indices into pool
+ * @param count number of indices
+ * @param cmp ordering function for two tokens
+ *
+ * @note Heapsort is used because it needs no extra memory and no recursion
+ */
+void jtok_sort_tokens(const jtok_tkn_t *pool, jtok_off_t *idx, size_t count,
+                      int (*cmp)(const jtok_tkn_t *, const jtok_tkn_t *));
 
 
 #ifdef __cplusplus
@@ -0,0 +1,77 @@
+#ifndef __JTOK_STITCH_H__
+#define __JTOK_STITCH_H__
+#ifdef __cplusplus
+/* clang-format off */
+extern "C"
+{
+/* clang-format on */
+#endif /* Start C linkage */
+
+#include <stddef.h>
+
+#include "jtok.h"
+
+/*
+ * Hook that lets a parse take over array elements that were already parsed
+ * elsewhere (see jtok_parallel.c). When the array parser reaches the comma
+ * at offset from, it calls splice, which may append tokens for the elements
+ * that follow, link them into the array and move parser->pos to the comma
+ * after the last of them.
+ */
+typedef struct jtok_stitch jtok_stitch_t;
+struct jtok_stitch
+{
+    jtok_off_t from; /* offset of the array comma to splice after, -1 if
+                        disarmed */
+
+    /**
+     * @brief Append pre-parsed elements to the array being parsed
+     *
+     * @param stitch the hook
+     * @param parser the parser, positioned on the comma at stitch->from
+     * @param depth the parse nesting depth of the array
+     * @param array_idx index of the array token
+     * @param element_type type of the array's elements so far (strings count
+     * as JTOK_OBJECT)
+     * @return JTOK_PARSE_STATUS_t JTOK_PARSE_STATUS_OK, whether or not
+     * anything was spliced
+     */
+    JTOK_PARSE_STATUS_t (*splice)(jtok_stitch_t *stitch, jtok_parser_t *parser,
+                                  int depth, jtok_off_t array_idx,
+                                  JTOK_TYPE_t element_type);
+};
+
+
+/**
+ * @brief Initialize a parser for a json string
+ *
+ * @param json_str the json
+ * @param json_len length of json_str
+ * @param tokens token pool
+ * @param poolsize number of tokens in the pool
+ * @return jtok_parser_t the parser, starting at offset 0
+ */
+jtok_parser_t jtok_new_parser(const char *json_str, size_t json_len,
+                              jtok_tkn_t *tokens, size_t poolsize);
+
+
+/**
+ * @brief jtok_parsen with a stitch hook armed for the whole parse
+ *
+ * @param json json string to parse
+ * @param len length of json
+ * @param tkns token pool
+ * @param size number of tokens in tkns
+ * @param stitch the hook, or NULL
+ * @return JTOK_PARSE_STATUS_t parse status
+ */
+JTOK_PARSE_STATUS_t jtok_parse_stitched(const char *json, size_t len,
+                                        jtok_tkn_t *tkns, size_t size,
+                                        jtok_stitch_t *stitch);
+
+#ifdef __cplusplus
+/* clang-format off */
+}
+/* clang-format on */
+#endif /* End C linkage */
+#endif /* __JTOK_STITCH_H__ */
@@ -9,6 +9,12 @@ extern "C"
 
 #include "jtok.h"
 
+#define JTOK_STRING_END -1     /* no more code points */
+#define JTOK_STRING_INVALID -2 /* malformed escape, surrogate or utf-8 */
+
+/* Longest utf-8 encoding of a single code point */
+#define JTOK_STRING_UTF8_MAX 4
+
 /**
  * @brief Parse and fill next available jtok token as a jtok string
  *
@@ -29,6 +35,27 @@ JTOK_PARSE_STATUS_t jtok_parse_string(jtok_parser_t *parser);
 bool jtok_toktokcmp_string(const jtok_tkn_t *tkn1, const jtok_tkn_t *tkn2);
 
 
+/**
+ * @brief Decode the next unicode code point of string text, resolving
+ * escapes (surrogate pairs included) and validating raw utf-8
+ *
+ * @param pos in/out position in the text
+ * @param end end of the text
+ * @return long the code point, JTOK_STRING_END or JTOK_STRING_INVALID
+ */
+long jtok_string_next_cp(const char **pos, const char *end);
+
+
+/**
+ * @brief Encode a code point as utf-8
+ *
+ * @param cp the code point (at most 0x10FFFF)
+ * @param out output location with room for JTOK_STRING_UTF8_MAX bytes
+ * @return int number of bytes written
+ */
+int jtok_string_put_utf8(long cp, char *out);
+
+
 #ifdef __cplusplus
 /* clang-format off */
 }
@@ -0,0 +1,66 @@
+#ifndef __JTOK_SWAR_H__
+#define __JTOK_SWAR_H__
+#ifdef __cplusplus
+/* clang-format off */
+extern "C"
+{
+/* clang-format on */
+#endif /* Start C linkage */
+
+/*
+ * "SIMD within a register" helpers. These test 8 bytes at once using plain
+ * 64-bit integer arithmetic so that the hot scanning loops get most of the
+ * benefit of vector instructions without tying the library to one ISA.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#define JTOK_SWAR_ONES 0x0101010101010101ull
+#define JTOK_SWAR_HIGHS 0x8080808080808080ull
+
+/**
+ * @brief Load 8 bytes from a possibly unaligned address
+ */
+static inline uint64_t jtok_swar_load(const void *src)
+{
+    uint64_t word;
+    memcpy(&word, src, sizeof(word));
+    return word;
+}
+
+/**
+ * @brief Mask with the high bit set in every byte of word that is zero
+ *
+ * @note May also flag a 0x01 byte that directly follows a zero byte, which is
+ * harmless for callers that only use the result to leave the fast path.
+ */
+static inline uint64_t jtok_swar_zero_bytes(uint64_t word)
+{
+    return (word - JTOK_SWAR_ONES) & ~word & JTOK_SWAR_HIGHS;
+}
+
+/**
+ * @brief Mask with the high bit set in bytes of word equal to c
+ */
+static inline uint64_t jtok_swar_eq_bytes(uint64_t word, unsigned char c)
+{
+    return jtok_swar_zero_bytes(word ^ (JTOK_SWAR_ONES * c));
+}
+
+/**
+ * @brief Mask with the high bit set in bytes of word less than n (n <= 128)
+ */
+static inline uint64_t jtok_swar_lt_bytes(uint64_t word, unsigned char n)
+{
+    return (word - JTOK_SWAR_ONES * n) & ~word & JTOK_SWAR_HIGHS;
+}
+
+
+#ifdef __cplusplus
+/* clang-format off */
+}
+/* clang-format on */
+#endif /* End C linkage */
+#endif /* __JTOK_SWAR_H__ */
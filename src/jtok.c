@@ -22,10 +22,10 @@
 #include "jtok_primitive.h"
 #include "jtok_string.h"
 #include "jtok_shared.h"
+#include "jtok_compare.h"
+#include "jtok_stitch.h"
 
 
-static jtok_parser_t jtok_new_parser(const char *json_str, jtok_tkn_t *tokens,
-                                     unsigned int poolsize);
 static bool          jtok_is_type_aggregate(const jtok_tkn_t *const tkn);
 
 
@@ -64,6 +64,10 @@ static const char *jtokerr_messages[] = {
     [JTOK_PARSE_STATUS_NON_ARRAY]        = "JTOK_PARSE_STATUS_NON_ARRAY",
     [JTOK_PARSE_STATUS_EMPTY_KEY]        = "JTOK_PARSE_STATUS_EMPTY_KEY",
     [JTOK_PARSE_STATUS_BAD_STRING]       = "JTOK_PARSE_STATUS_BAD_STRING",
+    [JTOK_PARSE_STATUS_NULL_PARAM]       = "JTOK_PARSE_STATUS_NULL_PARAM",
+    [JTOK_PARSE_STATUS_NEST_DEPTH_EXCEEDED] =
+        "JTOK_PARSE_STATUS_NEST_DEPTH_EXCEEDED",
+    [JTOK_PARSE_STATUS_IO_ERROR] = "JTOK_PARSE_STATUS_IO_ERROR",
 };
 
 
@@ -123,6 +127,9 @@ char *jtok_jtokerr_messages(JTOK_PARSE_STATUS_t err)
         case JTOK_PARSE_STATUS_NON_ARRAY:
         case JTOK_PARSE_STATUS_EMPTY_KEY:
         case JTOK_PARSE_STATUS_BAD_STRING:
+        case JTOK_PARSE_STATUS_NULL_PARAM:
+        case JTOK_PARSE_STATUS_NEST_DEPTH_EXCEEDED:
+        case JTOK_PARSE_STATUS_IO_ERROR:
         {
             retval = (char *)jtokerr_messages[err];
         }
@@ -138,17 +145,12 @@ char *jtok_jtokerr_messages(JTOK_PARSE_STATUS_t err)
 }
 
 
-uint_least16_t jtok_toklen(const jtok_tkn_t *tok)
+size_t jtok_toklen(const jtok_tkn_t *tok)
 {
-    uint_least16_t len = 0;
-    if (tok != NULL)
+    size_t len = 0;
+    if (tok != NULL && tok->end > tok->start)
     {
-        uint_least64_t tokstart = tok->start;
-        uint_least64_t tokend   = tok->end;
-        if (tokend - tokstart < UINT16_MAX)
-        {
-            len = tokend - tokstart;
-        }
+        len = (size_t)(tok->end - tok->start);
     }
     return len;
 }
@@ -173,8 +175,8 @@ bool jtok_tokcmp(const char *str, const jtok_tkn_t *tok)
     }
     else
     {
-        uint_least16_t least_size = jtok_toklen(tok);
-        uint_least16_t slen       = strlen(str);
+        size_t least_size = jtok_toklen(tok);
+        size_t slen       = strlen(str);
         if (least_size < slen)
         {
             least_size = slen;
@@ -195,13 +197,13 @@ bool jtok_tokcmp(const char *str, const jtok_tkn_t *tok)
 }
 
 
-bool jtok_tokncmp(const char *str, const jtok_tkn_t *tok, uint_least16_t n)
+bool jtok_tokncmp(const char *str, const jtok_tkn_t *tok, size_t n)
 {
     bool result = false;
     if (str != NULL && tok != NULL && tok->json != NULL)
     {
-        uint_least16_t least_size = jtok_toklen(tok);
-        uint_least16_t slen       = strlen(str);
+        size_t least_size = jtok_toklen(tok);
+        size_t slen       = strlen(str);
         if (least_size < slen)
         {
             least_size = slen;
@@ -227,12 +229,12 @@ bool jtok_tokncmp(const char *str, const jtok_tkn_t *tok, uint_least16_t n)
 }
 
 
-char *jtok_tokcpy(char *dst, uint_least16_t bufsize, const jtok_tkn_t *tkn)
+char *jtok_tokcpy(char *dst, size_t bufsize, const jtok_tkn_t *tkn)
 {
     char *result = NULL;
     if (dst != NULL && tkn != NULL && tkn->json != NULL)
     {
-        uint_least16_t copy_count = jtok_toklen(tkn);
+        size_t copy_count = jtok_toklen(tkn);
         if (copy_count > bufsize)
         {
             copy_count = bufsize;
@@ -243,11 +245,11 @@ char *jtok_tokcpy(char *dst, uint_least16_t bufsize, const jtok_tkn_t *tkn)
 }
 
 
-char *jtok_tokncpy(char *dst, uint_least16_t bufsize, const jtok_tkn_t *tkn,
-                   uint_least16_t n)
+char *jtok_tokncpy(char *dst, size_t bufsize, const jtok_tkn_t *tkn,
+                   size_t n)
 {
-    char *         result = NULL;
-    uint_least16_t count  = bufsize;
+    char * result = NULL;
+    size_t count  = bufsize;
     if (bufsize > n)
     {
         count = n;
@@ -258,6 +260,25 @@ char *jtok_tokncpy(char *dst, uint_least16_t bufsize, const jtok_tkn_t *tkn,
 
 
 JTOK_PARSE_STATUS_t jtok_parse(const char *json, jtok_tkn_t *tkns, size_t size)
+{
+    if (NULL == json)
+    {
+        return JTOK_PARSE_STATUS_NULL_PARAM;
+    }
+    return jtok_parsen(json, strlen(json), tkns, size);
+}
+
+
+JTOK_PARSE_STATUS_t jtok_parsen(const char *json, size_t len, jtok_tkn_t *tkns,
+                                size_t size)
+{
+    return jtok_parse_stitched(json, len, tkns, size, NULL);
+}
+
+
+JTOK_PARSE_STATUS_t jtok_parse_stitched(const char *json, size_t len,
+                                        jtok_tkn_t *tkns, size_t size,
+                                        jtok_stitch_t *stitch)
 {
     jtok_parser_t       parser;
     JTOK_PARSE_STATUS_t status;
@@ -273,24 +294,44 @@ JTOK_PARSE_STATUS_t jtok_parse(const char *json, jtok_tkn_t *tkns, size_t size)
     {
         status = JTOK_PARSE_STATUS_NOMEM;
     }
+    else if (len > (size_t)JTOK_OFF_MAX)
+    {
+        /* Offsets are jtok_off_t (see JTOK_OFFSET_WIDTH) */
+        status = JTOK_PARSE_STATUS_INVAL;
+    }
     else
     {
-        parser = jtok_new_parser(json, tkns, size);
+        /* Tokens past JTOK_OFF_MAX cannot be indexed, so are not used */
+        if (size > (size_t)JTOK_OFF_MAX)
+        {
+            size = (size_t)JTOK_OFF_MAX;
+        }
+        parser = jtok_new_parser(json, len, tkns, size);
+        parser.stitch = stitch;
 
         /* Skip leading whitespace */
-        while (isspace((int)json[parser.pos]))
+        while (parser.pos < parser.json_len &&
+               isspace((int)json[parser.pos]))
         {
             parser.pos++;
         }
-        status = jtok_parse_object(&parser, 0);
-    }
 
-  // Populates remaining unused tokens with JTOK_UNASSIGNED_TOKEN
-  // - Alex
-  for (int x = parser.toknext; x < size; x++) {
-    tkns[x].type = JTOK_UNASSIGNED_TOKEN;
-  }
+        if (parser.pos == parser.json_len)
+        {
+            status = JTOK_PARSE_STATUS_NON_OBJECT;
+        }
+        else
+        {
+            status = jtok_parse_object(&parser, 0);
+        }
 
+        /* Mark the end of the parsed tokens. Only one token is written so
+         * the cost of a parse does not depend on the size of the pool */
+        if ((size_t)parser.toknext < size)
+        {
+            tkns[parser.toknext].type = JTOK_UNASSIGNED_TOKEN;
+        }
+    }
     return status;
 }
 
@@ -314,19 +355,16 @@ int jtok_token_tostr(char *buf, unsigned int size, const char *json,
     if (buf != NULL)
     {
         unsigned int blen = 0;
-        int          k;
-        blen += snprintf(buf + blen, size - blen, "token : ");
-        for (k = token.start; k < token.end; k++)
-        {
-            blen += snprintf(buf + blen, size - blen, "%c", json[k]);
-        }
-        blen += snprintf(buf + blen, size - blen, "\n");
+        blen += snprintf(buf + blen, size - blen, "token : %.*s\n",
+                         (int)(token.end - token.start), &json[token.start]);
         blen += snprintf(buf + blen, size - blen, "type: %s\n",
                          jtok_toktypename(token.type));
 
 #ifdef DEBUG
-        blen += snprintf(buf + blen, size - blen, "start : %d\n", token.start);
-        blen += snprintf(buf + blen, size - blen, "end : %d\n", token.end);
+        blen += snprintf(buf + blen, size - blen, "start : %lld\n",
+                         (long long)token.start);
+        blen += snprintf(buf + blen, size - blen, "end : %lld\n",
+                         (long long)token.end);
 #endif /* ifdef DEBUG */
 
         return blen;
@@ -341,9 +379,36 @@ int jtok_token_tostr(char *buf, unsigned int size, const char *json,
 bool jtok_toktokcmp(const jtok_tkn_t *tkn1, const jtok_tkn_t *tkn2)
 {
     bool is_equal = false;
-    if (tkn1->type == tkn2->type)
+    if (tkn1 != NULL && tkn2 != NULL && tkn1->type == tkn2->type)
+    {
+        switch (tkn1->type)
+        {
+            case JTOK_PRIMITIVE:
+            case JTOK_OBJECT:
+            case JTOK_ARRAY:
+            case JTOK_STRING:
+            {
+                is_equal = tokcmp_funcs[tkn1->type](tkn1, tkn2);
+            }
+            break;
+            default:
+            {
+                is_equal = false;
+            }
+            break;
+        }
+    }
+    return is_equal;
+}
+
+
+bool jtok_toktokcmp_scratch(const jtok_tkn_t *tkn1, const jtok_tkn_t *tkn2,
+                            jtok_off_t *scratch, size_t scratch_len)
+{
+    bool is_equal = false;
+    if (tkn1 != NULL && tkn2 != NULL)
     {
-        return tokcmp_funcs[tkn1->type];
+        is_equal = jtok_deepcmp(tkn1, tkn2, scratch, scratch_len);
     }
     return is_equal;
 }
@@ -421,18 +486,19 @@ jtok_tkn_t *jtok_get_next_sibling(const jtok_tkn_t *child)
 }
 
 
-static jtok_parser_t jtok_new_parser(const char *json_str, jtok_tkn_t *tokens,
-                                     unsigned int poolsize)
+jtok_parser_t jtok_new_parser(const char *json_str, size_t json_len,
+                              jtok_tkn_t *tokens, size_t poolsize)
 {
     jtok_parser_t parser;
     parser.pos        = 0;
     parser.toknext    = 0;
     parser.toksuper   = JTOK_NO_PARENT_IDX;
     parser.json       = (char *)json_str;
-    parser.json_len   = strlen(json_str);
+    parser.json_len   = (jtok_off_t)json_len;
     parser.last_child = JTOK_NO_CHILD_IDX;
     parser.tkn_pool   = tokens;
-    parser.pool_size  = poolsize;
+    parser.pool_size  = (jtok_off_t)poolsize;
+    parser.stitch     = NULL;
     return parser;
 }
 
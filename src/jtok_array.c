@@ -12,25 +12,17 @@
 #include <assert.h>
 
 #include "jtok_array.h"
+#include "jtok_compare.h"
 #include "jtok_object.h"
 #include "jtok_shared.h"
 #include "jtok_string.h"
 #include "jtok_primitive.h"
+#include "jtok_stitch.h"
 
 JTOK_PARSE_STATUS_t jtok_parse_array(jtok_parser_t *parser, int depth)
 {
-    JTOK_PARSE_STATUS_t status             = JTOK_PARSE_STATUS_OK;
-    jtok_tkn_t *        tokens             = parser->tkn_pool;
-    unsigned int        start              = parser->pos;
-    const char *        json               = parser->json;
-    bool                element_type_found = false;
-    JTOK_TYPE_t         element_type       = JTOK_UNASSIGNED_TOKEN;
-    enum
-    {
-        ARRAY_START,
-        ARRAY_VALUE,
-        ARRAY_COMMA
-    } expecting = ARRAY_START;
+    JTOK_PARSE_STATUS_t status = JTOK_PARSE_STATUS_OK;
+    const char *        json   = parser->json;
 
     if (depth > JTOK_MAX_RECURSE_DEPTH)
     {
@@ -63,7 +55,7 @@ JTOK_PARSE_STATUS_t jtok_parse_array(jtok_parser_t *parser, int depth)
      * stack frame because parsing a sub-object changes the value of
      * parser->toksuper
      */
-    int array_token_index = parser->toksuper;
+    jtok_off_t array_token_index = parser->toksuper;
 
     /* end of token will be populated when we find the closing brace */
     jtok_fill_token(token, JTOK_ARRAY, parser->pos, JTOK_INVALID_ARRAY_INDEX);
@@ -74,6 +66,27 @@ JTOK_PARSE_STATUS_t jtok_parse_array(jtok_parser_t *parser, int depth)
     /* all arrays start with no children (since they can be empty) */
     parser->last_child = JTOK_NO_CHILD_IDX;
 
+    return jtok_parse_array_elements(parser, depth, array_token_index, false);
+}
+
+
+JTOK_PARSE_STATUS_t jtok_parse_array_elements(jtok_parser_t *parser, int depth,
+                                              jtok_off_t array_token_index,
+                                              bool segment)
+{
+    JTOK_PARSE_STATUS_t status             = JTOK_PARSE_STATUS_OK;
+    jtok_tkn_t *        tokens             = parser->tkn_pool;
+    jtok_off_t          start              = tokens[array_token_index].start;
+    const char *        json               = parser->json;
+    bool                element_type_found = false;
+    JTOK_TYPE_t         element_type       = JTOK_UNASSIGNED_TOKEN;
+    enum
+    {
+        ARRAY_START,
+        ARRAY_VALUE,
+        ARRAY_COMMA
+    } expecting = ARRAY_START;
+
     for (; parser->pos < parser->json_len && json[parser->pos] != '\0' &&
            status == JTOK_PARSE_STATUS_OK;
          parser->pos++)
@@ -100,19 +113,24 @@ JTOK_PARSE_STATUS_t jtok_parse_array(jtok_parser_t *parser, int depth)
                             element_type       = JTOK_OBJECT;
                         }
 
-                        int parent_array_idx = parser->toksuper;
+                        jtok_off_t parent_array_idx = parser->toksuper;
+
+                        /* The nested parse overwrites parser->last_child and
+                         * allocates tokens for its own children, so remember
+                         * both the previous element and the new one */
+                        jtok_off_t prev_element_idx = parser->last_child;
+                        jtok_off_t element_idx      = parser->toknext;
                         status = jtok_parse_object(parser, depth + 1);
                         if (status == JTOK_PARSE_STATUS_OK)
                         {
-                            if (parser->last_child != JTOK_NO_CHILD_IDX)
+                            if (prev_element_idx != JTOK_NO_CHILD_IDX)
                             {
                                 /* Link previous child to current child */
-                                tokens[parser->last_child].sibling =
-                                    parser->toknext - 1;
+                                tokens[prev_element_idx].sibling = element_idx;
                             }
 
                             /* Update last child and increase parent size */
-                            parser->last_child = parser->toknext - 1;
+                            parser->last_child = element_idx;
                             tokens[parent_array_idx].size++;
 
                             expecting = ARRAY_COMMA;
@@ -155,19 +173,24 @@ JTOK_PARSE_STATUS_t jtok_parse_array(jtok_parser_t *parser, int depth)
                             element_type       = JTOK_ARRAY;
                         }
 
-                        int parent_array_idx = parser->toksuper;
+                        jtok_off_t parent_array_idx = parser->toksuper;
+
+                        /* The nested parse overwrites parser->last_child and
+                         * allocates tokens for its own children, so remember
+                         * both the previous element and the new one */
+                        jtok_off_t prev_element_idx = parser->last_child;
+                        jtok_off_t element_idx      = parser->toknext;
                         status = jtok_parse_array(parser, depth + 1);
                         if (status == JTOK_PARSE_STATUS_OK)
                         {
-                            if (parser->last_child != JTOK_NO_CHILD_IDX)
+                            if (prev_element_idx != JTOK_NO_CHILD_IDX)
                             {
                                 /* Link previous child to current child */
-                                tokens[parser->last_child].sibling =
-                                    parser->toknext - 1;
+                                tokens[prev_element_idx].sibling = element_idx;
                             }
 
                             /* Update last child and increase parent size */
-                            parser->last_child = parser->toknext - 1;
+                            parser->last_child = element_idx;
                             tokens[parent_array_idx].size++;
 
                             expecting = ARRAY_COMMA;
@@ -199,7 +222,7 @@ JTOK_PARSE_STATUS_t jtok_parse_array(jtok_parser_t *parser, int depth)
                     {
                         jtok_tkn_t *parent_arr = &tokens[array_token_index];
                         if (parent_arr->type != JTOK_ARRAY ||
-                            parser->toknext == 0)
+                            parser->toknext == 0 || segment)
                         {
                             parser->pos = start;
                             status      = JTOK_PARSE_STATUS_INVAL;
@@ -242,8 +265,8 @@ JTOK_PARSE_STATUS_t jtok_parse_array(jtok_parser_t *parser, int depth)
                             element_type       = JTOK_OBJECT;
                         }
 
-                        int super = parser->toksuper;
-                        status    = jtok_parse_string(parser);
+                        jtok_off_t super = parser->toksuper;
+                        status           = jtok_parse_string(parser);
                         if (status == JTOK_PARSE_STATUS_OK)
                         {
                             if (parser->last_child != JTOK_NO_CHILD_IDX)
@@ -288,6 +311,16 @@ JTOK_PARSE_STATUS_t jtok_parse_array(jtok_parser_t *parser, int depth)
                 {
                     case ARRAY_COMMA:
                     {
+                        if (parser->stitch != NULL &&
+                            parser->pos == parser->stitch->from)
+                        {
+                            /* Elements after this comma were parsed ahead
+                             * of time. Splice them in and carry on from the
+                             * comma that follows the last of them. */
+                            status = parser->stitch->splice(
+                                parser->stitch, parser, depth,
+                                array_token_index, element_type);
+                        }
                         expecting = ARRAY_VALUE;
                     }
                     break;
@@ -341,8 +374,8 @@ JTOK_PARSE_STATUS_t jtok_parse_array(jtok_parser_t *parser, int depth)
 
                         if (status == JTOK_PARSE_STATUS_OK)
                         {
-                            int super = parser->toksuper;
-                            status    = jtok_parse_primitive(parser);
+                            jtok_off_t super = parser->toksuper;
+                            status           = jtok_parse_primitive(parser);
                             if (status == JTOK_PARSE_STATUS_OK)
                             {
                                 if (parser->last_child != JTOK_NO_CHILD_IDX)
@@ -383,7 +416,14 @@ JTOK_PARSE_STATUS_t jtok_parse_array(jtok_parser_t *parser, int depth)
         }
     }
 
-    if (status == JTOK_PARSE_STATUS_OK)
+    if (status == JTOK_PARSE_STATUS_OK && segment &&
+        expecting == ARRAY_VALUE && parser->pos == parser->json_len)
+    {
+        /* A run of elements, each followed by its comma, ended exactly at
+         * the end of the text */
+        return status;
+    }
+    else if (status == JTOK_PARSE_STATUS_OK)
     {
         parser->pos = start;
         status      = JTOK_PARSE_STATUS_PARTIAL_TOKEN;
@@ -395,60 +435,11 @@ JTOK_PARSE_STATUS_t jtok_parse_array(jtok_parser_t *parser, int depth)
 
 bool jtok_toktokcmp_array(const jtok_tkn_t *arr1, const jtok_tkn_t *arr2)
 {
-    bool                    is_equal = true;
-    const jtok_tkn_t *const pool1    = arr1->pool;
-    const jtok_tkn_t *const pool2    = arr2->pool;
-    assert(pool1->type == JTOK_OBJECT);
-    assert(pool2->type == JTOK_OBJECT);
+    jtok_off_t scratch[JTOK_TOKCMP_SCRATCH_SIZE];
     if (arr1->type != JTOK_ARRAY || arr2->type != JTOK_ARRAY)
     {
-        is_equal = false;
+        return false;
     }
-    else
-    {
-        if (arr1->size != arr2->size)
-        {
-            is_equal = false;
-        }
-        else if (arr1->size > 0)
-        {
-            /* Arrays have equal size but they aren't empty,
-             * so we'll have to compare their elements */
-            jtok_tkn_t *child1 = (jtok_tkn_t *)&arr1[1];
-            jtok_tkn_t *child2 = (jtok_tkn_t *)&arr2[1];
-            int         i;
-            for (i = 0; i < arr1->size && is_equal; i++)
-            {
-                /* Check that the Ith element of
-                 * first array is equal to Ith
-                 * eleemnt of second array */
-                if (!jtok_toktokcmp(child1, child2))
-                {
-                    is_equal = false;
-                }
-
-                if (child1->sibling == JTOK_NO_SIBLING_IDX)
-                {
-                    /* If this assertion fails there is a logic error
-                     * in the actual parser itself */
-                    assert(child2->sibling == JTOK_NO_SIBLING_IDX);
-                    break;
-                }
-                else
-                {
-                    /* Go to next array element */
-                    child1 = (jtok_tkn_t *)&pool1[child1->sibling];
-                    child2 = (jtok_tkn_t *)&pool2[child2->sibling];
-                }
-            }
-
-            if (i == arr1->size)
-            {
-                is_equal = false;
-            }
-        }
-    }
-
-
-    return is_equal;
+    return jtok_deepcmp(arr1, arr2, scratch,
+                        sizeof(scratch) / sizeof(*scratch));
 }
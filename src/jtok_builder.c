@@ -0,0 +1,406 @@
+/**
+ * @file jtok_builder.c
+ * @author Carl Mattatall (cmattatall2@gmail.com)
+ * @brief Source module to build a document's text and token pool together
+ * @version 0.1
+ * @date 2021-05-06
+ *
+ * @copyright Copyright (c) 2021 Carl Mattatall
+ *
+ */
+
+#include <string.h>
+
+#include "jtok.h"
+#include "jtok_builder.h"
+#include "jtok_shared.h"
+
+
+/**
+ * @brief Check that a value (or key) may be appended. The document root must
+ * be an object, as it must be for jtok_parse.
+ */
+static bool jtok_builder_ready(jtok_builder_t *builder, JTOK_TYPE_t type)
+{
+    if (builder->status == JTOK_WRITE_STATUS_OK && builder->count == 0 &&
+        type != JTOK_OBJECT)
+    {
+        builder->status = JTOK_WRITE_STATUS_INVAL;
+    }
+    return builder->status == JTOK_WRITE_STATUS_OK;
+}
+
+
+/**
+ * @brief Append a token for text the writer just emitted from offset mark
+ *
+ * @param builder the builder
+ * @param type token type
+ * @param mark writer length before the text was emitted
+ * @param depth writer depth before the text was emitted
+ * @param is_key true if the token is an object key
+ * @return jtok_off_t index of the new token, or JTOK_INVALID_ARRAY_INDEX
+ */
+static jtok_off_t jtok_builder_push(jtok_builder_t *builder, JTOK_TYPE_t type,
+                                    size_t mark, int depth, bool is_key)
+{
+    jtok_writer_t *writer = &builder->writer;
+    jtok_tkn_t *   tok;
+    jtok_off_t     idx;
+    jtok_off_t     start;
+    jtok_off_t     end;
+
+    builder->status = writer->status;
+    if (builder->status != JTOK_WRITE_STATUS_OK)
+    {
+        return JTOK_INVALID_ARRAY_INDEX;
+    }
+    if ((size_t)builder->count >= builder->pool_size ||
+        builder->count == JTOK_OFF_MAX || writer->len > (size_t)JTOK_OFF_MAX)
+    {
+        /* Out of tokens, or past what a token can index */
+        builder->status = JTOK_WRITE_STATUS_NOMEM;
+        return JTOK_INVALID_ARRAY_INDEX;
+    }
+
+    /* The writer puts at most a ',' in front of what was asked for */
+    start = (jtok_off_t)mark;
+    if (writer->buf[start] == ',')
+    {
+        start++;
+    }
+    end = (jtok_off_t)writer->len;
+    if (is_key)
+    {
+        end--; /* ':' */
+    }
+    if (type == JTOK_STRING)
+    {
+        /* String tokens exclude their quotes */
+        start++;
+        end--;
+    }
+
+    idx          = builder->count++;
+    tok          = &builder->pool[idx];
+    tok->json    = writer->buf;
+    tok->pool    = builder->pool;
+    tok->type    = type;
+    tok->start   = start;
+    tok->end     = end;
+    tok->size    = 0;
+    tok->parent  = builder->super;
+    tok->sibling = JTOK_NO_SIBLING_IDX;
+
+    if (builder->super != JTOK_NO_PARENT_IDX)
+    {
+        jtok_tkn_t *parent = &builder->pool[builder->super];
+        if (parent->type == JTOK_ARRAY ||
+            (parent->type == JTOK_OBJECT && is_key))
+        {
+            /* Keys and array elements are linked to their next sibling */
+            jtok_off_t *last = &builder->last_child[depth - 1];
+            if (*last != JTOK_NO_CHILD_IDX)
+            {
+                builder->pool[*last].sibling = idx;
+            }
+            *last = idx;
+            parent->size++;
+        }
+    }
+    return idx;
+}
+
+
+/**
+ * @brief A value is complete. If it belonged to a key, return to the object
+ */
+static void jtok_builder_value_done(jtok_builder_t *builder)
+{
+    if (builder->super != JTOK_NO_PARENT_IDX &&
+        builder->pool[builder->super].type == JTOK_STRING)
+    {
+        builder->super = builder->pool[builder->super].parent;
+    }
+}
+
+
+static JTOK_WRITE_STATUS_t jtok_builder_begin(jtok_builder_t *builder,
+                                              JTOK_TYPE_t type)
+{
+    size_t     mark;
+    int        depth;
+    jtok_off_t idx;
+    if (builder == NULL)
+    {
+        return JTOK_WRITE_STATUS_NULL_PARAM;
+    }
+    if (!jtok_builder_ready(builder, type))
+    {
+        return builder->status;
+    }
+
+    mark  = builder->writer.len;
+    depth = builder->writer.depth;
+    if (type == JTOK_OBJECT)
+    {
+        jtok_writer_begin_object(&builder->writer);
+    }
+    else
+    {
+        jtok_writer_begin_array(&builder->writer);
+    }
+    idx = jtok_builder_push(builder, type, mark, depth, false);
+    if (idx != JTOK_INVALID_ARRAY_INDEX)
+    {
+        builder->pool[idx].end     = JTOK_INVALID_ARRAY_INDEX;
+        builder->last_child[depth] = JTOK_NO_CHILD_IDX;
+        builder->super             = idx;
+    }
+    return builder->status;
+}
+
+
+static JTOK_WRITE_STATUS_t jtok_builder_end(jtok_builder_t *builder,
+                                            JTOK_TYPE_t type)
+{
+    jtok_off_t idx;
+    if (builder == NULL)
+    {
+        return JTOK_WRITE_STATUS_NULL_PARAM;
+    }
+    if (builder->status != JTOK_WRITE_STATUS_OK)
+    {
+        return builder->status;
+    }
+
+    if (type == JTOK_OBJECT)
+    {
+        jtok_writer_end_object(&builder->writer);
+    }
+    else
+    {
+        jtok_writer_end_array(&builder->writer);
+    }
+
+    /* The writer has already rejected mismatched or dangling closes */
+    builder->status = builder->writer.status;
+    if (builder->status == JTOK_WRITE_STATUS_OK)
+    {
+        idx                    = builder->super;
+        builder->pool[idx].end = (jtok_off_t)builder->writer.len;
+        builder->super         = builder->pool[idx].parent;
+        jtok_builder_value_done(builder);
+    }
+    return builder->status;
+}
+
+
+/**
+ * @brief Record the token for a leaf value the caller just wrote
+ */
+static JTOK_WRITE_STATUS_t jtok_builder_leaf(jtok_builder_t *builder,
+                                             JTOK_TYPE_t type, size_t mark)
+{
+    if (jtok_builder_push(builder, type, mark, builder->writer.depth, false) !=
+        JTOK_INVALID_ARRAY_INDEX)
+    {
+        jtok_builder_value_done(builder);
+    }
+    return builder->status;
+}
+
+
+void jtok_builder_init(jtok_builder_t *builder, jtok_tkn_t *pool,
+                       size_t pool_size, char *text, size_t text_size)
+{
+    memset(builder, 0, sizeof(*builder));
+    builder->pool      = pool;
+    builder->pool_size = (pool != NULL) ? pool_size : 0;
+    builder->super     = JTOK_NO_PARENT_IDX;
+    builder->status    = JTOK_WRITE_STATUS_OK;
+    if (text == NULL || text_size == 0)
+    {
+        builder->status = JTOK_WRITE_STATUS_NULL_PARAM;
+        text_size       = 1;
+    }
+    jtok_writer_init(&builder->writer, text, text_size - 1, NULL, NULL);
+}
+
+
+JTOK_WRITE_STATUS_t jtok_builder_begin_object(jtok_builder_t *builder)
+{
+    return jtok_builder_begin(builder, JTOK_OBJECT);
+}
+
+
+JTOK_WRITE_STATUS_t jtok_builder_end_object(jtok_builder_t *builder)
+{
+    return jtok_builder_end(builder, JTOK_OBJECT);
+}
+
+
+JTOK_WRITE_STATUS_t jtok_builder_begin_array(jtok_builder_t *builder)
+{
+    return jtok_builder_begin(builder, JTOK_ARRAY);
+}
+
+
+JTOK_WRITE_STATUS_t jtok_builder_end_array(jtok_builder_t *builder)
+{
+    return jtok_builder_end(builder, JTOK_ARRAY);
+}
+
+
+JTOK_WRITE_STATUS_t jtok_builder_key(jtok_builder_t *builder, const char *key,
+                                     size_t len)
+{
+    size_t     mark;
+    jtok_off_t idx;
+    if (builder == NULL || key == NULL)
+    {
+        return JTOK_WRITE_STATUS_NULL_PARAM;
+    }
+    if (!jtok_builder_ready(builder, JTOK_STRING))
+    {
+        return builder->status;
+    }
+    mark = builder->writer.len;
+    jtok_writer_key(&builder->writer, key, len);
+    idx = jtok_builder_push(builder, JTOK_STRING, mark, builder->writer.depth,
+                            true);
+    if (idx != JTOK_INVALID_ARRAY_INDEX)
+    {
+        /* A key's single child is its value */
+        builder->pool[idx].size = 1;
+        builder->super          = idx;
+    }
+    return builder->status;
+}
+
+
+JTOK_WRITE_STATUS_t jtok_builder_string(jtok_builder_t *builder,
+                                        const char *str, size_t len)
+{
+    size_t mark;
+    if (builder == NULL || str == NULL)
+    {
+        return JTOK_WRITE_STATUS_NULL_PARAM;
+    }
+    if (!jtok_builder_ready(builder, JTOK_STRING))
+    {
+        return builder->status;
+    }
+    mark = builder->writer.len;
+    jtok_writer_string(&builder->writer, str, len);
+    return jtok_builder_leaf(builder, JTOK_STRING, mark);
+}
+
+
+JTOK_WRITE_STATUS_t jtok_builder_int(jtok_builder_t *builder, int64_t value)
+{
+    size_t mark;
+    if (builder == NULL)
+    {
+        return JTOK_WRITE_STATUS_NULL_PARAM;
+    }
+    if (!jtok_builder_ready(builder, JTOK_PRIMITIVE))
+    {
+        return builder->status;
+    }
+    mark = builder->writer.len;
+    jtok_writer_int(&builder->writer, value);
+    return jtok_builder_leaf(builder, JTOK_PRIMITIVE, mark);
+}
+
+
+JTOK_WRITE_STATUS_t jtok_builder_uint(jtok_builder_t *builder, uint64_t value)
+{
+    size_t mark;
+    if (builder == NULL)
+    {
+        return JTOK_WRITE_STATUS_NULL_PARAM;
+    }
+    if (!jtok_builder_ready(builder, JTOK_PRIMITIVE))
+    {
+        return builder->status;
+    }
+    mark = builder->writer.len;
+    jtok_writer_uint(&builder->writer, value);
+    return jtok_builder_leaf(builder, JTOK_PRIMITIVE, mark);
+}
+
+
+JTOK_WRITE_STATUS_t jtok_builder_double(jtok_builder_t *builder, double value)
+{
+    size_t mark;
+    if (builder == NULL)
+    {
+        return JTOK_WRITE_STATUS_NULL_PARAM;
+    }
+    if (!jtok_builder_ready(builder, JTOK_PRIMITIVE))
+    {
+        return builder->status;
+    }
+    mark = builder->writer.len;
+    jtok_writer_double(&builder->writer, value);
+    return jtok_builder_leaf(builder, JTOK_PRIMITIVE, mark);
+}
+
+
+JTOK_WRITE_STATUS_t jtok_builder_bool(jtok_builder_t *builder, bool value)
+{
+    size_t mark;
+    if (builder == NULL)
+    {
+        return JTOK_WRITE_STATUS_NULL_PARAM;
+    }
+    if (!jtok_builder_ready(builder, JTOK_PRIMITIVE))
+    {
+        return builder->status;
+    }
+    mark = builder->writer.len;
+    jtok_writer_bool(&builder->writer, value);
+    return jtok_builder_leaf(builder, JTOK_PRIMITIVE, mark);
+}
+
+
+JTOK_WRITE_STATUS_t jtok_builder_null(jtok_builder_t *builder)
+{
+    size_t mark;
+    if (builder == NULL)
+    {
+        return JTOK_WRITE_STATUS_NULL_PARAM;
+    }
+    if (!jtok_builder_ready(builder, JTOK_PRIMITIVE))
+    {
+        return builder->status;
+    }
+    mark = builder->writer.len;
+    jtok_writer_null(&builder->writer);
+    return jtok_builder_leaf(builder, JTOK_PRIMITIVE, mark);
+}
+
+
+JTOK_WRITE_STATUS_t jtok_builder_finish(jtok_builder_t *builder)
+{
+    if (builder == NULL)
+    {
+        return JTOK_WRITE_STATUS_NULL_PARAM;
+    }
+    if (builder->status == JTOK_WRITE_STATUS_OK &&
+        (!builder->writer.root_done || builder->writer.depth != 0))
+    {
+        builder->status = JTOK_WRITE_STATUS_INVAL;
+    }
+    if (builder->status == JTOK_WRITE_STATUS_OK)
+    {
+        /* init reserved this byte */
+        builder->writer.buf[builder->writer.len] = '\0';
+        if ((size_t)builder->count < builder->pool_size)
+        {
+            builder->pool[builder->count].type = JTOK_UNASSIGNED_TOKEN;
+        }
+    }
+    return builder->status;
+}
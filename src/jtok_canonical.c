@@ -0,0 +1,375 @@
+/**
+ * @file jtok_canonical.c
+ * @author Carl Mattatall (cmattatall2@gmail.com)
+ * @brief Source module to emit RFC 8785 canonical json from a token pool
+ * @version 0.1
+ * @date 2021-05-07
+ *
+ * @copyright Copyright (c) 2021 Carl Mattatall
+ *
+ */
+
+#include <string.h>
+
+#include "jtok.h"
+#include "jtok_dtoa.h"
+#include "jtok_shared.h"
+#include "jtok_primitive.h"
+#include "jtok_string.h"
+
+/* Output is staged in this many bytes before being handed to write */
+#define JTOK_CANON_CHUNK 64
+
+typedef struct
+{
+    jtok_write_fn       write;
+    void *              ctx;
+    jtok_off_t *        scratch;
+    size_t              scratch_len;
+    size_t              scratch_used;
+    JTOK_WRITE_STATUS_t status;
+} jtok_canon_t;
+
+/* Walks the code units of a string token as UTF-16, after unescaping */
+typedef struct
+{
+    const char *pos;
+    const char *end;
+    long        low; /* pending low surrogate, or JTOK_STRING_END */
+} jtok_canon_utf16_t;
+
+
+static long jtok_canon_next_unit(jtok_canon_utf16_t *it)
+{
+    long cp;
+    if (it->low != JTOK_STRING_END)
+    {
+        cp      = it->low;
+        it->low = JTOK_STRING_END;
+        return cp;
+    }
+    cp = jtok_string_next_cp(&it->pos, it->end);
+    if (cp > 0xFFFF)
+    {
+        cp -= 0x10000;
+        it->low = 0xDC00 | (cp & 0x3FF);
+        cp      = 0xD800 | (cp >> 10);
+    }
+    return cp;
+}
+
+
+/**
+ * @brief Order two key tokens by the UTF-16 code units of their values, as
+ * RFC 8785 section 3.2.3 requires
+ */
+static int jtok_canon_keycmp(const jtok_tkn_t *key1, const jtok_tkn_t *key2)
+{
+    jtok_canon_utf16_t it1 = {&key1->json[key1->start], &key1->json[key1->end],
+                              JTOK_STRING_END};
+    jtok_canon_utf16_t it2 = {&key2->json[key2->start], &key2->json[key2->end],
+                              JTOK_STRING_END};
+    long               u1;
+    long               u2;
+    do
+    {
+        u1 = jtok_canon_next_unit(&it1);
+        u2 = jtok_canon_next_unit(&it2);
+    } while (u1 == u2 && u1 >= 0);
+    return (u1 < u2) ? -1 : (u1 > u2) ? 1 : 0;
+}
+
+
+static bool jtok_canon_emit(jtok_canon_t *canon, const char *data, size_t len)
+{
+    if (canon->status == JTOK_WRITE_STATUS_OK && len > 0)
+    {
+        if (0 != canon->write(canon->ctx, data, len))
+        {
+            canon->status = JTOK_WRITE_STATUS_SINK_ERROR;
+        }
+    }
+    return canon->status == JTOK_WRITE_STATUS_OK;
+}
+
+
+/**
+ * @brief Emit a string token with only the escapes RFC 8785 requires
+ */
+static void jtok_canon_string(jtok_canon_t *canon, const jtok_tkn_t *tkn)
+{
+    static const char hex[] = "0123456789abcdef";
+    char              out[JTOK_CANON_CHUNK];
+    size_t            len = 0;
+    const char *      pos = &tkn->json[tkn->start];
+    const char *      end = &tkn->json[tkn->end];
+    long              cp;
+
+    out[len++] = '\"';
+    while ((cp = jtok_string_next_cp(&pos, end)) >= 0)
+    {
+        if (len > sizeof(out) - 8)
+        {
+            jtok_canon_emit(canon, out, len);
+            len = 0;
+        }
+        switch (cp)
+        {
+            case '\"':
+            case '\\':
+            {
+                out[len++] = '\\';
+                out[len++] = (char)cp;
+            }
+            break;
+            case '\b':
+            {
+                out[len++] = '\\';
+                out[len++] = 'b';
+            }
+            break;
+            case '\f':
+            {
+                out[len++] = '\\';
+                out[len++] = 'f';
+            }
+            break;
+            case '\n':
+            {
+                out[len++] = '\\';
+                out[len++] = 'n';
+            }
+            break;
+            case '\r':
+            {
+                out[len++] = '\\';
+                out[len++] = 'r';
+            }
+            break;
+            case '\t':
+            {
+                out[len++] = '\\';
+                out[len++] = 't';
+            }
+            break;
+            default:
+            {
+                if (cp < 0x20)
+                {
+                    memcpy(&out[len], "\\u00", 4);
+                    out[len + 4] = hex[cp >> 4];
+                    out[len + 5] = hex[cp & 0xF];
+                    len += 6;
+                }
+                else
+                {
+                    len += jtok_string_put_utf8(cp, &out[len]);
+                }
+            }
+            break;
+        }
+    }
+    if (cp == JTOK_STRING_INVALID)
+    {
+        canon->status = JTOK_WRITE_STATUS_INVAL;
+        return;
+    }
+    out[len++] = '\"';
+    jtok_canon_emit(canon, out, len);
+}
+
+
+/**
+ * @brief Emit a number the way ECMAScript Number.prototype.toString would
+ */
+static void jtok_canon_number(jtok_canon_t *canon, const jtok_tkn_t *tkn)
+{
+    double value;
+    char   out[JTOK_DTOA_FORMAT_MAX];
+
+    if (!jtok_primitive_todouble(tkn, &value) || value != value ||
+        value - value != 0)
+    {
+        /* Not a number, NaN or out of double range */
+        canon->status = JTOK_WRITE_STATUS_INVAL;
+        return;
+    }
+    jtok_canon_emit(canon, out, jtok_dtoa_format(value, out));
+}
+
+
+static void jtok_canon_value(jtok_canon_t *canon, const jtok_tkn_t *tkn,
+                             int depth);
+
+
+static void jtok_canon_member(jtok_canon_t *canon, const jtok_tkn_t *key,
+                              bool first, int depth)
+{
+    if (!first)
+    {
+        jtok_canon_emit(canon, ",", 1);
+    }
+    jtok_canon_string(canon, key);
+    jtok_canon_emit(canon, ":", 1);
+    jtok_canon_value(canon, key + 1, depth);
+}
+
+
+static void jtok_canon_object(jtok_canon_t *canon, const jtok_tkn_t *tkn,
+                              int depth)
+{
+    size_t need = (size_t)tkn->size;
+    jtok_canon_emit(canon, "{", 1);
+    if (need <= canon->scratch_len - canon->scratch_used)
+    {
+        /* Sort an index array of the keys. Member text is never copied. */
+        size_t            mark   = canon->scratch_used;
+        jtok_off_t *      sorted = &canon->scratch[mark];
+        size_t            count  = 0;
+        size_t            i;
+        const jtok_tkn_t *key = (tkn->size > 0) ? tkn + 1 : NULL;
+        for (; key != NULL && count < need; key = jtok_get_next_sibling(key))
+        {
+            sorted[count++] = (jtok_off_t)(key - tkn->pool);
+        }
+        canon->scratch_used += need;
+        jtok_sort_tokens(tkn->pool, sorted, count, jtok_canon_keycmp);
+        for (i = 0; i < count && canon->status == JTOK_WRITE_STATUS_OK; i++)
+        {
+            if (i > 0 && jtok_canon_keycmp(&tkn->pool[sorted[i - 1]],
+                                           &tkn->pool[sorted[i]]) == 0)
+            {
+                canon->status = JTOK_WRITE_STATUS_INVAL; /* duplicate key */
+                break;
+            }
+            jtok_canon_member(canon, &tkn->pool[sorted[i]], i == 0, depth);
+        }
+        canon->scratch_used = mark;
+    }
+    else
+    {
+        /* Not enough scratch: repeatedly select the next smallest key */
+        const jtok_tkn_t *prev = NULL;
+        int               i;
+        for (i = 0; i < tkn->size && canon->status == JTOK_WRITE_STATUS_OK;
+             i++)
+        {
+            const jtok_tkn_t *next = NULL;
+            const jtok_tkn_t *key  = tkn + 1;
+            for (; key != NULL; key = jtok_get_next_sibling(key))
+            {
+                if (prev == NULL || jtok_canon_keycmp(key, prev) > 0)
+                {
+                    int order = (next == NULL) ? -1
+                                               : jtok_canon_keycmp(key, next);
+                    if (order == 0)
+                    {
+                        canon->status = JTOK_WRITE_STATUS_INVAL;
+                    }
+                    else if (order < 0)
+                    {
+                        next = key;
+                    }
+                }
+            }
+            if (next == NULL)
+            {
+                break;
+            }
+            jtok_canon_member(canon, next, i == 0, depth);
+            prev = next;
+        }
+    }
+    jtok_canon_emit(canon, "}", 1);
+}
+
+
+static void jtok_canon_value(jtok_canon_t *canon, const jtok_tkn_t *tkn,
+                             int depth)
+{
+    if (canon->status != JTOK_WRITE_STATUS_OK)
+    {
+        return;
+    }
+    if (depth > JTOK_MAX_RECURSE_DEPTH)
+    {
+        canon->status = JTOK_WRITE_STATUS_NEST_DEPTH_EXCEEDED;
+        return;
+    }
+    if (tkn->json == NULL)
+    {
+        canon->status = JTOK_WRITE_STATUS_INVAL;
+        return;
+    }
+
+    switch (tkn->type)
+    {
+        case JTOK_OBJECT:
+        {
+            jtok_canon_object(canon, tkn, depth + 1);
+        }
+        break;
+        case JTOK_ARRAY:
+        {
+            const jtok_tkn_t *elem  = (tkn->size > 0) ? tkn + 1 : NULL;
+            bool              first = true;
+            jtok_canon_emit(canon, "[", 1);
+            for (; elem != NULL && canon->status == JTOK_WRITE_STATUS_OK;
+                 elem = jtok_get_next_sibling(elem))
+            {
+                if (!first)
+                {
+                    jtok_canon_emit(canon, ",", 1);
+                }
+                first = false;
+                jtok_canon_value(canon, elem, depth + 1);
+            }
+            jtok_canon_emit(canon, "]", 1);
+        }
+        break;
+        case JTOK_STRING:
+        {
+            jtok_canon_string(canon, tkn);
+        }
+        break;
+        case JTOK_PRIMITIVE:
+        {
+            if (jtok_primitive_is_number(tkn))
+            {
+                jtok_canon_number(canon, tkn);
+            }
+            else
+            {
+                /* true, false and null are already canonical */
+                jtok_canon_emit(canon, &tkn->json[tkn->start],
+                                (size_t)(tkn->end - tkn->start));
+            }
+        }
+        break;
+        default:
+        {
+            canon->status = JTOK_WRITE_STATUS_INVAL;
+        }
+        break;
+    }
+}
+
+
+JTOK_WRITE_STATUS_t jtok_canonical(const jtok_tkn_t *tkn, jtok_off_t *scratch,
+                                   size_t scratch_len, jtok_write_fn write,
+                                   void *ctx)
+{
+    jtok_canon_t canon;
+    if (tkn == NULL || write == NULL)
+    {
+        return JTOK_WRITE_STATUS_NULL_PARAM;
+    }
+    canon.write        = write;
+    canon.ctx          = ctx;
+    canon.scratch      = scratch;
+    canon.scratch_len  = (scratch != NULL) ? scratch_len : 0;
+    canon.scratch_used = 0;
+    canon.status       = JTOK_WRITE_STATUS_OK;
+    jtok_canon_value(&canon, tkn, 0);
+    return canon.status;
+}
@@ -0,0 +1,408 @@
+/**
+ * @file jtok_compare.c
+ * @author Carl Mattatall (cmattatall2@gmail.com)
+ * @brief Source module for deep (structural) comparison of jtok tokens
+ * @version 0.1
+ * @date 2021-04-10
+ *
+ * @copyright Copyright (c) 2021 Carl Mattatall
+ *
+ * @note The comparison walks both trees with an explicit stack instead of
+ * recursing through jtok_toktokcmp, so stack usage is bounded by
+ * JTOK_MAX_RECURSE_DEPTH regardless of document shape.
+ */
+
+#include <string.h>
+
+#include "jtok_compare.h"
+#include "jtok_hash.h"
+#include "jtok_primitive.h"
+#include "jtok_string.h"
+#include "jtok_shared.h"
+
+/* Aggregates nest at most JTOK_MAX_RECURSE_DEPTH + 1 levels deep */
+#define JTOK_CMP_STACK_DEPTH (JTOK_MAX_RECURSE_DEPTH + 2)
+
+/* Key table slots that hold no key, or a key already matched */
+#define JTOK_CMP_SLOT_EMPTY ((jtok_off_t)-1)
+#define JTOK_CMP_SLOT_TAKEN ((jtok_off_t)-2)
+
+typedef struct
+{
+    const jtok_tkn_t *agg1;      /* aggregate from first tree */
+    const jtok_tkn_t *agg2;      /* aggregate from second tree */
+    const jtok_tkn_t *cur1;      /* next unvisited child of agg1 */
+    const jtok_tkn_t *cur2;      /* next unvisited child of agg2 */
+    jtok_off_t *      table;     /* agg2 keys by hash (or NULL) */
+    size_t            slots;     /* entries in table */
+    bool              dups;      /* agg2 has a key more than once */
+    int               next;      /* index of next pair to compare */
+    size_t            scratch_mark; /* scratch in use before this frame */
+} jtok_cmp_frame_t;
+
+
+static const jtok_tkn_t *jtok_cmp_next_sibling(const jtok_tkn_t *tkn)
+{
+    if (tkn->sibling == JTOK_NO_SIBLING_IDX)
+    {
+        return NULL;
+    }
+    return &tkn->pool[tkn->sibling];
+}
+
+
+static bool jtok_cmp_span_identical(const jtok_tkn_t *tkn1,
+                                    const jtok_tkn_t *tkn2)
+{
+    bool identical = false;
+    if (tkn1->json != NULL && tkn2->json != NULL)
+    {
+        jtok_off_t len = tkn1->end - tkn1->start;
+        if (len == tkn2->end - tkn2->start && len >= 0)
+        {
+            identical = (0 == memcmp(&tkn1->json[tkn1->start],
+                                     &tkn2->json[tkn2->start], (size_t)len));
+        }
+    }
+    return identical;
+}
+
+
+static uint64_t jtok_cmp_key_hash(const jtok_tkn_t *key)
+{
+    return jtok_hash_bytes(&key->json[key->start], jtok_toklen(key), 0);
+}
+
+
+/* Hash of the value of a member, to tell apart members with the same key */
+static uint64_t jtok_cmp_value_hash(const jtok_tkn_t *key)
+{
+    return (key->size > 0) ? jtok_hash(&key[1]) : 0;
+}
+
+
+/**
+ * @brief Index the keys of an object in an open-addressed hash table
+ *
+ * @param obj the object
+ * @param table the table
+ * @param slots number of entries in table, more than obj->size
+ * @param dups set if a key occurs more than once
+ * @return size_t number of keys indexed
+ */
+static size_t jtok_cmp_index_keys(const jtok_tkn_t *obj, jtok_off_t *table,
+                                  size_t slots, bool *dups)
+{
+    size_t            count = 0;
+    const jtok_tkn_t *key   = (obj->size > 0) ? &obj[1] : NULL;
+    size_t            slot;
+
+    *dups = false;
+    for (slot = 0; slot < slots; slot++)
+    {
+        table[slot] = JTOK_CMP_SLOT_EMPTY;
+    }
+    while (key != NULL && count < (size_t)obj->size)
+    {
+        slot = (size_t)(jtok_cmp_key_hash(key) % slots);
+        while (table[slot] != JTOK_CMP_SLOT_EMPTY)
+        {
+            if (0 == jtok_keycmp(&obj->pool[table[slot]], key))
+            {
+                *dups = true;
+            }
+            slot = (slot + 1) % slots;
+        }
+        table[slot] = (jtok_off_t)(key - obj->pool);
+        count++;
+        key = jtok_cmp_next_sibling(key);
+    }
+    return count;
+}
+
+
+/**
+ * @brief Find the unmatched member of the indexed object that pairs with
+ * key, and mark it matched. Members with the same key pair up by the hash
+ * of their values.
+ */
+static const jtok_tkn_t *jtok_cmp_take_key(const jtok_cmp_frame_t *frame,
+                                           const jtok_tkn_t *      key)
+{
+    const jtok_tkn_t *pool  = frame->agg2->pool;
+    size_t            slot  = (size_t)(jtok_cmp_key_hash(key) % frame->slots);
+    bool              known = false;
+    uint64_t          value = 0;
+
+    for (; frame->table[slot] != JTOK_CMP_SLOT_EMPTY;
+         slot = (slot + 1) % frame->slots)
+    {
+        const jtok_tkn_t *candidate;
+        if (frame->table[slot] == JTOK_CMP_SLOT_TAKEN)
+        {
+            continue;
+        }
+        candidate = &pool[frame->table[slot]];
+        if (0 != jtok_keycmp(key, candidate))
+        {
+            continue;
+        }
+        if (frame->dups)
+        {
+            if (!known)
+            {
+                value = jtok_cmp_value_hash(key);
+                known = true;
+            }
+            if (value != jtok_cmp_value_hash(candidate))
+            {
+                continue;
+            }
+        }
+        frame->table[slot] = JTOK_CMP_SLOT_TAKEN;
+        return candidate;
+    }
+    return NULL;
+}
+
+
+/* Count the members of obj with the key of member, and if by_value, with a
+ * value of the given hash. first is set to the first one found. */
+static size_t jtok_cmp_count_members(const jtok_tkn_t *obj,
+                                     const jtok_tkn_t *member, bool by_value,
+                                     uint64_t value, const jtok_tkn_t **first)
+{
+    const jtok_tkn_t *key   = (obj->size > 0) ? &obj[1] : NULL;
+    size_t            count = 0;
+    *first                  = NULL;
+    for (; key != NULL; key = jtok_cmp_next_sibling(key))
+    {
+        if (0 == jtok_keycmp(member, key) &&
+            (!by_value || value == jtok_cmp_value_hash(key)))
+        {
+            if (count++ == 0)
+            {
+                *first = key;
+            }
+        }
+    }
+    return count;
+}
+
+
+/**
+ * @brief Find the member of obj2 that pairs with a member of obj1 without
+ * any scratch, in O(n) per member. The last resort for objects too large
+ * for the scratch left.
+ *
+ * @note A key that occurs more than once must occur as often in both
+ * objects with each value (compared by hash), so the pairing is the same
+ * whichever object is searched.
+ */
+static const jtok_tkn_t *jtok_cmp_find_key(const jtok_tkn_t *obj1,
+                                           const jtok_tkn_t *obj2,
+                                           const jtok_tkn_t *key)
+{
+    const jtok_tkn_t *found;
+    const jtok_tkn_t *ignored;
+    size_t            n1 = jtok_cmp_count_members(obj1, key, false, 0, &ignored);
+    size_t            n2 = jtok_cmp_count_members(obj2, key, false, 0, &found);
+    uint64_t          value;
+
+    if (n1 != n2)
+    {
+        return NULL;
+    }
+    if (n2 > 1)
+    {
+        value = jtok_cmp_value_hash(key);
+        n1    = jtok_cmp_count_members(obj1, key, true, value, &ignored);
+        n2    = jtok_cmp_count_members(obj2, key, true, value, &found);
+        if (n1 != n2)
+        {
+            return NULL;
+        }
+    }
+    return found;
+}
+
+
+bool jtok_deepcmp(const jtok_tkn_t *tkn1, const jtok_tkn_t *tkn2,
+                  jtok_off_t *scratch, size_t scratch_len)
+{
+    jtok_cmp_frame_t  stack[JTOK_CMP_STACK_DEPTH];
+    int               depth        = 0;
+    size_t            scratch_used = 0;
+    const jtok_tkn_t *a            = tkn1;
+    const jtok_tkn_t *b            = tkn2;
+
+    if (scratch == NULL)
+    {
+        scratch_len = 0;
+    }
+
+    /* Equal subtrees always hash equal, so differing hashes settle it in
+     * one linear pass, before any keys are sorted or searched */
+    if (a != NULL && b != NULL && a->type == b->type &&
+        (a->type == JTOK_OBJECT || a->type == JTOK_ARRAY) && a != b &&
+        !jtok_cmp_span_identical(a, b))
+    {
+        uint64_t h1 = jtok_hash(a);
+        uint64_t h2 = jtok_hash(b);
+        if (h1 != 0 && h2 != 0 && h1 != h2)
+        {
+            return false;
+        }
+    }
+
+    for (;;)
+    {
+        /* Compare the current pair, descending into it if aggregate */
+        if (a == NULL || b == NULL || a->type != b->type)
+        {
+            return false;
+        }
+
+        if (a != b && !jtok_cmp_span_identical(a, b))
+        {
+            switch (a->type)
+            {
+                case JTOK_PRIMITIVE:
+                {
+                    if (!jtok_toktokcmp_primitive(a, b))
+                    {
+                        return false;
+                    }
+                }
+                break;
+                case JTOK_STRING:
+                {
+                    if (!jtok_toktokcmp_string(a, b))
+                    {
+                        return false;
+                    }
+                }
+                break;
+                case JTOK_OBJECT:
+                case JTOK_ARRAY:
+                {
+                    if (a->size != b->size)
+                    {
+                        return false;
+                    }
+                    else if (a->size > 0)
+                    {
+                        if (depth == JTOK_CMP_STACK_DEPTH)
+                        {
+                            /* Cannot come from jtok_parse */
+                            return false;
+                        }
+
+                        jtok_cmp_frame_t *frame = &stack[depth++];
+                        frame->agg1             = a;
+                        frame->agg2             = b;
+                        frame->cur1             = &a[1];
+                        frame->cur2             = &b[1];
+                        frame->table            = NULL;
+                        frame->slots            = 0;
+                        frame->dups             = false;
+                        frame->next             = 0;
+                        frame->scratch_mark     = scratch_used;
+
+                        /* Index the keys of the second object by hash, in
+                         * twice as many slots as keys when there is room */
+                        size_t room = scratch_len - scratch_used;
+                        size_t need = 2 * (size_t)a->size;
+                        if (a->type == JTOK_OBJECT && room > (size_t)a->size)
+                        {
+                            frame->table = &scratch[scratch_used];
+                            frame->slots = (room < need) ? room : need;
+                            scratch_used += frame->slots;
+                            if (jtok_cmp_index_keys(b, frame->table,
+                                                    frame->slots,
+                                                    &frame->dups) !=
+                                (size_t)b->size)
+                            {
+                                return false;
+                            }
+                        }
+                    }
+                }
+                break;
+                default:
+                {
+                    return false;
+                }
+                break;
+            }
+        }
+
+        /* Pick the next pair from the innermost unfinished aggregate */
+        a = NULL;
+        b = NULL;
+        while (a == NULL && depth > 0)
+        {
+            jtok_cmp_frame_t *frame = &stack[depth - 1];
+            if (frame->next == frame->agg1->size)
+            {
+                scratch_used = frame->scratch_mark;
+                depth--;
+                continue;
+            }
+
+            if (frame->agg1->type == JTOK_ARRAY)
+            {
+                a           = frame->cur1;
+                b           = frame->cur2;
+                frame->cur1 = (a != NULL) ? jtok_cmp_next_sibling(a) : NULL;
+                frame->cur2 = (b != NULL) ? jtok_cmp_next_sibling(b) : NULL;
+                if (a == NULL || b == NULL)
+                {
+                    return false;
+                }
+            }
+            else
+            {
+                const jtok_tkn_t *key1 = frame->cur1;
+                const jtok_tkn_t *key2;
+                if (key1 == NULL)
+                {
+                    return false;
+                }
+                frame->cur1 = jtok_cmp_next_sibling(key1);
+                if (frame->table != NULL)
+                {
+                    key2 = jtok_cmp_take_key(frame, key1);
+                }
+                else
+                {
+                    key2 = jtok_cmp_find_key(frame->agg1, frame->agg2, key1);
+                }
+                if (key2 == NULL)
+                {
+                    return false;
+                }
+
+                /* A key's value is always the token right after it */
+                if (key1->size != key2->size)
+                {
+                    return false;
+                }
+                a = (key1->size > 0) ? &key1[1] : NULL;
+                b = (key2->size > 0) ? &key2[1] : NULL;
+                if (a == NULL && b == NULL)
+                {
+                    frame->next++;
+                    continue;
+                }
+            }
+            frame->next++;
+        }
+
+        if (a == NULL)
+        {
+            /* Every frame was exhausted without finding a difference */
+            return true;
+        }
+    }
+}
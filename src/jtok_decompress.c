@@ -0,0 +1,354 @@
+/**
+ * @file jtok_decompress.c
+ * @author Carl Mattatall (cmattatall2@gmail.com)
+ * @brief Source module to parse compressed json as it is decompressed
+ * @version 0.1
+ * @date 2021-05-16
+ *
+ * @copyright Copyright (c) 2021 Carl Mattatall
+ *
+ */
+#include <limits.h>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(JTOK_HAVE_ZLIB)
+#include <zlib.h>
+#endif /* #if defined(JTOK_HAVE_ZLIB) */
+
+#if defined(JTOK_HAVE_ZSTD)
+#include <zstd.h>
+#endif /* #if defined(JTOK_HAVE_ZSTD) */
+
+#include "jtok.h"
+#include "jtok_decompress.h"
+#include "jtok_events.h"
+
+typedef struct
+{
+    const jtok_decompress_config_t *config;
+    jtok_decompress_read_fn         read;
+    void *                          read_ctx;
+    JTOK_CODEC_t                    codec;
+    size_t                          in_pos; /* next unconsumed byte of in */
+    size_t                          in_end; /* bytes of in holding data */
+    bool                            eof;    /* read has returned 0 */
+    bool                            ended;  /* the decoder is between
+                                               members or frames */
+#if defined(JTOK_HAVE_ZLIB)
+    z_stream z;
+    bool     z_ready;
+#endif /* #if defined(JTOK_HAVE_ZLIB) */
+#if defined(JTOK_HAVE_ZSTD)
+    ZSTD_DStream *zs;
+#endif /* #if defined(JTOK_HAVE_ZSTD) */
+} jtok_decompress_t;
+
+
+bool jtok_codec_available(JTOK_CODEC_t codec)
+{
+    switch (codec)
+    {
+        case JTOK_CODEC_AUTO:
+        case JTOK_CODEC_NONE:
+        {
+            return true;
+        }
+        break;
+        case JTOK_CODEC_GZIP:
+        {
+#if defined(JTOK_HAVE_ZLIB)
+            return true;
+#endif /* #if defined(JTOK_HAVE_ZLIB) */
+        }
+        break;
+        case JTOK_CODEC_ZSTD:
+        {
+#if defined(JTOK_HAVE_ZSTD)
+            return true;
+#endif /* #if defined(JTOK_HAVE_ZSTD) */
+        }
+        break;
+    }
+    return false;
+}
+
+
+/* Top up the input buffer once it has all been consumed */
+static void jtok_decompress_refill(jtok_decompress_t *d)
+{
+    size_t got;
+    if (d->in_pos < d->in_end || d->eof)
+    {
+        return;
+    }
+    got       = d->read(d->read_ctx, d->config->in, d->config->in_len);
+    d->in_pos = 0;
+    d->in_end = (got > d->config->in_len) ? d->config->in_len : got;
+    d->eof    = (got == 0);
+}
+
+
+/* Read enough of the stream to recognise its codec from the magic bytes */
+static JTOK_CODEC_t jtok_decompress_sniff(jtok_decompress_t *d)
+{
+    static const unsigned char gzip[] = {0x1f, 0x8b};
+    static const unsigned char zstd[] = {0x28, 0xb5, 0x2f, 0xfd};
+    size_t                     got    = 1;
+
+    while (d->in_end < JTOK_DECOMPRESS_MIN_IN && got > 0)
+    {
+        got = d->read(d->read_ctx, &d->config->in[d->in_end],
+                      d->config->in_len - d->in_end);
+        d->in_end += got;
+    }
+    d->eof = (d->in_end == 0);
+
+    if (d->in_end >= sizeof(gzip) &&
+        memcmp(d->config->in, gzip, sizeof(gzip)) == 0)
+    {
+        return JTOK_CODEC_GZIP;
+    }
+    if (d->in_end >= sizeof(zstd) &&
+        memcmp(d->config->in, zstd, sizeof(zstd)) == 0)
+    {
+        return JTOK_CODEC_ZSTD;
+    }
+    return JTOK_CODEC_NONE;
+}
+
+
+static JTOK_PARSE_STATUS_t jtok_decompress_open(jtok_decompress_t *d)
+{
+    if (d->codec == JTOK_CODEC_AUTO)
+    {
+        d->codec = jtok_decompress_sniff(d);
+    }
+    if (!jtok_codec_available(d->codec))
+    {
+        return JTOK_PARSE_STATUS_INVAL;
+    }
+
+#if defined(JTOK_HAVE_ZLIB)
+    if (d->codec == JTOK_CODEC_GZIP)
+    {
+        /* 32 on top of the window size detects gzip or zlib headers */
+        if (inflateInit2(&d->z, MAX_WBITS + 32) != Z_OK)
+        {
+            return JTOK_PARSE_STATUS_NOMEM;
+        }
+        d->z_ready = true;
+    }
+#endif /* #if defined(JTOK_HAVE_ZLIB) */
+#if defined(JTOK_HAVE_ZSTD)
+    if (d->codec == JTOK_CODEC_ZSTD)
+    {
+        d->zs = ZSTD_createDStream();
+        if (d->zs == NULL || ZSTD_isError(ZSTD_initDStream(d->zs)))
+        {
+            return JTOK_PARSE_STATUS_NOMEM;
+        }
+    }
+#endif /* #if defined(JTOK_HAVE_ZSTD) */
+    return JTOK_PARSE_STATUS_OK;
+}
+
+
+static void jtok_decompress_close(jtok_decompress_t *d)
+{
+#if defined(JTOK_HAVE_ZLIB)
+    if (d->z_ready)
+    {
+        inflateEnd(&d->z);
+    }
+#endif /* #if defined(JTOK_HAVE_ZLIB) */
+#if defined(JTOK_HAVE_ZSTD)
+    if (d->zs != NULL)
+    {
+        ZSTD_freeDStream(d->zs);
+    }
+#endif /* #if defined(JTOK_HAVE_ZSTD) */
+    (void)d;
+}
+
+
+/* One decoder step from the input buffer into dst */
+static JTOK_PARSE_STATUS_t jtok_decompress_step(jtok_decompress_t *d,
+                                                char *dst, size_t room,
+                                                size_t *produced)
+{
+    size_t avail = d->in_end - d->in_pos;
+    switch (d->codec)
+    {
+#if defined(JTOK_HAVE_ZLIB)
+        case JTOK_CODEC_GZIP:
+        {
+            int ret;
+            if (d->ended && avail > 0)
+            {
+                /* Another gzip member follows */
+                inflateReset(&d->z);
+                d->ended = false;
+            }
+            d->z.next_in   = (Bytef *)&d->config->in[d->in_pos];
+            d->z.avail_in  = (uInt)((avail > UINT_MAX) ? UINT_MAX : avail);
+            d->z.next_out  = (Bytef *)dst;
+            d->z.avail_out = (uInt)((room > UINT_MAX) ? UINT_MAX : room);
+            ret            = inflate(&d->z, Z_NO_FLUSH);
+            d->in_pos      = (size_t)((const char *)d->z.next_in -
+                                 d->config->in);
+            *produced      = (size_t)((char *)d->z.next_out - dst);
+            if (ret == Z_STREAM_END)
+            {
+                d->ended = true;
+            }
+            else if (ret != Z_OK && ret != Z_BUF_ERROR)
+            {
+                return JTOK_PARSE_STATUS_IO_ERROR;
+            }
+        }
+        break;
+#endif /* #if defined(JTOK_HAVE_ZLIB) */
+#if defined(JTOK_HAVE_ZSTD)
+        case JTOK_CODEC_ZSTD:
+        {
+            ZSTD_inBuffer  zin;
+            ZSTD_outBuffer zout;
+            size_t         ret;
+            zin.src   = &d->config->in[d->in_pos];
+            zin.size  = avail;
+            zin.pos   = 0;
+            zout.dst  = dst;
+            zout.size = room;
+            zout.pos  = 0;
+            ret       = ZSTD_decompressStream(d->zs, &zout, &zin);
+            if (ZSTD_isError(ret))
+            {
+                return JTOK_PARSE_STATUS_IO_ERROR;
+            }
+            d->in_pos += zin.pos;
+            *produced = zout.pos;
+            d->ended  = (ret == 0); /* frame done and flushed */
+        }
+        break;
+#endif /* #if defined(JTOK_HAVE_ZSTD) */
+        default:
+        {
+            *produced = (avail < room) ? avail : room;
+            memcpy(dst, &d->config->in[d->in_pos], *produced);
+            d->in_pos += *produced;
+        }
+        break;
+    }
+    return JTOK_PARSE_STATUS_OK;
+}
+
+
+/* Decompress at least one byte into dst, or none at the end of the stream */
+static JTOK_PARSE_STATUS_t jtok_decompress_fill(jtok_decompress_t *d,
+                                                char *dst, size_t room,
+                                                size_t *produced)
+{
+    JTOK_PARSE_STATUS_t status = JTOK_PARSE_STATUS_OK;
+    *produced                  = 0;
+    while (*produced == 0 && status == JTOK_PARSE_STATUS_OK)
+    {
+        jtok_decompress_refill(d);
+        if (d->eof && (d->ended || d->codec == JTOK_CODEC_NONE))
+        {
+            break;
+        }
+
+        /* At the end of the input a decoder may still have output held
+         * back for want of room. Once it has none, the stream was cut
+         * short: plain json can end anywhere, compressed streams cannot. */
+        status = jtok_decompress_step(d, dst, room, produced);
+        if (status == JTOK_PARSE_STATUS_OK && *produced == 0 && d->eof)
+        {
+            status = JTOK_PARSE_STATUS_IO_ERROR;
+        }
+    }
+    return status;
+}
+
+
+static JTOK_PARSE_STATUS_t jtok_decompress_run(jtok_decompress_t *d,
+                                               jtok_event_fn fn, void *ctx)
+{
+    const jtok_decompress_config_t *config = d->config;
+    jtok_events_t                   parser;
+    jtok_event_t                    ev;
+    JTOK_PARSE_STATUS_t             status;
+    size_t                          base = 0; /* stream offset of window[0] */
+    size_t                          have = 0; /* bytes in the window */
+    size_t                          keep;
+    size_t                          produced;
+
+    jtok_events_init(&parser, config->scratch, config->scratch_len);
+    for (;;)
+    {
+        /* Slide what the parser still needs to the front of the window */
+        keep = base + have - jtok_events_offset(&parser);
+        memmove(config->window, &config->window[have - keep], keep);
+        base += have - keep;
+        have = keep;
+        if (have == config->window_len)
+        {
+            return JTOK_PARSE_STATUS_NOMEM;
+        }
+
+        status = jtok_decompress_fill(d, &config->window[have],
+                                      config->window_len - have, &produced);
+        if (status != JTOK_PARSE_STATUS_OK)
+        {
+            return status;
+        }
+        have += produced;
+
+        jtok_events_input(&parser, config->window, have, produced == 0);
+        while ((status = jtok_events_next(&parser, &ev)) ==
+               JTOK_PARSE_STATUS_OK)
+        {
+            if (fn(ctx, &ev) != 0 || ev.type == JTOK_EVENT_END)
+            {
+                return JTOK_PARSE_STATUS_OK;
+            }
+        }
+        if (status != JTOK_PARSE_STATUS_PARTIAL_TOKEN || produced == 0)
+        {
+            return status;
+        }
+    }
+}
+
+
+JTOK_PARSE_STATUS_t jtok_decompress_events(
+    const jtok_decompress_config_t *config, jtok_decompress_read_fn read,
+    void *read_ctx, jtok_event_fn fn, void *ctx)
+{
+    jtok_decompress_t   d;
+    JTOK_PARSE_STATUS_t status;
+
+    if (config == NULL || read == NULL || fn == NULL || config->in == NULL ||
+        config->window == NULL)
+    {
+        return JTOK_PARSE_STATUS_NULL_PARAM;
+    }
+    if (config->in_len < JTOK_DECOMPRESS_MIN_IN || config->window_len == 0)
+    {
+        return JTOK_PARSE_STATUS_INVAL;
+    }
+
+    memset(&d, 0, sizeof(d));
+    d.config   = config;
+    d.read     = read;
+    d.read_ctx = read_ctx;
+    d.codec    = config->codec;
+    status     = jtok_decompress_open(&d);
+    if (status == JTOK_PARSE_STATUS_OK)
+    {
+        status = jtok_decompress_run(&d, fn, ctx);
+    }
+    jtok_decompress_close(&d);
+    return status;
+}
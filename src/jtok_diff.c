@@ -0,0 +1,466 @@
+/**
+ * @file jtok_diff.c
+ * @author Carl Mattatall (cmattatall2@gmail.com)
+ * @brief Source module to produce RFC 6902 JSON Patches from two token trees
+ * @version 0.1
+ * @date 2021-04-24
+ *
+ * @copyright Copyright (c) 2021 Carl Mattatall
+ *
+ */
+
+#include <string.h>
+
+#include "jtok.h"
+#include "jtok_shared.h"
+#include "jtok_string.h"
+
+/* Longest JSON Pointer (in bytes) that a patch operation can carry */
+#ifndef JTOK_DIFF_PATH_MAX
+#define JTOK_DIFF_PATH_MAX 512
+#endif /* #ifndef JTOK_DIFF_PATH_MAX */
+
+/* Decimal digits of the largest array index (log10(2) < 3/10) */
+#define JTOK_DIFF_INDEX_DIGITS (JTOK_OFFSET_WIDTH * 3 / 10 + 1)
+
+typedef struct
+{
+    jtok_write_fn       write;
+    void *              ctx;
+    jtok_off_t *        scratch;
+    size_t              scratch_len;
+    size_t              scratch_used;
+    bool                first_op;
+    size_t              path_len;
+    char                path[JTOK_DIFF_PATH_MAX];
+    JTOK_WRITE_STATUS_t status;
+} jtok_diff_t;
+
+
+static JTOK_WRITE_STATUS_t jtok_diff_value(jtok_diff_t *     diff,
+                                           const jtok_tkn_t *from,
+                                           const jtok_tkn_t *to, int depth);
+
+
+static bool jtok_diff_emit(jtok_diff_t *diff, const char *data, size_t len)
+{
+    if (diff->status == JTOK_WRITE_STATUS_OK && len > 0)
+    {
+        if (0 != diff->write(diff->ctx, data, len))
+        {
+            diff->status = JTOK_WRITE_STATUS_SINK_ERROR;
+        }
+    }
+    return diff->status == JTOK_WRITE_STATUS_OK;
+}
+
+
+static bool jtok_diff_emit_str(jtok_diff_t *diff, const char *str)
+{
+    return jtok_diff_emit(diff, str, strlen(str));
+}
+
+
+static void jtok_diff_op(jtok_diff_t *diff, const char *op,
+                         const jtok_tkn_t *value)
+{
+    jtok_diff_emit_str(diff, diff->first_op ? "{\"op\":\"" : ",{\"op\":\"");
+    diff->first_op = false;
+    jtok_diff_emit_str(diff, op);
+    jtok_diff_emit_str(diff, "\",\"path\":\"");
+    jtok_diff_emit(diff, diff->path, diff->path_len);
+    if (value != NULL)
+    {
+        size_t      len;
+        const char *span = jtok_tokspan(value, &len);
+        if (span == NULL)
+        {
+            diff->status = JTOK_WRITE_STATUS_INVAL;
+        }
+        jtok_diff_emit_str(diff, "\",\"value\":");
+        jtok_diff_emit(diff, span, len);
+        jtok_diff_emit_str(diff, "}");
+    }
+    else
+    {
+        jtok_diff_emit_str(diff, "\"}");
+    }
+}
+
+
+static bool jtok_diff_path_putc(jtok_diff_t *diff, char c)
+{
+    if (diff->path_len >= sizeof(diff->path))
+    {
+        diff->status = JTOK_WRITE_STATUS_NOMEM;
+        return false;
+    }
+    diff->path[diff->path_len++] = c;
+    return true;
+}
+
+
+/* Append "/<key>" with the JSON Pointer escapes ~0 and ~1. The key is
+ * decoded first, so escaped '/' and '~' are caught whatever their spelling,
+ * then written back as the body of a json string. */
+static size_t jtok_diff_path_push_key(jtok_diff_t *diff, const jtok_tkn_t *key)
+{
+    static const char hex[] = "0123456789abcdef";
+    size_t            mark  = diff->path_len;
+    const char *      pos   = &key->json[key->start];
+    const char *      end   = &key->json[key->end];
+    char              utf8[JTOK_STRING_UTF8_MAX];
+    int               count;
+    int               i;
+    long              cp;
+
+    jtok_diff_path_putc(diff, '/');
+    while (diff->status == JTOK_WRITE_STATUS_OK &&
+           (cp = jtok_string_next_cp(&pos, end)) != JTOK_STRING_END)
+    {
+        switch (cp)
+        {
+            case JTOK_STRING_INVALID:
+            {
+                diff->status = JTOK_WRITE_STATUS_INVAL;
+            }
+            break;
+            case '~':
+            {
+                jtok_diff_path_putc(diff, '~');
+                jtok_diff_path_putc(diff, '0');
+            }
+            break;
+            case '/':
+            {
+                jtok_diff_path_putc(diff, '~');
+                jtok_diff_path_putc(diff, '1');
+            }
+            break;
+            case '"':
+            case '\\':
+            {
+                jtok_diff_path_putc(diff, '\\');
+                jtok_diff_path_putc(diff, (char)cp);
+            }
+            break;
+            default:
+            {
+                if (cp < 0x20)
+                {
+                    jtok_diff_path_putc(diff, '\\');
+                    jtok_diff_path_putc(diff, 'u');
+                    jtok_diff_path_putc(diff, '0');
+                    jtok_diff_path_putc(diff, '0');
+                    jtok_diff_path_putc(diff, hex[cp >> 4]);
+                    jtok_diff_path_putc(diff, hex[cp & 0xF]);
+                }
+                else
+                {
+                    count = jtok_string_put_utf8(cp, utf8);
+                    for (i = 0; i < count; i++)
+                    {
+                        jtok_diff_path_putc(diff, utf8[i]);
+                    }
+                }
+            }
+            break;
+        }
+    }
+    return mark;
+}
+
+
+static size_t jtok_diff_path_push_index(jtok_diff_t *diff, jtok_off_t index)
+{
+    size_t mark = diff->path_len;
+    char   digits[JTOK_DIFF_INDEX_DIGITS];
+    int    count = 0;
+    do
+    {
+        digits[count++] = (char)('0' + index % 10);
+        index /= 10;
+    } while (index > 0);
+
+    jtok_diff_path_putc(diff, '/');
+    while (count > 0 && diff->status == JTOK_WRITE_STATUS_OK)
+    {
+        jtok_diff_path_putc(diff, digits[--count]);
+    }
+    return mark;
+}
+
+
+static const jtok_tkn_t *jtok_diff_next_sibling(const jtok_tkn_t *tkn)
+{
+    if (tkn->sibling == JTOK_NO_SIBLING_IDX)
+    {
+        return NULL;
+    }
+    return &tkn->pool[tkn->sibling];
+}
+
+
+/**
+ * @brief Order two key tokens by their decoded code points, so keys that
+ * only differ in how they are escaped match, as their paths do
+ */
+static int jtok_diff_keycmp(const jtok_tkn_t *key1, const jtok_tkn_t *key2)
+{
+    const char *pos1 = &key1->json[key1->start];
+    const char *end1 = &key1->json[key1->end];
+    const char *pos2 = &key2->json[key2->start];
+    const char *end2 = &key2->json[key2->end];
+    long        cp1;
+    long        cp2;
+
+    if (end1 - pos1 == end2 - pos2 && 0 == memcmp(pos1, pos2, end1 - pos1))
+    {
+        return 0;
+    }
+    do
+    {
+        cp1 = jtok_string_next_cp(&pos1, end1);
+        cp2 = jtok_string_next_cp(&pos2, end2);
+    } while (cp1 == cp2 && cp1 >= 0);
+    if (cp1 == JTOK_STRING_INVALID || cp2 == JTOK_STRING_INVALID)
+    {
+        /* Malformed text has no decoded value to order by */
+        return jtok_keycmp(key1, key2);
+    }
+    return (cp1 < cp2) ? -1 : (cp1 > cp2) ? 1 : 0;
+}
+
+
+static const jtok_tkn_t *jtok_diff_find_key(const jtok_tkn_t *obj,
+                                            const jtok_tkn_t *key)
+{
+    const jtok_tkn_t *candidate = (obj->size > 0) ? &obj[1] : NULL;
+    while (candidate != NULL && 0 != jtok_diff_keycmp(key, candidate))
+    {
+        candidate = jtok_diff_next_sibling(candidate);
+    }
+    return candidate;
+}
+
+
+static size_t jtok_diff_collect_keys(const jtok_tkn_t *obj, jtok_off_t *idx)
+{
+    size_t            count = 0;
+    const jtok_tkn_t *key   = (obj->size > 0) ? &obj[1] : NULL;
+    while (key != NULL && count < (size_t)obj->size)
+    {
+        idx[count++] = (jtok_off_t)(key - obj->pool);
+        key          = jtok_diff_next_sibling(key);
+    }
+    return count;
+}
+
+
+static void jtok_diff_member(jtok_diff_t *diff, const jtok_tkn_t *from_key,
+                             const jtok_tkn_t *to_key, int depth)
+{
+    const jtok_tkn_t *key  = (from_key != NULL) ? from_key : to_key;
+    size_t            mark = jtok_diff_path_push_key(diff, key);
+    if (diff->status == JTOK_WRITE_STATUS_OK)
+    {
+        if (to_key == NULL)
+        {
+            jtok_diff_op(diff, "remove", NULL);
+        }
+        else if (from_key == NULL)
+        {
+            jtok_diff_op(diff, "add", &to_key[1]);
+        }
+        else
+        {
+            jtok_diff_value(diff, &from_key[1], &to_key[1], depth);
+        }
+    }
+    diff->path_len = mark;
+}
+
+
+static void jtok_diff_object(jtok_diff_t *diff, const jtok_tkn_t *from,
+                             const jtok_tkn_t *to, int depth)
+{
+    size_t need = (size_t)from->size + (size_t)to->size;
+    if (need <= diff->scratch_len - diff->scratch_used)
+    {
+        /* Sort-merge both key sets */
+        size_t      mark    = diff->scratch_used;
+        jtok_off_t *sorted1 = &diff->scratch[mark];
+        jtok_off_t *sorted2 = &diff->scratch[mark + from->size];
+        size_t      n1      = jtok_diff_collect_keys(from, sorted1);
+        size_t      n2      = jtok_diff_collect_keys(to, sorted2);
+        size_t      i       = 0;
+        size_t      j       = 0;
+
+        diff->scratch_used += need;
+        jtok_sort_tokens(from->pool, sorted1, n1, jtok_diff_keycmp);
+        jtok_sort_tokens(to->pool, sorted2, n2, jtok_diff_keycmp);
+        while ((i < n1 || j < n2) && diff->status == JTOK_WRITE_STATUS_OK)
+        {
+            const jtok_tkn_t *key1 = (i < n1) ? &from->pool[sorted1[i]] : NULL;
+            const jtok_tkn_t *key2 = (j < n2) ? &to->pool[sorted2[j]] : NULL;
+            int               order;
+            if (key1 == NULL)
+            {
+                order = 1;
+            }
+            else if (key2 == NULL)
+            {
+                order = -1;
+            }
+            else
+            {
+                order = jtok_diff_keycmp(key1, key2);
+            }
+
+            if (order < 0)
+            {
+                jtok_diff_member(diff, key1, NULL, depth);
+                i++;
+            }
+            else if (order > 0)
+            {
+                jtok_diff_member(diff, NULL, key2, depth);
+                j++;
+            }
+            else
+            {
+                jtok_diff_member(diff, key1, key2, depth);
+                i++;
+                j++;
+            }
+        }
+        diff->scratch_used = mark;
+    }
+    else
+    {
+        /* Not enough scratch, match keys with a linear search */
+        const jtok_tkn_t *key = (from->size > 0) ? &from[1] : NULL;
+        for (; key != NULL && diff->status == JTOK_WRITE_STATUS_OK;
+             key = jtok_diff_next_sibling(key))
+        {
+            jtok_diff_member(diff, key, jtok_diff_find_key(to, key), depth);
+        }
+
+        key = (to->size > 0) ? &to[1] : NULL;
+        for (; key != NULL && diff->status == JTOK_WRITE_STATUS_OK;
+             key = jtok_diff_next_sibling(key))
+        {
+            if (jtok_diff_find_key(from, key) == NULL)
+            {
+                jtok_diff_member(diff, NULL, key, depth);
+            }
+        }
+    }
+}
+
+
+static void jtok_diff_array(jtok_diff_t *diff, const jtok_tkn_t *from,
+                            const jtok_tkn_t *to, int depth)
+{
+    const jtok_tkn_t *elem1 = (from->size > 0) ? &from[1] : NULL;
+    const jtok_tkn_t *elem2 = (to->size > 0) ? &to[1] : NULL;
+    jtok_off_t        index = 0;
+    size_t            mark;
+
+    /* Elements present in both arrays are diffed by position */
+    while (elem1 != NULL && elem2 != NULL &&
+           diff->status == JTOK_WRITE_STATUS_OK)
+    {
+        mark = jtok_diff_path_push_index(diff, index);
+        jtok_diff_value(diff, elem1, elem2, depth);
+        diff->path_len = mark;
+        elem1          = jtok_diff_next_sibling(elem1);
+        elem2          = jtok_diff_next_sibling(elem2);
+        index++;
+    }
+
+    /* Extra elements in the new array are appended in order */
+    for (; elem2 != NULL && diff->status == JTOK_WRITE_STATUS_OK;
+         elem2 = jtok_diff_next_sibling(elem2))
+    {
+        mark = diff->path_len;
+        jtok_diff_path_putc(diff, '/');
+        jtok_diff_path_putc(diff, '-');
+        jtok_diff_op(diff, "add", elem2);
+        diff->path_len = mark;
+    }
+
+    /* Surplus elements of the old array are removed from the back so
+     * earlier indices stay valid while the patch is applied */
+    for (index = from->size - 1;
+         index >= to->size && diff->status == JTOK_WRITE_STATUS_OK; index--)
+    {
+        mark = jtok_diff_path_push_index(diff, index);
+        jtok_diff_op(diff, "remove", NULL);
+        diff->path_len = mark;
+    }
+}
+
+
+static JTOK_WRITE_STATUS_t jtok_diff_value(jtok_diff_t *     diff,
+                                           const jtok_tkn_t *from,
+                                           const jtok_tkn_t *to, int depth)
+{
+    size_t      len1;
+    size_t      len2;
+    const char *span1 = jtok_tokspan(from, &len1);
+    const char *span2 = jtok_tokspan(to, &len2);
+
+    if (depth > JTOK_MAX_RECURSE_DEPTH)
+    {
+        diff->status = JTOK_WRITE_STATUS_NEST_DEPTH_EXCEEDED;
+    }
+    else if (from->type == to->type && span1 != NULL && span2 != NULL &&
+             len1 == len2 && 0 == memcmp(span1, span2, len1))
+    {
+        /* Identical source text, nothing below here can differ */
+    }
+    else if (from->type != to->type)
+    {
+        jtok_diff_op(diff, "replace", to);
+    }
+    else if (from->type == JTOK_OBJECT)
+    {
+        jtok_diff_object(diff, from, to, depth + 1);
+    }
+    else if (from->type == JTOK_ARRAY)
+    {
+        jtok_diff_array(diff, from, to, depth + 1);
+    }
+    else if (!jtok_toktokcmp(from, to))
+    {
+        jtok_diff_op(diff, "replace", to);
+    }
+    return diff->status;
+}
+
+
+JTOK_WRITE_STATUS_t jtok_diff(const jtok_tkn_t *from, const jtok_tkn_t *to,
+                              jtok_off_t *scratch, size_t scratch_len,
+                              jtok_write_fn write, void *ctx)
+{
+    jtok_diff_t diff;
+    if (from == NULL || to == NULL || write == NULL)
+    {
+        return JTOK_WRITE_STATUS_NULL_PARAM;
+    }
+
+    diff.write        = write;
+    diff.ctx          = ctx;
+    diff.scratch      = scratch;
+    diff.scratch_len  = (scratch != NULL) ? scratch_len : 0;
+    diff.scratch_used = 0;
+    diff.first_op     = true;
+    diff.path_len     = 0;
+    diff.status       = JTOK_WRITE_STATUS_OK;
+
+    jtok_diff_emit_str(&diff, "[");
+    jtok_diff_value(&diff, from, to, 0);
+    jtok_diff_emit_str(&diff, "]");
+    return diff.status;
+}
@@ -0,0 +1,493 @@
+/**
+ * @file jtok_dtoa.c
+ * @author Carl Mattatall (cmattatall2@gmail.com)
+ * @brief Source module to print doubles in their shortest round-trip form
+ * @version 0.1
+ * @date 2021-05-17
+ *
+ * @copyright Copyright (c) 2021 Carl Mattatall
+ *
+ * @note The digit generation is Grisu3 (Loitsch, "Printing Floating-Point
+ * Numbers Quickly and Accurately with Integers", PLDI 2010). It works on
+ * 64-bit significands scaled by a cached power of ten and gives up on the
+ * roughly 0.5% of doubles where it cannot prove the result shortest.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "jtok_dtoa.h"
+
+/* Scaled values land with a binary exponent in this range, which keeps the
+ * integral part within 32 bits */
+#define JTOK_DTOA_ALPHA -60
+#define JTOK_DTOA_GAMMA -32
+
+#define JTOK_DTOA_HIDDEN_BIT 0x0010000000000000ull
+#define JTOK_DTOA_FRACTION_MASK 0x000FFFFFFFFFFFFFull
+#define JTOK_DTOA_EXPONENT_BIAS 1075 /* 1023 + 52 fraction bits */
+
+#define JTOK_DTOA_CACHE_FIRST -348 /* decimal exponent of the first entry */
+#define JTOK_DTOA_CACHE_STEP 8     /* decimal exponents between entries */
+
+typedef struct
+{
+    uint64_t f;
+    int      e; /* value is f * 2^e */
+} jtok_diyfp_t;
+
+typedef struct
+{
+    uint64_t f;
+    int16_t  e;
+    int16_t  k; /* f * 2^e is 10^k, rounded to 64 bits */
+} jtok_dtoa_power_t;
+
+/* clang-format off */
+static const jtok_dtoa_power_t jtok_dtoa_powers[] = {
+    {0xFA8FD5A0081C0288ull, -1220, -348},
+    {0xBAAEE17FA23EBF76ull, -1193, -340},
+    {0x8B16FB203055AC76ull, -1166, -332},
+    {0xCF42894A5DCE35EAull, -1140, -324},
+    {0x9A6BB0AA55653B2Dull, -1113, -316},
+    {0xE61ACF033D1A45DFull, -1087, -308},
+    {0xAB70FE17C79AC6CAull, -1060, -300},
+    {0xFF77B1FCBEBCDC4Full, -1034, -292},
+    {0xBE5691EF416BD60Cull, -1007, -284},
+    {0x8DD01FAD907FFC3Cull, -980, -276},
+    {0xD3515C2831559A83ull, -954, -268},
+    {0x9D71AC8FADA6C9B5ull, -927, -260},
+    {0xEA9C227723EE8BCBull, -901, -252},
+    {0xAECC49914078536Dull, -874, -244},
+    {0x823C12795DB6CE57ull, -847, -236},
+    {0xC21094364DFB5637ull, -821, -228},
+    {0x9096EA6F3848984Full, -794, -220},
+    {0xD77485CB25823AC7ull, -768, -212},
+    {0xA086CFCD97BF97F4ull, -741, -204},
+    {0xEF340A98172AACE5ull, -715, -196},
+    {0xB23867FB2A35B28Eull, -688, -188},
+    {0x84C8D4DFD2C63F3Bull, -661, -180},
+    {0xC5DD44271AD3CDBAull, -635, -172},
+    {0x936B9FCEBB25C996ull, -608, -164},
+    {0xDBAC6C247D62A584ull, -582, -156},
+    {0xA3AB66580D5FDAF6ull, -555, -148},
+    {0xF3E2F893DEC3F126ull, -529, -140},
+    {0xB5B5ADA8AAFF80B8ull, -502, -132},
+    {0x87625F056C7C4A8Bull, -475, -124},
+    {0xC9BCFF6034C13053ull, -449, -116},
+    {0x964E858C91BA2655ull, -422, -108},
+    {0xDFF9772470297EBDull, -396, -100},
+    {0xA6DFBD9FB8E5B88Full, -369, -92},
+    {0xF8A95FCF88747D94ull, -343, -84},
+    {0xB94470938FA89BCFull, -316, -76},
+    {0x8A08F0F8BF0F156Bull, -289, -68},
+    {0xCDB02555653131B6ull, -263, -60},
+    {0x993FE2C6D07B7FACull, -236, -52},
+    {0xE45C10C42A2B3B06ull, -210, -44},
+    {0xAA242499697392D3ull, -183, -36},
+    {0xFD87B5F28300CA0Eull, -157, -28},
+    {0xBCE5086492111AEBull, -130, -20},
+    {0x8CBCCC096F5088CCull, -103, -12},
+    {0xD1B71758E219652Cull, -77, -4},
+    {0x9C40000000000000ull, -50, 4},
+    {0xE8D4A51000000000ull, -24, 12},
+    {0xAD78EBC5AC620000ull, 3, 20},
+    {0x813F3978F8940984ull, 30, 28},
+    {0xC097CE7BC90715B3ull, 56, 36},
+    {0x8F7E32CE7BEA5C70ull, 83, 44},
+    {0xD5D238A4ABE98068ull, 109, 52},
+    {0x9F4F2726179A2245ull, 136, 60},
+    {0xED63A231D4C4FB27ull, 162, 68},
+    {0xB0DE65388CC8ADA8ull, 189, 76},
+    {0x83C7088E1AAB65DBull, 216, 84},
+    {0xC45D1DF942711D9Aull, 242, 92},
+    {0x924D692CA61BE758ull, 269, 100},
+    {0xDA01EE641A708DEAull, 295, 108},
+    {0xA26DA3999AEF774Aull, 322, 116},
+    {0xF209787BB47D6B85ull, 348, 124},
+    {0xB454E4A179DD1877ull, 375, 132},
+    {0x865B86925B9BC5C2ull, 402, 140},
+    {0xC83553C5C8965D3Dull, 428, 148},
+    {0x952AB45CFA97A0B3ull, 455, 156},
+    {0xDE469FBD99A05FE3ull, 481, 164},
+    {0xA59BC234DB398C25ull, 508, 172},
+    {0xF6C69A72A3989F5Cull, 534, 180},
+    {0xB7DCBF5354E9BECEull, 561, 188},
+    {0x88FCF317F22241E2ull, 588, 196},
+    {0xCC20CE9BD35C78A5ull, 614, 204},
+    {0x98165AF37B2153DFull, 641, 212},
+    {0xE2A0B5DC971F303Aull, 667, 220},
+    {0xA8D9D1535CE3B396ull, 694, 228},
+    {0xFB9B7CD9A4A7443Cull, 720, 236},
+    {0xBB764C4CA7A44410ull, 747, 244},
+    {0x8BAB8EEFB6409C1Aull, 774, 252},
+    {0xD01FEF10A657842Cull, 800, 260},
+    {0x9B10A4E5E9913129ull, 827, 268},
+    {0xE7109BFBA19C0C9Dull, 853, 276},
+    {0xAC2820D9623BF429ull, 880, 284},
+    {0x80444B5E7AA7CF85ull, 907, 292},
+    {0xBF21E44003ACDD2Dull, 933, 300},
+    {0x8E679C2F5E44FF8Full, 960, 308},
+    {0xD433179D9C8CB841ull, 986, 316},
+    {0x9E19DB92B4E31BA9ull, 1013, 324},
+    {0xEB96BF6EBADF77D9ull, 1039, 332},
+    {0xAF87023B9BF0EE6Bull, 1066, 340},
+};
+/* clang-format on */
+
+static const uint32_t jtok_dtoa_pow10[] = {
+    1,      10,      100,      1000,      10000,
+    100000, 1000000, 10000000, 100000000, 1000000000,
+};
+
+
+static jtok_diyfp_t jtok_diyfp_normalize(jtok_diyfp_t x)
+{
+    while ((x.f & (1ull << 63)) == 0)
+    {
+        x.f <<= 1;
+        x.e--;
+    }
+    return x;
+}
+
+
+/* Upper 64 bits of the 128-bit product, rounded */
+static jtok_diyfp_t jtok_diyfp_times(jtok_diyfp_t x, jtok_diyfp_t y)
+{
+    const uint64_t mask = 0xFFFFFFFFull;
+    uint64_t       a    = x.f >> 32;
+    uint64_t       b    = x.f & mask;
+    uint64_t       c    = y.f >> 32;
+    uint64_t       d    = y.f & mask;
+    uint64_t       ac   = a * c;
+    uint64_t       bc   = b * c;
+    uint64_t       ad   = a * d;
+    uint64_t       bd   = b * d;
+    uint64_t       mid  = (bd >> 32) + (ad & mask) + (bc & mask);
+    jtok_diyfp_t   r;
+
+    mid += 1ull << 31;
+    r.f = ac + (ad >> 32) + (bc >> 32) + (mid >> 32);
+    r.e = x.e + y.e + 64;
+    return r;
+}
+
+
+/**
+ * @brief Pull the last digit down towards w while that stays safely inside
+ * the rounding interval, then check the result is unambiguous
+ *
+ * @return false if the digits might not be the shortest closest ones
+ */
+static bool jtok_dtoa_weed(char *digits, int count, uint64_t too_high_w,
+                           uint64_t unsafe, uint64_t rest, uint64_t ten_kappa,
+                           uint64_t unit)
+{
+    uint64_t small = too_high_w - unit;
+    uint64_t big   = too_high_w + unit;
+
+    while (rest < small && unsafe - rest >= ten_kappa &&
+           (rest + ten_kappa < small ||
+            small - rest >= rest + ten_kappa - small))
+    {
+        digits[count - 1]--;
+        rest += ten_kappa;
+    }
+    if (rest < big && unsafe - rest >= ten_kappa &&
+        (rest + ten_kappa < big || big - rest > rest + ten_kappa - big))
+    {
+        return false;
+    }
+    return 2 * unit <= rest && rest <= unsafe - 4 * unit;
+}
+
+
+/**
+ * @brief Generate the digits of w, stopping as soon as they identify it
+ * within the scaled interval (low, high)
+ */
+static bool jtok_dtoa_digits(jtok_diyfp_t low, jtok_diyfp_t w,
+                             jtok_diyfp_t high, char *digits, int *count,
+                             int *kappa)
+{
+    uint64_t unit     = 1;
+    uint64_t too_low  = low.f - unit;
+    uint64_t too_high = high.f + unit;
+    uint64_t unsafe   = too_high - too_low;
+    int      shift    = -w.e;
+    uint64_t one      = 1ull << shift;
+    uint32_t integral = (uint32_t)(too_high >> shift);
+    uint64_t fraction = too_high & (one - 1);
+    int      power    = 9;
+
+    while (power > 0 && jtok_dtoa_pow10[power] > integral)
+    {
+        power--;
+    }
+    *kappa = power + 1;
+    *count = 0;
+    while (*kappa > 0)
+    {
+        uint32_t divisor = jtok_dtoa_pow10[*kappa - 1];
+        uint64_t rest;
+        digits[(*count)++] = (char)('0' + integral / divisor);
+        integral %= divisor;
+        (*kappa)--;
+        rest = ((uint64_t)integral << shift) + fraction;
+        if (rest < unsafe)
+        {
+            return jtok_dtoa_weed(digits, *count, too_high - w.f, unsafe, rest,
+                                  (uint64_t)divisor << shift, unit);
+        }
+    }
+    for (;;)
+    {
+        fraction *= 10;
+        unit *= 10;
+        unsafe *= 10;
+        digits[(*count)++] = (char)('0' + (fraction >> shift));
+        fraction &= one - 1;
+        (*kappa)--;
+        if (fraction < unsafe)
+        {
+            return jtok_dtoa_weed(digits, *count, (too_high - w.f) * unit,
+                                  unsafe, fraction, one, unit);
+        }
+    }
+}
+
+
+static bool jtok_dtoa_grisu3(double value, char *digits, int *count,
+                             int *point)
+{
+    uint64_t                 bits;
+    uint64_t                 fraction;
+    int                      biased;
+    jtok_diyfp_t             v;
+    jtok_diyfp_t             w;
+    jtok_diyfp_t             plus;
+    jtok_diyfp_t             minus;
+    jtok_diyfp_t             ten_k;
+    const jtok_dtoa_power_t *cached;
+    int                      last = (int)(sizeof(jtok_dtoa_powers) /
+                                          sizeof(*jtok_dtoa_powers)) -
+                             1;
+    int                      min_e;
+    int                      max_e;
+    int                      index;
+    int                      kappa;
+
+    memcpy(&bits, &value, sizeof(bits));
+    fraction = bits & JTOK_DTOA_FRACTION_MASK;
+    biased   = (int)((bits >> 52) & 0x7FF);
+    if (biased == 0)
+    {
+        v.f = fraction; /* subnormal */
+        v.e = 1 - JTOK_DTOA_EXPONENT_BIAS;
+    }
+    else
+    {
+        v.f = fraction | JTOK_DTOA_HIDDEN_BIT;
+        v.e = biased - JTOK_DTOA_EXPONENT_BIAS;
+    }
+
+    /* The rounding interval is half an ulp either side, except that the
+     * ulp below a power of two is half the size of the one above it */
+    plus.f = (v.f << 1) + 1;
+    plus.e = v.e - 1;
+    plus   = jtok_diyfp_normalize(plus);
+    if (fraction == 0 && biased > 1)
+    {
+        minus.f = (v.f << 2) - 1;
+        minus.e = v.e - 2;
+    }
+    else
+    {
+        minus.f = (v.f << 1) - 1;
+        minus.e = v.e - 1;
+    }
+    minus.f <<= minus.e - plus.e;
+    minus.e = plus.e;
+    w       = jtok_diyfp_normalize(v);
+
+    /* Cached 10^k that scales w into [ALPHA, GAMMA]: estimate the entry
+     * from log10(2), then step to the one whose exponent fits */
+    min_e = JTOK_DTOA_ALPHA - (w.e + 64);
+    max_e = JTOK_DTOA_GAMMA - (w.e + 64);
+    index = (int)(((min_e + 63) * 0.30102999566398114 - JTOK_DTOA_CACHE_FIRST) /
+                  JTOK_DTOA_CACHE_STEP);
+    index = (index < 0) ? 0 : (index > last) ? last : index;
+    while (index < last && jtok_dtoa_powers[index].e < min_e)
+    {
+        index++;
+    }
+    while (index > 0 && jtok_dtoa_powers[index].e > max_e)
+    {
+        index--;
+    }
+    cached  = &jtok_dtoa_powers[index];
+    ten_k.f = cached->f;
+    ten_k.e = cached->e;
+
+    if (!jtok_dtoa_digits(jtok_diyfp_times(minus, ten_k),
+                          jtok_diyfp_times(w, ten_k),
+                          jtok_diyfp_times(plus, ten_k), digits, count,
+                          &kappa))
+    {
+        return false;
+    }
+    *point = *count + kappa - cached->k;
+    return true;
+}
+
+
+/* Check whether 0.<digits> * 10^point reads back as value */
+static bool jtok_dtoa_reads_back(const char *digits, int count, int point,
+                                 double value)
+{
+    char text[JTOK_DTOA_FORMAT_MAX + 8];
+    snprintf(text, sizeof(text), "0.%.*se%d", count, digits, point);
+    return strtod(text, NULL) == value;
+}
+
+
+/**
+ * @brief Exact search for the few doubles Grisu3 leaves undecided
+ *
+ * @note At each length the correctly rounded digits are the closest
+ * candidate. When they fall below value the next candidate up can still be
+ * inside the interval, which is wider above a power of two than below it.
+ */
+static int jtok_dtoa_fallback(double value, char *digits, int *point)
+{
+    char sci[JTOK_DTOA_FORMAT_MAX];
+    int  count;
+    int  i;
+    for (count = 1; count < JTOK_DTOA_DIGITS_MAX; count++)
+    {
+        const char *p;
+        snprintf(sci, sizeof(sci), "%.*e", count - 1, value);
+        for (i = 0, p = sci; *p != 'e'; p++)
+        {
+            if (*p != '.')
+            {
+                digits[i++] = *p;
+            }
+        }
+        *point = atoi(p + 1) + 1;
+        if (strtod(sci, NULL) == value)
+        {
+            return count;
+        }
+        if (strtod(sci, NULL) < value)
+        {
+            for (i = count - 1; i >= 0 && digits[i] == '9'; i--)
+            {
+                digits[i] = '0';
+            }
+            if (i < 0)
+            {
+                digits[0] = '1';
+                (*point)++;
+            }
+            else
+            {
+                digits[i]++;
+            }
+            if (jtok_dtoa_reads_back(digits, count, *point, value))
+            {
+                return count;
+            }
+        }
+    }
+    snprintf(sci, sizeof(sci), "%.*e", JTOK_DTOA_DIGITS_MAX - 1, value);
+    digits[0] = sci[0];
+    memcpy(&digits[1], &sci[2], JTOK_DTOA_DIGITS_MAX - 1);
+    *point = atoi(&sci[JTOK_DTOA_DIGITS_MAX + 2]) + 1;
+    return JTOK_DTOA_DIGITS_MAX;
+}
+
+
+int jtok_dtoa_shortest(double value, char *digits, int *point)
+{
+    int count;
+    if (!jtok_dtoa_grisu3(value, digits, &count, point))
+    {
+        count = jtok_dtoa_fallback(value, digits, point);
+    }
+    while (count > 1 && digits[count - 1] == '0')
+    {
+        count--;
+    }
+    return count;
+}
+
+
+size_t jtok_dtoa_format(double value, char *out)
+{
+    char   digits[JTOK_DTOA_DIGITS_MAX];
+    int    count;
+    int    point;
+    size_t len = 0;
+
+    if (value == 0)
+    {
+        out[0] = '0'; /* -0 included */
+        return 1;
+    }
+    if (value < 0)
+    {
+        out[len++] = '-';
+        value      = -value;
+    }
+    count = jtok_dtoa_shortest(value, digits, &point);
+
+    if (count <= point && point <= 21)
+    {
+        memcpy(&out[len], digits, (size_t)count);
+        len += (size_t)count;
+        while (count++ < point)
+        {
+            out[len++] = '0';
+        }
+    }
+    else if (0 < point && point <= 21)
+    {
+        memcpy(&out[len], digits, (size_t)point);
+        len += (size_t)point;
+        out[len++] = '.';
+        memcpy(&out[len], &digits[point], (size_t)(count - point));
+        len += (size_t)(count - point);
+    }
+    else if (-6 < point && point <= 0)
+    {
+        out[len++] = '0';
+        out[len++] = '.';
+        for (; point < 0; point++)
+        {
+            out[len++] = '0';
+        }
+        memcpy(&out[len], digits, (size_t)count);
+        len += (size_t)count;
+    }
+    else
+    {
+        char exponent[8];
+        int  n;
+        out[len++] = digits[0];
+        if (count > 1)
+        {
+            out[len++] = '.';
+            memcpy(&out[len], &digits[1], (size_t)(count - 1));
+            len += (size_t)(count - 1);
+        }
+        n = snprintf(exponent, sizeof(exponent), "e%+d", point - 1);
+        memcpy(&out[len], exponent, (size_t)n);
+        len += (size_t)n;
+    }
+    return len;
+}
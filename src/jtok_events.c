@@ -0,0 +1,633 @@
+/**
+ * @file jtok_events.c
+ * @author Carl Mattatall (cmattatall2@gmail.com)
+ * @brief Source module for event (SAX-style) parsing
+ * @version 0.1
+ * @date 2021-05-13
+ *
+ * @copyright Copyright (c) 2021 Carl Mattatall
+ *
+ */
+
+#include <ctype.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "jtok.h"
+#include "jtok_events.h"
+#include "jtok_primitive.h"
+#include "jtok_string.h"
+#include "jtok_shared.h"
+
+/* What a frame expects next. An array uses FIRST, VALUE and COMMA. */
+enum
+{
+    JTOK_EVENTS_FIRST, /* first key or element, or the closing bracket */
+    JTOK_EVENTS_KEY,   /* a key after a comma */
+    JTOK_EVENTS_COLON,
+    JTOK_EVENTS_VALUE,
+    JTOK_EVENTS_COMMA, /* a comma or the closing bracket */
+};
+
+/* Kinds of array element, which may not be mixed */
+enum
+{
+    JTOK_EVENTS_NO_ELEMENTS,
+    JTOK_EVENTS_PRIMITIVES,
+    JTOK_EVENTS_VALUES, /* strings, objects and arrays */
+};
+
+
+static JTOK_PARSE_STATUS_t jtok_events_fail(jtok_events_t *      parser,
+                                            JTOK_PARSE_STATUS_t status)
+{
+    parser->status = status;
+    return status;
+}
+
+
+/* Out of input in the middle of something */
+static JTOK_PARSE_STATUS_t jtok_events_more(jtok_events_t *parser)
+{
+    if (parser->last)
+    {
+        return jtok_events_fail(parser, JTOK_PARSE_STATUS_PARTIAL_TOKEN);
+    }
+    return JTOK_PARSE_STATUS_PARTIAL_TOKEN;
+}
+
+
+static bool jtok_events_space(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+
+/* The characters jtok_parse starts a primitive on */
+static bool jtok_events_primitive_start(char c)
+{
+    return c == '+' || c == '-' || isdigit((unsigned char)c) || c == 't' ||
+           c == 'f' || c == 'n';
+}
+
+
+static void jtok_events_span(const jtok_events_t *parser, jtok_event_t *ev,
+                             size_t start, size_t end)
+{
+    ev->start = start;
+    ev->end   = end;
+    ev->text  = (start >= parser->base) ? &parser->data[start - parser->base]
+                                        : NULL;
+}
+
+
+/* Decode escapes into the scratch buffer, if they fit */
+static void jtok_events_decode(const jtok_events_t *parser, jtok_event_t *ev,
+                               bool escaped)
+{
+    const char *pos = ev->text;
+    const char *end = ev->text + (ev->end - ev->start);
+    size_t      len = 0;
+    long        cp;
+
+    if (!escaped)
+    {
+        ev->value     = ev->text;
+        ev->value_len = ev->end - ev->start;
+        return;
+    }
+
+    while ((cp = jtok_string_next_cp(&pos, end)) >= 0)
+    {
+        if (parser->scratch == NULL ||
+            parser->scratch_len - len < JTOK_STRING_UTF8_MAX)
+        {
+            return;
+        }
+        len += (size_t)jtok_string_put_utf8(cp, &parser->scratch[len]);
+    }
+    if (cp == JTOK_STRING_END)
+    {
+        ev->value     = parser->scratch;
+        ev->value_len = len;
+    }
+}
+
+
+static JTOK_PARSE_STATUS_t jtok_events_string(jtok_events_t *parser,
+                                              jtok_event_t * ev, bool key)
+{
+    const char *data    = parser->data;
+    size_t      end     = parser->len;
+    size_t      first   = parser->pos - parser->base + 1;
+    size_t      i       = first;
+    char        quote   = data[first - 1];
+    bool        escaped = false;
+    int         hex;
+
+    while (i < end && data[i] != quote)
+    {
+        if (data[i] != '\\')
+        {
+            i++;
+            continue;
+        }
+
+        /* Same escapes as jtok_parse_string */
+        if (end - i < 2)
+        {
+            return jtok_events_more(parser);
+        }
+        escaped = true;
+        switch (data[i + 1])
+        {
+            case '\"':
+            case '/':
+            case '\\':
+            case 'b':
+            case 'f':
+            case 'r':
+            case 'n':
+            case 't':
+            {
+                i += 2;
+            }
+            break;
+            case 'u':
+            {
+                if (end - i < 2 + HEXCHAR_ESCAPE_SEQ_COUNT)
+                {
+                    return jtok_events_more(parser);
+                }
+                for (hex = 0; hex < HEXCHAR_ESCAPE_SEQ_COUNT; hex++)
+                {
+                    if (!isxdigit((unsigned char)data[i + 2 + hex]))
+                    {
+                        return jtok_events_fail(parser, JTOK_PARSE_STATUS_INVAL);
+                    }
+                }
+                i += 2 + HEXCHAR_ESCAPE_SEQ_COUNT;
+            }
+            break;
+            default:
+            {
+                return jtok_events_fail(parser, JTOK_PARSE_STATUS_INVAL);
+            }
+            break;
+        }
+    }
+
+    if (i >= end)
+    {
+        return jtok_events_more(parser);
+    }
+    if (key && i == first)
+    {
+        return jtok_events_fail(parser, JTOK_PARSE_STATUS_EMPTY_KEY);
+    }
+
+    ev->type = key ? JTOK_EVENT_KEY : JTOK_EVENT_STRING;
+    jtok_events_span(parser, ev, parser->base + first, parser->base + i);
+    jtok_events_decode(parser, ev, escaped);
+    parser->pos = parser->base + i + 1;
+    return JTOK_PARSE_STATUS_OK;
+}
+
+
+static JTOK_PARSE_STATUS_t jtok_events_primitive(jtok_events_t *parser,
+                                                 jtok_event_t * ev)
+{
+    const char *        data  = parser->data;
+    size_t              first = parser->pos - parser->base;
+    size_t              i     = first;
+    size_t              len;
+    jtok_off_t          end = 0;
+    JTOK_PARSE_STATUS_t status;
+    char                buf[JTOK_PRIMITIVE_MAX_NUMBER_LEN + 1];
+    char *              endptr;
+
+    /* A primitive ends where the token parser's does */
+    while (i < parser->len && !jtok_events_space(data[i]) && data[i] != ',' &&
+           data[i] != ']' && data[i] != '}')
+    {
+        i++;
+    }
+
+    if (i == parser->len && !parser->last)
+    {
+        return jtok_events_more(parser);
+    }
+
+    /* Scan through the terminator with the grammar jtok_parse uses */
+    len    = (i < parser->len) ? i - first + 1 : i - first;
+    status = jtok_primitive_scan(&data[first], (jtok_off_t)len, &end);
+    if (status == JTOK_PARSE_STATUS_PARTIAL_TOKEN && i == parser->len)
+    {
+        return jtok_events_more(parser);
+    }
+    else if (status != JTOK_PARSE_STATUS_OK)
+    {
+        return jtok_events_fail(parser, status);
+    }
+
+    len = (size_t)end;
+    if (data[first] == 't')
+    {
+        ev->type = JTOK_EVENT_TRUE;
+    }
+    else if (data[first] == 'f')
+    {
+        ev->type = JTOK_EVENT_FALSE;
+    }
+    else if (data[first] == 'n')
+    {
+        ev->type = JTOK_EVENT_NULL;
+    }
+    else
+    {
+        /* A lone sign is a primitive to jtok_parse, but not a number */
+        ev->type   = JTOK_EVENT_NUMBER;
+        ev->number = NAN;
+        if (len <= JTOK_PRIMITIVE_MAX_NUMBER_LEN)
+        {
+            /* The text is not nul-terminated so copy it out before strtod */
+            memcpy(buf, &data[first], len);
+            buf[len]   = '\0';
+            ev->number = strtod(buf, &endptr);
+            if (endptr != &buf[len])
+            {
+                ev->number = NAN;
+            }
+        }
+    }
+
+    jtok_events_span(parser, ev, parser->pos, parser->pos + len);
+    parser->pos += len;
+    return JTOK_PARSE_STATUS_OK;
+}
+
+
+/* A value where the top frame expects one */
+static JTOK_PARSE_STATUS_t jtok_events_value(jtok_events_t *parser,
+                                             jtok_event_t *ev, char c)
+{
+    jtok_events_frame_t *frame = &parser->frames[parser->depth - 1];
+    jtok_events_frame_t *child;
+    JTOK_PARSE_STATUS_t  status;
+    uint8_t              kind  = JTOK_EVENTS_VALUES;
+
+    if (c != '{' && c != '[' && c != '\"' && c != '\'')
+    {
+        if (!jtok_events_primitive_start(c))
+        {
+            return jtok_events_fail(parser, JTOK_PARSE_STATUS_INVAL);
+        }
+        kind = JTOK_EVENTS_PRIMITIVES;
+    }
+    if (frame->type == JTOK_ARRAY && frame->elements != JTOK_EVENTS_NO_ELEMENTS &&
+        frame->elements != kind)
+    {
+        return jtok_events_fail(parser, JTOK_STATUS_MIXED_ARRAY);
+    }
+
+    if (c == '{' || c == '[')
+    {
+        if (parser->depth > JTOK_MAX_RECURSE_DEPTH)
+        {
+            return jtok_events_fail(parser,
+                                    JTOK_PARSE_STATUS_NEST_DEPTH_EXCEEDED);
+        }
+        ev->type         = (c == '{') ? JTOK_EVENT_OBJECT_START
+                                      : JTOK_EVENT_ARRAY_START;
+        child            = &parser->frames[parser->depth];
+        child->start     = parser->pos;
+        child->type      = (c == '{') ? JTOK_OBJECT : JTOK_ARRAY;
+        child->expecting = JTOK_EVENTS_FIRST;
+        child->elements  = JTOK_EVENTS_NO_ELEMENTS;
+        jtok_events_span(parser, ev, parser->pos, parser->pos + 1);
+        parser->pos++;
+        status = JTOK_PARSE_STATUS_OK;
+    }
+    else if (kind == JTOK_EVENTS_VALUES)
+    {
+        status = jtok_events_string(parser, ev, false);
+    }
+    else
+    {
+        status = jtok_events_primitive(parser, ev);
+    }
+
+    /* Nothing changes until the whole value has arrived */
+    if (status == JTOK_PARSE_STATUS_OK)
+    {
+        frame->expecting = JTOK_EVENTS_COMMA;
+        frame->elements  = kind;
+        if (c == '{' || c == '[')
+        {
+            parser->depth++;
+        }
+    }
+    return status;
+}
+
+
+static JTOK_PARSE_STATUS_t jtok_events_close(jtok_events_t *parser,
+                                             jtok_event_t * ev)
+{
+    jtok_events_frame_t *frame = &parser->frames[parser->depth - 1];
+
+    ev->type = (frame->type == JTOK_OBJECT) ? JTOK_EVENT_OBJECT_END
+                                            : JTOK_EVENT_ARRAY_END;
+    jtok_events_span(parser, ev, frame->start, parser->pos + 1);
+    parser->pos++;
+    parser->depth--;
+    ev->depth    = parser->depth;
+    parser->done = (parser->depth == 0);
+    return JTOK_PARSE_STATUS_OK;
+}
+
+
+void jtok_events_init(jtok_events_t *parser, char *scratch, size_t scratch_len)
+{
+    if (parser == NULL)
+    {
+        return;
+    }
+    parser->data        = NULL;
+    parser->len         = 0;
+    parser->base        = 0;
+    parser->pos         = 0;
+    parser->last        = false;
+    parser->depth       = 0;
+    parser->done        = false;
+    parser->status      = JTOK_PARSE_STATUS_OK;
+    parser->scratch     = scratch;
+    parser->scratch_len = (scratch != NULL) ? scratch_len : 0;
+}
+
+
+JTOK_PARSE_STATUS_t jtok_events_input(jtok_events_t *parser, const char *data,
+                                      size_t len, bool last)
+{
+    if (parser == NULL || (data == NULL && len > 0))
+    {
+        return JTOK_PARSE_STATUS_NULL_PARAM;
+    }
+    parser->data = data;
+    parser->len  = len;
+    parser->base = parser->pos;
+    parser->last = last;
+    return JTOK_PARSE_STATUS_OK;
+}
+
+
+size_t jtok_events_offset(const jtok_events_t *parser)
+{
+    return (parser != NULL) ? parser->pos : 0;
+}
+
+
+JTOK_PARSE_STATUS_t jtok_events_next(jtok_events_t *parser, jtok_event_t *ev)
+{
+    jtok_events_frame_t *frame;
+    JTOK_PARSE_STATUS_t  status;
+    char                 c;
+    char                 closer;
+
+    if (parser == NULL || ev == NULL)
+    {
+        return JTOK_PARSE_STATUS_NULL_PARAM;
+    }
+    if (parser->status != JTOK_PARSE_STATUS_OK)
+    {
+        return parser->status;
+    }
+
+    ev->type      = JTOK_EVENT_NONE;
+    ev->depth     = parser->depth;
+    ev->value     = NULL;
+    ev->value_len = 0;
+    ev->number    = 0;
+    if (parser->done)
+    {
+        ev->type = JTOK_EVENT_END;
+        jtok_events_span(parser, ev, parser->pos, parser->pos);
+        return JTOK_PARSE_STATUS_OK;
+    }
+
+    for (;;)
+    {
+        while (parser->pos - parser->base < parser->len &&
+               (jtok_events_space(parser->data[parser->pos - parser->base]) ||
+                (parser->depth == 0 &&
+                 isspace((unsigned char)parser->data[parser->pos -
+                                                     parser->base]))))
+        {
+            parser->pos++;
+        }
+        if (parser->pos - parser->base == parser->len)
+        {
+            if (parser->last && parser->depth == 0)
+            {
+                return jtok_events_fail(parser, JTOK_PARSE_STATUS_NON_OBJECT);
+            }
+            return jtok_events_more(parser);
+        }
+        c = parser->data[parser->pos - parser->base];
+
+        if (parser->depth == 0)
+        {
+            /* The root, like jtok_parse's, must be an object */
+            if (c != '{')
+            {
+                return jtok_events_fail(parser, JTOK_PARSE_STATUS_NON_OBJECT);
+            }
+            parser->frames[0].start     = parser->pos;
+            parser->frames[0].type      = JTOK_OBJECT;
+            parser->frames[0].expecting = JTOK_EVENTS_FIRST;
+            parser->frames[0].elements  = JTOK_EVENTS_NO_ELEMENTS;
+            parser->depth               = 1;
+            ev->type                    = JTOK_EVENT_OBJECT_START;
+            jtok_events_span(parser, ev, parser->pos, parser->pos + 1);
+            parser->pos++;
+            return JTOK_PARSE_STATUS_OK;
+        }
+
+        frame  = &parser->frames[parser->depth - 1];
+        closer = (frame->type == JTOK_OBJECT) ? '}' : ']';
+        switch (frame->expecting)
+        {
+            case JTOK_EVENTS_COMMA:
+            {
+                if (c == ',')
+                {
+                    frame->expecting = (frame->type == JTOK_OBJECT)
+                                           ? JTOK_EVENTS_KEY
+                                           : JTOK_EVENTS_VALUE;
+                    parser->pos++;
+                    continue;
+                }
+                if (c == closer)
+                {
+                    return jtok_events_close(parser, ev);
+                }
+                if (frame->type == JTOK_ARRAY)
+                {
+                    if (jtok_events_primitive_start(c))
+                    {
+                        status = JTOK_PARSE_STATUS_STRAY_COMMA;
+                    }
+                    else if (c == '{' || c == '[' || c == '\"')
+                    {
+                        status = JTOK_PARSE_STATUS_ARRAY_SEPARATOR;
+                    }
+                    else
+                    {
+                        status = JTOK_PARSE_STATUS_INVAL;
+                    }
+                }
+                else if (c == '\"' || c == '\'')
+                {
+                    status = JTOK_PARSE_STATUS_VAL_NO_COMMA;
+                }
+                else if (jtok_events_primitive_start(c))
+                {
+                    status = JTOK_PARSE_STATUS_KEY_NO_VAL;
+                }
+                else
+                {
+                    status = JTOK_PARSE_STATUS_INVAL;
+                }
+                return jtok_events_fail(parser, status);
+            }
+            break;
+            case JTOK_EVENTS_COLON:
+            {
+                if (c == ':')
+                {
+                    frame->expecting = JTOK_EVENTS_VALUE;
+                    parser->pos++;
+                    continue;
+                }
+                if (c == '{' || c == '[' || c == '\"' || c == '\'')
+                {
+                    status = JTOK_PARSE_STATUS_VAL_NO_COLON;
+                }
+                else if (c == '}' || jtok_events_primitive_start(c))
+                {
+                    status = JTOK_PARSE_STATUS_KEY_NO_VAL;
+                }
+                else if (c == ',')
+                {
+                    status = JTOK_PARSE_STATUS_OBJ_NOKEY;
+                }
+                else
+                {
+                    status = JTOK_PARSE_STATUS_INVAL;
+                }
+                return jtok_events_fail(parser, status);
+            }
+            break;
+            case JTOK_EVENTS_FIRST:
+            case JTOK_EVENTS_KEY:
+            {
+                if (frame->type == JTOK_ARRAY)
+                {
+                    /* An array's FIRST: an element or the end */
+                    if (c == ']')
+                    {
+                        return jtok_events_close(parser, ev);
+                    }
+                    if (c == ',')
+                    {
+                        return jtok_events_fail(parser,
+                                                JTOK_PARSE_STATUS_STRAY_COMMA);
+                    }
+                    return jtok_events_value(parser, ev, c);
+                }
+                if (c == '\"' || c == '\'')
+                {
+                    status = jtok_events_string(parser, ev, true);
+                    if (status == JTOK_PARSE_STATUS_OK)
+                    {
+                        frame->expecting = JTOK_EVENTS_COLON;
+                    }
+                    return status;
+                }
+                if (c == '}' && frame->expecting == JTOK_EVENTS_FIRST)
+                {
+                    return jtok_events_close(parser, ev);
+                }
+                if (c == '}')
+                {
+                    /* jtok_parse lets this trailing comma through */
+                    status = JTOK_PARSE_STATUS_COMMA_NO_KEY;
+                }
+                else if (c == ',' || c == '{' || c == '[')
+                {
+                    status = JTOK_PARSE_STATUS_OBJ_NOKEY;
+                }
+                else if (jtok_events_primitive_start(c))
+                {
+                    status = JTOK_PARSE_STATUS_KEY_NO_VAL;
+                }
+                else
+                {
+                    status = JTOK_PARSE_STATUS_INVAL;
+                }
+                return jtok_events_fail(parser, status);
+            }
+            break;
+            case JTOK_EVENTS_VALUE:
+            default:
+            {
+                if (c == ']' && frame->type == JTOK_ARRAY)
+                {
+                    return jtok_events_fail(parser,
+                                            JTOK_PARSE_STATUS_ARRAY_SEPARATOR);
+                }
+                if (c == ',')
+                {
+                    return jtok_events_fail(
+                        parser, (frame->type == JTOK_ARRAY)
+                                    ? JTOK_PARSE_STATUS_STRAY_COMMA
+                                    : JTOK_PARSE_STATUS_OBJ_NOKEY);
+                }
+                if (c == '}' && frame->type == JTOK_OBJECT)
+                {
+                    return jtok_events_fail(parser,
+                                            JTOK_PARSE_STATUS_KEY_NO_VAL);
+                }
+                return jtok_events_value(parser, ev, c);
+            }
+            break;
+        }
+    }
+}
+
+
+JTOK_PARSE_STATUS_t jtok_events_parse(const char *json, size_t len,
+                                      jtok_event_fn fn, void *ctx,
+                                      char *scratch, size_t scratch_len)
+{
+    jtok_events_t       parser;
+    jtok_event_t        ev;
+    JTOK_PARSE_STATUS_t status;
+
+    if (json == NULL || fn == NULL)
+    {
+        return JTOK_PARSE_STATUS_NULL_PARAM;
+    }
+
+    jtok_events_init(&parser, scratch, scratch_len);
+    jtok_events_input(&parser, json, len, true);
+    while ((status = jtok_events_next(&parser, &ev)) == JTOK_PARSE_STATUS_OK)
+    {
+        if (fn(ctx, &ev) != 0 || ev.type == JTOK_EVENT_END)
+        {
+            break;
+        }
+    }
+    return status;
+}
@@ -0,0 +1,146 @@
+/**
+ * @file jtok_file.c
+ * @author Carl Mattatall (cmattatall2@gmail.com)
+ * @brief Source module to parse memory-mapped files in place
+ * @version 0.1
+ * @date 2021-05-14
+ *
+ * @copyright Copyright (c) 2021 Carl Mattatall
+ *
+ */
+
+/* 64-bit file sizes on 32-bit targets. off_t never leaves this module. */
+#define _FILE_OFFSET_BITS 64
+
+#include <stdint.h>
+#include <string.h>
+
+#if defined(JTOK_HAVE_POSIX)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif /* #if defined(JTOK_HAVE_POSIX) */
+
+#include "jtok.h"
+#include "jtok_file.h"
+
+#if defined(JTOK_HAVE_POSIX)
+
+/* Hints only: failures are ignored and missing advice is skipped */
+static void jtok_file_advise(void *map, size_t len, int advice)
+{
+    if (map != NULL && advice >= 0)
+    {
+        (void)madvise(map, len, advice);
+    }
+}
+
+#if defined(MADV_SEQUENTIAL)
+#define JTOK_MADV_SEQUENTIAL MADV_SEQUENTIAL
+#else
+#define JTOK_MADV_SEQUENTIAL -1
+#endif /* #if defined(MADV_SEQUENTIAL) */
+
+#if defined(MADV_NORMAL)
+#define JTOK_MADV_NORMAL MADV_NORMAL
+#else
+#define JTOK_MADV_NORMAL -1
+#endif /* #if defined(MADV_NORMAL) */
+
+#if defined(MADV_HUGEPAGE)
+#define JTOK_MADV_HUGEPAGE MADV_HUGEPAGE
+#else
+#define JTOK_MADV_HUGEPAGE -1
+#endif /* #if defined(MADV_HUGEPAGE) */
+
+#endif /* #if defined(JTOK_HAVE_POSIX) */
+
+
+JTOK_PARSE_STATUS_t jtok_parse_file(jtok_file_t *file, const char *path,
+                                    jtok_tkn_t *tkns, size_t size,
+                                    unsigned int flags)
+{
+#if defined(JTOK_HAVE_POSIX)
+    JTOK_PARSE_STATUS_t status;
+    struct stat         st;
+    void *              map = NULL;
+    int                 fd;
+    if (file == NULL || path == NULL || tkns == NULL)
+    {
+        return JTOK_PARSE_STATUS_NULL_PARAM;
+    }
+    memset(file, 0, sizeof(*file));
+
+    fd = open(path, O_RDONLY);
+    if (fd < 0)
+    {
+        return JTOK_PARSE_STATUS_IO_ERROR;
+    }
+    if (fstat(fd, &st) != 0 || st.st_size < 0 ||
+        (uint64_t)st.st_size > SIZE_MAX)
+    {
+        close(fd);
+        return JTOK_PARSE_STATUS_IO_ERROR;
+    }
+
+    /* An empty file cannot be mapped. It is parsed as an empty document. */
+    if (st.st_size > 0)
+    {
+        map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map == MAP_FAILED)
+        {
+            close(fd);
+            return JTOK_PARSE_STATUS_IO_ERROR;
+        }
+    }
+    close(fd);
+
+    file->map     = map;
+    file->map_len = (size_t)st.st_size;
+    file->json    = (map != NULL) ? (const char *)map : "";
+    file->len     = (size_t)st.st_size;
+
+    if (flags & JTOK_FILE_HUGEPAGES)
+    {
+        jtok_file_advise(map, file->map_len, JTOK_MADV_HUGEPAGE);
+    }
+
+    /* The parser reads up to len and never past it, so the last page of
+     * the mapping needs no terminator and nothing beyond it is touched */
+    jtok_file_advise(map, file->map_len, JTOK_MADV_SEQUENTIAL);
+    status = jtok_parsen(file->json, file->len, tkns, size);
+    jtok_file_advise(map, file->map_len, JTOK_MADV_NORMAL);
+
+    if (status != JTOK_PARSE_STATUS_OK)
+    {
+        jtok_file_close(file);
+    }
+    return status;
+#else
+    (void)path;
+    (void)tkns;
+    (void)size;
+    (void)flags;
+    if (file != NULL)
+    {
+        memset(file, 0, sizeof(*file));
+    }
+    return JTOK_PARSE_STATUS_IO_ERROR;
+#endif /* #if defined(JTOK_HAVE_POSIX) */
+}
+
+
+void jtok_file_close(jtok_file_t *file)
+{
+    if (file != NULL)
+    {
+#if defined(JTOK_HAVE_POSIX)
+        if (file->map != NULL)
+        {
+            munmap(file->map, file->map_len);
+        }
+#endif /* #if defined(JTOK_HAVE_POSIX) */
+        memset(file, 0, sizeof(*file));
+    }
+}
@@ -0,0 +1,283 @@
+/**
+ * @file jtok_hash.c
+ * @author Carl Mattatall (cmattatall2@gmail.com)
+ * @brief Source module for structural hashing of jtok token subtrees
+ * @version 0.1
+ * @date 2021-04-17
+ *
+ * @copyright Copyright (c) 2021 Carl Mattatall
+ *
+ * @note The hash follows the same equality rules as jtok_toktokcmp:
+ * object members are combined commutatively so key order does not matter,
+ * array elements are combined in order, and numbers are hashed by value.
+ */
+
+#include <string.h>
+
+#include "jtok_hash.h"
+#include "jtok_primitive.h"
+
+#define JTOK_HASH_K1 0x9E3779B97F4A7C15ull
+#define JTOK_HASH_K2 0xC2B2AE3D27D4EB4Full
+
+/* Domain separation so "1", 1 and [1] never share a hash */
+#define JTOK_HASH_SEED_STRING 0x5354524Eull  /* "STRN" */
+#define JTOK_HASH_SEED_LITERAL 0x4C495452ull /* "LITR" */
+#define JTOK_HASH_SEED_NUMBER 0x4E554D42ull  /* "NUMB" */
+#define JTOK_HASH_SEED_OBJECT 0x4F424A54ull  /* "OBJT" */
+#define JTOK_HASH_SEED_ARRAY 0x41525259ull   /* "ARRY" */
+
+/* Every aggregate and every key occupies one stack entry */
+#define JTOK_HASH_STACK_DEPTH (2 * JTOK_MAX_RECURSE_DEPTH + 4)
+
+typedef enum
+{
+    JTOK_HASH_FRAME_OBJECT,
+    JTOK_HASH_FRAME_ARRAY,
+    JTOK_HASH_FRAME_KEY,
+} JTOK_HASH_FRAME_t;
+
+typedef struct
+{
+    JTOK_HASH_FRAME_t type;
+    jtok_off_t        remaining; /* children not yet hashed */
+    jtok_off_t        size;      /* total number of children */
+    uint64_t          acc;       /* running combination of child hashes */
+} jtok_hash_frame_t;
+
+
+static uint64_t jtok_hash_rotl(uint64_t x, unsigned int r)
+{
+    return (x << r) | (x >> (64 - r));
+}
+
+
+uint64_t jtok_hash_mix(uint64_t x)
+{
+    x ^= x >> 30;
+    x *= 0xBF58476D1CE4E5B9ull;
+    x ^= x >> 27;
+    x *= 0x94D049BB133111EBull;
+    x ^= x >> 31;
+    return x;
+}
+
+
+uint64_t jtok_hash_bytes(const void *data, size_t len, uint64_t seed)
+{
+    const unsigned char *bytes = (const unsigned char *)data;
+    uint64_t             h     = seed ^ (len * JTOK_HASH_K1);
+    uint64_t             word;
+
+    /* 8 bytes per step; memcpy keeps unaligned loads well defined */
+    while (len >= sizeof(word))
+    {
+        memcpy(&word, bytes, sizeof(word));
+        h ^= jtok_hash_rotl(word * JTOK_HASH_K2, 31) * JTOK_HASH_K1;
+        h = jtok_hash_rotl(h, 27) * 5 + 0x52DCE729;
+        bytes += sizeof(word);
+        len -= sizeof(word);
+    }
+
+    word = 0;
+    memcpy(&word, bytes, len);
+    h ^= jtok_hash_rotl(word * JTOK_HASH_K2, 31) * JTOK_HASH_K1;
+    return jtok_hash_mix(h);
+}
+
+
+static uint64_t jtok_hash_leaf(const jtok_tkn_t *tkn)
+{
+    const char *text = (tkn->json != NULL) ? &tkn->json[tkn->start] : "";
+    size_t      len  = (tkn->json != NULL) ? jtok_toklen(tkn) : 0;
+    uint64_t    h;
+    double      value;
+
+    if (tkn->type == JTOK_STRING)
+    {
+        h = jtok_hash_bytes(text, len, JTOK_HASH_SEED_STRING);
+    }
+    else if (!jtok_primitive_is_number(tkn))
+    {
+        h = jtok_hash_bytes(text, len, JTOK_HASH_SEED_LITERAL);
+    }
+    else if (jtok_primitive_todouble(tkn, &value))
+    {
+        /* Normalize so 1, 1.0, +1 and 1e0 (and 0 / -0) hash the same */
+        uint64_t bits;
+        if (value == 0.0)
+        {
+            value = 0.0;
+        }
+        memcpy(&bits, &value, sizeof(bits));
+        h = jtok_hash_mix(bits ^ JTOK_HASH_SEED_NUMBER);
+    }
+    else
+    {
+        /* Too long to decode, so fall back to the literal text */
+        h = jtok_hash_bytes(text, len, JTOK_HASH_SEED_NUMBER);
+    }
+    return h;
+}
+
+
+static uint64_t jtok_hash_finish(const jtok_hash_frame_t *frame)
+{
+    uint64_t h = 0;
+    switch (frame->type)
+    {
+        case JTOK_HASH_FRAME_OBJECT:
+        {
+            h = jtok_hash_mix(frame->acc ^ JTOK_HASH_SEED_OBJECT ^
+                              ((uint64_t)frame->size * JTOK_HASH_K2));
+        }
+        break;
+        case JTOK_HASH_FRAME_ARRAY:
+        {
+            h = jtok_hash_mix(frame->acc ^ JTOK_HASH_SEED_ARRAY ^
+                              ((uint64_t)frame->size * JTOK_HASH_K2));
+        }
+        break;
+        case JTOK_HASH_FRAME_KEY:
+        {
+            /* acc already holds the member hash */
+            h = frame->acc;
+        }
+        break;
+    }
+    return h;
+}
+
+
+static void jtok_hash_combine(jtok_hash_frame_t *frame, uint64_t h)
+{
+    switch (frame->type)
+    {
+        case JTOK_HASH_FRAME_OBJECT:
+        {
+            /* Addition is commutative, so member order is irrelevant */
+            frame->acc += h;
+        }
+        break;
+        case JTOK_HASH_FRAME_ARRAY:
+        {
+            frame->acc = jtok_hash_mix(jtok_hash_rotl(frame->acc, 23) ^ h) +
+                         JTOK_HASH_K1;
+        }
+        break;
+        case JTOK_HASH_FRAME_KEY:
+        {
+            /* acc holds the key hash until the value arrives */
+            frame->acc = jtok_hash_mix(frame->acc * JTOK_HASH_K1 + h);
+        }
+        break;
+    }
+}
+
+
+uint64_t jtok_hash(const jtok_tkn_t *tkn)
+{
+    jtok_hash_frame_t stack[JTOK_HASH_STACK_DEPTH];
+    int               depth = 0;
+    const jtok_tkn_t *cur   = tkn;
+
+    if (tkn == NULL)
+    {
+        return 0;
+    }
+
+    /* Subtrees occupy a contiguous run of the token pool in document order,
+     * so a single forward walk visits every node exactly once */
+    for (;; cur++)
+    {
+        uint64_t h;
+        bool     pushed = false;
+        switch (cur->type)
+        {
+            case JTOK_OBJECT:
+            case JTOK_ARRAY:
+            {
+                if (cur->size > 0)
+                {
+                    if (depth == JTOK_HASH_STACK_DEPTH)
+                    {
+                        return 0;
+                    }
+                    stack[depth].type      = (cur->type == JTOK_OBJECT)
+                                                 ? JTOK_HASH_FRAME_OBJECT
+                                                 : JTOK_HASH_FRAME_ARRAY;
+                    stack[depth].remaining = cur->size;
+                    stack[depth].size      = cur->size;
+                    stack[depth].acc       = 0;
+                    depth++;
+                    pushed = true;
+                }
+                else
+                {
+                    jtok_hash_frame_t empty = {
+                        .type = (cur->type == JTOK_OBJECT)
+                                    ? JTOK_HASH_FRAME_OBJECT
+                                    : JTOK_HASH_FRAME_ARRAY,
+                        .remaining = 0,
+                        .size      = 0,
+                        .acc       = 0,
+                    };
+                    h = jtok_hash_finish(&empty);
+                }
+            }
+            break;
+            case JTOK_STRING:
+            {
+                h = jtok_hash_leaf(cur);
+                if (cur->size > 0 && cur != tkn)
+                {
+                    /* Object key: wait for its value before combining */
+                    if (depth == JTOK_HASH_STACK_DEPTH)
+                    {
+                        return 0;
+                    }
+                    stack[depth].type      = JTOK_HASH_FRAME_KEY;
+                    stack[depth].remaining = 1;
+                    stack[depth].size      = 1;
+                    stack[depth].acc       = h;
+                    depth++;
+                    pushed = true;
+                }
+            }
+            break;
+            case JTOK_PRIMITIVE:
+            {
+                h = jtok_hash_leaf(cur);
+            }
+            break;
+            default:
+            {
+                return 0;
+            }
+            break;
+        }
+
+        if (pushed)
+        {
+            continue;
+        }
+
+        /* Hand the finished hash up through every frame it completes */
+        while (depth > 0)
+        {
+            jtok_hash_frame_t *top = &stack[depth - 1];
+            jtok_hash_combine(top, h);
+            if (--top->remaining > 0)
+            {
+                break;
+            }
+            h = jtok_hash_finish(top);
+            depth--;
+        }
+
+        if (depth == 0)
+        {
+            return h;
+        }
+    }
+}
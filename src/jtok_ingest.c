@@ -0,0 +1,761 @@
+/**
+ * @file jtok_ingest.c
+ * @author Carl Mattatall (cmattatall2@gmail.com)
+ * @brief Source module to read and parse NDJSON files with overlapped reads
+ * @version 0.1
+ * @date 2021-05-16
+ *
+ * @copyright Copyright (c) 2021 Carl Mattatall
+ *
+ */
+
+/* 64-bit file offsets on 32-bit targets. off_t never leaves this module. */
+#define _FILE_OFFSET_BITS 64
+
+#include <stdint.h>
+#include <string.h>
+
+#if defined(JTOK_HAVE_POSIX)
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif /* #if defined(JTOK_HAVE_POSIX) */
+
+#if defined(JTOK_HAVE_POSIX) && defined(JTOK_HAVE_IO_URING) &&                \
+    defined(JTOK_HAVE_ATOMICS)
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#if defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter) &&           \
+    defined(__NR_io_uring_register)
+#define JTOK_INGEST_URING
+#endif /* #if defined(__NR_io_uring_setup) && ... */
+#endif /* #if defined(JTOK_HAVE_POSIX) && defined(JTOK_HAVE_IO_URING) && ... */
+
+#include "jtok.h"
+#include "jtok_ingest.h"
+#include "jtok_lines.h"
+
+#if defined(JTOK_HAVE_POSIX)
+
+/* One chunk of a file, read into buffer seq % depth */
+typedef struct
+{
+    size_t              file;   /* index in paths */
+    int                 fd;     /* -1 if the file could not be opened */
+    uint64_t            offset; /* file offset of the chunk */
+    size_t              want;   /* bytes to read */
+    size_t              got;    /* bytes read so far */
+    bool                last;   /* the chunk ends its file */
+    bool                done;   /* no more bytes will arrive */
+    JTOK_PARSE_STATUS_t status; /* JTOK_PARSE_STATUS_IO_ERROR if it failed */
+    struct iovec        iov;    /* for IORING_OP_READV */
+} jtok_ingest_chunk_t;
+
+#if defined(JTOK_INGEST_URING)
+/* Just enough of io_uring for reads, driven through the raw system calls */
+typedef struct
+{
+    int                  fd;
+    bool                 fixed;     /* buffers are registered */
+    unsigned             to_submit; /* queued but not yet submitted */
+    unsigned *           sq_tail;
+    unsigned *           sq_mask;
+    unsigned *           sq_array;
+    unsigned *           cq_head;
+    unsigned *           cq_tail;
+    unsigned *           cq_mask;
+    struct io_uring_sqe *sqes;
+    struct io_uring_cqe *cqes;
+    void *               sq_map;
+    size_t               sq_map_len;
+    void *               cq_map;
+    size_t               cq_map_len;
+    size_t               sqes_len;
+} jtok_uring_t;
+#endif /* #if defined(JTOK_INGEST_URING) */
+
+typedef struct
+{
+    const char *const *         paths;
+    size_t                      count;
+    const jtok_ingest_config_t *config;
+    jtok_ingest_fn              fn;
+    void *                      ctx;
+
+    /* Reading: the file whose chunks are being handed out */
+    size_t   next_file; /* next file to open */
+    bool     open;      /* fd has chunks left to hand out */
+    int      fd;
+    size_t   file;
+    uint64_t file_len;
+    uint64_t offset; /* offset of its next chunk */
+    size_t   issued; /* chunks handed out */
+
+    /* Parsing: the file whose chunks are being delivered */
+    size_t              delivered; /* chunks delivered */
+    size_t              index;     /* documents so far in the file */
+    size_t              line;      /* lines so far in the file */
+    size_t              carry_used;
+    size_t              carry_total; /* length of the carried line */
+    uint64_t            carry_offset;
+    bool                carrying;
+    bool                stop;
+    JTOK_PARSE_STATUS_t status;
+
+    jtok_ingest_chunk_t chunks[JTOK_INGEST_MAX_DEPTH];
+#if defined(JTOK_INGEST_URING)
+    jtok_uring_t uring;
+    bool         use_uring;
+#endif /* #if defined(JTOK_INGEST_URING) */
+} jtok_ingest_t;
+
+/* One call to jtok_parse_lines */
+typedef struct
+{
+    jtok_ingest_t *in;
+    uint64_t       offset; /* file offset of the parsed text */
+    size_t         docs;   /* documents delivered */
+    size_t         line;   /* line of the last document in the text */
+    size_t         tail;   /* offset in the text just past that document */
+} jtok_ingest_batch_t;
+
+
+#if defined(JTOK_INGEST_URING)
+
+static bool jtok_uring_init(jtok_uring_t *uring, unsigned entries, char *buf,
+                            size_t len)
+{
+    struct io_uring_params params;
+    struct iovec           iov;
+    char *                 sq;
+    char *                 cq;
+    long                   fd;
+
+    memset(uring, 0, sizeof(*uring));
+    memset(&params, 0, sizeof(params));
+    fd = syscall(__NR_io_uring_setup, entries, &params);
+    if (fd < 0)
+    {
+        return false;
+    }
+    uring->fd         = (int)fd;
+    uring->sq_map_len =
+        params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    uring->cq_map_len =
+        params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    uring->sqes_len = params.sq_entries * sizeof(struct io_uring_sqe);
+
+#if defined(IORING_FEAT_SINGLE_MMAP)
+    if (params.features & IORING_FEAT_SINGLE_MMAP)
+    {
+        /* Both rings share one mapping */
+        if (uring->cq_map_len > uring->sq_map_len)
+        {
+            uring->sq_map_len = uring->cq_map_len;
+        }
+        uring->cq_map_len = 0;
+    }
+#endif /* #if defined(IORING_FEAT_SINGLE_MMAP) */
+
+    uring->sq_map = mmap(NULL, uring->sq_map_len, PROT_READ | PROT_WRITE,
+                         MAP_SHARED | MAP_POPULATE, uring->fd,
+                         IORING_OFF_SQ_RING);
+    uring->cq_map = uring->sq_map;
+    if (uring->sq_map != MAP_FAILED && uring->cq_map_len > 0)
+    {
+        uring->cq_map = mmap(NULL, uring->cq_map_len, PROT_READ | PROT_WRITE,
+                             MAP_SHARED | MAP_POPULATE, uring->fd,
+                             IORING_OFF_CQ_RING);
+    }
+    uring->sqes = mmap(NULL, uring->sqes_len, PROT_READ | PROT_WRITE,
+                       MAP_SHARED | MAP_POPULATE, uring->fd, IORING_OFF_SQES);
+    if (uring->sq_map == MAP_FAILED || uring->cq_map == MAP_FAILED ||
+        uring->sqes == MAP_FAILED)
+    {
+        if (uring->sq_map != MAP_FAILED)
+        {
+            munmap(uring->sq_map, uring->sq_map_len);
+        }
+        if (uring->cq_map != MAP_FAILED && uring->cq_map_len > 0)
+        {
+            munmap(uring->cq_map, uring->cq_map_len);
+        }
+        if (uring->sqes != MAP_FAILED)
+        {
+            munmap(uring->sqes, uring->sqes_len);
+        }
+        close(uring->fd);
+        return false;
+    }
+
+    sq              = (char *)uring->sq_map;
+    cq              = (char *)uring->cq_map;
+    uring->sq_tail  = (unsigned *)(sq + params.sq_off.tail);
+    uring->sq_mask  = (unsigned *)(sq + params.sq_off.ring_mask);
+    uring->sq_array = (unsigned *)(sq + params.sq_off.array);
+    uring->cq_head  = (unsigned *)(cq + params.cq_off.head);
+    uring->cq_tail  = (unsigned *)(cq + params.cq_off.tail);
+    uring->cq_mask  = (unsigned *)(cq + params.cq_off.ring_mask);
+    uring->cqes     = (struct io_uring_cqe *)(cq + params.cq_off.cqes);
+
+    /* Registered buffers spare the kernel mapping them on every read. The
+     * locked-memory limit may refuse them, in which case plain reads do. */
+    iov.iov_base = buf;
+    iov.iov_len  = len;
+    uring->fixed = (0 == syscall(__NR_io_uring_register, uring->fd,
+                                 IORING_REGISTER_BUFFERS, &iov, 1));
+    return true;
+}
+
+
+static void jtok_uring_exit(jtok_uring_t *uring)
+{
+    munmap(uring->sqes, uring->sqes_len);
+    if (uring->cq_map_len > 0)
+    {
+        munmap(uring->cq_map, uring->cq_map_len);
+    }
+    munmap(uring->sq_map, uring->sq_map_len);
+    close(uring->fd); /* unregisters the buffers */
+}
+
+
+static void jtok_uring_read(jtok_uring_t *uring, jtok_ingest_chunk_t *chunk,
+                            char *buf, uint64_t slot)
+{
+    unsigned             tail = *uring->sq_tail;
+    unsigned             idx  = tail & *uring->sq_mask;
+    struct io_uring_sqe *sqe  = &uring->sqes[idx];
+
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->fd        = chunk->fd;
+    sqe->off       = chunk->offset + chunk->got;
+    sqe->user_data = slot;
+    if (uring->fixed)
+    {
+        sqe->opcode    = IORING_OP_READ_FIXED;
+        sqe->addr      = (uint64_t)(uintptr_t)&buf[chunk->got];
+        sqe->len       = (uint32_t)(chunk->want - chunk->got);
+        sqe->buf_index = 0;
+    }
+    else
+    {
+        chunk->iov.iov_base = &buf[chunk->got];
+        chunk->iov.iov_len  = chunk->want - chunk->got;
+        sqe->opcode         = IORING_OP_READV;
+        sqe->addr           = (uint64_t)(uintptr_t)&chunk->iov;
+        sqe->len            = 1;
+    }
+    uring->sq_array[idx] = idx;
+
+    /* The kernel must see the entry before the new tail */
+    __atomic_store_n(uring->sq_tail, tail + 1, __ATOMIC_RELEASE);
+    uring->to_submit++;
+}
+
+#endif /* #if defined(JTOK_INGEST_URING) */
+
+
+static char *jtok_ingest_buffer(const jtok_ingest_t *in, size_t seq)
+{
+    return &in->config->buffers[(seq % in->config->depth) *
+                                in->config->chunk_len];
+}
+
+
+/**
+ * @brief Read a chunk, or queue the read. Only the pread path finishes
+ * here; queued reads go to the kernel on the next jtok_ingest_submit, so
+ * they run while earlier chunks are parsed.
+ */
+static void jtok_ingest_read(jtok_ingest_t *in, size_t seq)
+{
+    jtok_ingest_chunk_t *chunk = &in->chunks[seq % in->config->depth];
+    char *               buf   = jtok_ingest_buffer(in, seq);
+    ssize_t              n;
+
+    if (chunk->done)
+    {
+        return;
+    }
+#if defined(JTOK_INGEST_URING)
+    if (in->use_uring)
+    {
+        jtok_uring_read(&in->uring, chunk, buf, seq % in->config->depth);
+        return;
+    }
+#endif /* #if defined(JTOK_INGEST_URING) */
+
+    while (chunk->got < chunk->want)
+    {
+        n = pread(chunk->fd, &buf[chunk->got], chunk->want - chunk->got,
+                  (off_t)(chunk->offset + chunk->got));
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (n < 0)
+        {
+            chunk->status = JTOK_PARSE_STATUS_IO_ERROR;
+        }
+        if (n <= 0)
+        {
+            break; /* a file that shrank ends early */
+        }
+        chunk->got += (size_t)n;
+    }
+    chunk->done = true;
+}
+
+
+#if defined(JTOK_INGEST_URING)
+
+/**
+ * @brief Submit the queued reads, optionally waiting for one to complete
+ *
+ * @param in the ingest
+ * @param wait number of completions to wait for, 0 to return at once
+ */
+static void jtok_uring_enter(jtok_ingest_t *in, unsigned wait)
+{
+    jtok_uring_t *uring = &in->uring;
+    unsigned      i;
+    long          ret;
+
+    do
+    {
+        ret = syscall(__NR_io_uring_enter, uring->fd, uring->to_submit, wait,
+                      (wait > 0) ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+    } while (ret < 0 && (errno == EINTR || errno == EAGAIN || errno == EBUSY));
+    if (ret < 0)
+    {
+        /* The ring is unusable. Nothing more will complete. */
+        for (i = 0; i < in->config->depth; i++)
+        {
+            if (!in->chunks[i].done)
+            {
+                in->chunks[i].status = JTOK_PARSE_STATUS_IO_ERROR;
+                in->chunks[i].done   = true;
+            }
+        }
+        uring->to_submit = 0;
+        return;
+    }
+    uring->to_submit -= (unsigned)ret;
+}
+
+
+/* Collect the reads that have completed, without blocking */
+static void jtok_uring_reap(jtok_ingest_t *in)
+{
+    jtok_uring_t *       uring = &in->uring;
+    jtok_ingest_chunk_t *chunk;
+    struct io_uring_cqe *cqe;
+    unsigned             head;
+    unsigned             tail;
+    size_t               slot;
+
+    head = *uring->cq_head;
+    tail = __atomic_load_n(uring->cq_tail, __ATOMIC_ACQUIRE);
+    for (; head != tail; head++)
+    {
+        cqe   = &uring->cqes[head & *uring->cq_mask];
+        slot  = (size_t)cqe->user_data;
+        chunk = &in->chunks[slot];
+        if (cqe->res < 0)
+        {
+            chunk->status = JTOK_PARSE_STATUS_IO_ERROR;
+            chunk->done   = true;
+        }
+        else if (cqe->res == 0)
+        {
+            chunk->done = true; /* a file that shrank ends early */
+        }
+        else
+        {
+            chunk->got += (size_t)cqe->res;
+            chunk->done = (chunk->got == chunk->want);
+            if (!chunk->done)
+            {
+                /* A short read carries on where it stopped */
+                jtok_uring_read(uring, chunk,
+                                &in->config->buffers[slot *
+                                                     in->config->chunk_len],
+                                slot);
+            }
+        }
+    }
+    __atomic_store_n(uring->cq_head, head, __ATOMIC_RELEASE);
+}
+
+
+/* Wait until a chunk's read is complete, keeping the other reads going */
+static void jtok_ingest_wait(jtok_ingest_t *in, jtok_ingest_chunk_t *chunk)
+{
+    jtok_uring_reap(in);
+    while (!chunk->done)
+    {
+        jtok_uring_enter(in, 1);
+        jtok_uring_reap(in);
+    }
+    if (in->uring.to_submit > 0)
+    {
+        jtok_uring_enter(in, 0); /* reads requeued after a short read */
+    }
+}
+
+#endif /* #if defined(JTOK_INGEST_URING) */
+
+
+/**
+ * @brief Hand out the next chunk of input, opening files as they are
+ * reached. A file that cannot be opened becomes a failed chunk, so the
+ * error is reported in order.
+ *
+ * @param in the ingest
+ * @param chunk where the chunk is described
+ * @return true if there was a chunk, false at the end of the input
+ */
+static bool jtok_ingest_assign(jtok_ingest_t *in, jtok_ingest_chunk_t *chunk)
+{
+    struct stat st;
+    int         fd;
+
+    memset(chunk, 0, sizeof(*chunk));
+    while (!in->open)
+    {
+        if (in->next_file == in->count)
+        {
+            return false;
+        }
+        in->file = in->next_file++;
+        fd       = open(in->paths[in->file], O_RDONLY);
+        if (fd < 0 || fstat(fd, &st) != 0 || st.st_size < 0)
+        {
+            if (fd >= 0)
+            {
+                close(fd);
+            }
+            chunk->file   = in->file;
+            chunk->fd     = -1;
+            chunk->last   = true;
+            chunk->done   = true;
+            chunk->status = JTOK_PARSE_STATUS_IO_ERROR;
+            return true;
+        }
+        if (st.st_size == 0)
+        {
+            close(fd); /* nothing to parse */
+            continue;
+        }
+        in->fd       = fd;
+        in->file_len = (uint64_t)st.st_size;
+        in->offset   = 0;
+        in->open     = true;
+    }
+
+    chunk->file   = in->file;
+    chunk->fd     = in->fd;
+    chunk->offset = in->offset;
+    chunk->want   = in->config->chunk_len;
+    if (chunk->want > in->file_len - in->offset)
+    {
+        chunk->want = (size_t)(in->file_len - in->offset);
+    }
+    chunk->status = JTOK_PARSE_STATUS_OK;
+    in->offset += chunk->want;
+    if (in->offset == in->file_len)
+    {
+        /* The last chunk closes the file once it is delivered */
+        chunk->last = true;
+        in->open    = false;
+    }
+    return true;
+}
+
+
+static int jtok_ingest_line(void *ctx, const jtok_line_t *line,
+                            jtok_tkn_t *tkns)
+{
+    jtok_ingest_batch_t *batch = (jtok_ingest_batch_t *)ctx;
+    jtok_ingest_t *      in    = batch->in;
+    jtok_line_t          doc   = *line;
+
+    doc.index += in->index;
+    doc.line += in->line;
+    doc.offset = (size_t)(batch->offset + line->offset);
+    batch->docs++;
+    batch->line = line->line;
+    batch->tail = line->offset + line->len;
+    if (in->fn(in->ctx, in->chunks[in->delivered % in->config->depth].file,
+               &doc, tkns) != 0)
+    {
+        in->stop = true;
+        return 1;
+    }
+    return 0;
+}
+
+
+/* Parse whole lines of text from file offset offset */
+static void jtok_ingest_lines(jtok_ingest_t *in, const char *text, size_t len,
+                              uint64_t offset)
+{
+    jtok_ingest_batch_t batch = {in, offset, 0, 0, 0};
+    const char *        pos;
+    const char *        end = text + len;
+
+    (void)jtok_parse_lines(text, len, in->config->tkns, in->config->size,
+                           jtok_ingest_line, &batch);
+    in->index += batch.docs;
+
+    /* The parser has found the line of the last document. Only the blank
+     * lines after it are left to count. */
+    in->line += (batch.docs > 0) ? batch.line : 0;
+    pos = text + batch.tail;
+    while ((pos = memchr(pos, '\n', (size_t)(end - pos))) != NULL)
+    {
+        in->line++;
+        pos++;
+    }
+}
+
+
+/* Add to the line that spans chunks. What does not fit is only counted. */
+static void jtok_ingest_carry(jtok_ingest_t *in, const char *text, size_t len)
+{
+    size_t room = 0;
+    if (in->config->carry != NULL)
+    {
+        room = in->config->carry_len - in->carry_used;
+    }
+    if (room > len)
+    {
+        room = len;
+    }
+    if (room > 0)
+    {
+        memcpy(&in->config->carry[in->carry_used], text, room);
+        in->carry_used += room;
+    }
+    in->carry_total += len;
+}
+
+
+/* The line that spans chunks is complete */
+static void jtok_ingest_flush(jtok_ingest_t *in, bool newline)
+{
+    jtok_line_t line;
+    size_t      file = in->chunks[in->delivered % in->config->depth].file;
+
+    in->carrying = false;
+    if (in->carry_total == in->carry_used)
+    {
+        jtok_ingest_lines(in, in->config->carry, in->carry_used,
+                          in->carry_offset);
+    }
+    else if (!in->stop)
+    {
+        /* Too long to gather, so it cannot be parsed */
+        line.index  = in->index++;
+        line.line   = in->line;
+        line.offset = (size_t)in->carry_offset;
+        line.len    = in->carry_total;
+        line.status = JTOK_PARSE_STATUS_NOMEM;
+        if (in->fn(in->ctx, file, &line, in->config->tkns) != 0)
+        {
+            in->stop = true;
+        }
+    }
+    if (newline)
+    {
+        in->line++;
+    }
+}
+
+
+/* Parse a chunk whose read is complete, and every chunk before it */
+static void jtok_ingest_deliver(jtok_ingest_t *in, jtok_ingest_chunk_t *chunk,
+                                const char *buf)
+{
+    const char *newline;
+    size_t      pos = 0;
+    size_t      end;
+
+    if (in->stop || in->status != JTOK_PARSE_STATUS_OK)
+    {
+        return;
+    }
+    if (chunk->status != JTOK_PARSE_STATUS_OK)
+    {
+        in->status = chunk->status;
+        return;
+    }
+    if (chunk->offset == 0)
+    {
+        in->index    = 0;
+        in->line     = 0;
+        in->carrying = false;
+    }
+
+    /* Finish the line the previous chunk ended in */
+    if (in->carrying)
+    {
+        newline = memchr(buf, '\n', chunk->got);
+        pos     = (newline != NULL) ? (size_t)(newline - buf) : chunk->got;
+        jtok_ingest_carry(in, buf, pos);
+        if (newline != NULL)
+        {
+            jtok_ingest_flush(in, true);
+            pos++;
+        }
+        else if (chunk->last)
+        {
+            jtok_ingest_flush(in, false);
+        }
+    }
+
+    /* Whole lines are parsed in place. The last chunk of a file may end
+     * with an unterminated line, which is complete too. */
+    end = chunk->got;
+    if (!chunk->last)
+    {
+        while (end > pos && buf[end - 1] != '\n')
+        {
+            end--;
+        }
+    }
+    if (end > pos && !in->stop)
+    {
+        jtok_ingest_lines(in, &buf[pos], end - pos, chunk->offset + pos);
+    }
+
+    if (end < chunk->got)
+    {
+        in->carrying     = true;
+        in->carry_used   = 0;
+        in->carry_total  = 0;
+        in->carry_offset = chunk->offset + end;
+        jtok_ingest_carry(in, &buf[end], chunk->got - end);
+    }
+}
+
+
+/* Hand the queued reads to the kernel without waiting for them */
+static void jtok_ingest_submit(jtok_ingest_t *in)
+{
+#if defined(JTOK_INGEST_URING)
+    if (in->use_uring && in->uring.to_submit > 0)
+    {
+        jtok_uring_enter(in, 0);
+    }
+#else
+    (void)in;
+#endif /* #if defined(JTOK_INGEST_URING) */
+}
+
+
+static JTOK_PARSE_STATUS_t jtok_ingest_run(jtok_ingest_t *in)
+{
+    jtok_ingest_chunk_t *chunk;
+    size_t               seq;
+
+    /* Fill the queue */
+    while (in->issued < in->config->depth &&
+           jtok_ingest_assign(in, &in->chunks[in->issued]))
+    {
+        jtok_ingest_read(in, in->issued++);
+    }
+    jtok_ingest_submit(in);
+
+    while (in->delivered < in->issued)
+    {
+        seq   = in->delivered;
+        chunk = &in->chunks[seq % in->config->depth];
+#if defined(JTOK_INGEST_URING)
+        if (in->use_uring && !chunk->done)
+        {
+            jtok_ingest_wait(in, chunk);
+        }
+#endif /* #if defined(JTOK_INGEST_URING) */
+        jtok_ingest_deliver(in, chunk, jtok_ingest_buffer(in, seq));
+        if (chunk->last && chunk->fd >= 0)
+        {
+            close(chunk->fd);
+        }
+        in->delivered++;
+
+        /* Reuse the buffer for the next chunk. After an error or a stop,
+         * the reads in flight are only drained. */
+        if (!in->stop && in->status == JTOK_PARSE_STATUS_OK &&
+            jtok_ingest_assign(in, chunk))
+        {
+            jtok_ingest_read(in, in->issued++);
+            jtok_ingest_submit(in);
+        }
+    }
+
+    if (in->open)
+    {
+        close(in->fd);
+    }
+    return in->status;
+}
+
+#endif /* #if defined(JTOK_HAVE_POSIX) */
+
+
+JTOK_PARSE_STATUS_t jtok_ingest_files(const char *const *paths, size_t count,
+                                      const jtok_ingest_config_t *config,
+                                      jtok_ingest_fn fn, void *ctx)
+{
+#if defined(JTOK_HAVE_POSIX)
+    jtok_ingest_t       in;
+    JTOK_PARSE_STATUS_t status;
+#endif /* #if defined(JTOK_HAVE_POSIX) */
+
+    if ((paths == NULL && count > 0) || config == NULL || fn == NULL ||
+        config->buffers == NULL || config->tkns == NULL)
+    {
+        return JTOK_PARSE_STATUS_NULL_PARAM;
+    }
+    if (config->depth < 1 || config->depth > JTOK_INGEST_MAX_DEPTH ||
+        config->chunk_len == 0 || config->size == 0)
+    {
+        return JTOK_PARSE_STATUS_INVAL;
+    }
+
+#if defined(JTOK_HAVE_POSIX)
+    memset(&in, 0, sizeof(in));
+    in.paths  = paths;
+    in.count  = count;
+    in.config = config;
+    in.fn     = fn;
+    in.ctx    = ctx;
+    in.status = JTOK_PARSE_STATUS_OK;
+#if defined(JTOK_INGEST_URING)
+    if (!(config->flags & JTOK_INGEST_NO_URING))
+    {
+        in.use_uring = jtok_uring_init(&in.uring, config->depth,
+                                       config->buffers,
+                                       config->depth * config->chunk_len);
+    }
+#endif /* #if defined(JTOK_INGEST_URING) */
+
+    status = jtok_ingest_run(&in);
+
+#if defined(JTOK_INGEST_URING)
+    if (in.use_uring)
+    {
+        jtok_uring_exit(&in.uring);
+    }
+#endif /* #if defined(JTOK_INGEST_URING) */
+    return status;
+#else
+    (void)ctx;
+    return JTOK_PARSE_STATUS_IO_ERROR;
+#endif /* #if defined(JTOK_HAVE_POSIX) */
+}
@@ -0,0 +1,535 @@
+/**
+ * @file jtok_iov.c
+ * @author Carl Mattatall (cmattatall2@gmail.com)
+ * @brief Source module to parse documents split across segments
+ * @version 0.1
+ * @date 2021-05-16
+ *
+ * @copyright Copyright (c) 2021 Carl Mattatall
+ *
+ */
+
+#include <string.h>
+
+#include "jtok.h"
+#include "jtok_events.h"
+#include "jtok_iov.h"
+#include "jtok_primitive.h"
+#include "jtok_segments.h"
+
+/* A segment and the stream offset of its first byte */
+typedef struct
+{
+    size_t seg;
+    size_t start;
+} jtok_iov_pos_t;
+
+typedef struct
+{
+    const jtok_iov_t *iov;
+    size_t            count;
+    size_t            total; /* length of the stream */
+    jtok_tkn_t *      pool;
+    size_t            pool_size;
+    jtok_off_t        toknext;
+    jtok_off_t        key; /* key awaiting its value */
+    jtok_off_t        open[JTOK_MAX_RECURSE_DEPTH + 1];
+    jtok_off_t        last_child[JTOK_MAX_RECURSE_DEPTH + 1];
+    jtok_iov_pos_t    open_pos[JTOK_MAX_RECURSE_DEPTH + 1];
+    jtok_iov_pos_t    cur; /* segment being parsed */
+    bool              stream_offsets;
+
+    /* While a value straddles a boundary the parser is fed from a window:
+     * the stream from wbase to wend, copied to wbuf. That is stitch[wpos],
+     * or edge for a primitive that ends on the boundary. Stitched tokens
+     * keep the first wkeep bytes of it. */
+    char *         stitch;
+    size_t         stitch_len;
+    size_t         stitch_used;
+    bool           windowed;
+    char *         wbuf;
+    size_t         wcap; /* size of wbuf */
+    size_t         wpos;
+    size_t         wbase;
+    size_t         wend;
+    size_t         wsplit; /* end of the segment the window started in */
+    size_t         wkeep;
+    jtok_iov_pos_t wcopy; /* segment holding wend */
+    char           edge[JTOK_PRIMITIVE_MAX_NUMBER_LEN + 1];
+} jtok_iov_parser_t;
+
+
+static size_t jtok_iov_end(const jtok_iov_parser_t *p,
+                           const jtok_iov_pos_t *   pos)
+{
+    return pos->start + p->iov[pos->seg].len;
+}
+
+
+/* Move pos forward to the segment holding off (or the last one) */
+static void jtok_iov_seek(const jtok_iov_parser_t *p, jtok_iov_pos_t *pos,
+                          size_t off)
+{
+    while (pos->seg + 1 < p->count && off >= jtok_iov_end(p, pos))
+    {
+        pos->start += p->iov[pos->seg].len;
+        pos->seg++;
+    }
+}
+
+
+/* Append up to n more bytes of the stream to the window */
+static bool jtok_iov_copy(jtok_iov_parser_t *p, size_t n)
+{
+    size_t avail;
+    if (n > p->total - p->wend)
+    {
+        n = p->total - p->wend;
+    }
+    if (n > p->wcap - (p->wend - p->wbase))
+    {
+        return false;
+    }
+    while (n > 0)
+    {
+        jtok_iov_seek(p, &p->wcopy, p->wend);
+        avail = jtok_iov_end(p, &p->wcopy) - p->wend;
+        if (avail > n)
+        {
+            avail = n;
+        }
+        memcpy(&p->wbuf[p->wend - p->wbase],
+               (const char *)p->iov[p->wcopy.seg].base +
+                   (p->wend - p->wcopy.start),
+               avail);
+        p->wend += avail;
+        n -= avail;
+    }
+    return true;
+}
+
+
+/* Hand the parser the stream from its offset to the end of the window or
+ * of the current segment. Returns true if that is the end of the stream. */
+static bool jtok_iov_feed(jtok_iov_parser_t *p, jtok_events_t *parser)
+{
+    size_t      off = jtok_events_offset(parser);
+    const char *data;
+    size_t      end;
+
+    if (p->windowed)
+    {
+        data = &p->wbuf[off - p->wbase];
+        end  = p->wend;
+    }
+    else
+    {
+        data = (const char *)p->iov[p->cur.seg].base + (off - p->cur.start);
+        end  = jtok_iov_end(p, &p->cur);
+    }
+    jtok_events_input(parser, data, end - off, end == p->total);
+    return end == p->total;
+}
+
+
+/**
+ * @brief Point a token at its text [start, end), whose bytes (with quotes
+ * and delimiter) are [lo, hi). pos is a segment at or before lo.
+ */
+static void jtok_iov_place(jtok_iov_parser_t *p, jtok_tkn_t *tkn,
+                           jtok_iov_pos_t pos, size_t lo, size_t hi,
+                           size_t start, size_t end)
+{
+    jtok_iov_seek(p, &pos, lo);
+    if (p->stream_offsets)
+    {
+        tkn->json  = NULL;
+        tkn->start = (jtok_off_t)start;
+        tkn->end   = (jtok_off_t)end;
+    }
+    else if (hi <= jtok_iov_end(p, &pos))
+    {
+        tkn->json  = (char *)p->iov[pos.seg].base;
+        tkn->start = (jtok_off_t)(start - pos.start);
+        tkn->end   = (jtok_off_t)(end - pos.start);
+    }
+    else if (p->windowed && lo >= p->wbase && hi <= p->wend)
+    {
+        tkn->json  = p->wbuf;
+        tkn->start = (jtok_off_t)(start - p->wbase);
+        tkn->end   = (jtok_off_t)(end - p->wbase);
+        if (p->wkeep < hi - p->wbase)
+        {
+            p->wkeep = hi - p->wbase;
+        }
+    }
+    else
+    {
+        tkn->json  = NULL;
+        tkn->start = (jtok_off_t)start;
+        tkn->end   = (jtok_off_t)end;
+    }
+}
+
+
+/* Append a token and link it the way jtok_parse would */
+static jtok_tkn_t *jtok_iov_push(jtok_iov_parser_t *p, JTOK_TYPE_t type,
+                                 int depth, bool is_key)
+{
+    jtok_tkn_t *tkn;
+    jtok_tkn_t *parent;
+    jtok_off_t  idx;
+    jtok_off_t *last;
+
+    if ((size_t)p->toknext >= p->pool_size)
+    {
+        return NULL;
+    }
+    idx          = p->toknext++;
+    tkn          = &p->pool[idx];
+    tkn->pool    = p->pool;
+    tkn->type    = type;
+    tkn->size    = 0;
+    tkn->sibling = JTOK_NO_SIBLING_IDX;
+    tkn->parent  = (depth > 0) ? p->open[depth - 1] : JTOK_NO_PARENT_IDX;
+    if (p->key != JTOK_NO_PARENT_IDX)
+    {
+        tkn->parent = p->key;
+        p->key      = JTOK_NO_PARENT_IDX;
+    }
+
+    if (tkn->parent != JTOK_NO_PARENT_IDX)
+    {
+        parent = &p->pool[tkn->parent];
+        if (parent->type == JTOK_ARRAY ||
+            (parent->type == JTOK_OBJECT && is_key))
+        {
+            /* Keys and array elements are linked to their next sibling */
+            last = &p->last_child[depth - 1];
+            if (*last != JTOK_NO_CHILD_IDX)
+            {
+                p->pool[*last].sibling = idx;
+            }
+            *last = idx;
+            parent->size++;
+        }
+    }
+    if (is_key)
+    {
+        tkn->size = 1;
+        p->key    = idx;
+    }
+    return tkn;
+}
+
+
+static JTOK_PARSE_STATUS_t jtok_iov_token(jtok_iov_parser_t * p,
+                                          const jtok_event_t *ev)
+{
+    jtok_tkn_t *tkn;
+    size_t      quote = 0;
+    int         depth = ev->depth;
+
+    switch (ev->type)
+    {
+        case JTOK_EVENT_OBJECT_START:
+        case JTOK_EVENT_ARRAY_START:
+        {
+            tkn = jtok_iov_push(p,
+                                (ev->type == JTOK_EVENT_OBJECT_START)
+                                    ? JTOK_OBJECT
+                                    : JTOK_ARRAY,
+                                depth, false);
+            if (tkn == NULL)
+            {
+                return JTOK_PARSE_STATUS_NOMEM;
+            }
+            tkn->json            = NULL;
+            tkn->start           = (jtok_off_t)ev->start;
+            tkn->end             = JTOK_INVALID_ARRAY_INDEX;
+            p->open[depth]       = p->toknext - 1;
+            p->last_child[depth] = JTOK_NO_CHILD_IDX;
+            p->open_pos[depth]   = p->cur;
+            jtok_iov_seek(p, &p->open_pos[depth], ev->start);
+        }
+        break;
+        case JTOK_EVENT_OBJECT_END:
+        case JTOK_EVENT_ARRAY_END:
+        {
+            tkn = &p->pool[p->open[depth]];
+            jtok_iov_place(p, tkn, p->open_pos[depth], ev->start, ev->end,
+                           ev->start, ev->end);
+        }
+        break;
+        default:
+        {
+            if (ev->type == JTOK_EVENT_KEY || ev->type == JTOK_EVENT_STRING)
+            {
+                quote = 1;
+                tkn   = jtok_iov_push(p, JTOK_STRING, depth,
+                                    ev->type == JTOK_EVENT_KEY);
+            }
+            else
+            {
+                tkn = jtok_iov_push(p, JTOK_PRIMITIVE, depth, false);
+            }
+            if (tkn == NULL)
+            {
+                return JTOK_PARSE_STATUS_NOMEM;
+            }
+
+            /* A string's quotes are kept with its text */
+            jtok_iov_place(p, tkn, p->cur, ev->start - quote,
+                           ev->end + quote, ev->start, ev->end);
+        }
+        break;
+    }
+    return JTOK_PARSE_STATUS_OK;
+}
+
+
+/* Start a window at off, in buf, holding the rest of the current segment */
+static bool jtok_iov_window(jtok_iov_parser_t *p, size_t off, char *buf,
+                            size_t cap)
+{
+    p->windowed = true;
+    p->wbuf     = buf;
+    p->wcap     = cap;
+    p->wpos     = p->stitch_used;
+    p->wbase    = off;
+    p->wend     = off;
+    p->wkeep    = 0;
+    p->wcopy    = p->cur;
+    p->wsplit   = jtok_iov_end(p, &p->cur);
+    return jtok_iov_copy(p, p->wsplit - off);
+}
+
+
+/**
+ * @brief Check whether the value at off is a primitive that ends exactly
+ * on the segment boundary, the next byte of the stream ending it
+ *
+ * @note Such a primitive is already complete. The parser only needs to see
+ * the byte after it, so the two are put in edge and stitch is not used.
+ */
+static bool jtok_iov_edge(jtok_iov_parser_t *p, size_t off)
+{
+    const char *   seg   = (const char *)p->iov[p->cur.seg].base;
+    size_t         split = jtok_iov_end(p, &p->cur);
+    jtok_iov_pos_t next  = p->cur;
+    char           c     = seg[off - p->cur.start];
+
+    if (c == '\"' || c == '\'' || split - off >= sizeof(p->edge) ||
+        split == p->total)
+    {
+        return false;
+    }
+    jtok_iov_seek(p, &next, split);
+    c = ((const char *)p->iov[next.seg].base)[split - next.start];
+    if (c != ' ' && c != '\t' && c != '\r' && c != '\n' && c != ',' &&
+        c != ']' && c != '}')
+    {
+        return false;
+    }
+    return jtok_iov_window(p, off, p->edge, sizeof(p->edge)) &&
+           jtok_iov_copy(p, 1);
+}
+
+
+/* The parser needs more than the current segment or window holds */
+static bool jtok_iov_stitch(jtok_iov_parser_t *p, size_t off)
+{
+    size_t grow;
+    size_t room;
+
+    if (!p->windowed)
+    {
+        if (jtok_iov_edge(p, off))
+        {
+            return true;
+        }
+        if (p->stitch == NULL ||
+            !jtok_iov_window(p, off, &p->stitch[p->stitch_used],
+                             p->stitch_len - p->stitch_used))
+        {
+            return false;
+        }
+    }
+
+    /* The parser rescans the value from its start every time the window
+     * grows, so grow it geometrically: a value of n bytes is then scanned
+     * O(n) times in all rather than O(n^2 / JTOK_IOV_STITCH_STEP) */
+    grow = p->wend - p->wbase;
+    room = p->wcap - grow;
+    if (grow < JTOK_IOV_STITCH_STEP)
+    {
+        grow = JTOK_IOV_STITCH_STEP;
+    }
+    if (grow > room)
+    {
+        grow = room;
+    }
+    return grow > 0 && jtok_iov_copy(p, grow);
+}
+
+
+JTOK_PARSE_STATUS_t jtok_parse_iov(const jtok_iov_t *iov, size_t count,
+                                   jtok_tkn_t *tkns, size_t size,
+                                   char *stitch, size_t stitch_len)
+{
+    return jtok_parse_segments(iov, count, tkns, size, stitch, stitch_len,
+                               false, NULL);
+}
+
+
+JTOK_PARSE_STATUS_t jtok_parse_segments(const jtok_iov_t *iov, size_t count,
+                                        jtok_tkn_t *tkns, size_t size,
+                                        char *stitch, size_t stitch_len,
+                                        bool stream_offsets, size_t *written)
+{
+    jtok_iov_parser_t   p;
+    jtok_events_t       parser;
+    jtok_event_t        ev;
+    JTOK_PARSE_STATUS_t status;
+    size_t              off;
+    size_t              i;
+    bool                last;
+
+    if (written != NULL)
+    {
+        *written = 0;
+    }
+    if (iov == NULL || tkns == NULL)
+    {
+        return JTOK_PARSE_STATUS_NULL_PARAM;
+    }
+    if (size < 1)
+    {
+        return JTOK_PARSE_STATUS_NOMEM;
+    }
+
+    memset(&p, 0, sizeof(p));
+    for (i = 0; i < count; i++)
+    {
+        if (iov[i].base == NULL && iov[i].len > 0)
+        {
+            return JTOK_PARSE_STATUS_NULL_PARAM;
+        }
+        p.total += iov[i].len;
+        if (p.total > (size_t)JTOK_OFF_MAX)
+        {
+            /* Offsets are jtok_off_t (see JTOK_OFFSET_WIDTH) */
+            return JTOK_PARSE_STATUS_INVAL;
+        }
+    }
+    if (p.total == 0)
+    {
+        return JTOK_PARSE_STATUS_NON_OBJECT;
+    }
+
+    /* Tokens past JTOK_OFF_MAX cannot be indexed, so are not used */
+    if (size > (size_t)JTOK_OFF_MAX)
+    {
+        size = (size_t)JTOK_OFF_MAX;
+    }
+    p.iov            = iov;
+    p.count          = count;
+    p.pool           = tkns;
+    p.pool_size      = size;
+    p.key            = JTOK_NO_PARENT_IDX;
+    p.stream_offsets = stream_offsets;
+    p.stitch         = stitch;
+    p.stitch_len     = (stitch != NULL) ? stitch_len : 0;
+
+    jtok_events_init(&parser, NULL, 0);
+    jtok_iov_seek(&p, &p.cur, 0);
+    last = jtok_iov_feed(&p, &parser);
+    for (;;)
+    {
+        status = jtok_events_next(&parser, &ev);
+        off    = jtok_events_offset(&parser);
+        if (status == JTOK_PARSE_STATUS_OK)
+        {
+            if (ev.type == JTOK_EVENT_END)
+            {
+                break;
+            }
+            status = jtok_iov_token(&p, &ev);
+            if (status != JTOK_PARSE_STATUS_OK)
+            {
+                break;
+            }
+            if (p.windowed && off >= p.wsplit)
+            {
+                /* Past the boundary: back to parsing the segments in place */
+                p.windowed    = false;
+                p.stitch_used = p.wpos + p.wkeep;
+                jtok_iov_seek(&p, &p.cur, off);
+                last = jtok_iov_feed(&p, &parser);
+            }
+        }
+        else if (status == JTOK_PARSE_STATUS_PARTIAL_TOKEN && !last)
+        {
+            if (!p.windowed && off == jtok_iov_end(&p, &p.cur))
+            {
+                /* Nothing straddles the boundary */
+                jtok_iov_seek(&p, &p.cur, off);
+            }
+            else if (!jtok_iov_stitch(&p, off))
+            {
+                status = JTOK_PARSE_STATUS_NOMEM;
+                break;
+            }
+            last = jtok_iov_feed(&p, &parser);
+        }
+        else
+        {
+            break;
+        }
+    }
+
+    /* Mark the end of the parsed tokens */
+    if ((size_t)p.toknext < size)
+    {
+        tkns[p.toknext].type = JTOK_UNASSIGNED_TOKEN;
+    }
+    if (written != NULL)
+    {
+        *written = (size_t)p.toknext;
+    }
+    return status;
+}
+
+
+bool jtok_iov_locate(const jtok_iov_t *iov, size_t count,
+                     const jtok_tkn_t *tkn, size_t *segment, size_t *offset)
+{
+    size_t start = 0;
+    size_t i;
+
+    if (iov == NULL || tkn == NULL || segment == NULL || offset == NULL)
+    {
+        return false;
+    }
+    for (i = 0; i < count; i++)
+    {
+        if (tkn->json == NULL)
+        {
+            /* start is a stream offset */
+            if ((size_t)tkn->start < start + iov[i].len)
+            {
+                *segment = i;
+                *offset  = (size_t)tkn->start - start;
+                return true;
+            }
+            start += iov[i].len;
+        }
+        else if ((const void *)tkn->json == iov[i].base && iov[i].len > 0)
+        {
+            *segment = i;
+            *offset  = (size_t)tkn->start;
+            return true;
+        }
+    }
+    return false;
+}
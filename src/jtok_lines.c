@@ -0,0 +1,438 @@
+/**
+ * @file jtok_lines.c
+ * @author Carl Mattatall (cmattatall2@gmail.com)
+ * @brief Source module to parse buffers of newline-delimited json documents
+ * @version 0.1
+ * @date 2021-05-09
+ *
+ * @copyright Copyright (c) 2021 Carl Mattatall
+ *
+ */
+
+#include <ctype.h>
+#include <string.h>
+
+#if defined(JTOK_HAVE_THREADS)
+#include <pthread.h>
+#endif /* #if defined(JTOK_HAVE_THREADS) */
+
+#include "jtok.h"
+#include "jtok_lines.h"
+
+/* State shared by every worker of a jtok_parse_lines_mt call */
+typedef struct
+{
+    const char *               buf;
+    size_t                     len;
+    const jtok_lines_config_t *config;
+    jtok_line_fn               fn;
+    void *                     ctx;
+    size_t                     chunk_len;
+    size_t                     chunk_count;
+    size_t                     next_chunk; /* next chunk to hand out */
+    size_t                     turn;       /* chunk allowed to deliver */
+    size_t                     line_base;  /* lines before that chunk */
+    size_t                     index_base; /* documents before that chunk */
+    bool                       stop;       /* fn asked to stop */
+#if defined(JTOK_HAVE_THREADS)
+    pthread_mutex_t lock;
+    pthread_cond_t  turn_changed;
+#endif /* #if defined(JTOK_HAVE_THREADS) */
+} jtok_lines_mt_t;
+
+typedef struct
+{
+    jtok_lines_mt_t *shared;
+    jtok_tkn_t *     pool;
+    size_t           delivered;
+#if defined(JTOK_HAVE_THREADS)
+    pthread_t thread;
+#endif /* #if defined(JTOK_HAVE_THREADS) */
+} jtok_lines_worker_t;
+
+/* Documents a worker has parsed but not yet delivered (ordered mode) */
+typedef struct
+{
+    jtok_line_t lines[JTOK_LINES_MAX_PENDING];
+    size_t      first_tkn[JTOK_LINES_MAX_PENDING];
+    size_t      count;
+    size_t      pool_used;
+} jtok_lines_pending_t;
+
+
+/**
+ * @brief Find the line that starts at pos
+ *
+ * @param buf the buffer
+ * @param len length of buf
+ * @param pos start of the line
+ * @param end output location for the end of the line's text
+ * @param next output location for the start of the following line
+ * @return true if the line holds more than whitespace
+ */
+static bool jtok_lines_find(const char *buf, size_t len, size_t pos,
+                            size_t *end, size_t *next)
+{
+    /* memchr is vectorized by every mainstream libc, which beats a
+     * hand-rolled scan for a single delimiter */
+    const char *newline = memchr(&buf[pos], '\n', len - pos);
+    size_t      first   = pos;
+
+    *end  = (newline != NULL) ? (size_t)(newline - buf) : len;
+    *next = (newline != NULL) ? *end + 1 : len;
+    while (first < *end && isspace((int)buf[first]))
+    {
+        first++;
+    }
+    if (first < *end && buf[*end - 1] == '\r')
+    {
+        *end -= 1;
+    }
+    return first < *end;
+}
+
+
+size_t jtok_parse_lines(const char *buf, size_t len, jtok_tkn_t *tkns,
+                        size_t size, jtok_line_fn fn, void *ctx)
+{
+    jtok_line_t info;
+    size_t      pos = 0;
+    size_t      end;
+    size_t      next;
+    if (buf == NULL || tkns == NULL || fn == NULL)
+    {
+        return 0;
+    }
+
+    info.index = 0;
+    info.line  = 0;
+    for (; pos < len; pos = next, info.line++)
+    {
+        if (jtok_lines_find(buf, len, pos, &end, &next))
+        {
+            info.offset = pos;
+            info.len    = end - pos;
+            info.status = jtok_parsen(&buf[pos], info.len, tkns, size);
+            if (0 != fn(ctx, &info, tkns))
+            {
+                return next;
+            }
+            info.index++;
+        }
+    }
+    return len;
+}
+
+
+static void jtok_lines_lock(jtok_lines_mt_t *mt)
+{
+#if defined(JTOK_HAVE_THREADS)
+    pthread_mutex_lock(&mt->lock);
+#else
+    (void)mt;
+#endif /* #if defined(JTOK_HAVE_THREADS) */
+}
+
+
+static void jtok_lines_unlock(jtok_lines_mt_t *mt)
+{
+#if defined(JTOK_HAVE_THREADS)
+    pthread_mutex_unlock(&mt->lock);
+#else
+    (void)mt;
+#endif /* #if defined(JTOK_HAVE_THREADS) */
+}
+
+
+/**
+ * @brief Deliver a worker's pending documents once every earlier chunk has
+ * delivered its own
+ *
+ * @param worker the worker
+ * @param pending the documents to deliver
+ * @param chunk the chunk they came from
+ * @param chunk_lines if the chunk is finished, the number of lines it held.
+ * JTOK_LINES_UNKNOWN otherwise.
+ * @param chunk_docs if the chunk is finished, the number of documents it held
+ */
+static void jtok_lines_flush(jtok_lines_worker_t * worker,
+                             jtok_lines_pending_t *pending, size_t chunk,
+                             size_t chunk_lines, size_t chunk_docs)
+{
+    jtok_lines_mt_t *mt = worker->shared;
+    size_t           line_base;
+    size_t           index_base;
+    size_t           i;
+    bool             stop;
+
+    jtok_lines_lock(mt);
+#if defined(JTOK_HAVE_THREADS)
+    while (mt->turn != chunk && !mt->stop)
+    {
+        pthread_cond_wait(&mt->turn_changed, &mt->lock);
+    }
+#else
+    (void)chunk; /* a single worker always has the turn */
+#endif /* #if defined(JTOK_HAVE_THREADS) */
+    stop       = mt->stop;
+    line_base  = mt->line_base;
+    index_base = mt->index_base;
+    jtok_lines_unlock(mt);
+
+    /* Only the worker whose turn it is gets here, so fn is never re-entered */
+    for (i = 0; i < pending->count && !stop; i++)
+    {
+        jtok_line_t *line = &pending->lines[i];
+        line->line += line_base;
+        line->index += index_base;
+        stop = (0 != mt->fn(mt->ctx, line,
+                            &worker->pool[pending->first_tkn[i]]));
+        worker->delivered++;
+    }
+    pending->count     = 0;
+    pending->pool_used = 0;
+
+    if (stop || chunk_lines != JTOK_LINES_UNKNOWN)
+    {
+        jtok_lines_lock(mt);
+        mt->stop = mt->stop || stop;
+        if (chunk_lines != JTOK_LINES_UNKNOWN)
+        {
+            mt->line_base += chunk_lines;
+            mt->index_base += chunk_docs;
+            mt->turn++;
+        }
+#if defined(JTOK_HAVE_THREADS)
+        pthread_cond_broadcast(&mt->turn_changed);
+#endif /* #if defined(JTOK_HAVE_THREADS) */
+        jtok_lines_unlock(mt);
+    }
+}
+
+
+/**
+ * @brief Parse a document into the unused part of a worker's pool, keeping
+ * it to deliver later
+ */
+static void jtok_lines_hold(jtok_lines_worker_t * worker,
+                            jtok_lines_pending_t *pending,
+                            const jtok_line_t *line, size_t chunk)
+{
+    jtok_lines_mt_t *mt   = worker->shared;
+    size_t           size = mt->config->pool_size;
+    size_t           used = pending->pool_used;
+    jtok_tkn_t *     tkns = &worker->pool[used];
+    jtok_line_t *    held = &pending->lines[pending->count];
+    size_t           room;
+    size_t           count;
+
+    /* Behind other documents, always leave room for the end-of-document
+     * marker. Only a document alone in the pool may fill it, as it could
+     * with jtok_parse_lines */
+    room         = (used > 0) ? size - used - 1 : size;
+    *held        = *line;
+    held->status = JTOK_PARSE_STATUS_NOMEM;
+    if (room > 0)
+    {
+        held->status =
+            jtok_parsen(&mt->buf[line->offset], line->len, tkns, room);
+    }
+    if (held->status == JTOK_PARSE_STATUS_NOMEM && used > 0)
+    {
+        /* Deliver what is held to make the whole pool available */
+        jtok_line_t copy = *line;
+        jtok_lines_flush(worker, pending, chunk, JTOK_LINES_UNKNOWN, 0);
+        jtok_lines_hold(worker, pending, &copy, chunk);
+        return;
+    }
+
+    pending->first_tkn[pending->count++] = used;
+    if (held->status == JTOK_PARSE_STATUS_OK)
+    {
+        /* Claim the tokens and the end-of-document marker after them, so
+         * the next document held does not overwrite the marker. jtok_parsen
+         * only writes the marker if it fits in room. */
+        for (count = 0;
+             count < room && tkns[count].type != JTOK_UNASSIGNED_TOKEN; count++)
+        {
+        }
+        if (used + count < size)
+        {
+            tkns[count].type = JTOK_UNASSIGNED_TOKEN;
+            count++;
+        }
+        pending->pool_used = used + count;
+    }
+    if (pending->count == JTOK_LINES_MAX_PENDING || pending->pool_used == size)
+    {
+        jtok_lines_flush(worker, pending, chunk, JTOK_LINES_UNKNOWN, 0);
+    }
+}
+
+
+/**
+ * @brief Parse every line that starts inside a chunk
+ */
+static void jtok_lines_chunk(jtok_lines_worker_t * worker,
+                             jtok_lines_pending_t *pending, size_t chunk)
+{
+    jtok_lines_mt_t *mt      = worker->shared;
+    bool             ordered = mt->config->ordered;
+    size_t           limit   = (chunk + 1) * mt->chunk_len;
+    size_t           pos     = 0;
+    size_t           end;
+    size_t           next;
+    jtok_line_t      info;
+
+    if (chunk > 0)
+    {
+        /* The chunk starts at the first line that starts inside it */
+        const char *newline = memchr(&mt->buf[chunk * mt->chunk_len - 1], '\n',
+                                     mt->len - chunk * mt->chunk_len + 1);
+        pos = (newline != NULL) ? (size_t)(newline - mt->buf) + 1 : mt->len;
+    }
+    if (limit > mt->len)
+    {
+        limit = mt->len;
+    }
+
+    info.line  = 0;
+    info.index = 0;
+    for (; pos < limit; pos = next, info.line++)
+    {
+        if (!jtok_lines_find(mt->buf, mt->len, pos, &end, &next))
+        {
+            continue;
+        }
+        info.offset = pos;
+        info.len    = end - pos;
+        if (ordered)
+        {
+            jtok_lines_hold(worker, pending, &info, chunk);
+            info.index++;
+        }
+        else
+        {
+            jtok_line_t unordered = info;
+            unordered.line        = JTOK_LINES_UNKNOWN;
+            unordered.index       = JTOK_LINES_UNKNOWN;
+            unordered.status      = jtok_parsen(&mt->buf[pos], info.len,
+                                                worker->pool,
+                                                mt->config->pool_size);
+            worker->delivered++;
+            if (0 != mt->fn(mt->ctx, &unordered, worker->pool))
+            {
+                jtok_lines_lock(mt);
+                mt->stop = true;
+                jtok_lines_unlock(mt);
+                return;
+            }
+        }
+    }
+    if (ordered)
+    {
+        jtok_lines_flush(worker, pending, chunk, info.line, info.index);
+    }
+}
+
+
+static void *jtok_lines_work(void *arg)
+{
+    jtok_lines_worker_t *worker = arg;
+    jtok_lines_mt_t *    mt     = worker->shared;
+    jtok_lines_pending_t pending;
+    size_t               chunk;
+
+    pending.count     = 0;
+    pending.pool_used = 0;
+    for (;;)
+    {
+        jtok_lines_lock(mt);
+        chunk = mt->next_chunk;
+        if (mt->stop || chunk >= mt->chunk_count)
+        {
+            jtok_lines_unlock(mt);
+            break;
+        }
+        mt->next_chunk++;
+        jtok_lines_unlock(mt);
+        jtok_lines_chunk(worker, &pending, chunk);
+    }
+    return NULL;
+}
+
+
+size_t jtok_parse_lines_mt(const char *buf, size_t len,
+                           const jtok_lines_config_t *config, jtok_line_fn fn,
+                           void *ctx)
+{
+    jtok_lines_mt_t     mt;
+    jtok_lines_worker_t workers[JTOK_LINES_MAX_THREADS];
+    unsigned            count = 1;
+    unsigned            i;
+    size_t              delivered = 0;
+
+    if (buf == NULL || config == NULL || fn == NULL || config->pools == NULL ||
+        config->pool_size == 0 || config->threads == 0 ||
+        config->threads > JTOK_LINES_MAX_THREADS)
+    {
+        return 0;
+    }
+
+    mt.buf         = buf;
+    mt.len         = len;
+    mt.config      = config;
+    mt.fn          = fn;
+    mt.ctx         = ctx;
+    mt.chunk_len   = (config->chunk_len > 0) ? config->chunk_len
+                                             : JTOK_LINES_CHUNK_DEFAULT;
+    mt.chunk_count = len / mt.chunk_len + (len % mt.chunk_len != 0);
+    mt.next_chunk  = 0;
+    mt.turn        = 0;
+    mt.line_base   = 0;
+    mt.index_base  = 0;
+    mt.stop        = false;
+
+    workers[0].shared    = &mt;
+    workers[0].pool      = config->pools;
+    workers[0].delivered = 0;
+
+#if defined(JTOK_HAVE_THREADS)
+    pthread_mutex_init(&mt.lock, NULL);
+    pthread_cond_init(&mt.turn_changed, NULL);
+
+    /* No point starting more workers than there are chunks */
+    for (i = 1; i < config->threads && i < mt.chunk_count; i++)
+    {
+        workers[count].shared    = &mt;
+        workers[count].pool      = &config->pools[i * config->pool_size];
+        workers[count].delivered = 0;
+        if (0 == pthread_create(&workers[count].thread, NULL, jtok_lines_work,
+                                &workers[count]))
+        {
+            count++;
+        }
+    }
+#endif /* #if defined(JTOK_HAVE_THREADS) */
+
+    /* The calling thread works too. If threads could not be started it
+     * simply does more of the chunks itself. */
+    jtok_lines_work(&workers[0]);
+
+    for (i = 0; i < count; i++)
+    {
+#if defined(JTOK_HAVE_THREADS)
+        if (i > 0)
+        {
+            pthread_join(workers[i].thread, NULL);
+        }
+#endif /* #if defined(JTOK_HAVE_THREADS) */
+        delivered += workers[i].delivered;
+    }
+
+#if defined(JTOK_HAVE_THREADS)
+    pthread_cond_destroy(&mt.turn_changed);
+    pthread_mutex_destroy(&mt.lock);
+#endif /* #if defined(JTOK_HAVE_THREADS) */
+    return delivered;
+}
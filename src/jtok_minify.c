@@ -0,0 +1,337 @@
+/**
+ * @file jtok_minify.c
+ * @author Carl Mattatall (cmattatall2@gmail.com)
+ * @brief Source module to strip insignificant whitespace from json in place
+ * @version 0.1
+ * @date 2021-05-03
+ *
+ * @copyright Copyright (c) 2021 Carl Mattatall
+ *
+ */
+
+#include <ctype.h>
+#include <string.h>
+
+#include "jtok.h"
+#include "jtok_shared.h"
+#include "jtok_swar.h"
+
+#define JTOK_MINIFY_STACK_SIZE (JTOK_MAX_RECURSE_DEPTH + 1)
+
+typedef struct
+{
+    char *  buf;
+    size_t  len;
+    size_t  rd; /* next byte to read */
+    size_t  wr; /* next byte to write (always <= rd) */
+    bool    validate;
+    bool    root_done;
+    int     depth;
+    char    stack[JTOK_MINIFY_STACK_SIZE]; /* open brackets when validating */
+} jtok_minifier_t;
+
+
+/**
+ * @brief Mask of bytes in word that end a run of bytes copied verbatim
+ * outside of a string: whitespace, control characters, NUL and quotes.
+ * When validating, brackets also end a run so they can be matched.
+ */
+static uint64_t jtok_minify_stop_bytes(uint64_t word, bool validate)
+{
+    uint64_t mask = jtok_swar_lt_bytes(word, (unsigned char)(' ' + 1)) |
+                    jtok_swar_eq_bytes(word, '\"') |
+                    jtok_swar_eq_bytes(word, '\'');
+    if (validate)
+    {
+        /* '[' | 0x20 == '{' and ']' | 0x20 == '}' */
+        uint64_t folded = word | (JTOK_SWAR_ONES * 0x20);
+        mask |= jtok_swar_eq_bytes(folded, '{') |
+                jtok_swar_eq_bytes(folded, '}');
+    }
+    return mask;
+}
+
+
+/**
+ * @brief Copy one byte from the read position to the write position
+ */
+static void jtok_minify_keep(jtok_minifier_t *m)
+{
+    m->buf[m->wr++] = m->buf[m->rd++];
+}
+
+
+/**
+ * @brief Copy a string (including its quotes) starting at the read position
+ *
+ * @param m the minifier
+ * @return JTOK_PARSE_STATUS_t JTOK_PARSE_STATUS_OK, or when validating the
+ * same error jtok_parse_string would report
+ */
+static JTOK_PARSE_STATUS_t jtok_minify_string(jtok_minifier_t *m)
+{
+    char quote = m->buf[m->rd];
+    jtok_minify_keep(m);
+    while (m->rd < m->len)
+    {
+        /* Bulk copy 8 bytes at a time while nothing interesting is in them */
+        while (m->rd + sizeof(uint64_t) <= m->len)
+        {
+            uint64_t word = jtok_swar_load(&m->buf[m->rd]);
+            if ((jtok_swar_eq_bytes(word, (unsigned char)quote) |
+                 jtok_swar_eq_bytes(word, '\\') | jtok_swar_zero_bytes(word)) !=
+                0)
+            {
+                break;
+            }
+            memcpy(&m->buf[m->wr], &word, sizeof(word));
+            m->wr += sizeof(word);
+            m->rd += sizeof(word);
+        }
+        if (m->rd >= m->len || m->buf[m->rd] == '\0')
+        {
+            break;
+        }
+
+        if (m->buf[m->rd] == quote)
+        {
+            jtok_minify_keep(m);
+            return JTOK_PARSE_STATUS_OK;
+        }
+        else if (m->buf[m->rd] == '\\')
+        {
+            jtok_minify_keep(m);
+            if (m->rd >= m->len || m->buf[m->rd] == '\0')
+            {
+                break;
+            }
+            if (m->validate)
+            {
+                switch (m->buf[m->rd])
+                {
+                    case '\"':
+                    case '/':
+                    case '\\':
+                    case 'b':
+                    case 'f':
+                    case 'r':
+                    case 'n':
+                    case 't':
+                    {
+                    }
+                    break;
+                    case 'u':
+                    {
+                        int i;
+                        for (i = 1; i <= HEXCHAR_ESCAPE_SEQ_COUNT; i++)
+                        {
+                            if (m->rd + i >= m->len ||
+                                !isxdigit((int)m->buf[m->rd + i]))
+                            {
+                                return JTOK_PARSE_STATUS_INVAL;
+                            }
+                        }
+                    }
+                    break;
+                    default:
+                    {
+                        return JTOK_PARSE_STATUS_INVAL;
+                    }
+                    break;
+                }
+            }
+            jtok_minify_keep(m);
+        }
+        else
+        {
+            jtok_minify_keep(m);
+        }
+    }
+    return JTOK_PARSE_STATUS_PARTIAL_TOKEN;
+}
+
+
+/**
+ * @brief Track brackets and the single object root while validating
+ *
+ * @param m the minifier
+ * @param c the significant byte about to be kept
+ * @return JTOK_PARSE_STATUS_t JTOK_PARSE_STATUS_OK if c is allowed here
+ */
+static JTOK_PARSE_STATUS_t jtok_minify_structure(jtok_minifier_t *m, char c)
+{
+    if (m->root_done)
+    {
+        return JTOK_PARSE_STATUS_INVALID_END;
+    }
+    if (m->depth == 0 && c != '{')
+    {
+        return JTOK_PARSE_STATUS_NON_OBJECT;
+    }
+    switch (c)
+    {
+        case '{':
+        case '[':
+        {
+            if (m->depth >= JTOK_MINIFY_STACK_SIZE)
+            {
+                return JTOK_PARSE_STATUS_NEST_DEPTH_EXCEEDED;
+            }
+            m->stack[m->depth++] = (char)(c + 2); /* matching close */
+        }
+        break;
+        case '}':
+        case ']':
+        {
+            if (m->stack[m->depth - 1] != c)
+            {
+                return JTOK_PARSE_STATUS_INVAL;
+            }
+            if (--m->depth == 0)
+            {
+                m->root_done = true;
+            }
+        }
+        break;
+    }
+    return JTOK_PARSE_STATUS_OK;
+}
+
+
+/**
+ * @brief Minify m->buf, optionally validating its structure along the way
+ *
+ * @param m the minifier
+ * @return JTOK_PARSE_STATUS_t JTOK_PARSE_STATUS_OK on success
+ */
+static JTOK_PARSE_STATUS_t jtok_minify_run(jtok_minifier_t *m)
+{
+    JTOK_PARSE_STATUS_t status = JTOK_PARSE_STATUS_OK;
+    while (status == JTOK_PARSE_STATUS_OK && m->rd < m->len)
+    {
+        /* Runs of ordinary bytes cost one load and one store per 8 bytes */
+        while (m->rd + sizeof(uint64_t) <= m->len)
+        {
+            uint64_t word = jtok_swar_load(&m->buf[m->rd]);
+            if (jtok_minify_stop_bytes(word, m->validate) != 0)
+            {
+                break;
+            }
+            if (m->validate && m->depth == 0)
+            {
+                /* Significant bytes outside the root object */
+                status = m->root_done ? JTOK_PARSE_STATUS_INVALID_END
+                                      : JTOK_PARSE_STATUS_NON_OBJECT;
+                break;
+            }
+            if (m->wr != m->rd)
+            {
+                memcpy(&m->buf[m->wr], &word, sizeof(word));
+            }
+            m->wr += sizeof(word);
+            m->rd += sizeof(word);
+        }
+        if (status != JTOK_PARSE_STATUS_OK || m->rd >= m->len)
+        {
+            break;
+        }
+
+        char c = m->buf[m->rd];
+        switch (c)
+        {
+            case '\0':
+            {
+                m->len = m->rd; /* nul terminator ends the document */
+            }
+            break;
+            case '\"':
+            case '\'':
+            {
+                if (m->validate && (m->root_done || m->depth == 0))
+                {
+                    status = m->root_done ? JTOK_PARSE_STATUS_INVALID_END
+                                          : JTOK_PARSE_STATUS_NON_OBJECT;
+                }
+                else
+                {
+                    status = jtok_minify_string(m);
+                }
+            }
+            break;
+            default:
+            {
+                if (isspace((int)c))
+                {
+                    /* The same whitespace jtok_parse skips, \v and \f too */
+                    m->rd++;
+                    break;
+                }
+                if (m->validate)
+                {
+                    if (iscntrl((int)c))
+                    {
+                        status = JTOK_PARSE_STATUS_INVAL;
+                        break;
+                    }
+                    status = jtok_minify_structure(m, c);
+                }
+                if (status == JTOK_PARSE_STATUS_OK)
+                {
+                    jtok_minify_keep(m);
+                }
+            }
+            break;
+        }
+    }
+
+    if (status == JTOK_PARSE_STATUS_OK && m->validate && !m->root_done)
+    {
+        status = (m->wr == 0) ? JTOK_PARSE_STATUS_NON_OBJECT
+                              : JTOK_PARSE_STATUS_PARTIAL_TOKEN;
+    }
+    return status;
+}
+
+
+size_t jtok_minify(char *buf, size_t len)
+{
+    jtok_minifier_t m;
+    if (buf == NULL)
+    {
+        return 0;
+    }
+    memset(&m, 0, sizeof(m));
+    m.buf = buf;
+    m.len = len;
+    jtok_minify_run(&m);
+    if (m.wr < len)
+    {
+        buf[m.wr] = '\0';
+    }
+    return m.wr;
+}
+
+
+JTOK_PARSE_STATUS_t jtok_minify_validate(char *buf, size_t *len)
+{
+    jtok_minifier_t     m;
+    JTOK_PARSE_STATUS_t status;
+    if (buf == NULL || len == NULL)
+    {
+        return JTOK_PARSE_STATUS_NULL_PARAM;
+    }
+    memset(&m, 0, sizeof(m));
+    m.buf      = buf;
+    m.len      = *len;
+    m.validate = true;
+    status     = jtok_minify_run(&m);
+    if (status == JTOK_PARSE_STATUS_OK)
+    {
+        if (m.wr < *len)
+        {
+            buf[m.wr] = '\0';
+        }
+        *len = m.wr;
+    }
+    return status;
+}
@@ -13,6 +13,7 @@
 #include <limits.h>
 
 #include "jtok_object.h"
+#include "jtok_compare.h"
 #include "jtok_array.h"
 #include "jtok_primitive.h"
 #include "jtok_string.h"
@@ -23,9 +24,9 @@ JTOK_PARSE_STATUS_t jtok_parse_object(jtok_parser_t *parser, int depth)
 {
     JTOK_PARSE_STATUS_t status = JTOK_PARSE_STATUS_OK;
 
-    int         start  = parser->pos;
+    jtok_off_t  start  = parser->pos;
     const char *json   = parser->json;
-    int         len    = parser->json_len;
+    jtok_off_t  len    = parser->json_len;
     jtok_tkn_t *tokens = parser->tkn_pool;
 
     if (depth > JTOK_MAX_RECURSE_DEPTH)
@@ -74,7 +75,7 @@ JTOK_PARSE_STATUS_t jtok_parse_object(jtok_parser_t *parser, int depth)
      * stack frame because parsing a sub-object changes the value of
      * parser->toksuper
      */
-    int object_token_index = parser->toksuper;
+    jtok_off_t object_token_index = parser->toksuper;
 
     /* end of token will be populated when we find the closing brace */
     jtok_fill_token(token, JTOK_OBJECT, parser->pos, JTOK_INVALID_ARRAY_INDEX);
@@ -108,7 +109,7 @@ JTOK_PARSE_STATUS_t jtok_parse_object(jtok_parser_t *parser, int depth)
                     case OBJECT_VALUE: /* Enter and parse the sub-object */
                     {
                         /* Index of the key that owns this object */
-                        int key_idx = parser->toksuper;
+                        jtok_off_t key_idx = parser->toksuper;
 
 
                         status = jtok_parse_object(parser, depth + 1);
@@ -150,8 +151,8 @@ JTOK_PARSE_STATUS_t jtok_parse_object(jtok_parser_t *parser, int depth)
                     case OBJECT_VALUE:
                     {
                         /* Index of key that "owns" the array */
-                        int key_idx = parser->toksuper;
-                        status      = jtok_parse_array(parser, depth + 1);
+                        jtok_off_t key_idx = parser->toksuper;
+                        status = jtok_parse_array(parser, depth + 1);
 
                         if (status == JTOK_PARSE_STATUS_OK)
                         {
@@ -492,123 +493,11 @@ JTOK_PARSE_STATUS_t jtok_parse_object(jtok_parser_t *parser, int depth)
 
 bool jtok_toktokcmp_object(const jtok_tkn_t *obj1, const jtok_tkn_t *obj2)
 {
-    const jtok_tkn_t *const pool1 = obj1->pool;
-    assert(pool1 != NULL);
-    assert(pool1->type == JTOK_OBJECT);
-    assert(pool1->json == obj1->json);
-    if (pool1 != obj1)
-    {
-        /* Greater than 1 because if it's non-empty, it must AT LEAST
-         * have a key inside it as well as the value for that key */
-        assert(pool1->size > 1);
-    }
-
-    const jtok_tkn_t *const pool2 = obj2->pool;
-    assert(pool2 != NULL);
-    assert(pool2->type == JTOK_OBJECT);
-    assert(pool2->json == obj2->json);
-    if (pool2 != obj2)
-    {
-        /* Greater than 1 because if it's non-empty, it must AT LEAST
-         * have a key inside it as well as the value for that key */
-        assert(pool2->size > 1);
-    }
-
-
-    bool is_equal = true;
+    jtok_off_t scratch[JTOK_TOKCMP_SCRATCH_SIZE];
     if (obj1->type != JTOK_OBJECT || obj2->type != JTOK_OBJECT)
     {
-        is_equal = false;
-    }
-    else
-    {
-        /* Easy preliminary check */
-        if (obj1->size != obj2->size)
-        {
-            is_equal = false;
-        }
-        else if (obj1->size > 0)
-        {
-            /*
-             * 2 empty objects are trivally equal
-             * so only perform child comparison if the objects actaully
-             * have children
-             */
-            int i;
-            int j;
-
-            /* When object not empty, its first child is token after object */
-            jtok_tkn_t *child1 = (jtok_tkn_t *)&obj1[1];
-            assert(child1->type == JTOK_STRING);
-            for (i = 0; i < obj1->size && is_equal; i++)
-            {
-                jtok_tkn_t *child2 = (jtok_tkn_t *)&obj2[1];
-                assert(child2->type == JTOK_STRING);
-
-                /* Try to find matching key in second object */
-                for (j = 0; j < obj2->size && is_equal; j++)
-                {
-                    if (jtok_toktokcmp(child1, child2))
-                    {
-                        /* If key matches, compare values */
-                        jtok_tkn_t *val1 = &child1[1];
-                        jtok_tkn_t *val2 = &child2[1];
-                        if (jtok_toktokcmp(val1, val2))
-                        {
-                            /* value of key in obj1 matches value of key in obj2
-                             * exit search loop for key in obj2 */
-                            break;
-                        }
-                        else
-                        {
-                            /*
-                             * Since there cannot be duplicate keys
-                             * in a json object, if we find the key in obj2
-                             * but it's value isn't equal to the value of the
-                             * SAME key in obj1, then the objects cannot be
-                             * equal.
-                             */
-                            is_equal = false;
-                        }
-                    }
-                    else
-                    {
-                        /* Curerent key in obj2 doesnt match current key in
-                         * obj1, but the objects may have keys ordered
-                         * differently. So we check if we can explore other
-                         * child keys and if yes, we repeat the process until
-                         * all of obj2's child keys are exhausted */
-
-                        if (child2->sibling == JTOK_NO_SIBLING_IDX)
-                        {
-                            /* We've ran out of children in obj2 to check
-                             * against current key in obj1 */
-                            is_equal = false;
-                            break;
-                        }
-                        else
-                        {
-                            /* Go to next key */
-                            child2 = (jtok_tkn_t *)&pool2[child2->sibling];
-                        }
-                    }
-                } /* END J LOOP */
-
-                if (j == obj2->size)
-                {
-                    /* Did not find key in obj2 matching current key in obj1
-                     */
-                    is_equal = false;
-                }
-                else
-                {
-                    /* We matched current key in obj1,  */
-                    /* so go to next key to match.      */
-                    child1 = (jtok_tkn_t *)&pool1[child1->sibling];
-                }
-
-            } /* END I LOOP */
-        }
+        return false;
     }
-    return is_equal;
-}
\ No newline at end of file
+    return jtok_deepcmp(obj1, obj2, scratch,
+                        sizeof(scratch) / sizeof(*scratch));
+}
@@ -0,0 +1,461 @@
+/**
+ * @file jtok_overlay.c
+ * @author Carl Mattatall (cmattatall2@gmail.com)
+ * @brief Source module to record edits against a parsed document and emit
+ * the edited document without touching the original text or token pool
+ * @version 0.1
+ * @date 2021-05-05
+ *
+ * @copyright Copyright (c) 2021 Carl Mattatall
+ *
+ */
+
+#include <string.h>
+
+#include "jtok.h"
+#include "jtok_overlay.h"
+#include "jtok_shared.h"
+#include "jtok_string.h"
+#include "jtok_writer.h"
+
+typedef struct
+{
+    const jtok_overlay_t *overlay;
+    jtok_write_fn         write;
+    void *                ctx;
+    JTOK_WRITE_STATUS_t   status;
+} jtok_overlay_out_t;
+
+
+static JTOK_WRITE_STATUS_t jtok_overlay_add(jtok_overlay_t *overlay,
+                                            const jtok_edit_t *edit)
+{
+    if (overlay == NULL || overlay->root == NULL || edit == NULL ||
+        edit->target == NULL)
+    {
+        return JTOK_WRITE_STATUS_NULL_PARAM;
+    }
+    if (edit->target->json != overlay->root->json)
+    {
+        /* Target belongs to a different document */
+        return JTOK_WRITE_STATUS_INVAL;
+    }
+    if (overlay->count >= overlay->max)
+    {
+        return JTOK_WRITE_STATUS_NOMEM;
+    }
+    overlay->edits[overlay->count++] = *edit;
+    return JTOK_WRITE_STATUS_OK;
+}
+
+
+/**
+ * @brief Find the most recent edit of type op that targets tkn
+ */
+static const jtok_edit_t *jtok_overlay_find(const jtok_overlay_t *overlay,
+                                            const jtok_tkn_t *tkn, JTOK_EDIT_t op)
+{
+    size_t i = overlay->count;
+    while (i-- > 0)
+    {
+        if (overlay->edits[i].target == tkn && overlay->edits[i].op == op)
+        {
+            return &overlay->edits[i];
+        }
+    }
+    return NULL;
+}
+
+
+/**
+ * @brief Check if any edit lands inside (or on, for inserts) a container
+ */
+static bool jtok_overlay_touches(const jtok_overlay_t *overlay,
+                                 const jtok_tkn_t *tkn)
+{
+    size_t i;
+    for (i = 0; i < overlay->count; i++)
+    {
+        const jtok_edit_t *edit = &overlay->edits[i];
+        if (edit->target == tkn)
+        {
+            if (edit->op == JTOK_EDIT_INSERT || edit->op == JTOK_EDIT_APPEND)
+            {
+                return true;
+            }
+        }
+        else if (edit->target->json == tkn->json &&
+                 edit->target->start >= tkn->start &&
+                 edit->target->end <= tkn->end)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+
+static bool jtok_overlay_emit(jtok_overlay_out_t *out, const char *data,
+                              size_t len)
+{
+    if (out->status == JTOK_WRITE_STATUS_OK && len > 0)
+    {
+        if (0 != out->write(out->ctx, data, len))
+        {
+            out->status = JTOK_WRITE_STATUS_SINK_ERROR;
+        }
+    }
+    return out->status == JTOK_WRITE_STATUS_OK;
+}
+
+
+static bool jtok_overlay_emit_span(jtok_overlay_out_t *out,
+                                   const jtok_tkn_t *tkn)
+{
+    size_t      len;
+    const char *span = jtok_tokspan(tkn, &len);
+    if (span == NULL)
+    {
+        out->status = JTOK_WRITE_STATUS_INVAL;
+    }
+    return jtok_overlay_emit(out, span, len);
+}
+
+
+static void jtok_overlay_value(jtok_overlay_out_t *out, const jtok_tkn_t *tkn,
+                               int depth);
+
+
+/* Emit the source text between two positions of the document */
+static bool jtok_overlay_emit_gap(jtok_overlay_out_t *out, const char *from,
+                                  const char *to)
+{
+    return jtok_overlay_emit(out, from, (size_t)(to - from));
+}
+
+
+/* Emit an inserted key, quoted and escaped by the writer */
+static void jtok_overlay_emit_key(jtok_overlay_out_t *out,
+                                  const jtok_edit_t * edit)
+{
+    char          buf[64];
+    jtok_writer_t writer;
+    if (out->status != JTOK_WRITE_STATUS_OK)
+    {
+        return;
+    }
+    jtok_writer_init(&writer, buf, sizeof(buf), out->write, out->ctx);
+    jtok_writer_string(&writer, edit->key, edit->key_len);
+    out->status = jtok_writer_flush(&writer);
+}
+
+
+/**
+ * @brief Re-emit a container that holds an edit. The text around every
+ * surviving item (whitespace, commas, colons) is copied from the source so
+ * the layout is kept; added items copy the spacing of the existing ones.
+ */
+static void jtok_overlay_container(jtok_overlay_out_t *out,
+                                   const jtok_tkn_t *tkn, int depth)
+{
+    const jtok_overlay_t *overlay   = out->overlay;
+    bool                  is_object = (tkn->type == JTOK_OBJECT);
+    bool                  first     = true;
+    const jtok_tkn_t *    child     = (tkn->size > 0) ? tkn + 1 : NULL;
+    const char *          prev      = &tkn->json[tkn->start + 1];
+    const char *          lead      = prev; /* spacing before the first item */
+    const char *          lead_end  = prev;
+    const char *          sep       = NULL; /* text between two items */
+    const char *          sep_end   = NULL;
+    const char *          colon     = ":";
+    size_t                colon_len = 1;
+    const char *          span;
+    const char *          value;
+    size_t                len;
+    int                   i;
+    size_t                e;
+
+    if (depth > JTOK_MAX_RECURSE_DEPTH)
+    {
+        out->status = JTOK_WRITE_STATUS_NEST_DEPTH_EXCEEDED;
+        return;
+    }
+
+    jtok_overlay_emit(out, is_object ? "{" : "[", 1);
+    for (i = 0; i < tkn->size && child != NULL; i++)
+    {
+        const jtok_tkn_t *item = is_object ? child + 1 : child;
+        span                   = jtok_tokspan(child, &len);
+        value                  = jtok_tokspan(item, &len);
+        if (span == NULL || value == NULL)
+        {
+            out->status = JTOK_WRITE_STATUS_INVAL;
+            return;
+        }
+        if (i == 0)
+        {
+            lead_end = span;
+        }
+        else if (i == 1)
+        {
+            sep     = prev;
+            sep_end = span;
+        }
+        if (is_object)
+        {
+            /* Separator between the key and its value, e.g. ": " */
+            colon     = span + (child->end - child->start) + 2;
+            colon_len = (size_t)(value - colon);
+        }
+
+        if (jtok_overlay_find(overlay, child, JTOK_EDIT_DELETE) == NULL)
+        {
+            /* The source gap before an item that follows another one holds
+             * the comma. The first survivor takes the opening spacing. */
+            if (first)
+            {
+                jtok_overlay_emit_gap(out, lead, lead_end);
+            }
+            else
+            {
+                jtok_overlay_emit_gap(out, prev, span);
+            }
+            first = false;
+            if (is_object)
+            {
+                jtok_overlay_emit_gap(out, span, value);
+            }
+            jtok_overlay_value(out, item, depth + 1);
+        }
+        prev  = value + len;
+        child = jtok_get_next_sibling(child);
+    }
+
+    /* New members and elements go after the surviving original ones */
+    for (e = 0; e < overlay->count; e++)
+    {
+        const jtok_edit_t *edit = &overlay->edits[e];
+        if (edit->target == tkn &&
+            (edit->op == JTOK_EDIT_INSERT || edit->op == JTOK_EDIT_APPEND))
+        {
+            if (first)
+            {
+                jtok_overlay_emit_gap(out, lead, lead_end);
+            }
+            else if (sep != NULL)
+            {
+                jtok_overlay_emit_gap(out, sep, sep_end);
+            }
+            else
+            {
+                jtok_overlay_emit(out, ",", 1);
+                jtok_overlay_emit_gap(out, lead, lead_end);
+            }
+            first = false;
+            if (edit->op == JTOK_EDIT_INSERT)
+            {
+                jtok_overlay_emit_key(out, edit);
+                jtok_overlay_emit(out, colon, colon_len);
+            }
+            jtok_overlay_emit(out, edit->value, edit->value_len);
+        }
+    }
+
+    /* Spacing before the closing bracket */
+    jtok_overlay_emit_gap(out, prev, &tkn->json[tkn->end - 1]);
+    jtok_overlay_emit(out, is_object ? "}" : "]", 1);
+}
+
+
+static void jtok_overlay_value(jtok_overlay_out_t *out, const jtok_tkn_t *tkn,
+                               int depth)
+{
+    const jtok_edit_t *set = jtok_overlay_find(out->overlay, tkn, JTOK_EDIT_SET);
+    if (set != NULL)
+    {
+        jtok_overlay_emit(out, set->value, set->value_len);
+    }
+    else if ((tkn->type == JTOK_OBJECT || tkn->type == JTOK_ARRAY) &&
+             jtok_overlay_touches(out->overlay, tkn))
+    {
+        jtok_overlay_container(out, tkn, depth);
+    }
+    else
+    {
+        /* Untouched subtree: one copy of the original text */
+        jtok_overlay_emit_span(out, tkn);
+    }
+}
+
+
+/* Compare a key token (escapes resolved) with unescaped key bytes */
+static bool jtok_overlay_keyeq(const jtok_tkn_t *tkn, const char *key,
+                               size_t len)
+{
+    const char *pos = &tkn->json[tkn->start];
+    const char *end = &tkn->json[tkn->end];
+    char        utf8[JTOK_STRING_UTF8_MAX];
+    size_t      at = 0;
+    long        cp;
+    int         n;
+
+    while ((cp = jtok_string_next_cp(&pos, end)) >= 0)
+    {
+        n = jtok_string_put_utf8(cp, utf8);
+        if (at + (size_t)n > len || 0 != memcmp(&key[at], utf8, (size_t)n))
+        {
+            return false;
+        }
+        at += (size_t)n;
+    }
+    return cp == JTOK_STRING_END && at == len;
+}
+
+
+/**
+ * @brief Find the value of a member of object that has not been deleted
+ */
+static const jtok_tkn_t *jtok_overlay_member(const jtok_overlay_t *overlay,
+                                             const jtok_tkn_t *    object,
+                                             const char *key, size_t len)
+{
+    const jtok_tkn_t *child = (object->size > 0) ? object + 1 : NULL;
+    int               i;
+    for (i = 0; i < object->size && child != NULL; i++)
+    {
+        if (jtok_overlay_keyeq(child, key, len) &&
+            jtok_overlay_find(overlay, child, JTOK_EDIT_DELETE) == NULL)
+        {
+            return child + 1;
+        }
+        child = jtok_get_next_sibling(child);
+    }
+    return NULL;
+}
+
+
+void jtok_overlay_init(jtok_overlay_t *overlay, const jtok_tkn_t *root,
+                       jtok_edit_t *edits, size_t max)
+{
+    overlay->root  = root;
+    overlay->edits = edits;
+    overlay->max   = (edits != NULL) ? max : 0;
+    overlay->count = 0;
+}
+
+
+JTOK_WRITE_STATUS_t jtok_overlay_set(jtok_overlay_t *overlay,
+                                     const jtok_tkn_t *value, const char *json,
+                                     size_t len)
+{
+    jtok_edit_t edit = {.op = JTOK_EDIT_SET, .target = value};
+    if (json == NULL)
+    {
+        return JTOK_WRITE_STATUS_NULL_PARAM;
+    }
+    if (value != NULL && jtok_tokenIsKey(*value))
+    {
+        /* Keys are not values. Delete and insert to rename a member */
+        return JTOK_WRITE_STATUS_INVAL;
+    }
+    edit.value     = json;
+    edit.value_len = len;
+    return jtok_overlay_add(overlay, &edit);
+}
+
+
+JTOK_WRITE_STATUS_t jtok_overlay_delete(jtok_overlay_t *overlay,
+                                        const jtok_tkn_t *tkn)
+{
+    jtok_edit_t edit = {.op = JTOK_EDIT_DELETE, .target = tkn};
+    if (tkn != NULL && !jtok_tokenIsKey(*tkn) &&
+        (tkn->parent == JTOK_NO_PARENT_IDX ||
+         tkn->pool[tkn->parent].type != JTOK_ARRAY))
+    {
+        /* Only members (by key) and array elements can be removed */
+        return JTOK_WRITE_STATUS_INVAL;
+    }
+    return jtok_overlay_add(overlay, &edit);
+}
+
+
+JTOK_WRITE_STATUS_t jtok_overlay_insert(jtok_overlay_t *overlay,
+                                        const jtok_tkn_t *object,
+                                        const char *key, size_t key_len,
+                                        const char *json, size_t len)
+{
+    jtok_edit_t       edit = {.op = JTOK_EDIT_INSERT, .target = object};
+    const jtok_tkn_t *existing;
+    size_t            i;
+    if (key == NULL || json == NULL)
+    {
+        return JTOK_WRITE_STATUS_NULL_PARAM;
+    }
+    if (object != NULL && object->type != JTOK_OBJECT)
+    {
+        return JTOK_WRITE_STATUS_INVAL;
+    }
+    edit.key       = key;
+    edit.key_len   = key_len;
+    edit.value     = json;
+    edit.value_len = len;
+    if (overlay != NULL && object != NULL)
+    {
+        /* An existing key has its value replaced instead of being added a
+         * second time */
+        if ((existing = jtok_overlay_member(overlay, object, key, key_len)) !=
+            NULL)
+        {
+            return jtok_overlay_set(overlay, existing, json, len);
+        }
+        for (i = 0; i < overlay->count; i++)
+        {
+            jtok_edit_t *prior = &overlay->edits[i];
+            if (prior->target == object && prior->op == JTOK_EDIT_INSERT &&
+                prior->key_len == key_len &&
+                0 == memcmp(prior->key, key, key_len))
+            {
+                prior->value     = json;
+                prior->value_len = len;
+                return JTOK_WRITE_STATUS_OK;
+            }
+        }
+    }
+    return jtok_overlay_add(overlay, &edit);
+}
+
+
+JTOK_WRITE_STATUS_t jtok_overlay_append(jtok_overlay_t *overlay,
+                                        const jtok_tkn_t *array,
+                                        const char *json, size_t len)
+{
+    jtok_edit_t edit = {.op = JTOK_EDIT_APPEND, .target = array};
+    if (json == NULL)
+    {
+        return JTOK_WRITE_STATUS_NULL_PARAM;
+    }
+    if (array != NULL && array->type != JTOK_ARRAY)
+    {
+        return JTOK_WRITE_STATUS_INVAL;
+    }
+    edit.value     = json;
+    edit.value_len = len;
+    return jtok_overlay_add(overlay, &edit);
+}
+
+
+JTOK_WRITE_STATUS_t jtok_overlay_serialize(const jtok_overlay_t *overlay,
+                                           jtok_write_fn write, void *ctx)
+{
+    jtok_overlay_out_t out;
+    if (overlay == NULL || overlay->root == NULL || write == NULL)
+    {
+        return JTOK_WRITE_STATUS_NULL_PARAM;
+    }
+    out.overlay = overlay;
+    out.write   = write;
+    out.ctx     = ctx;
+    out.status  = JTOK_WRITE_STATUS_OK;
+    jtok_overlay_value(&out, overlay->root, 0);
+    return out.status;
+}
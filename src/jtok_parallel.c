@@ -0,0 +1,565 @@
+/**
+ * @file jtok_parallel.c
+ * @author Carl Mattatall (cmattatall2@gmail.com)
+ * @brief Source module to parse a single large json document on several
+ * threads
+ * @version 0.1
+ * @date 2021-05-10
+ *
+ * @copyright Copyright (c) 2021 Carl Mattatall
+ *
+ */
+
+#include <limits.h>
+#include <stdbool.h>
+#include <string.h>
+
+#if defined(JTOK_HAVE_THREADS)
+#include <pthread.h>
+#endif /* #if defined(JTOK_HAVE_THREADS) */
+
+#include "jtok.h"
+#include "jtok_parallel.h"
+#include "jtok_array.h"
+#include "jtok_shared.h"
+#include "jtok_stitch.h"
+
+#if defined(JTOK_HAVE_THREADS)
+
+/* Arrays are split only at this depth: the root object is 0 and its
+ * members 1 */
+#define JTOK_PARALLEL_DEPTH 1
+
+/* Commas recorded per scan, one for each depth the chunk can start at */
+#define JTOK_PARALLEL_DEPTHS (JTOK_MAX_RECURSE_DEPTH + 2)
+
+/* Lexical state of a scan, which is also the index of the scan that
+ * starts in it */
+enum
+{
+    JTOK_PARALLEL_OUT, /* outside any string */
+    JTOK_PARALLEL_DQ,  /* inside a "string" */
+    JTOK_PARALLEL_SQ,  /* inside a 'string' */
+    JTOK_PARALLEL_TRACKS
+};
+
+/* Result of scanning a chunk from one assumed starting state */
+typedef struct
+{
+    unsigned char state;   /* state at the end of the chunk */
+    int           depth;   /* nesting depth at the end, relative to the start */
+    jtok_off_t    escaped; /* offset of the character after a backslash */
+
+    /* comma[n]: offset of the first comma 1 - n levels deeper than the
+     * chunk start, or -1. A chunk starting at depth d finds commas at depth
+     * JTOK_PARALLEL_DEPTH + 1 in comma[d - 1]. */
+    jtok_off_t comma[JTOK_PARALLEL_DEPTHS];
+} jtok_parallel_track_t;
+
+typedef struct
+{
+    const char *          json;
+    jtok_off_t            begin;
+    jtok_off_t            end;
+    jtok_parallel_track_t tracks[JTOK_PARALLEL_TRACKS];
+    pthread_t             thread;
+    bool                  started;
+} jtok_parallel_chunk_t;
+
+/* The elements between two split commas, parsed by a helper thread */
+typedef struct
+{
+    const char *        json;
+    jtok_off_t          from; /* comma before the first element */
+    jtok_off_t          to;   /* comma after the last element */
+    jtok_tkn_t *        pool;
+    size_t              pool_size;
+    JTOK_PARSE_STATUS_t status;
+    jtok_off_t          count; /* tokens used, counting the array token */
+    jtok_off_t          last;  /* index of the last element */
+    jtok_off_t          size;  /* number of elements */
+
+    /* Where the segment goes in the result, once that is decided */
+    jtok_tkn_t *tokens;
+    jtok_off_t  array_idx; /* index of the array */
+    jtok_off_t  base;      /* segment token j becomes base + j, or -1 */
+    jtok_off_t  next;      /* index of the element after the last one */
+
+    struct jtok_parallel *par;
+    pthread_t             thread;
+    bool                  started;
+} jtok_parallel_segment_t;
+
+typedef struct jtok_parallel
+{
+    jtok_stitch_t           stitch; /* must be first */
+    jtok_parallel_segment_t segments[JTOK_PARSE_MT_MAX_THREADS];
+    size_t                  count;
+    size_t                  parsed;  /* segments parsed by helper threads */
+    bool                    decided; /* segment places are final */
+    pthread_mutex_t         lock;
+    pthread_cond_t          changed;
+} jtok_parallel_t;
+
+/* The only characters that change the state or depth of a scan */
+static const bool jtok_parallel_special[UCHAR_MAX + 1] = {
+    ['\"'] = true, ['\''] = true, ['\\'] = true, ['{'] = true,
+    ['}']  = true, ['[']  = true, [']']  = true, [',']  = true,
+};
+
+
+static void jtok_parallel_step(jtok_parallel_track_t *track, char c,
+                               jtok_off_t pos)
+{
+    int n;
+    switch (track->state)
+    {
+        case JTOK_PARALLEL_OUT:
+        {
+            switch (c)
+            {
+                case '\"':
+                {
+                    track->state = JTOK_PARALLEL_DQ;
+                }
+                break;
+                case '\'':
+                {
+                    track->state = JTOK_PARALLEL_SQ;
+                }
+                break;
+                case '{':
+                case '[':
+                {
+                    track->depth++;
+                }
+                break;
+                case '}':
+                case ']':
+                {
+                    track->depth--;
+                }
+                break;
+                case ',':
+                {
+                    n = 1 - track->depth;
+                    if (n >= 0 && n < JTOK_PARALLEL_DEPTHS &&
+                        track->comma[n] < 0)
+                    {
+                        track->comma[n] = pos;
+                    }
+                }
+                break;
+            }
+        }
+        break;
+        case JTOK_PARALLEL_DQ:
+        case JTOK_PARALLEL_SQ:
+        {
+            if (pos == track->escaped)
+            {
+                break;
+            }
+            if (c == '\\')
+            {
+                track->escaped = pos + 1;
+            }
+            else if ((c == '\"' && track->state == JTOK_PARALLEL_DQ) ||
+                     (c == '\'' && track->state == JTOK_PARALLEL_SQ))
+            {
+                track->state = JTOK_PARALLEL_OUT;
+            }
+        }
+        break;
+    }
+}
+
+
+static void jtok_parallel_scan(jtok_parallel_chunk_t *chunk)
+{
+    jtok_parallel_track_t *tracks = chunk->tracks;
+    const char *           json   = chunk->json;
+    jtok_off_t             pos;
+    int                    t;
+    int                    n;
+
+    for (t = 0; t < JTOK_PARALLEL_TRACKS; t++)
+    {
+        tracks[t].state   = (unsigned char)t;
+        tracks[t].depth   = 0;
+        tracks[t].escaped = -1;
+        for (n = 0; n < JTOK_PARALLEL_DEPTHS; n++)
+        {
+            tracks[t].comma[n] = -1;
+        }
+    }
+
+    /* Most bytes matter to none of the scans */
+    for (pos = chunk->begin; pos < chunk->end; pos++)
+    {
+        if (jtok_parallel_special[(unsigned char)json[pos]])
+        {
+            for (t = 0; t < JTOK_PARALLEL_TRACKS; t++)
+            {
+                jtok_parallel_step(&tracks[t], json[pos], pos);
+            }
+        }
+    }
+}
+
+
+static void jtok_parallel_segment(jtok_parallel_segment_t *segment)
+{
+    jtok_parser_t parser;
+    jtok_tkn_t *  array;
+
+    /* Parse the elements into a stand-in array token at index 0. The text
+     * ends with the comma after the last element. */
+    parser = jtok_new_parser(segment->json, (size_t)segment->to + 1,
+                             segment->pool, segment->pool_size);
+    array  = jtok_alloc_token(&parser);
+    if (array == NULL)
+    {
+        segment->status = JTOK_PARSE_STATUS_NOMEM;
+        return;
+    }
+    jtok_fill_token(array, JTOK_ARRAY, segment->from, JTOK_INVALID_ARRAY_INDEX);
+    parser.pos        = segment->from + 1;
+    parser.toksuper   = 0;
+    parser.last_child = JTOK_NO_CHILD_IDX;
+
+    segment->status = jtok_parse_array_elements(&parser, JTOK_PARALLEL_DEPTH,
+                                                0, true);
+    segment->count  = parser.toknext;
+    segment->last   = parser.last_child;
+    segment->size   = array->size;
+}
+
+
+/* Copy a parsed segment into the result, rebasing its indices */
+static void jtok_parallel_rebase(jtok_parallel_segment_t *segment)
+{
+    jtok_tkn_t *tokens = segment->tokens;
+    jtok_tkn_t *tkn;
+    jtok_off_t  base = segment->base;
+    jtok_off_t  j;
+
+    /* Segment token j becomes token base + j */
+    for (j = 1; j < segment->count; j++)
+    {
+        tkn       = &tokens[base + j];
+        *tkn      = segment->pool[j];
+        tkn->pool = tokens;
+        if (tkn->parent == 0)
+        {
+            tkn->parent = segment->array_idx;
+        }
+        else
+        {
+            tkn->parent += base;
+        }
+        if (tkn->sibling != JTOK_NO_SIBLING_IDX)
+        {
+            tkn->sibling += base;
+        }
+    }
+    tokens[base + segment->last].sibling = segment->next;
+}
+
+
+static void *jtok_parallel_scan_thread(void *arg)
+{
+    jtok_parallel_scan((jtok_parallel_chunk_t *)arg);
+    return NULL;
+}
+
+
+static void *jtok_parallel_segment_thread(void *arg)
+{
+    jtok_parallel_segment_t *segment = (jtok_parallel_segment_t *)arg;
+    jtok_parallel_t *        par     = segment->par;
+
+    jtok_parallel_segment(segment);
+
+    /* Wait to hear where (and whether) the segment goes in the result */
+    pthread_mutex_lock(&par->lock);
+    par->parsed++;
+    pthread_cond_broadcast(&par->changed);
+    while (!par->decided)
+    {
+        pthread_cond_wait(&par->changed, &par->lock);
+    }
+    pthread_mutex_unlock(&par->lock);
+
+    if (segment->base != JTOK_INVALID_ARRAY_INDEX)
+    {
+        jtok_parallel_rebase(segment);
+    }
+    return NULL;
+}
+
+
+/* Release the helpers, which then copy the segments that were given a
+ * place in the result, and wait for them */
+static void jtok_parallel_finish(jtok_parallel_t *par)
+{
+    size_t i;
+    if (par->decided)
+    {
+        return;
+    }
+
+    pthread_mutex_lock(&par->lock);
+    par->decided = true;
+    pthread_cond_broadcast(&par->changed);
+    pthread_mutex_unlock(&par->lock);
+
+    for (i = 0; i < par->count; i++)
+    {
+        if (par->segments[i].started)
+        {
+            pthread_join(par->segments[i].thread, NULL);
+        }
+        else if (par->segments[i].base != JTOK_INVALID_ARRAY_INDEX)
+        {
+            jtok_parallel_rebase(&par->segments[i]);
+        }
+    }
+}
+
+
+static JTOK_PARSE_STATUS_t jtok_parallel_splice(jtok_stitch_t *stitch,
+                                                jtok_parser_t *parser,
+                                                int        depth,
+                                                jtok_off_t array_idx,
+                                                JTOK_TYPE_t element_type)
+{
+    jtok_parallel_t *        par    = (jtok_parallel_t *)stitch;
+    jtok_tkn_t *             tokens = parser->tkn_pool;
+    jtok_parallel_segment_t *segment;
+    JTOK_TYPE_t              type;
+    size_t                   started = 0;
+    size_t                   i;
+    jtok_off_t               base;
+
+    stitch->from = JTOK_INVALID_ARRAY_INDEX;
+
+    /* Parse the segments no thread could be started for, then wait for the
+     * others */
+    for (i = 0; i < par->count; i++)
+    {
+        if (par->segments[i].started)
+        {
+            started++;
+        }
+        else
+        {
+            jtok_parallel_segment(&par->segments[i]);
+        }
+    }
+    pthread_mutex_lock(&par->lock);
+    while (par->parsed < started)
+    {
+        pthread_cond_wait(&par->changed, &par->lock);
+    }
+    pthread_mutex_unlock(&par->lock);
+
+    for (i = 0; i < par->count && depth == JTOK_PARALLEL_DEPTH; i++)
+    {
+        segment = &par->segments[i];
+        if (segment->status != JTOK_PARSE_STATUS_OK || segment->count < 2 ||
+            (size_t)parser->toknext + (size_t)segment->count - 1 >
+                (size_t)parser->pool_size)
+        {
+            break;
+        }
+
+        /* The array parser checks later elements against the kind of the
+         * first one, so a segment only parsed the same way as the rest of
+         * the array if it starts with the same kind */
+        type = segment->pool[1].type;
+        if (type == JTOK_STRING)
+        {
+            type = JTOK_OBJECT;
+        }
+        if (type != element_type)
+        {
+            break;
+        }
+
+        base               = parser->toknext - 1;
+        segment->tokens    = tokens;
+        segment->array_idx = array_idx;
+        segment->base      = base;
+        segment->next      = JTOK_NO_SIBLING_IDX;
+
+        if (i == 0)
+        {
+            tokens[parser->last_child].sibling = base + 1;
+        }
+        else
+        {
+            par->segments[i - 1].next = base + 1;
+        }
+        parser->last_child = base + segment->last;
+        parser->toknext    = base + segment->count;
+        parser->pos        = segment->to;
+        tokens[array_idx].size += segment->size;
+    }
+
+    /* The tokens must all be in place before the parse goes on and links
+     * the next element to the last spliced one */
+    jtok_parallel_finish(par);
+    return JTOK_PARSE_STATUS_OK;
+}
+
+#endif /* #if defined(JTOK_HAVE_THREADS) */
+
+
+JTOK_PARSE_STATUS_t jtok_parse_mt(const char *json, size_t len,
+                                  jtok_tkn_t *tkns, size_t size,
+                                  const jtok_parse_mt_config_t *config)
+{
+#if defined(JTOK_HAVE_THREADS)
+    jtok_parallel_chunk_t chunks[JTOK_PARSE_MT_MAX_THREADS + 1];
+    jtok_parallel_t       par;
+    jtok_off_t            splits[JTOK_PARSE_MT_MAX_THREADS + 1];
+    size_t                split_count = 0;
+    size_t                chunk_count;
+    size_t                threads;
+    size_t                i;
+    unsigned char         state;
+    int                   depth;
+    jtok_off_t            comma;
+    JTOK_PARSE_STATUS_t   status;
+#endif /* #if defined(JTOK_HAVE_THREADS) */
+
+    if (config == NULL)
+    {
+        return JTOK_PARSE_STATUS_NULL_PARAM;
+    }
+    if (config->threads == 0 || config->threads > JTOK_PARSE_MT_MAX_THREADS)
+    {
+        return JTOK_PARSE_STATUS_INVAL;
+    }
+    if (config->threads > 1 &&
+        (config->pools == NULL || config->pool_size > (size_t)JTOK_OFF_MAX))
+    {
+        return JTOK_PARSE_STATUS_INVAL;
+    }
+
+#if defined(JTOK_HAVE_THREADS)
+    threads = config->threads;
+    if (threads > len / JTOK_PARSE_MT_MIN_CHUNK)
+    {
+        threads = len / JTOK_PARSE_MT_MIN_CHUNK;
+    }
+    if (threads < 2 || json == NULL || tkns == NULL || size < 1 ||
+        len > (size_t)JTOK_OFF_MAX || size > (size_t)JTOK_OFF_MAX)
+    {
+        return jtok_parsen(json, len, tkns, size);
+    }
+
+    /* threads + 1 chunks. The first and last are half as long because the
+     * calling thread parses both of them. */
+    chunk_count = threads + 1;
+    for (i = 0; i < chunk_count; i++)
+    {
+        chunks[i].json  = json;
+        chunks[i].begin = (i == 0) ? 0 : chunks[i - 1].end;
+        if (i + 1 == chunk_count)
+        {
+            chunks[i].end = (jtok_off_t)len;
+        }
+        else
+        {
+            chunks[i].end = (jtok_off_t)((2 * i + 1) * len / (2 * threads));
+
+            /* Never start a chunk right after a backslash, so no chunk
+             * starts in the middle of an escape sequence */
+            while (chunks[i].end < (jtok_off_t)len && chunks[i].end > 0 &&
+                   json[chunks[i].end - 1] == '\\')
+            {
+                chunks[i].end++;
+            }
+            if (chunks[i].end < chunks[i].begin)
+            {
+                chunks[i].end = chunks[i].begin;
+            }
+        }
+        chunks[i].started = false;
+    }
+
+    /* Phase 1: scan every chunk from every possible starting state */
+    for (i = 1; i + 1 < chunk_count; i++)
+    {
+        chunks[i].started = (0 == pthread_create(&chunks[i].thread, NULL,
+                                                 jtok_parallel_scan_thread,
+                                                 &chunks[i]));
+    }
+    for (i = 0; i < chunk_count; i++)
+    {
+        if (chunks[i].started)
+        {
+            pthread_join(chunks[i].thread, NULL);
+        }
+        else
+        {
+            jtok_parallel_scan(&chunks[i]);
+        }
+    }
+
+    /* Phase 2: work out the real state at each chunk start and pick the
+     * chunk's first comma at the split depth */
+    state = JTOK_PARALLEL_OUT;
+    depth = 0;
+    for (i = 0; i < chunk_count; i++)
+    {
+        if (i > 0 && depth >= 1 && depth - 1 < JTOK_PARALLEL_DEPTHS)
+        {
+            comma = chunks[i].tracks[state].comma[depth - 1];
+            if (comma >= 0)
+            {
+                splits[split_count++] = comma;
+            }
+        }
+        depth += chunks[i].tracks[state].depth;
+        state = chunks[i].tracks[state].state;
+    }
+
+    /* Phase 3: parse the elements between consecutive splits on helper
+     * threads while this thread parses the document up to the first one */
+    par.stitch.from   = (split_count >= 2) ? splits[0] : -1;
+    par.stitch.splice = jtok_parallel_splice;
+    par.count         = (split_count >= 2) ? split_count - 1 : 0;
+    par.parsed        = 0;
+    par.decided       = false;
+    pthread_mutex_init(&par.lock, NULL);
+    pthread_cond_init(&par.changed, NULL);
+    for (i = 0; i < par.count; i++)
+    {
+        par.segments[i].json      = json;
+        par.segments[i].from      = splits[i];
+        par.segments[i].to        = splits[i + 1];
+        par.segments[i].pool      = &config->pools[i * config->pool_size];
+        par.segments[i].pool_size = config->pool_size;
+        par.segments[i].status    = JTOK_PARSE_STATUS_UNKNOWN_ERROR;
+        par.segments[i].base      = JTOK_INVALID_ARRAY_INDEX;
+        par.segments[i].par       = &par;
+        par.segments[i].started =
+            (0 == pthread_create(&par.segments[i].thread, NULL,
+                                 jtok_parallel_segment_thread,
+                                 &par.segments[i]));
+    }
+
+    status = jtok_parse_stitched(json, len, tkns, size, &par.stitch);
+
+    /* The split may never have been reached */
+    jtok_parallel_finish(&par);
+    pthread_cond_destroy(&par.changed);
+    pthread_mutex_destroy(&par.lock);
+    return status;
+#else
+    return jtok_parsen(json, len, tkns, size);
+#endif /* #if defined(JTOK_HAVE_THREADS) */
+}
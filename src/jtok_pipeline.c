@@ -0,0 +1,899 @@
+/**
+ * @file jtok_pipeline.c
+ * @author Carl Mattatall (cmattatall2@gmail.com)
+ * @brief Source module for the reader / parser / consumer ingest pipeline
+ * @version 0.1
+ * @date 2021-05-12
+ *
+ * @copyright Copyright (c) 2021 Carl Mattatall
+ *
+ */
+
+#include <ctype.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "jtok.h"
+#include "jtok_pool.h"
+#include "jtok_pipeline.h"
+
+#if defined(JTOK_HAVE_THREADS) && defined(JTOK_HAVE_ATOMICS)
+#define JTOK_PIPE_THREADED
+#include <pthread.h>
+#include <sched.h>
+#endif /* #if defined(JTOK_HAVE_THREADS) && defined(JTOK_HAVE_ATOMICS) */
+
+/* Index of the item that tells a stage to finish */
+#define JTOK_PIPE_END SIZE_MAX
+
+/* Length of a JTOK_PIPE_LENGTH_PREFIX header */
+#define JTOK_PIPE_PREFIX_LEN 4
+
+#ifndef JTOK_PIPE_BATCH_DEFAULT
+#define JTOK_PIPE_BATCH_DEFAULT 16
+#endif /* #ifndef JTOK_PIPE_BATCH_DEFAULT */
+
+/*
+ * State of one jtok_pipe_run call. Everything above "done" belongs to the
+ * reader alone.
+ *
+ * The stream buffer is used as a circle, but every document must be in one
+ * piece. Bytes from fill onwards are free up to "lo", the start of the
+ * oldest document the consumer has not released yet (or scan if there is
+ * none). When fill reaches the end of the buffer, the unfinished document
+ * at scan is moved to the front if it fits below lo. Until every document
+ * framed before that move has been released ("wrapped"), new data may only
+ * go up to lo.
+ */
+typedef struct
+{
+    const jtok_pipe_config_t *config;
+    jtok_pipe_read_fn         read;
+    void *                    read_ctx;
+    jtok_pipe_fn              fn;
+    void *                    fn_ctx;
+    jtok_ring_t               in;
+    jtok_ring_t               out;
+    bool                      threaded;
+    size_t                    fill;         /* end of the data read */
+    size_t                    scan;         /* start of the next document */
+    size_t                    base;         /* stream offset of scan */
+    size_t                    skip;         /* bytes of a dropped document
+                                               still to be read */
+    bool                      discard_line; /* dropping a line that did not
+                                               fit */
+    bool                      wrapped;
+    size_t                    wrap_index; /* first document after the move */
+    size_t                    emitted;    /* documents framed */
+    size_t                    reclaimed;  /* documents released, in order */
+    size_t                    start[JTOK_PIPE_MAX_INFLIGHT];
+    bool                      done[JTOK_PIPE_MAX_INFLIGHT];
+    size_t                    delivered; /* consumer only */
+    bool                      stop;      /* fn asked to stop */
+#if defined(JTOK_PIPE_THREADED)
+    pthread_mutex_t           lock;     /* held to sleep on progress */
+    pthread_cond_t            progress;
+    size_t                    epoch;    /* bumped whenever a stage moves */
+    size_t                    sleepers; /* stages sleeping on progress */
+#endif /* #if defined(JTOK_PIPE_THREADED) */
+} jtok_pipe_t;
+
+/* A stage waiting for another one */
+typedef struct
+{
+    unsigned spins; /* times yielded so far */
+    size_t   seen;  /* epoch before the stage last looked */
+} jtok_pipe_wait_t;
+
+
+#if defined(JTOK_HAVE_ATOMICS)
+
+static size_t jtok_pipe_load(const size_t *value)
+{
+    return __atomic_load_n(value, __ATOMIC_ACQUIRE);
+}
+
+
+static size_t jtok_pipe_peek(const size_t *value)
+{
+    return __atomic_load_n(value, __ATOMIC_RELAXED);
+}
+
+
+static void jtok_pipe_store(size_t *value, size_t desired)
+{
+    __atomic_store_n(value, desired, __ATOMIC_RELEASE);
+}
+
+
+static bool jtok_pipe_claim(size_t *value, size_t *expected)
+{
+    return __atomic_compare_exchange_n(value, expected, *expected + 1, true,
+                                       __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+}
+
+
+static bool jtok_pipe_get_flag(const bool *flag)
+{
+    return __atomic_load_n(flag, __ATOMIC_ACQUIRE);
+}
+
+
+static void jtok_pipe_set_flag(bool *flag)
+{
+    __atomic_store_n(flag, true, __ATOMIC_RELEASE);
+}
+
+#else
+
+static size_t jtok_pipe_load(const size_t *value)
+{
+    return *value;
+}
+
+
+static size_t jtok_pipe_peek(const size_t *value)
+{
+    return *value;
+}
+
+
+static void jtok_pipe_store(size_t *value, size_t desired)
+{
+    *value = desired;
+}
+
+
+static bool jtok_pipe_claim(size_t *value, size_t *expected)
+{
+    *value = *expected + 1;
+    return true;
+}
+
+
+static bool jtok_pipe_get_flag(const bool *flag)
+{
+    return *flag;
+}
+
+
+static void jtok_pipe_set_flag(bool *flag)
+{
+    *flag = true;
+}
+
+#endif /* #if defined(JTOK_HAVE_ATOMICS) */
+
+
+JTOK_PARSE_STATUS_t jtok_ring_init(jtok_ring_t *ring, jtok_ring_cell_t *cells,
+                                   size_t count)
+{
+    size_t i;
+
+    if (ring == NULL || cells == NULL)
+    {
+        return JTOK_PARSE_STATUS_NULL_PARAM;
+    }
+    if (count < 2 || (count & (count - 1)) != 0)
+    {
+        return JTOK_PARSE_STATUS_INVAL;
+    }
+
+    for (i = 0; i < count; i++)
+    {
+        cells[i].seq = i;
+    }
+    ring->cells = cells;
+    ring->mask  = count - 1;
+    ring->head  = 0;
+    ring->tail  = 0;
+    return JTOK_PARSE_STATUS_OK;
+}
+
+
+/*
+ * A cell whose sequence number equals the push position is free to fill,
+ * and one whose sequence number is one past the pop position holds an item.
+ * Claiming the position with a compare-and-swap makes the cell ours, and
+ * publishing the next sequence number hands it to the other end.
+ */
+bool jtok_ring_push(jtok_ring_t *ring, const jtok_pipe_item_t *item)
+{
+    jtok_ring_cell_t *cell;
+    size_t            pos;
+    intptr_t          diff;
+
+    if (ring == NULL || item == NULL)
+    {
+        return false;
+    }
+
+    pos = jtok_pipe_peek(&ring->head);
+    for (;;)
+    {
+        cell = &ring->cells[pos & ring->mask];
+        diff = (intptr_t)jtok_pipe_load(&cell->seq) - (intptr_t)pos;
+        if (diff == 0)
+        {
+            if (jtok_pipe_claim(&ring->head, &pos))
+            {
+                break;
+            }
+        }
+        else if (diff < 0)
+        {
+            return false; /* a full lap behind: the ring is full */
+        }
+        else
+        {
+            pos = jtok_pipe_peek(&ring->head);
+        }
+    }
+
+    cell->item = *item;
+    jtok_pipe_store(&cell->seq, pos + 1);
+    return true;
+}
+
+
+bool jtok_ring_pop(jtok_ring_t *ring, jtok_pipe_item_t *item)
+{
+    jtok_ring_cell_t *cell;
+    size_t            pos;
+    intptr_t          diff;
+
+    if (ring == NULL || item == NULL)
+    {
+        return false;
+    }
+
+    pos = jtok_pipe_peek(&ring->tail);
+    for (;;)
+    {
+        cell = &ring->cells[pos & ring->mask];
+        diff = (intptr_t)jtok_pipe_load(&cell->seq) - (intptr_t)(pos + 1);
+        if (diff == 0)
+        {
+            if (jtok_pipe_claim(&ring->tail, &pos))
+            {
+                break;
+            }
+        }
+        else if (diff < 0)
+        {
+            return false; /* not filled yet: the ring is empty */
+        }
+        else
+        {
+            pos = jtok_pipe_peek(&ring->tail);
+        }
+    }
+
+    *item = cell->item;
+    jtok_pipe_store(&cell->seq, pos + ring->mask + 1);
+    return true;
+}
+
+
+static bool jtok_pipe_stopped(const jtok_pipe_t *pipe)
+{
+    return jtok_pipe_get_flag(&pipe->stop);
+}
+
+
+/* Start waiting. Call before looking for what to wait for. */
+static void jtok_pipe_wait_init(jtok_pipe_t *pipe, jtok_pipe_wait_t *wait)
+{
+    wait->spins = 0;
+#if defined(JTOK_PIPE_THREADED)
+    wait->seen = __atomic_load_n(&pipe->epoch, __ATOMIC_SEQ_CST);
+#else
+    (void)pipe;
+    wait->seen = 0;
+#endif /* #if defined(JTOK_PIPE_THREADED) */
+}
+
+
+/*
+ * Give another stage a chance to catch up: yield for a while, then sleep
+ * until some stage has moved since the caller last looked. A stage that
+ * moves bumps the epoch before it checks for sleepers, and a sleeper counts
+ * itself before it checks the epoch, so one of the two always sees the
+ * other.
+ */
+static void jtok_pipe_idle(jtok_pipe_t *pipe, jtok_pipe_wait_t *wait)
+{
+#if defined(JTOK_PIPE_THREADED)
+    if (wait->spins < JTOK_PIPE_SPIN)
+    {
+        wait->spins++;
+        sched_yield();
+    }
+    else
+    {
+        pthread_mutex_lock(&pipe->lock);
+        __atomic_add_fetch(&pipe->sleepers, 1, __ATOMIC_SEQ_CST);
+        while (__atomic_load_n(&pipe->epoch, __ATOMIC_SEQ_CST) == wait->seen)
+        {
+            pthread_cond_wait(&pipe->progress, &pipe->lock);
+        }
+        __atomic_sub_fetch(&pipe->sleepers, 1, __ATOMIC_SEQ_CST);
+        pthread_mutex_unlock(&pipe->lock);
+    }
+    wait->seen = __atomic_load_n(&pipe->epoch, __ATOMIC_SEQ_CST);
+#else
+    (void)pipe;
+    (void)wait;
+#endif /* #if defined(JTOK_PIPE_THREADED) */
+}
+
+
+/* Wake any stage sleeping in jtok_pipe_idle */
+static void jtok_pipe_notify(jtok_pipe_t *pipe)
+{
+#if defined(JTOK_PIPE_THREADED)
+    __atomic_add_fetch(&pipe->epoch, 1, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&pipe->sleepers, __ATOMIC_SEQ_CST) > 0)
+    {
+        pthread_mutex_lock(&pipe->lock);
+        pthread_cond_broadcast(&pipe->progress);
+        pthread_mutex_unlock(&pipe->lock);
+    }
+#else
+    (void)pipe;
+#endif /* #if defined(JTOK_PIPE_THREADED) */
+}
+
+
+static void jtok_pipe_parse(jtok_pipe_t *pipe, jtok_pipe_item_t *item)
+{
+    jtok_pipe_wait_t wait;
+
+    if (item->status != JTOK_PARSE_STATUS_OK || jtok_pipe_stopped(pipe))
+    {
+        return;
+    }
+
+    /* Out of contexts means the consumer is holding them all: wait for it */
+    jtok_pipe_wait_init(pipe, &wait);
+    while ((item->ctx = jtok_ctx_acquire(pipe->config->contexts)) == NULL)
+    {
+        jtok_pipe_idle(pipe, &wait);
+    }
+    item->status = jtok_ctx_parse(item->ctx, item->data, item->len);
+}
+
+
+static void jtok_pipe_deliver(jtok_pipe_t *pipe, const jtok_pipe_item_t *item)
+{
+    if (!jtok_pipe_stopped(pipe))
+    {
+        pipe->delivered++;
+        if (pipe->fn(pipe->fn_ctx, item) != 0)
+        {
+            jtok_pipe_set_flag(&pipe->stop);
+        }
+    }
+    if (item->ctx != NULL)
+    {
+        jtok_ctx_release(item->ctx);
+    }
+
+    /* The reader may now reuse the bytes of the document */
+    jtok_pipe_set_flag(&pipe->done[item->index % JTOK_PIPE_MAX_INFLIGHT]);
+    jtok_pipe_notify(pipe);
+}
+
+
+static void jtok_pipe_push(jtok_pipe_t *pipe, jtok_ring_t *ring,
+                           const jtok_pipe_item_t *item)
+{
+    jtok_pipe_wait_t wait;
+
+    jtok_pipe_wait_init(pipe, &wait);
+    while (!jtok_ring_push(ring, item))
+    {
+        jtok_pipe_idle(pipe, &wait);
+    }
+    jtok_pipe_notify(pipe);
+}
+
+
+#if defined(JTOK_PIPE_THREADED)
+
+static void *jtok_pipe_worker(void *arg)
+{
+    jtok_pipe_t *    pipe = (jtok_pipe_t *)arg;
+    jtok_pipe_item_t items[JTOK_PIPE_MAX_BATCH];
+    jtok_pipe_wait_t wait;
+    size_t           count;
+    size_t           i;
+    bool             end = false;
+
+    while (!end)
+    {
+        /* Wait for one document, then take whatever else is ready. Stop at
+         * an end marker so that every worker gets exactly one. */
+        jtok_pipe_wait_init(pipe, &wait);
+        while (!jtok_ring_pop(&pipe->in, &items[0]))
+        {
+            jtok_pipe_idle(pipe, &wait);
+        }
+        count = 1;
+        while (count < pipe->config->batch &&
+               items[count - 1].index != JTOK_PIPE_END &&
+               jtok_ring_pop(&pipe->in, &items[count]))
+        {
+            count++;
+        }
+        jtok_pipe_notify(pipe);
+
+        for (i = 0; i < count; i++)
+        {
+            if (items[i].index == JTOK_PIPE_END)
+            {
+                end = true;
+            }
+            else
+            {
+                jtok_pipe_parse(pipe, &items[i]);
+                jtok_pipe_push(pipe, &pipe->out, &items[i]);
+            }
+        }
+    }
+    return NULL;
+}
+
+
+static void *jtok_pipe_consumer(void *arg)
+{
+    jtok_pipe_t *    pipe = (jtok_pipe_t *)arg;
+    jtok_pipe_item_t item;
+    jtok_pipe_wait_t wait;
+
+    jtok_pipe_wait_init(pipe, &wait);
+    for (;;)
+    {
+        if (!jtok_ring_pop(&pipe->out, &item))
+        {
+            jtok_pipe_idle(pipe, &wait);
+            continue;
+        }
+
+        if (item.index == JTOK_PIPE_END)
+        {
+            break;
+        }
+
+        /* Delivering also tells the workers about the room made in out */
+        jtok_pipe_deliver(pipe, &item);
+        jtok_pipe_wait_init(pipe, &wait);
+    }
+    return NULL;
+}
+
+#endif /* #if defined(JTOK_PIPE_THREADED) */
+
+
+/* Move past documents the consumer has released, oldest first */
+static void jtok_pipe_reclaim(jtok_pipe_t *pipe)
+{
+    bool *done;
+
+    while (pipe->reclaimed < pipe->emitted)
+    {
+        done = &pipe->done[pipe->reclaimed % JTOK_PIPE_MAX_INFLIGHT];
+        if (!jtok_pipe_get_flag(done))
+        {
+            break;
+        }
+        *done = false;
+        pipe->reclaimed++;
+    }
+    if (pipe->wrapped && pipe->reclaimed >= pipe->wrap_index)
+    {
+        pipe->wrapped = false;
+    }
+}
+
+
+/* Hand a framed document to the parsers, or parse it here if there are
+ * none */
+static void jtok_pipe_emit(jtok_pipe_t *pipe, size_t start, size_t len,
+                           JTOK_PARSE_STATUS_t status)
+{
+    jtok_pipe_item_t item;
+    jtok_pipe_wait_t wait;
+
+    jtok_pipe_wait_init(pipe, &wait);
+    for (;;)
+    {
+        jtok_pipe_reclaim(pipe);
+        if (pipe->emitted - pipe->reclaimed < JTOK_PIPE_MAX_INFLIGHT)
+        {
+            break;
+        }
+        jtok_pipe_idle(pipe, &wait);
+    }
+
+    item.index  = pipe->emitted;
+    item.offset = pipe->base + (start - pipe->scan);
+    item.data   = (status != JTOK_PARSE_STATUS_NOMEM) ? &pipe->config->buf[start]
+                                                      : NULL;
+    item.len    = (item.data != NULL) ? len : 0;
+    item.ctx    = NULL;
+    item.status = status;
+
+    pipe->start[pipe->emitted % JTOK_PIPE_MAX_INFLIGHT] = start;
+    pipe->emitted++;
+
+    if (pipe->threaded)
+    {
+        jtok_pipe_push(pipe, &pipe->in, &item);
+    }
+    else
+    {
+        jtok_pipe_parse(pipe, &item);
+        jtok_pipe_deliver(pipe, &item);
+    }
+}
+
+
+static void jtok_pipe_advance(jtok_pipe_t *pipe, size_t to)
+{
+    pipe->base += to - pipe->scan;
+    pipe->scan = to;
+}
+
+
+static bool jtok_pipe_blank(const char *text, size_t len)
+{
+    size_t i;
+    for (i = 0; i < len; i++)
+    {
+        if (!isspace((unsigned char)text[i]))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+static void jtok_pipe_emit_line(jtok_pipe_t *pipe, size_t end)
+{
+    const char *buf = pipe->config->buf;
+    size_t      len = end - pipe->scan;
+
+    if (len > 0 && buf[pipe->scan + len - 1] == '\r')
+    {
+        len--;
+    }
+    if (!jtok_pipe_blank(&buf[pipe->scan], len))
+    {
+        jtok_pipe_emit(pipe, pipe->scan, len, JTOK_PARSE_STATUS_OK);
+    }
+}
+
+
+/* Emit every complete document between scan and fill */
+static void jtok_pipe_frame(jtok_pipe_t *pipe)
+{
+    const char *buf = pipe->config->buf;
+    const char *newline;
+    size_t      len;
+    size_t      avail;
+
+    for (;;)
+    {
+        avail = pipe->fill - pipe->scan;
+        if (pipe->skip > 0)
+        {
+            len = (pipe->skip < avail) ? pipe->skip : avail;
+            pipe->skip -= len;
+            jtok_pipe_advance(pipe, pipe->scan + len);
+            if (pipe->skip > 0)
+            {
+                return;
+            }
+            continue;
+        }
+
+        if (pipe->config->framing == JTOK_PIPE_NEWLINE)
+        {
+            newline = memchr(&buf[pipe->scan], '\n', avail);
+            if (newline == NULL)
+            {
+                if (pipe->discard_line)
+                {
+                    jtok_pipe_advance(pipe, pipe->fill);
+                }
+                return;
+            }
+            len = (size_t)(newline - buf);
+            if (pipe->discard_line)
+            {
+                pipe->discard_line = false;
+            }
+            else
+            {
+                jtok_pipe_emit_line(pipe, len);
+            }
+            jtok_pipe_advance(pipe, len + 1);
+        }
+        else
+        {
+            if (avail < JTOK_PIPE_PREFIX_LEN)
+            {
+                return;
+            }
+            len = ((size_t)(unsigned char)buf[pipe->scan] << 24) |
+                  ((size_t)(unsigned char)buf[pipe->scan + 1] << 16) |
+                  ((size_t)(unsigned char)buf[pipe->scan + 2] << 8) |
+                  (size_t)(unsigned char)buf[pipe->scan + 3];
+            if (len > pipe->config->buf_size - JTOK_PIPE_PREFIX_LEN)
+            {
+                /* Can never fit: report it and skip over it as it arrives */
+                jtok_pipe_emit(pipe, pipe->scan, 0, JTOK_PARSE_STATUS_NOMEM);
+                jtok_pipe_advance(pipe, pipe->scan + JTOK_PIPE_PREFIX_LEN);
+                pipe->skip = len;
+                continue;
+            }
+            if (avail - JTOK_PIPE_PREFIX_LEN < len)
+            {
+                return;
+            }
+            jtok_pipe_emit(pipe, pipe->scan + JTOK_PIPE_PREFIX_LEN, len,
+                           JTOK_PARSE_STATUS_OK);
+            jtok_pipe_advance(pipe, pipe->scan + JTOK_PIPE_PREFIX_LEN + len);
+        }
+    }
+}
+
+
+/* Whatever is left when the stream ends */
+static void jtok_pipe_frame_last(jtok_pipe_t *pipe)
+{
+    if (pipe->fill == pipe->scan || pipe->skip > 0 || pipe->discard_line)
+    {
+        return;
+    }
+    if (pipe->config->framing == JTOK_PIPE_NEWLINE)
+    {
+        jtok_pipe_emit_line(pipe, pipe->fill);
+    }
+    else
+    {
+        jtok_pipe_emit(pipe, pipe->scan, pipe->fill - pipe->scan,
+                       JTOK_PARSE_STATUS_PARTIAL_TOKEN);
+    }
+    jtok_pipe_advance(pipe, pipe->fill);
+}
+
+
+/* Find free space after fill. Returns its end, or fill if there is none
+ * until the consumer releases something. */
+static size_t jtok_pipe_room(jtok_pipe_t *pipe)
+{
+    size_t size = pipe->config->buf_size;
+    size_t lo;
+    size_t partial;
+
+    jtok_pipe_reclaim(pipe);
+    lo = (pipe->reclaimed < pipe->emitted)
+             ? pipe->start[pipe->reclaimed % JTOK_PIPE_MAX_INFLIGHT]
+             : pipe->scan;
+
+    if (pipe->wrapped)
+    {
+        return lo;
+    }
+    if (pipe->fill < size)
+    {
+        return size;
+    }
+
+    /* Out of space at the end: move the unfinished document to the front */
+    partial = pipe->fill - pipe->scan;
+    if (pipe->reclaimed == pipe->emitted)
+    {
+        if (pipe->scan == 0)
+        {
+            /* One line fills the whole buffer: drop it */
+            jtok_pipe_emit(pipe, 0, 0, JTOK_PARSE_STATUS_NOMEM);
+            pipe->discard_line = true;
+            jtok_pipe_advance(pipe, pipe->fill);
+            pipe->scan = 0;
+            pipe->fill = 0;
+            return size;
+        }
+        memmove(pipe->config->buf, &pipe->config->buf[pipe->scan], partial);
+        pipe->scan = 0;
+        pipe->fill = partial;
+        return size;
+    }
+    if (partial < lo)
+    {
+        memmove(pipe->config->buf, &pipe->config->buf[pipe->scan], partial);
+        pipe->scan       = 0;
+        pipe->fill       = partial;
+        pipe->wrapped    = true;
+        pipe->wrap_index = pipe->emitted;
+        return lo;
+    }
+    return pipe->fill;
+}
+
+
+static void jtok_pipe_reader(jtok_pipe_t *pipe)
+{
+    jtok_pipe_wait_t wait;
+    size_t           limit;
+    size_t           got;
+
+    jtok_pipe_wait_init(pipe, &wait);
+    while (!jtok_pipe_stopped(pipe))
+    {
+        jtok_pipe_frame(pipe);
+
+        limit = jtok_pipe_room(pipe);
+        if (limit <= pipe->fill)
+        {
+            jtok_pipe_idle(pipe, &wait);
+            continue;
+        }
+        jtok_pipe_wait_init(pipe, &wait);
+
+        got = pipe->read(pipe->read_ctx, &pipe->config->buf[pipe->fill],
+                         limit - pipe->fill);
+        if (got == 0)
+        {
+            jtok_pipe_frame_last(pipe);
+            break;
+        }
+        pipe->fill += (got < limit - pipe->fill) ? got : limit - pipe->fill;
+    }
+}
+
+
+#if defined(JTOK_PIPE_THREADED)
+
+/* Start the consumer and the parsers. Returns the number of parsers, or 0
+ * if the pipeline has to run on the calling thread alone. */
+static unsigned jtok_pipe_start(jtok_pipe_t *pipe, pthread_t *consumer,
+                                pthread_t *workers)
+{
+    jtok_pipe_item_t end;
+    unsigned         count = 0;
+    unsigned         i;
+
+    if (0 != pthread_create(consumer, NULL, jtok_pipe_consumer, pipe))
+    {
+        return 0;
+    }
+    for (i = 0; i < pipe->config->workers; i++)
+    {
+        if (0 == pthread_create(&workers[count], NULL, jtok_pipe_worker, pipe))
+        {
+            count++;
+        }
+    }
+    if (count == 0)
+    {
+        memset(&end, 0, sizeof(end));
+        end.index = JTOK_PIPE_END;
+        jtok_pipe_push(pipe, &pipe->out, &end);
+        pthread_join(*consumer, NULL);
+    }
+    return count;
+}
+
+
+static void jtok_pipe_finish(jtok_pipe_t *pipe, pthread_t consumer,
+                             pthread_t *workers, unsigned count)
+{
+    jtok_pipe_item_t end;
+    unsigned         i;
+
+    /* Workers pass on everything before their end marker, so once they are
+     * all gone the consumer can be told to finish too */
+    memset(&end, 0, sizeof(end));
+    end.index = JTOK_PIPE_END;
+    for (i = 0; i < count; i++)
+    {
+        jtok_pipe_push(pipe, &pipe->in, &end);
+    }
+    for (i = 0; i < count; i++)
+    {
+        pthread_join(workers[i], NULL);
+    }
+    jtok_pipe_push(pipe, &pipe->out, &end);
+    pthread_join(consumer, NULL);
+}
+
+#endif /* #if defined(JTOK_PIPE_THREADED) */
+
+
+size_t jtok_pipe_run(const jtok_pipe_config_t *config, jtok_pipe_read_fn read,
+                     void *read_ctx, jtok_pipe_fn fn, void *fn_ctx)
+{
+    jtok_pipe_t         pipe;
+    jtok_pipe_config_t  settings;
+#if defined(JTOK_PIPE_THREADED)
+    pthread_t consumer;
+    pthread_t workers[JTOK_PIPE_MAX_WORKERS];
+    unsigned  count;
+#endif /* #if defined(JTOK_PIPE_THREADED) */
+
+    if (config == NULL || read == NULL || fn == NULL || config->buf == NULL ||
+        config->contexts == NULL)
+    {
+        return 0;
+    }
+    if (config->workers == 0 || config->workers > JTOK_PIPE_MAX_WORKERS ||
+        config->batch > JTOK_PIPE_MAX_BATCH ||
+        config->buf_size <= JTOK_PIPE_PREFIX_LEN ||
+        (config->framing != JTOK_PIPE_NEWLINE &&
+         config->framing != JTOK_PIPE_LENGTH_PREFIX))
+    {
+        return 0;
+    }
+
+    settings       = *config;
+    settings.batch = (config->batch > 0) ? config->batch
+                                         : JTOK_PIPE_BATCH_DEFAULT;
+    if (jtok_ring_init(&pipe.in, settings.in_cells, settings.in_count) !=
+            JTOK_PARSE_STATUS_OK ||
+        jtok_ring_init(&pipe.out, settings.out_cells, settings.out_count) !=
+            JTOK_PARSE_STATUS_OK)
+    {
+        return 0;
+    }
+
+    pipe.config       = &settings;
+    pipe.read         = read;
+    pipe.read_ctx     = read_ctx;
+    pipe.fn           = fn;
+    pipe.fn_ctx       = fn_ctx;
+    pipe.threaded     = false;
+    pipe.fill         = 0;
+    pipe.scan         = 0;
+    pipe.base         = 0;
+    pipe.skip         = 0;
+    pipe.discard_line = false;
+    pipe.wrapped      = false;
+    pipe.wrap_index   = 0;
+    pipe.emitted      = 0;
+    pipe.reclaimed    = 0;
+    pipe.delivered    = 0;
+    pipe.stop         = false;
+    memset(pipe.done, 0, sizeof(pipe.done));
+
+#if defined(JTOK_PIPE_THREADED)
+    pipe.epoch    = 0;
+    pipe.sleepers = 0;
+    if (0 != pthread_mutex_init(&pipe.lock, NULL))
+    {
+        return 0;
+    }
+    if (0 != pthread_cond_init(&pipe.progress, NULL))
+    {
+        pthread_mutex_destroy(&pipe.lock);
+        return 0;
+    }
+    count         = jtok_pipe_start(&pipe, &consumer, workers);
+    pipe.threaded = (count > 0);
+#endif /* #if defined(JTOK_PIPE_THREADED) */
+
+    jtok_pipe_reader(&pipe);
+
+#if defined(JTOK_PIPE_THREADED)
+    if (pipe.threaded)
+    {
+        jtok_pipe_finish(&pipe, consumer, workers, count);
+    }
+    pthread_cond_destroy(&pipe.progress);
+    pthread_mutex_destroy(&pipe.lock);
+#endif /* #if defined(JTOK_PIPE_THREADED) */
+    return pipe.delivered;
+}
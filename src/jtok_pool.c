@@ -0,0 +1,264 @@
+/**
+ * @file jtok_pool.c
+ * @author Carl Mattatall (cmattatall2@gmail.com)
+ * @brief Source module for pools of reusable parser contexts
+ * @version 0.1
+ * @date 2021-05-11
+ *
+ * @copyright Copyright (c) 2021 Carl Mattatall
+ *
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "jtok.h"
+#include "jtok_pool.h"
+
+/*
+ * The free list is a stack threaded through jtok_ctx_t.next. Links and the
+ * head hold index + 1 so that 0 can mean "none". The head also carries a
+ * tag in its upper 32 bits that changes on every push and pop, so a
+ * compare-and-swap based on a stale head fails even if the same context
+ * has been popped and pushed back in the meantime (the ABA problem).
+ */
+#define JTOK_POOL_NONE 0
+#define JTOK_POOL_INDEX(head) ((uint32_t)((head)&UINT32_MAX))
+#define JTOK_POOL_HEAD(head, index)                                            \
+    (((((head) >> 32) + 1) << 32) | (uint64_t)(index))
+
+
+#if defined(JTOK_HAVE_ATOMICS)
+
+static uint64_t jtok_pool_load_head(uint64_t *head)
+{
+    return __atomic_load_n(head, __ATOMIC_ACQUIRE);
+}
+
+
+static bool jtok_pool_swap_head(uint64_t *head, uint64_t *expected,
+                                uint64_t desired)
+{
+    return __atomic_compare_exchange_n(head, expected, desired, true,
+                                       __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+}
+
+
+static uint32_t jtok_pool_load_link(uint32_t *link)
+{
+    return __atomic_load_n(link, __ATOMIC_RELAXED);
+}
+
+
+static void jtok_pool_store_link(uint32_t *link, uint32_t value)
+{
+    __atomic_store_n(link, value, __ATOMIC_RELAXED);
+}
+
+
+static void jtok_pool_count(size_t *counter, size_t n)
+{
+    __atomic_fetch_add(counter, n, __ATOMIC_RELAXED);
+}
+
+
+static size_t jtok_pool_read_count(const size_t *counter)
+{
+    return __atomic_load_n(counter, __ATOMIC_RELAXED);
+}
+
+#else
+
+static uint64_t jtok_pool_load_head(uint64_t *head)
+{
+    return *head;
+}
+
+
+static bool jtok_pool_swap_head(uint64_t *head, uint64_t *expected,
+                                uint64_t desired)
+{
+    *head = desired;
+    (void)expected;
+    return true;
+}
+
+
+static uint32_t jtok_pool_load_link(uint32_t *link)
+{
+    return *link;
+}
+
+
+static void jtok_pool_store_link(uint32_t *link, uint32_t value)
+{
+    *link = value;
+}
+
+
+static void jtok_pool_count(size_t *counter, size_t n)
+{
+    *counter += n;
+}
+
+
+static size_t jtok_pool_read_count(const size_t *counter)
+{
+    return *counter;
+}
+
+#endif /* #if defined(JTOK_HAVE_ATOMICS) */
+
+
+JTOK_PARSE_STATUS_t jtok_ctx_pool_init(jtok_ctx_pool_t *pool, jtok_ctx_t *ctxs,
+                                       size_t count, jtok_tkn_t *tkns,
+                                       size_t tokens_per_ctx, void *scratch,
+                                       size_t scratch_per_ctx)
+{
+    jtok_ctx_t *ctx;
+    size_t      i;
+
+    if (pool == NULL || ctxs == NULL || tkns == NULL)
+    {
+        return JTOK_PARSE_STATUS_NULL_PARAM;
+    }
+    if (count == 0 || count >= UINT32_MAX || tokens_per_ctx == 0 ||
+        tokens_per_ctx > SIZE_MAX / count ||
+        (scratch != NULL && scratch_per_ctx > SIZE_MAX / count))
+    {
+        return JTOK_PARSE_STATUS_INVAL;
+    }
+
+    for (i = 0; i < count; i++)
+    {
+        ctx                 = &ctxs[i];
+        ctx->tkns           = &tkns[i * tokens_per_ctx];
+        ctx->size           = tokens_per_ctx;
+        ctx->scratch        = NULL;
+        ctx->scratch_len    = 0;
+        ctx->stats.parses   = 0;
+        ctx->stats.failures = 0;
+        ctx->stats.nomem    = 0;
+        ctx->stats.bytes    = 0;
+        ctx->pool           = pool;
+        ctx->next           = (uint32_t)(i + 2);
+        ctx->tkns[0].type   = JTOK_UNASSIGNED_TOKEN;
+        if (scratch != NULL)
+        {
+            ctx->scratch     = (char *)scratch + i * scratch_per_ctx;
+            ctx->scratch_len = scratch_per_ctx;
+        }
+    }
+
+    ctxs[count - 1].next = JTOK_POOL_NONE;
+
+    pool->ctxs  = ctxs;
+    pool->count = count;
+    pool->head  = 1; /* tag 0, first context */
+    return JTOK_PARSE_STATUS_OK;
+}
+
+
+jtok_ctx_t *jtok_ctx_acquire(jtok_ctx_pool_t *pool)
+{
+    uint64_t head;
+    uint64_t desired;
+    uint32_t index;
+
+    if (pool == NULL)
+    {
+        return NULL;
+    }
+
+    head = jtok_pool_load_head(&pool->head);
+    do
+    {
+        index = JTOK_POOL_INDEX(head);
+        if (index == JTOK_POOL_NONE)
+        {
+            return NULL;
+        }
+
+        /* If another thread takes this context first the link may be stale,
+         * but then the head has changed and the swap fails */
+        desired = JTOK_POOL_HEAD(
+            head, jtok_pool_load_link(&pool->ctxs[index - 1].next));
+    } while (!jtok_pool_swap_head(&pool->head, &head, desired));
+
+    return &pool->ctxs[index - 1];
+}
+
+
+void jtok_ctx_release(jtok_ctx_t *ctx)
+{
+    jtok_ctx_pool_t *pool;
+    uint64_t         head;
+    uint64_t         desired;
+    uint32_t         index;
+
+    if (ctx == NULL || ctx->pool == NULL)
+    {
+        return;
+    }
+
+    /* Reset, don't free: the next holder reuses the arena as-is */
+    ctx->tkns[0].type = JTOK_UNASSIGNED_TOKEN;
+
+    pool  = ctx->pool;
+    index = (uint32_t)(ctx - pool->ctxs) + 1;
+    head  = jtok_pool_load_head(&pool->head);
+    do
+    {
+        jtok_pool_store_link(&ctx->next, JTOK_POOL_INDEX(head));
+        desired = JTOK_POOL_HEAD(head, index);
+    } while (!jtok_pool_swap_head(&pool->head, &head, desired));
+}
+
+
+JTOK_PARSE_STATUS_t jtok_ctx_parse(jtok_ctx_t *ctx, const char *json,
+                                   size_t len)
+{
+    JTOK_PARSE_STATUS_t status;
+
+    if (ctx == NULL)
+    {
+        return JTOK_PARSE_STATUS_NULL_PARAM;
+    }
+
+    status = jtok_parsen(json, len, ctx->tkns, ctx->size);
+    jtok_pool_count(&ctx->stats.parses, 1);
+    jtok_pool_count(&ctx->stats.bytes, len);
+    if (status != JTOK_PARSE_STATUS_OK)
+    {
+        jtok_pool_count(&ctx->stats.failures, 1);
+        if (status == JTOK_PARSE_STATUS_NOMEM)
+        {
+            jtok_pool_count(&ctx->stats.nomem, 1);
+        }
+    }
+    return status;
+}
+
+
+void jtok_ctx_pool_stats(const jtok_ctx_pool_t *pool, jtok_ctx_stats_t *total)
+{
+    const jtok_ctx_stats_t *stats;
+    size_t                  i;
+
+    if (total == NULL)
+    {
+        return;
+    }
+    total->parses   = 0;
+    total->failures = 0;
+    total->nomem    = 0;
+    total->bytes    = 0;
+    for (i = 0; pool != NULL && i < pool->count; i++)
+    {
+        stats = &pool->ctxs[i].stats;
+        total->parses += jtok_pool_read_count(&stats->parses);
+        total->failures += jtok_pool_read_count(&stats->failures);
+        total->nomem += jtok_pool_read_count(&stats->nomem);
+        total->bytes += jtok_pool_read_count(&stats->bytes);
+    }
+}
@@ -0,0 +1,306 @@
+/**
+ * @file jtok_pretty.c
+ * @author Carl Mattatall (cmattatall2@gmail.com)
+ * @brief Source module to pretty-print json from a token pool or a byte stream
+ * @version 0.1
+ * @date 2021-05-04
+ *
+ * @copyright Copyright (c) 2021 Carl Mattatall
+ *
+ */
+
+#include <ctype.h>
+#include <string.h>
+
+#include "jtok.h"
+#include "jtok_pretty.h"
+#include "jtok_shared.h"
+#include "jtok_swar.h"
+
+#define JTOK_PRETTY_INDENT_CHUNK 64
+
+typedef struct
+{
+    bool       is_object;
+    bool       after_key;
+    jtok_off_t remaining;
+} jtok_pretty_frame_t;
+
+/* A newline followed by one chunk worth of indentation */
+static const char jtok_pretty_newline[] =
+    "\n                                                                ";
+
+
+/**
+ * @brief Start a new line indented for the given nesting depth
+ */
+static JTOK_WRITE_STATUS_t jtok_pretty_indent(jtok_writer_t *writer,
+                                              size_t depth, unsigned int indent)
+{
+    size_t spaces = depth * indent;
+    size_t count  = (spaces < JTOK_PRETTY_INDENT_CHUNK)
+                        ? spaces
+                        : JTOK_PRETTY_INDENT_CHUNK;
+    jtok_writer_raw(writer, jtok_pretty_newline, count + 1);
+    spaces -= count;
+    while (spaces > 0 && writer->status == JTOK_WRITE_STATUS_OK)
+    {
+        count = (spaces < JTOK_PRETTY_INDENT_CHUNK) ? spaces
+                                                    : JTOK_PRETTY_INDENT_CHUNK;
+        jtok_writer_raw(writer, &jtok_pretty_newline[1], count);
+        spaces -= count;
+    }
+    return writer->status;
+}
+
+
+JTOK_WRITE_STATUS_t jtok_pretty_tokens(jtok_writer_t *writer,
+                                       const jtok_tkn_t *tkn,
+                                       unsigned int indent)
+{
+    jtok_pretty_frame_t frames[JTOK_MAX_RECURSE_DEPTH + 2];
+    int                 depth = 0;
+    const jtok_tkn_t *  tok   = tkn;
+    if (writer == NULL || tkn == NULL)
+    {
+        return JTOK_WRITE_STATUS_NULL_PARAM;
+    }
+
+    do
+    {
+        size_t      len;
+        const char *span = jtok_tokspan(tok, &len);
+        if (span == NULL)
+        {
+            return JTOK_WRITE_STATUS_INVAL;
+        }
+
+        if (depth > 0 && frames[depth - 1].is_object &&
+            !frames[depth - 1].after_key)
+        {
+            /* Object key. Its value is the next token in the pool */
+            jtok_writer_raw(writer, span, len);
+            jtok_writer_raw(writer, ": ", 2);
+            frames[depth - 1].after_key = true;
+            tok++;
+            continue;
+        }
+
+        if ((tok->type == JTOK_OBJECT || tok->type == JTOK_ARRAY) &&
+            tok->size > 0)
+        {
+            if (depth >= (int)(sizeof(frames) / sizeof(*frames)))
+            {
+                return JTOK_WRITE_STATUS_NEST_DEPTH_EXCEEDED;
+            }
+            frames[depth].is_object = (tok->type == JTOK_OBJECT);
+            frames[depth].after_key = false;
+            frames[depth].remaining = tok->size;
+            depth++;
+            jtok_writer_raw(writer, span, 1);
+            jtok_pretty_indent(writer, (size_t)depth, indent);
+            tok++;
+            continue;
+        }
+
+        if (tok->type == JTOK_OBJECT)
+        {
+            jtok_writer_raw(writer, "{}", 2);
+        }
+        else if (tok->type == JTOK_ARRAY)
+        {
+            jtok_writer_raw(writer, "[]", 2);
+        }
+        else
+        {
+            jtok_writer_raw(writer, span, len);
+        }
+        tok++;
+
+        /* A value is complete. Close every container it was the last item of */
+        while (depth > 0)
+        {
+            jtok_pretty_frame_t *frame = &frames[depth - 1];
+            frame->after_key           = false;
+            if (--frame->remaining > 0)
+            {
+                jtok_writer_raw(writer, ",", 1);
+                jtok_pretty_indent(writer, (size_t)depth, indent);
+                break;
+            }
+            depth--;
+            jtok_pretty_indent(writer, (size_t)depth, indent);
+            jtok_writer_raw(writer, frame->is_object ? "}" : "]", 1);
+        }
+    } while (depth > 0 && writer->status == JTOK_WRITE_STATUS_OK);
+    return writer->status;
+}
+
+
+void jtok_pretty_init(jtok_pretty_t *pretty, jtok_writer_t *writer,
+                      unsigned int indent)
+{
+    memset(pretty, 0, sizeof(*pretty));
+    pretty->writer = writer;
+    pretty->indent = indent;
+}
+
+
+JTOK_WRITE_STATUS_t jtok_pretty_feed(jtok_pretty_t *pretty, const char *data,
+                                     size_t len)
+{
+    jtok_writer_t *writer;
+    size_t         run = 0; /* start of bytes to be copied verbatim */
+    size_t         i   = 0;
+    if (pretty == NULL || pretty->writer == NULL || (data == NULL && len > 0))
+    {
+        return JTOK_WRITE_STATUS_NULL_PARAM;
+    }
+    writer = pretty->writer;
+
+    while (i < len && writer->status == JTOK_WRITE_STATUS_OK)
+    {
+        char c = data[i];
+        if (pretty->quote != 0)
+        {
+            if (pretty->escape)
+            {
+                pretty->escape = false;
+                i++;
+                continue;
+            }
+
+            /* String bodies are skipped 8 bytes at a time */
+            while (i + sizeof(uint64_t) <= len)
+            {
+                uint64_t word = jtok_swar_load(&data[i]);
+                if ((jtok_swar_eq_bytes(word, (unsigned char)pretty->quote) |
+                     jtok_swar_eq_bytes(word, '\\')) != 0)
+                {
+                    break;
+                }
+                i += sizeof(word);
+            }
+            if (i >= len)
+            {
+                break;
+            }
+            if (data[i] == '\\')
+            {
+                pretty->escape = true;
+            }
+            else if (data[i] == pretty->quote)
+            {
+                pretty->quote = 0;
+            }
+            i++;
+            continue;
+        }
+
+        if (isspace((unsigned char)c))
+        {
+            /* Whatever the parser skips is dropped from the output */
+            jtok_writer_raw(writer, &data[run], i - run);
+            run = i + 1;
+            i++;
+            continue;
+        }
+
+        switch (c)
+        {
+            case '}':
+            case ']':
+            {
+                jtok_writer_raw(writer, &data[run], i - run);
+                run = i + 1;
+                if (pretty->depth > 0)
+                {
+                    pretty->depth--;
+                }
+                if (pretty->pending)
+                {
+                    pretty->pending = false;
+                }
+                else
+                {
+                    jtok_pretty_indent(writer, pretty->depth, pretty->indent);
+                }
+                jtok_writer_raw(writer, &c, 1);
+            }
+            break;
+            default:
+            {
+                if (pretty->pending)
+                {
+                    /* The container just opened is not empty after all */
+                    jtok_writer_raw(writer, &data[run], i - run);
+                    run             = i;
+                    pretty->pending = false;
+                    jtok_pretty_indent(writer, pretty->depth, pretty->indent);
+                }
+
+                switch (c)
+                {
+                    case '{':
+                    case '[':
+                    {
+                        jtok_writer_raw(writer, &data[run], i + 1 - run);
+                        run = i + 1;
+                        pretty->depth++;
+                        pretty->pending = true;
+                    }
+                    break;
+                    case ',':
+                    {
+                        jtok_writer_raw(writer, &data[run], i + 1 - run);
+                        run = i + 1;
+                        jtok_pretty_indent(writer, pretty->depth,
+                                           pretty->indent);
+                    }
+                    break;
+                    case ':':
+                    {
+                        jtok_writer_raw(writer, &data[run], i - run);
+                        run = i + 1;
+                        jtok_writer_raw(writer, ": ", 2);
+                    }
+                    break;
+                    case '\"':
+                    case '\'':
+                    {
+                        pretty->quote = c;
+                    }
+                    break;
+                    default:
+                    {
+                        /* Primitive bytes extend the verbatim run */
+                    }
+                    break;
+                }
+            }
+            break;
+        }
+        i++;
+    }
+
+    if (run < len)
+    {
+        jtok_writer_raw(writer, &data[run], len - run);
+    }
+    return writer->status;
+}
+
+
+JTOK_WRITE_STATUS_t jtok_pretty_finish(jtok_pretty_t *pretty)
+{
+    if (pretty == NULL || pretty->writer == NULL)
+    {
+        return JTOK_WRITE_STATUS_NULL_PARAM;
+    }
+    if (jtok_writer_flush(pretty->writer) == JTOK_WRITE_STATUS_OK &&
+        (pretty->quote != 0 || pretty->depth != 0))
+    {
+        return JTOK_WRITE_STATUS_INVAL;
+    }
+    return pretty->writer->status;
+}
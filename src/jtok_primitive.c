@@ -12,19 +12,16 @@
 #include <ctype.h>
 #include <string.h>
 #include <stdlib.h>
-#include <float.h>
 
 
 #include "jtok_primitive.h"
 #include "jtok_shared.h"
 
 
-JTOK_PARSE_STATUS_t jtok_parse_primitive(jtok_parser_t *parser)
+JTOK_PARSE_STATUS_t jtok_primitive_scan(const char *js, jtok_off_t len,
+                                        jtok_off_t *pos)
 {
-    jtok_tkn_t *token;
-    int         start = parser->pos;
-    const char *js    = (const char *)parser->json;
-    int         len   = parser->json_len;
+    jtok_off_t start = *pos;
 
     enum
     {
@@ -38,10 +35,9 @@ JTOK_PARSE_STATUS_t jtok_parse_primitive(jtok_parser_t *parser)
     bool decimal              = false;
     bool found_decimal_places = false;
 
-    for (start = parser->pos; parser->pos < len && js[parser->pos] != '\0';
-         parser->pos++)
+    for (; *pos < len && js[*pos] != '\0'; (*pos)++)
     {
-        switch (js[parser->pos])
+        switch (js[*pos])
         {
             case '0':
             case '1':
@@ -54,7 +50,7 @@ JTOK_PARSE_STATUS_t jtok_parse_primitive(jtok_parser_t *parser)
             case '8':
             case '9':
             {
-                if (parser->pos == start)
+                if (*pos == start)
                 {
                     primitive_type = NUMBER;
                 }
@@ -85,7 +81,7 @@ JTOK_PARSE_STATUS_t jtok_parse_primitive(jtok_parser_t *parser)
             case '+':
             case '-':
                 /* signs must come at beginning, or as an exponent */
-                if (start == parser->pos)
+                if (start == *pos)
                 {
                     primitive_type = NUMBER;
                 }
@@ -95,16 +91,16 @@ JTOK_PARSE_STATUS_t jtok_parse_primitive(jtok_parser_t *parser)
                 }
                 else
                 {
-                    parser->pos = start;
+                    *pos = start;
                     return JTOK_PARSE_STATUS_INVALID_PRIMITIVE;
                 }
                 break;
             case '.': /* decimal */
             {
-                if (parser->pos == start)
+                if (*pos == start)
                 {
                     /* {"key" : .123} is invalid */
-                    parser->pos = start;
+                    *pos = start;
                     return JTOK_PARSE_STATUS_INVALID_PRIMITIVE;
                 }
                 else
@@ -127,7 +123,7 @@ JTOK_PARSE_STATUS_t jtok_parse_primitive(jtok_parser_t *parser)
                         if (exponent)
                         {
                             /* { "key" : 123e+9.01} is invalid */
-                            parser->pos = start;
+                            *pos = start;
                             return JTOK_PARSE_STATUS_INVALID_PRIMITIVE;
                         }
                     }
@@ -141,10 +137,10 @@ JTOK_PARSE_STATUS_t jtok_parse_primitive(jtok_parser_t *parser)
             case 'e':
             case 'E':
             {
-                if (start == parser->pos)
+                if (start == *pos)
                 {
                     /* {"key" : e9"} is invalid */
-                    parser->pos = start;
+                    *pos = start;
                     return JTOK_PARSE_STATUS_INVALID_PRIMITIVE;
                 }
                 else
@@ -152,7 +148,7 @@ JTOK_PARSE_STATUS_t jtok_parse_primitive(jtok_parser_t *parser)
                     if (primitive_type == NUMBER)
                     {
                         /* previous char has to be a digit eg: 10e9 */
-                        if (isdigit((int)js[parser->pos - 1]))
+                        if (isdigit((int)js[*pos - 1]))
                         {
                             exponent             = true;
                             found_exponent_power = false;
@@ -160,7 +156,7 @@ JTOK_PARSE_STATUS_t jtok_parse_primitive(jtok_parser_t *parser)
                         }
                         else /* { "key" : -e9 } is invalid */
                         {
-                            parser->pos = start;
+                            *pos = start;
                             return JTOK_PARSE_STATUS_INVALID_PRIMITIVE;
                         }
                     }
@@ -179,75 +175,60 @@ JTOK_PARSE_STATUS_t jtok_parse_primitive(jtok_parser_t *parser)
             case ']':
             case '}':
             {
-                char last = js[parser->pos - 1];
+                char last = js[*pos - 1];
                 if (exponent)
                 {
                     if (!found_exponent_power)
                     {
-                        parser->pos = start;
+                        *pos = start;
                         return JTOK_PARSE_STATUS_INVALID_PRIMITIVE;
                     }
                 }
 
                 if (decimal && last == '.')
                 {
-                    parser->pos = start;
+                    *pos = start;
                     return JTOK_PARSE_STATUS_INVALID_PRIMITIVE;
                 }
 
-                token = jtok_alloc_token(parser);
-                if (token == NULL) /* not enough tokens provided by caller */
-                {
-                    parser->pos = start;
-                    return JTOK_PARSE_STATUS_NOMEM;
-                }
-                jtok_fill_token(token, JTOK_PRIMITIVE, start, parser->pos);
-
-                token->parent = parser->toksuper;
-
-                /* Go back 1 spot so when we return from current function, the
-                 * calling context can look at the current character
-                 *
-                 * This is because if the token terminates on a '}', it
-                 * may also terminate a superior token as well (such as a
-                 * higher level object in the given example)
-                 */
-                parser->pos--;
                 return JTOK_PARSE_STATUS_OK;
             }
             break;
             default:
             {
-                if (parser->pos == start)
+                if (*pos == start)
                 {
-                    if (0 == strncmp(&js[start], "true", strlen("true")))
+                    if (len - start >= (jtok_off_t)strlen("true") &&
+                        0 == strncmp(&js[start], "true", strlen("true")))
                     {
                         /* subtract 1 so we don't end up at character
                                   AFTER the final char in token */
-                        parser->pos += strlen("true") - 1;
+                        *pos += strlen("true") - 1;
                         break;
                     }
-                    else if (0 == strncmp(&js[start], "false", strlen("false")))
+                    else if (len - start >= (jtok_off_t)strlen("false") &&
+                             0 == strncmp(&js[start], "false", strlen("false")))
                     {
                         /* subtract 1 so we don't end up at character
                                   AFTER the final char in token */
-                        parser->pos += strlen("false") - 1;
+                        *pos += strlen("false") - 1;
                         break;
                     }
-                    else if (0 == strncmp(&js[start], "null", strlen("null")))
+                    else if (len - start >= (jtok_off_t)strlen("null") &&
+                             0 == strncmp(&js[start], "null", strlen("null")))
                     {
                         /* subtract 1 so we don't end up at character
                                   AFTER the final char in token */
-                        parser->pos += strlen("null") - 1;
+                        *pos += strlen("null") - 1;
                         break;
                     }
                     else
                     {
-                        parser->pos = start;
+                        *pos = start;
                         return JTOK_PARSE_STATUS_INVALID_PRIMITIVE;
                     }
                 }
-                parser->pos = start;
+                *pos = start;
                 return JTOK_PARSE_STATUS_PARTIAL_TOKEN;
             }
             break;
@@ -260,72 +241,135 @@ JTOK_PARSE_STATUS_t jtok_parse_primitive(jtok_parser_t *parser)
 }
 
 
-bool jtok_toktokcmp_primitive(const jtok_tkn_t *tkn1, const jtok_tkn_t *tkn2)
+JTOK_PARSE_STATUS_t jtok_parse_primitive(jtok_parser_t *parser)
 {
-    /** @todo really not proud of this function. SUPER inefficient
-     *  But it works for now. Really we should be storing some sort of
-     * "value subtype" as part of the parsing process and checking that here
+    jtok_tkn_t *       token;
+    jtok_off_t         start = parser->pos;
+    JTOK_PARSE_STATUS_t status;
+
+    status = jtok_primitive_scan((const char *)parser->json, parser->json_len,
+                                 &parser->pos);
+    if (status != JTOK_PARSE_STATUS_OK)
+    {
+        return status;
+    }
+
+    token = jtok_alloc_token(parser);
+    if (token == NULL) /* not enough tokens provided by caller */
+    {
+        parser->pos = start;
+        return JTOK_PARSE_STATUS_NOMEM;
+    }
+    jtok_fill_token(token, JTOK_PRIMITIVE, start, parser->pos);
+
+    token->parent = parser->toksuper;
+
+    /* Go back 1 spot so when we return from current function, the
+     * calling context can look at the current character
      *
-     * Currently we're pretty much re-parsing each token to determine a subtype
+     * This is because if the token terminates on a '}', it
+     * may also terminate a superior token as well (such as a
+     * higher level object in the given example)
      */
+    parser->pos--;
+    return JTOK_PARSE_STATUS_OK;
+}
+
 
-    bool           is_equal = false;
-    uint_least16_t len1     = jtok_toklen(tkn1);
-    uint_least16_t len2     = jtok_toklen(tkn2);
-    uint_least16_t min_len  = len1;
-    if (min_len > len2)
+bool jtok_primitive_todouble(const jtok_tkn_t *tkn, double *value)
+{
+    /* Token text is not nul-terminated so copy it out before strtod */
+    char   buf[JTOK_PRIMITIVE_MAX_NUMBER_LEN + 1];
+    char * endptr;
+    size_t len = jtok_toklen(tkn);
+    if (len == 0 || len > JTOK_PRIMITIVE_MAX_NUMBER_LEN || tkn->json == NULL)
     {
-        min_len = len2;
+        return false;
     }
 
+    memcpy(buf, &tkn->json[tkn->start], len);
+    buf[len] = '\0';
+    *value   = strtod(buf, &endptr);
+    return endptr == &buf[len];
+}
 
-    const char *start1 = &tkn1->json[tkn1->start];
-    const char *start2 = &tkn2->json[tkn2->start];
 
-    if (0 == strncmp("true", start1, min_len) &&
-        0 == strncmp("true", start2, min_len))
+bool jtok_primitive_tointeger(const jtok_tkn_t *tkn, bool *negative,
+                              uint64_t *magnitude)
+{
+    const char *pos;
+    const char *end;
+    uint64_t    value = 0;
+    if (tkn->json == NULL || tkn->end <= tkn->start)
     {
-        is_equal = true;
+        return false;
     }
-    else if (0 == strncmp("false", start1, min_len) &&
-             0 == strncmp("false", start2, min_len))
+
+    pos       = &tkn->json[tkn->start];
+    end       = &tkn->json[tkn->end];
+    *negative = (*pos == '-');
+    if (*pos == '-' || *pos == '+')
     {
-        is_equal = true;
+        pos++;
     }
-    else if (0 == strncmp("null", start1, min_len) &&
-             0 == strncmp("null", start2, min_len))
+    if (pos == end)
     {
-        is_equal = true;
+        return false;
     }
-    else
+    for (; pos < end; pos++)
     {
-        /* Token isn't 'true', 'false', or 'null', need to parse it as a number
-         *
-         * Again, since we don't store the subtypes, we have to assume
-         * its a real number and do all the operations with ungodly
-         * floating precision arithmetic
-         */
-        const char *end1 = &tkn1->json[tkn1->end];
-        const char *end2 = &tkn2->json[tkn2->end];
+        unsigned digit = (unsigned)(*pos - '0');
+        if (digit > 9 || value > (UINT64_MAX - digit) / 10)
+        {
+            return false;
+        }
+        value = value * 10 + digit;
+    }
+    *magnitude = value;
+    return true;
+}
 
-        float val1;
-        float val2;
-        char *endptr1 = (char *)start1;
-        char *endptr2 = (char *)start2;
 
-        val1 = strtof(start1, &endptr1);
-        val2 = strtof(start2, &endptr2);
-        if (endptr2 == end2) /* if first tkn was parsed correctly */
+bool jtok_toktokcmp_primitive(const jtok_tkn_t *tkn1, const jtok_tkn_t *tkn2)
+{
+    bool   is_equal = false;
+    size_t len1     = jtok_toklen(tkn1);
+    size_t len2     = jtok_toklen(tkn2);
+
+    if (len1 == 0 || len2 == 0)
+    {
+        is_equal = false;
+    }
+    else if (!jtok_primitive_is_number(tkn1) || !jtok_primitive_is_number(tkn2))
+    {
+        /* 'true', 'false' and 'null' only ever equal themselves */
+        is_equal = (len1 == len2) && (0 == memcmp(&tkn1->json[tkn1->start],
+                                                  &tkn2->json[tkn2->start],
+                                                  len1));
+    }
+    else
+    {
+        /* Numbers compare by value so 1, +1, 1.0 and 1e0 are all equal */
+        double val1;
+        double val2;
+        if (jtok_primitive_todouble(tkn1, &val1) &&
+            jtok_primitive_todouble(tkn2, &val2))
         {
-            if (endptr1 == end1) /* if second tkn was parsed correctly */
-            {
-                if ((val1 - val2) < FLT_EPSILON)
-                {
-                    is_equal = true;
-                }
-            }
+            is_equal = (val1 == val2);
         }
     }
 
     return is_equal;
-}
\ No newline at end of file
+}
+
+
+bool jtok_primitive_is_number(const jtok_tkn_t *tkn)
+{
+    bool is_number = false;
+    if (tkn != NULL && tkn->json != NULL && tkn->end > tkn->start)
+    {
+        char first = tkn->json[tkn->start];
+        is_number  = (first == '-' || first == '+' || isdigit((int)first));
+    }
+    return is_number;
+}
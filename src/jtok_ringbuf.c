@@ -0,0 +1,173 @@
+/**
+ * @file jtok_ringbuf.c
+ * @author Carl Mattatall (cmattatall2@gmail.com)
+ * @brief Source module to parse messages in a ring buffer
+ * @version 0.1
+ * @date 2021-05-16
+ *
+ * @copyright Copyright (c) 2021 Carl Mattatall
+ *
+ */
+
+#include <string.h>
+
+#include "jtok.h"
+#include "jtok_iov.h"
+#include "jtok_ringbuf.h"
+#include "jtok_segments.h"
+
+
+/* Turn a token's stream offsets into ring positions */
+static void jtok_ringbuf_place(const jtok_ringbuf_t *ring, jtok_tkn_t *tkn)
+{
+    size_t start = ring->head + (size_t)tkn->start;
+    size_t lo    = (tkn->type == JTOK_STRING) ? start - 1 : start;
+    size_t shift = 0;
+
+    /* Text that starts (quote included) past the wrap is addressed from
+     * the beginning of the storage, so it never looks wrapped */
+    if (lo >= ring->capacity)
+    {
+        shift = ring->capacity;
+    }
+    tkn->json  = (char *)ring->base;
+    tkn->start = (jtok_off_t)(start - shift);
+    if (tkn->end != JTOK_INVALID_ARRAY_INDEX)
+    {
+        tkn->end = (jtok_off_t)(ring->head + (size_t)tkn->end - shift);
+    }
+}
+
+
+/**
+ * @brief Split the text of a token at the wrap
+ *
+ * @param ring the ring
+ * @param tkn the token
+ * @param piece where the two pieces of text are stored
+ * @param len where their lengths are stored. The second may be 0.
+ */
+static void jtok_ringbuf_pieces(const jtok_ringbuf_t *ring,
+                                const jtok_tkn_t *tkn, const char *piece[2],
+                                size_t len[2])
+{
+    size_t start = (size_t)tkn->start;
+    size_t total = jtok_toklen(tkn);
+
+    if (start >= ring->capacity)
+    {
+        start -= ring->capacity;
+    }
+    len[0] = total;
+    len[1] = 0;
+    if (start + total > ring->capacity)
+    {
+        len[0] = ring->capacity - start;
+        len[1] = total - len[0];
+    }
+    piece[0] = &ring->base[start];
+    piece[1] = ring->base;
+}
+
+
+JTOK_PARSE_STATUS_t jtok_parse_ringbuf(const jtok_ringbuf_t *ring,
+                                       jtok_tkn_t *tkns, size_t size)
+{
+    return jtok_parse_ringbuf_scratch(ring, tkns, size, NULL, 0);
+}
+
+
+JTOK_PARSE_STATUS_t jtok_parse_ringbuf_scratch(const jtok_ringbuf_t *ring,
+                                               jtok_tkn_t *tkns, size_t size,
+                                               char *scratch,
+                                               size_t scratch_len)
+{
+    char                window[JTOK_RINGBUF_WINDOW];
+    char *              stitch     = window;
+    size_t              stitch_len = sizeof(window);
+    jtok_iov_t          segments[2];
+    size_t              count = 1;
+    size_t              written;
+    size_t              i;
+    JTOK_PARSE_STATUS_t status;
+
+    if (ring == NULL || ring->base == NULL || tkns == NULL)
+    {
+        return JTOK_PARSE_STATUS_NULL_PARAM;
+    }
+    if (ring->head >= ring->capacity || ring->tail >= ring->capacity ||
+        ring->capacity > (size_t)JTOK_OFF_MAX / 2)
+    {
+        /* Positions of wrapped text run up to twice the capacity */
+        return JTOK_PARSE_STATUS_INVAL;
+    }
+
+    segments[0].base = &ring->base[ring->head];
+    segments[0].len  = ring->tail - ring->head;
+    if (ring->tail < ring->head)
+    {
+        segments[0].len  = ring->capacity - ring->head;
+        segments[1].base = ring->base;
+        segments[1].len  = ring->tail;
+        count            = 2;
+    }
+
+    if (scratch != NULL && scratch_len > stitch_len)
+    {
+        stitch     = scratch;
+        stitch_len = scratch_len;
+    }
+    status = jtok_parse_segments(segments, count, tkns, size, stitch,
+                                 stitch_len, true, &written);
+    for (i = 0; status == JTOK_PARSE_STATUS_OK && i < written; i++)
+    {
+        jtok_ringbuf_place(ring, &tkns[i]);
+    }
+    return status;
+}
+
+
+bool jtok_ringbuf_tokcmp(const jtok_ringbuf_t *ring, const char *str,
+                         const jtok_tkn_t *tok)
+{
+    const char *piece[2];
+    size_t      len[2];
+
+    if (str == NULL)
+    {
+        return tok != NULL && tok->json == NULL;
+    }
+    if (ring == NULL || tok == NULL || tok->json == NULL ||
+        strlen(str) != jtok_toklen(tok))
+    {
+        return false;
+    }
+    jtok_ringbuf_pieces(ring, tok, piece, len);
+    return 0 == memcmp(str, piece[0], len[0]) &&
+           0 == memcmp(&str[len[0]], piece[1], len[1]);
+}
+
+
+char *jtok_ringbuf_tokcpy(const jtok_ringbuf_t *ring, char *dst,
+                          size_t bufsize, const jtok_tkn_t *tkn)
+{
+    const char *piece[2];
+    size_t      len[2];
+
+    if (ring == NULL || dst == NULL || tkn == NULL || tkn->json == NULL)
+    {
+        return NULL;
+    }
+    jtok_ringbuf_pieces(ring, tkn, piece, len);
+    if (len[0] > bufsize)
+    {
+        len[0] = bufsize;
+    }
+    if (len[1] > bufsize - len[0])
+    {
+        len[1] = bufsize - len[0];
+    }
+    memcpy(dst, piece[0], len[0]);
+    memcpy(&dst[len[0]], piece[1], len[1]);
+    return dst;
+}
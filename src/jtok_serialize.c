@@ -0,0 +1,103 @@
+/**
+ * @file jtok_serialize.c
+ * @author Carl Mattatall (cmattatall2@gmail.com)
+ * @brief Source module to re-serialize token subtrees by splicing the
+ * original source text instead of rebuilding it token by token
+ * @version 0.1
+ * @date 2021-05-02
+ *
+ * @copyright Copyright (c) 2021 Carl Mattatall
+ *
+ */
+
+#include <string.h>
+
+#include "jtok.h"
+#include "jtok_shared.h"
+
+
+/**
+ * @brief Find the splice whose target starts first at or after pos
+ *
+ * @param splices the splices
+ * @param count number of splices
+ * @param json source text of the subtree being emitted
+ * @param pos first byte not yet emitted
+ * @param end end of the subtree span
+ * @param span_len output location for the length of the target span
+ * @return const jtok_splice_t* the splice, or NULL if none remain
+ *
+ * @note Targets that begin before pos lie inside an already replaced token
+ * (or outside the subtree) and are skipped.
+ */
+static const jtok_splice_t *jtok_next_splice(const jtok_splice_t *splices,
+                                             size_t count, const char *json,
+                                             const char *pos, const char *end,
+                                             size_t *span_len)
+{
+    const jtok_splice_t *next       = NULL;
+    const char *         next_start = NULL;
+    size_t               i;
+    for (i = 0; i < count; i++)
+    {
+        size_t      len;
+        const char *start = jtok_tokspan(splices[i].target, &len);
+        if (start != NULL && splices[i].target->json == json && start >= pos &&
+            start + len <= end && (next == NULL || start < next_start))
+        {
+            next       = &splices[i];
+            next_start = start;
+            *span_len  = len;
+        }
+    }
+    return next;
+}
+
+
+JTOK_WRITE_STATUS_t jtok_serialize(const jtok_tkn_t *tkn,
+                                   const jtok_splice_t *splices, size_t count,
+                                   jtok_write_fn write, void *ctx)
+{
+    size_t      len;
+    const char *pos;
+    const char *end;
+    if (tkn == NULL || write == NULL || (splices == NULL && count != 0))
+    {
+        return JTOK_WRITE_STATUS_NULL_PARAM;
+    }
+
+    pos = jtok_tokspan(tkn, &len);
+    if (pos == NULL)
+    {
+        return JTOK_WRITE_STATUS_INVAL;
+    }
+    end = pos + len;
+
+    while (pos < end)
+    {
+        size_t               span_len = 0;
+        const jtok_splice_t *splice =
+            jtok_next_splice(splices, count, tkn->json, pos, end, &span_len);
+        const char *stop = end;
+        if (splice != NULL)
+        {
+            stop = jtok_tokspan(splice->target, &span_len);
+        }
+
+        /* Everything up to the next replaced token is copied in one piece */
+        if (stop > pos && 0 != write(ctx, pos, (size_t)(stop - pos)))
+        {
+            return JTOK_WRITE_STATUS_SINK_ERROR;
+        }
+        if (splice == NULL)
+        {
+            break;
+        }
+        if (splice->len > 0 && 0 != write(ctx, splice->text, splice->len))
+        {
+            return JTOK_WRITE_STATUS_SINK_ERROR;
+        }
+        pos = stop + span_len;
+    }
+    return JTOK_WRITE_STATUS_OK;
+}
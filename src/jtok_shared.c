@@ -18,7 +18,8 @@
 #include "jtok_shared.h"
 
 
-int jtok_fill_token(jtok_tkn_t *token, JTOK_TYPE_t type, int start, int end)
+int jtok_fill_token(jtok_tkn_t *token, JTOK_TYPE_t type, jtok_off_t start,
+                    jtok_off_t end)
 {
     if (token != NULL)
     {
@@ -38,7 +39,7 @@ int jtok_fill_token(jtok_tkn_t *token, JTOK_TYPE_t type, int start, int end)
 jtok_tkn_t *jtok_alloc_token(jtok_parser_t *parser)
 {
     jtok_tkn_t *tok;
-    if (parser->toknext >= (int)parser->pool_size)
+    if (parser->toknext >= parser->pool_size)
     {
         return NULL;
     }
@@ -51,3 +52,88 @@ jtok_tkn_t *jtok_alloc_token(jtok_parser_t *parser)
     tok->sibling          = JTOK_NO_SIBLING_IDX;
     return tok;
 }
+
+
+const char *jtok_tokspan(const jtok_tkn_t *token, size_t *len)
+{
+    const char *span = NULL;
+    *len             = 0;
+    if (token != NULL && token->json != NULL && token->end >= token->start &&
+        token->start >= 0)
+    {
+        jtok_off_t start = token->start;
+        jtok_off_t end   = token->end;
+        if (token->type == JTOK_STRING)
+        {
+            /* String tokens exclude their quotes */
+            start--;
+            end++;
+        }
+        span = &token->json[start];
+        *len = (size_t)(end - start);
+    }
+    return span;
+}
+
+
+int jtok_keycmp(const jtok_tkn_t *key1, const jtok_tkn_t *key2)
+{
+    jtok_off_t len1 = key1->end - key1->start;
+    jtok_off_t len2 = key2->end - key2->start;
+    if (len1 != len2)
+    {
+        return (len1 < len2) ? -1 : 1;
+    }
+    return memcmp(&key1->json[key1->start], &key2->json[key2->start],
+                  (size_t)len1);
+}
+
+
+static void jtok_sift_down(const jtok_tkn_t *pool, jtok_off_t *idx, size_t root,
+                           size_t count,
+                           int (*cmp)(const jtok_tkn_t *, const jtok_tkn_t *))
+{
+    size_t child;
+    while ((child = 2 * root + 1) < count)
+    {
+        if (child + 1 < count &&
+            cmp(&pool[idx[child]], &pool[idx[child + 1]]) < 0)
+        {
+            child++;
+        }
+
+        if (cmp(&pool[idx[root]], &pool[idx[child]]) >= 0)
+        {
+            break;
+        }
+
+        jtok_off_t tmp = idx[root];
+        idx[root]      = idx[child];
+        idx[child]     = tmp;
+        root           = child;
+    }
+}
+
+
+void jtok_sort_tokens(const jtok_tkn_t *pool, jtok_off_t *idx, size_t count,
+                      int (*cmp)(const jtok_tkn_t *, const jtok_tkn_t *))
+{
+    size_t i;
+    if (count < 2)
+    {
+        return;
+    }
+
+    for (i = count / 2; i > 0; i--)
+    {
+        jtok_sift_down(pool, idx, i - 1, count, cmp);
+    }
+
+    for (i = count - 1; i > 0; i--)
+    {
+        jtok_off_t tmp = idx[0];
+        idx[0]         = idx[i];
+        idx[i]         = tmp;
+        jtok_sift_down(pool, idx, 0, i, cmp);
+    }
+}
@@ -21,9 +21,9 @@ JTOK_PARSE_STATUS_t jtok_parse_string(jtok_parser_t *parser)
 {
     jtok_tkn_t *token;
     jtok_tkn_t *tokens = parser->tkn_pool;
-    int         start;
+    jtok_off_t  start;
     char *      js  = parser->json;
-    int         len = parser->json_len;
+    jtok_off_t  len = parser->json_len;
     if (js[parser->pos] == '\"' || js[parser->pos] == '\'')
     {
         char start_char = js[parser->pos];
@@ -122,8 +122,8 @@ JTOK_PARSE_STATUS_t jtok_parse_string(jtok_parser_t *parser)
 
 bool jtok_toktokcmp_string(const jtok_tkn_t *tkn1, const jtok_tkn_t *tkn2)
 {
-    bool           is_equal = false;
-    uint_least16_t len      = jtok_toklen(tkn1);
+    bool   is_equal = false;
+    size_t len      = jtok_toklen(tkn1);
     if (len == jtok_toklen(tkn2))
     {
         const char *start1 = &tkn1->json[tkn1->start];
@@ -135,3 +135,198 @@ bool jtok_toktokcmp_string(const jtok_tkn_t *tkn1, const jtok_tkn_t *tkn2)
     }
     return is_equal;
 }
+
+
+static long jtok_string_hex4(const char *p, const char *end)
+{
+    long value = 0;
+    int  i;
+    if (end - p < HEXCHAR_ESCAPE_SEQ_COUNT)
+    {
+        return JTOK_STRING_INVALID;
+    }
+    for (i = 0; i < HEXCHAR_ESCAPE_SEQ_COUNT; i++)
+    {
+        char c = p[i];
+        value <<= 4;
+        if (c >= '0' && c <= '9')
+        {
+            value |= c - '0';
+        }
+        else if ((c | 0x20) >= 'a' && (c | 0x20) <= 'f')
+        {
+            value |= (c | 0x20) - 'a' + 10;
+        }
+        else
+        {
+            return JTOK_STRING_INVALID;
+        }
+    }
+    return value;
+}
+
+
+long jtok_string_next_cp(const char **pos, const char *end)
+{
+    const unsigned char *p = (const unsigned char *)*pos;
+    long                 cp;
+    int                  extra;
+    int                  i;
+    if (*pos >= end)
+    {
+        return JTOK_STRING_END;
+    }
+
+    if (*p == '\\')
+    {
+        if (end - *pos < 2)
+        {
+            return JTOK_STRING_INVALID;
+        }
+        *pos += 2;
+        switch (p[1])
+        {
+            case '\"':
+            case '\\':
+            case '/':
+            {
+                return p[1];
+            }
+            break;
+            case 'b':
+            {
+                return '\b';
+            }
+            break;
+            case 'f':
+            {
+                return '\f';
+            }
+            break;
+            case 'n':
+            {
+                return '\n';
+            }
+            break;
+            case 'r':
+            {
+                return '\r';
+            }
+            break;
+            case 't':
+            {
+                return '\t';
+            }
+            break;
+            case 'u':
+            {
+                cp = jtok_string_hex4(*pos, end);
+                if (cp < 0)
+                {
+                    return JTOK_STRING_INVALID;
+                }
+                *pos += HEXCHAR_ESCAPE_SEQ_COUNT;
+                if (cp >= 0xDC00 && cp <= 0xDFFF)
+                {
+                    return JTOK_STRING_INVALID; /* lone low surrogate */
+                }
+                if (cp >= 0xD800 && cp <= 0xDBFF)
+                {
+                    long low;
+                    if (end - *pos < 2 || (*pos)[0] != '\\' || (*pos)[1] != 'u')
+                    {
+                        return JTOK_STRING_INVALID;
+                    }
+                    low = jtok_string_hex4(*pos + 2, end);
+                    if (low < 0xDC00 || low > 0xDFFF)
+                    {
+                        return JTOK_STRING_INVALID;
+                    }
+                    *pos += 2 + HEXCHAR_ESCAPE_SEQ_COUNT;
+                    cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                }
+                return cp;
+            }
+            break;
+            default:
+            {
+                return JTOK_STRING_INVALID;
+            }
+            break;
+        }
+    }
+
+    /* Raw utf-8 */
+    if (*p < 0x80)
+    {
+        *pos += 1;
+        return *p;
+    }
+    else if ((*p & 0xE0) == 0xC0)
+    {
+        cp    = *p & 0x1F;
+        extra = 1;
+    }
+    else if ((*p & 0xF0) == 0xE0)
+    {
+        cp    = *p & 0x0F;
+        extra = 2;
+    }
+    else if ((*p & 0xF8) == 0xF0)
+    {
+        cp    = *p & 0x07;
+        extra = 3;
+    }
+    else
+    {
+        return JTOK_STRING_INVALID;
+    }
+    if (end - *pos <= extra)
+    {
+        return JTOK_STRING_INVALID;
+    }
+    for (i = 1; i <= extra; i++)
+    {
+        if ((p[i] & 0xC0) != 0x80)
+        {
+            return JTOK_STRING_INVALID;
+        }
+        cp = (cp << 6) | (p[i] & 0x3F);
+    }
+    *pos += 1 + extra;
+    if (cp > 0x10FFFF || (cp >= 0xD800 && cp <= 0xDFFF) ||
+        cp < ((extra == 1) ? 0x80 : (extra == 2) ? 0x800 : 0x10000))
+    {
+        return JTOK_STRING_INVALID;
+    }
+    return cp;
+}
+
+
+int jtok_string_put_utf8(long cp, char *out)
+{
+    int len = 0;
+    if (cp < 0x80)
+    {
+        out[len++] = (char)cp;
+    }
+    else if (cp < 0x800)
+    {
+        out[len++] = (char)(0xC0 | (cp >> 6));
+        out[len++] = (char)(0x80 | (cp & 0x3F));
+    }
+    else if (cp < 0x10000)
+    {
+        out[len++] = (char)(0xE0 | (cp >> 12));
+        out[len++] = (char)(0x80 | ((cp >> 6) & 0x3F));
+        out[len++] = (char)(0x80 | (cp & 0x3F));
+    }
+    else
+    {
+        out[len++] = (char)(0xF0 | (cp >> 18));
+        out[len++] = (char)(0x80 | ((cp >> 12) & 0x3F));
+        out[len++] = (char)(0x80 | ((cp >> 6) & 0x3F));
+        out[len++] = (char)(0x80 | (cp & 0x3F));
+    }
+    return len;
+}
@@ -0,0 +1,540 @@
+/**
+ * @file jtok_tape.c
+ * @author Carl Mattatall (cmattatall2@gmail.com)
+ * @brief Source module to save parsed documents as relocatable binary tapes
+ * and to navigate them in place
+ * @version 0.1
+ * @date 2021-05-08
+ *
+ * @copyright Copyright (c) 2021 Carl Mattatall
+ *
+ */
+
+#include <string.h>
+
+#if defined(JTOK_HAVE_POSIX)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif /* #if defined(JTOK_HAVE_POSIX) */
+
+#include "jtok.h"
+#include "jtok_tape.h"
+#include "jtok_shared.h"
+#include "jtok_primitive.h"
+
+/* Tokens and numbers are converted in batches of this many per write */
+#define JTOK_TAPE_BATCH 32
+
+#define JTOK_TAPE_ALIGN(x) (((x) + 7u) & ~(uint64_t)7u)
+
+/* Longest chain of ancestors a token can have: a container and a key for
+ * every level of nesting, then the root */
+#define JTOK_TAPE_DEPTH_MAX (2 * (JTOK_MAX_RECURSE_DEPTH + 1) + 1)
+
+typedef struct
+{
+    jtok_write_fn       write;
+    void *              ctx;
+    JTOK_WRITE_STATUS_t status;
+} jtok_tape_out_t;
+
+/* An open ancestor and the first token after its subtree */
+typedef struct
+{
+    size_t idx;
+    size_t next;
+} jtok_tape_link_t;
+
+
+static bool jtok_tape_emit(jtok_tape_out_t *out, const void *data, size_t len)
+{
+    if (out->status == JTOK_WRITE_STATUS_OK && len > 0)
+    {
+        if (0 != out->write(out->ctx, (const char *)data, len))
+        {
+            out->status = JTOK_WRITE_STATUS_SINK_ERROR;
+        }
+    }
+    return out->status == JTOK_WRITE_STATUS_OK;
+}
+
+
+/**
+ * @brief Index of the first token after the subtree rooted at pool[idx].
+ * A key's subtree includes its value.
+ *
+ * @note This scans the subtree, so it is only used to find where the
+ * document ends. Per-token ends come from the sibling links.
+ */
+static size_t jtok_tape_subtree_end(const jtok_tkn_t *pool, size_t count,
+                                    size_t idx)
+{
+    const jtok_tkn_t *tkn = &pool[idx];
+    size_t            next;
+    if (jtok_tokenIsKey(*tkn) && idx + 1 < count)
+    {
+        return jtok_tape_subtree_end(pool, count, idx + 1);
+    }
+    next = idx + 1;
+    if (tkn->type == JTOK_OBJECT || tkn->type == JTOK_ARRAY)
+    {
+        /* Descendants are the following tokens that start inside the span */
+        while (next < count && pool[next].start < tkn->end)
+        {
+            next++;
+        }
+    }
+    return next;
+}
+
+
+static bool jtok_tape_is_number(const jtok_tkn_t *tkn, double *value)
+{
+    return tkn->type == JTOK_PRIMITIVE && jtok_primitive_is_number(tkn) &&
+           jtok_primitive_todouble(tkn, value);
+}
+
+
+JTOK_WRITE_STATUS_t jtok_tape_write(const jtok_tkn_t *pool, size_t count,
+                                    jtok_write_fn write, void *ctx)
+{
+    static const char  padding[8] = {0};
+    jtok_tape_header_t header;
+    jtok_tape_out_t    out = {write, ctx, JTOK_WRITE_STATUS_OK};
+    size_t             token_count;
+    size_t             number_count = 0;
+    size_t             i;
+    double             value;
+
+    if (pool == NULL || write == NULL || count == 0)
+    {
+        return JTOK_WRITE_STATUS_NULL_PARAM;
+    }
+    if (pool->json == NULL || pool->start < 0 || pool->end < pool->start ||
+        (pool->type != JTOK_OBJECT && pool->type != JTOK_ARRAY))
+    {
+        return JTOK_WRITE_STATUS_INVAL;
+    }
+
+    token_count = jtok_tape_subtree_end(pool, count, 0);
+    for (i = 0; i < token_count; i++)
+    {
+        if (pool[i].type == JTOK_UNASSIGNED_TOKEN)
+        {
+            token_count = i;
+            break;
+        }
+        if (jtok_tape_is_number(&pool[i], &value))
+        {
+            number_count++;
+        }
+    }
+    if ((uint64_t)pool->end >= UINT32_MAX || token_count >= INT32_MAX)
+    {
+        /* Offsets and indices are stored in 32 bits, indices signed */
+        return JTOK_WRITE_STATUS_NOMEM;
+    }
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, JTOK_TAPE_MAGIC, sizeof(header.magic));
+    header.version       = JTOK_TAPE_VERSION;
+    header.endian        = JTOK_TAPE_ENDIAN;
+    header.token_count   = (uint32_t)token_count;
+    header.number_count  = (uint32_t)number_count;
+    header.text_len      = (uint32_t)pool->end; /* text keeps its offsets */
+    header.token_offset  = JTOK_TAPE_ALIGN(sizeof(header));
+    header.number_offset = header.token_offset +
+                           token_count * sizeof(jtok_tape_tkn_t);
+    header.text_offset = header.number_offset + number_count * sizeof(double);
+    header.file_size   = JTOK_TAPE_ALIGN(header.text_offset +
+                                         header.text_len + 1);
+    jtok_tape_emit(&out, &header, sizeof(header));
+    jtok_tape_emit(&out, padding, header.token_offset - sizeof(header));
+
+    /* Tokens. A subtree ends at the next sibling, or failing that where its
+     * nearest ancestor with a sibling ends. The ancestors are on a stack,
+     * so every end is found in O(1). */
+    {
+        jtok_tape_tkn_t  batch[JTOK_TAPE_BATCH];
+        jtok_tape_link_t stack[JTOK_TAPE_DEPTH_MAX];
+        size_t           depth  = 0;
+        size_t           used   = 0;
+        uint32_t         number = 0;
+        size_t           next;
+        for (i = 0; i < token_count && out.status == JTOK_WRITE_STATUS_OK; i++)
+        {
+            jtok_tape_tkn_t *t = &batch[used++];
+            while (depth > 0 &&
+                   (jtok_off_t)stack[depth - 1].idx != pool[i].parent)
+            {
+                depth--;
+            }
+            if (pool[i].sibling != JTOK_NO_SIBLING_IDX)
+            {
+                next = (size_t)pool[i].sibling;
+            }
+            else
+            {
+                next = (depth > 0) ? stack[depth - 1].next : token_count;
+            }
+            if (pool[i].size > 0)
+            {
+                if (depth == JTOK_TAPE_DEPTH_MAX)
+                {
+                    out.status = JTOK_WRITE_STATUS_NEST_DEPTH_EXCEEDED;
+                    break;
+                }
+                stack[depth].idx    = i;
+                stack[depth++].next = next;
+            }
+
+            memset(t, 0, sizeof(*t));
+            t->start   = (uint32_t)pool[i].start;
+            t->end     = (uint32_t)pool[i].end;
+            t->size    = (int32_t)pool[i].size;
+            t->parent  = (int32_t)pool[i].parent;
+            t->sibling = (int32_t)pool[i].sibling;
+            t->next    = (uint32_t)next;
+            t->number  = JTOK_TAPE_NONE;
+            t->type    = (uint8_t)pool[i].type;
+            if (jtok_tape_is_number(&pool[i], &value))
+            {
+                t->number = number++;
+            }
+            if (used == JTOK_TAPE_BATCH)
+            {
+                jtok_tape_emit(&out, batch, sizeof(batch));
+                used = 0;
+            }
+        }
+        jtok_tape_emit(&out, batch, used * sizeof(*batch));
+    }
+
+    /* Numbers, decoded once here instead of by every reader */
+    {
+        double batch[JTOK_TAPE_BATCH];
+        size_t used = 0;
+        for (i = 0; i < token_count && out.status == JTOK_WRITE_STATUS_OK; i++)
+        {
+            if (jtok_tape_is_number(&pool[i], &batch[used]))
+            {
+                if (++used == JTOK_TAPE_BATCH)
+                {
+                    jtok_tape_emit(&out, batch, sizeof(batch));
+                    used = 0;
+                }
+            }
+        }
+        jtok_tape_emit(&out, batch, used * sizeof(*batch));
+    }
+
+    /* Text, then its nul and padding to the file size */
+    jtok_tape_emit(&out, pool->json, header.text_len);
+    jtok_tape_emit(&out, padding,
+                   header.file_size - header.text_offset - header.text_len);
+    return out.status;
+}
+
+
+JTOK_PARSE_STATUS_t jtok_tape_open(jtok_tape_t *tape, const void *data,
+                                   size_t len)
+{
+    const jtok_tape_header_t *header = data;
+    const char *              base   = data;
+    if (tape == NULL || data == NULL)
+    {
+        return JTOK_PARSE_STATUS_NULL_PARAM;
+    }
+    memset(tape, 0, sizeof(*tape));
+    if (((uintptr_t)data & 7u) != 0 || len < sizeof(*header) ||
+        0 != memcmp(header->magic, JTOK_TAPE_MAGIC, sizeof(header->magic)) ||
+        header->version != JTOK_TAPE_VERSION ||
+        header->endian != JTOK_TAPE_ENDIAN || header->file_size > len)
+    {
+        return JTOK_PARSE_STATUS_INVAL;
+    }
+
+    /* Every section must be aligned, in order and inside the file. Each
+     * bound is checked against the room left so no sum can overflow. */
+    if ((header->token_offset & 7u) != 0 || (header->number_offset & 7u) != 0 ||
+        header->token_offset < sizeof(*header) ||
+        header->token_offset > header->file_size ||
+        header->token_count > (header->file_size - header->token_offset) /
+                                  sizeof(jtok_tape_tkn_t) ||
+        header->number_offset < header->token_offset +
+                                    (uint64_t)header->token_count *
+                                        sizeof(jtok_tape_tkn_t) ||
+        header->number_offset > header->file_size ||
+        header->number_count > (header->file_size - header->number_offset) /
+                                   sizeof(double) ||
+        header->text_offset < header->number_offset +
+                                  (uint64_t)header->number_count *
+                                      sizeof(double) ||
+        header->text_offset >= header->file_size ||
+        header->file_size - header->text_offset <= header->text_len ||
+        base[header->text_offset + header->text_len] != '\0')
+    {
+        return JTOK_PARSE_STATUS_INVAL;
+    }
+
+    tape->header  = header;
+    tape->tokens  = (const jtok_tape_tkn_t *)(base + header->token_offset);
+    tape->numbers = (const double *)(base + header->number_offset);
+    tape->text    = base + header->text_offset;
+    return JTOK_PARSE_STATUS_OK;
+}
+
+
+JTOK_PARSE_STATUS_t jtok_tape_map(jtok_tape_t *tape, const char *path)
+{
+#if defined(JTOK_HAVE_POSIX)
+    JTOK_PARSE_STATUS_t status;
+    struct stat         st;
+    void *              map;
+    int                 fd;
+    if (tape == NULL || path == NULL)
+    {
+        return JTOK_PARSE_STATUS_NULL_PARAM;
+    }
+    memset(tape, 0, sizeof(*tape));
+
+    fd = open(path, O_RDONLY);
+    if (fd < 0)
+    {
+        return JTOK_PARSE_STATUS_IO_ERROR;
+    }
+    if (fstat(fd, &st) != 0 || st.st_size <= 0)
+    {
+        close(fd);
+        return JTOK_PARSE_STATUS_IO_ERROR;
+    }
+    map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+    {
+        return JTOK_PARSE_STATUS_IO_ERROR;
+    }
+
+    status = jtok_tape_open(tape, map, (size_t)st.st_size);
+    if (status != JTOK_PARSE_STATUS_OK)
+    {
+        munmap(map, (size_t)st.st_size);
+        return status;
+    }
+    tape->map     = map;
+    tape->map_len = (size_t)st.st_size;
+    return JTOK_PARSE_STATUS_OK;
+#else
+    (void)path;
+    if (tape != NULL)
+    {
+        memset(tape, 0, sizeof(*tape));
+    }
+    return JTOK_PARSE_STATUS_IO_ERROR;
+#endif /* #if defined(JTOK_HAVE_POSIX) */
+}
+
+
+void jtok_tape_unmap(jtok_tape_t *tape)
+{
+    if (tape != NULL)
+    {
+#if defined(JTOK_HAVE_POSIX)
+        if (tape->map != NULL)
+        {
+            munmap(tape->map, tape->map_len);
+        }
+#endif /* #if defined(JTOK_HAVE_POSIX) */
+        memset(tape, 0, sizeof(*tape));
+    }
+}
+
+
+const jtok_tape_tkn_t *jtok_tape_token(const jtok_tape_t *tape, uint32_t idx)
+{
+    const jtok_tape_tkn_t *tkn;
+    if (tape == NULL || tape->header == NULL ||
+        idx >= tape->header->token_count)
+    {
+        return NULL;
+    }
+    tkn = &tape->tokens[idx];
+    if (tkn->start > tkn->end || tkn->end > tape->header->text_len)
+    {
+        return NULL;
+    }
+    return tkn;
+}
+
+
+const char *jtok_tape_text(const jtok_tape_t *tape, uint32_t idx, size_t *len)
+{
+    const jtok_tape_tkn_t *tkn = jtok_tape_token(tape, idx);
+    if (tkn == NULL)
+    {
+        *len = 0;
+        return NULL;
+    }
+    *len = tkn->end - tkn->start;
+    return &tape->text[tkn->start];
+}
+
+
+bool jtok_tape_number(const jtok_tape_t *tape, uint32_t idx, double *value)
+{
+    const jtok_tape_tkn_t *tkn = jtok_tape_token(tape, idx);
+    if (tkn == NULL || tkn->number >= tape->header->number_count)
+    {
+        return false;
+    }
+    *value = tape->numbers[tkn->number];
+    return true;
+}
+
+
+/**
+ * @brief First child of a container, following the jtok pool layout
+ */
+static uint32_t jtok_tape_first_child(const jtok_tape_t *tape, uint32_t idx,
+                                      JTOK_TYPE_t type)
+{
+    const jtok_tape_tkn_t *tkn = jtok_tape_token(tape, idx);
+    if (tkn == NULL || tkn->type != type || tkn->size <= 0)
+    {
+        return JTOK_TAPE_NONE;
+    }
+    return idx + 1;
+}
+
+
+static uint32_t jtok_tape_next_sibling(const jtok_tape_t *tape, uint32_t idx)
+{
+    const jtok_tape_tkn_t *tkn = jtok_tape_token(tape, idx);
+    if (tkn == NULL || tkn->sibling < 0 || (uint32_t)tkn->sibling <= idx)
+    {
+        /* Siblings always come later in the pool. Anything else is corrupt */
+        return JTOK_TAPE_NONE;
+    }
+    return (uint32_t)tkn->sibling;
+}
+
+
+uint32_t jtok_tape_obj_get(const jtok_tape_t *tape, uint32_t obj,
+                           const char *key, size_t key_len)
+{
+    uint32_t idx = jtok_tape_first_child(tape, obj, JTOK_OBJECT);
+    if (key == NULL)
+    {
+        return JTOK_TAPE_NONE;
+    }
+    for (; idx != JTOK_TAPE_NONE; idx = jtok_tape_next_sibling(tape, idx))
+    {
+        size_t      len;
+        const char *text = jtok_tape_text(tape, idx, &len);
+        if (text != NULL && len == key_len && 0 == memcmp(text, key, len))
+        {
+            return (jtok_tape_token(tape, idx + 1) != NULL) ? idx + 1
+                                                            : JTOK_TAPE_NONE;
+        }
+    }
+    return JTOK_TAPE_NONE;
+}
+
+
+uint32_t jtok_tape_array_get(const jtok_tape_t *tape, uint32_t arr, size_t n)
+{
+    uint32_t idx = jtok_tape_first_child(tape, arr, JTOK_ARRAY);
+    for (; idx != JTOK_TAPE_NONE && n > 0; n--)
+    {
+        idx = jtok_tape_next_sibling(tape, idx);
+    }
+    return idx;
+}
+
+
+/* Check the fields of token i that jtok_tape_to_pool copies into a pool */
+static bool jtok_tape_tkn_valid(const jtok_tape_t *tape,
+                                const jtok_tape_tkn_t *t, uint32_t i)
+{
+    uint32_t count = tape->header->token_count;
+    if (t->type < JTOK_PRIMITIVE || t->type > JTOK_STRING ||
+        t->start > t->end || t->end > tape->header->text_len || t->size < 0)
+    {
+        return false;
+    }
+
+    /* Parents come before their children, siblings after each other */
+    if (t->parent != JTOK_NO_PARENT_IDX &&
+        (t->parent < 0 || (uint32_t)t->parent >= i))
+    {
+        return false;
+    }
+    if (t->sibling != JTOK_NO_SIBLING_IDX &&
+        (t->sibling < 0 || (uint32_t)t->sibling <= i ||
+         (uint32_t)t->sibling >= count))
+    {
+        return false;
+    }
+    return true;
+}
+
+
+JTOK_PARSE_STATUS_t jtok_tape_to_pool(const jtok_tape_t *tape, jtok_tkn_t *tkns,
+                                      size_t size)
+{
+    uint32_t count;
+    uint32_t i;
+    if (tape == NULL || tape->header == NULL || tkns == NULL)
+    {
+        return JTOK_PARSE_STATUS_NULL_PARAM;
+    }
+    count = tape->header->token_count;
+    if (size < count)
+    {
+        return JTOK_PARSE_STATUS_NOMEM;
+    }
+#if JTOK_OFF_MAX < UINT32_MAX
+    if (count > JTOK_OFF_MAX || tape->header->text_len > JTOK_OFF_MAX)
+    {
+        /* Tokens could not index the tape (see JTOK_OFFSET_WIDTH) */
+        return JTOK_PARSE_STATUS_INVAL;
+    }
+#endif /* #if JTOK_OFF_MAX < UINT32_MAX */
+
+    for (i = 0; i < count; i++)
+    {
+        const jtok_tape_tkn_t *t = jtok_tape_token(tape, i);
+        if (t == NULL || !jtok_tape_tkn_valid(tape, t, i))
+        {
+            return JTOK_PARSE_STATUS_INVAL;
+        }
+        tkns[i].start   = (jtok_off_t)t->start;
+        tkns[i].end     = (jtok_off_t)t->end;
+        tkns[i].size    = 0; /* counted from the children below */
+        tkns[i].parent  = (jtok_off_t)t->parent;
+        tkns[i].sibling = (jtok_off_t)t->sibling;
+        tkns[i].type    = (JTOK_TYPE_t)t->type;
+        tkns[i].pool    = tkns;
+        tkns[i].json    = (char *)tape->text;
+        if (t->parent != JTOK_NO_PARENT_IDX)
+        {
+            tkns[t->parent].size++;
+        }
+    }
+
+    /* Sizes are walked as child counts, so must match them exactly */
+    for (i = 0; i < count; i++)
+    {
+        if ((int64_t)tkns[i].size != (int64_t)jtok_tape_token(tape, i)->size)
+        {
+            return JTOK_PARSE_STATUS_INVAL;
+        }
+    }
+    if (size > count)
+    {
+        tkns[count].type = JTOK_UNASSIGNED_TOKEN;
+    }
+    return JTOK_PARSE_STATUS_OK;
+}
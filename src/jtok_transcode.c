@@ -0,0 +1,926 @@
+/**
+ * @file jtok_transcode.c
+ * @author Carl Mattatall (cmattatall2@gmail.com)
+ * @brief Source module to transcode between token pools, MessagePack and CBOR
+ * @version 0.1
+ * @date 2021-05-09
+ *
+ * @copyright Copyright (c) 2021 Carl Mattatall
+ *
+ */
+
+#include <string.h>
+
+#include "jtok.h"
+#include "jtok_transcode.h"
+#include "jtok_shared.h"
+#include "jtok_primitive.h"
+#include "jtok_string.h"
+
+/* Unescaped string bytes are staged in this many bytes before being written.
+ * Escaped strings that unescape to less than this are decoded only once. */
+#define JTOK_XCODE_STAGE 256
+
+typedef enum
+{
+    JTOK_XCODE_MSGPACK,
+    JTOK_XCODE_CBOR,
+} JTOK_XCODE_FORMAT_t;
+
+/* What a length prefix introduces */
+typedef enum
+{
+    JTOK_XCODE_STRING,
+    JTOK_XCODE_ARRAY,
+    JTOK_XCODE_MAP,
+} JTOK_XCODE_HEAD_t;
+
+typedef struct
+{
+    JTOK_XCODE_FORMAT_t format;
+    jtok_write_fn       write;
+    void *              ctx;
+    JTOK_WRITE_STATUS_t status;
+} jtok_xcode_t;
+
+typedef struct
+{
+    const uint8_t *     pos;
+    const uint8_t *     end;
+    jtok_writer_t *     writer;
+    JTOK_WRITE_STATUS_t status;
+} jtok_xdec_t;
+
+
+static bool jtok_xcode_emit(jtok_xcode_t *enc, const void *data, size_t len)
+{
+    if (enc->status == JTOK_WRITE_STATUS_OK && len > 0)
+    {
+        if (0 != enc->write(enc->ctx, (const char *)data, len))
+        {
+            enc->status = JTOK_WRITE_STATUS_SINK_ERROR;
+        }
+    }
+    return enc->status == JTOK_WRITE_STATUS_OK;
+}
+
+
+/**
+ * @brief Emit a marker byte followed by value as a big-endian integer
+ */
+static void jtok_xcode_emit_be(jtok_xcode_t *enc, uint8_t marker,
+                               uint64_t value, int bytes)
+{
+    uint8_t out[1 + sizeof(uint64_t)];
+    int     i;
+    out[0] = marker;
+    for (i = bytes; i > 0; i--)
+    {
+        out[i] = (uint8_t)value;
+        value >>= 8;
+    }
+    jtok_xcode_emit(enc, out, (size_t)(1 + bytes));
+}
+
+
+/**
+ * @brief Emit a CBOR initial byte and argument in the shortest form
+ */
+static void jtok_xcode_cbor_head(jtok_xcode_t *enc, uint8_t major,
+                                 uint64_t value)
+{
+    major <<= 5;
+    if (value < 24)
+    {
+        jtok_xcode_emit_be(enc, major | (uint8_t)value, 0, 0);
+    }
+    else if (value <= UINT8_MAX)
+    {
+        jtok_xcode_emit_be(enc, major | 24, value, 1);
+    }
+    else if (value <= UINT16_MAX)
+    {
+        jtok_xcode_emit_be(enc, major | 25, value, 2);
+    }
+    else if (value <= UINT32_MAX)
+    {
+        jtok_xcode_emit_be(enc, major | 26, value, 4);
+    }
+    else
+    {
+        jtok_xcode_emit_be(enc, major | 27, value, 8);
+    }
+}
+
+
+/**
+ * @brief Emit the length prefix of a string, array or map
+ */
+static void jtok_xcode_head(jtok_xcode_t *enc, JTOK_XCODE_HEAD_t kind,
+                            uint64_t len)
+{
+    /* MessagePack fix-width marker, limit and 8/16/32-bit markers per kind */
+    static const struct
+    {
+        uint8_t fix;
+        uint8_t fix_max;
+        uint8_t marker[3];
+        uint8_t cbor_major;
+    } heads[] = {
+        [JTOK_XCODE_STRING] = {0xa0, 31, {0xd9, 0xda, 0xdb}, 3},
+        [JTOK_XCODE_ARRAY]  = {0x90, 15, {0x00, 0xdc, 0xdd}, 4},
+        [JTOK_XCODE_MAP]    = {0x80, 15, {0x00, 0xde, 0xdf}, 5},
+    };
+
+    if (enc->format == JTOK_XCODE_CBOR)
+    {
+        jtok_xcode_cbor_head(enc, heads[kind].cbor_major, len);
+    }
+    else if (len <= heads[kind].fix_max)
+    {
+        jtok_xcode_emit_be(enc, heads[kind].fix | (uint8_t)len, 0, 0);
+    }
+    else if (len <= UINT8_MAX && heads[kind].marker[0] != 0x00)
+    {
+        jtok_xcode_emit_be(enc, heads[kind].marker[0], len, 1);
+    }
+    else if (len <= UINT16_MAX)
+    {
+        jtok_xcode_emit_be(enc, heads[kind].marker[1], len, 2);
+    }
+    else if (len <= UINT32_MAX)
+    {
+        jtok_xcode_emit_be(enc, heads[kind].marker[2], len, 4);
+    }
+    else
+    {
+        enc->status = JTOK_WRITE_STATUS_INVAL;
+    }
+}
+
+
+static void jtok_xcode_double(jtok_xcode_t *enc, double value)
+{
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    jtok_xcode_emit_be(enc, (enc->format == JTOK_XCODE_CBOR) ? 0xfb : 0xcb,
+                       bits, 8);
+}
+
+
+/**
+ * @brief Emit an integer given as a sign and magnitude in the smallest form
+ */
+static void jtok_xcode_integer(jtok_xcode_t *enc, bool negative,
+                               uint64_t magnitude)
+{
+    if (enc->format == JTOK_XCODE_CBOR)
+    {
+        if (negative && magnitude > 0)
+        {
+            jtok_xcode_cbor_head(enc, 1, magnitude - 1);
+        }
+        else
+        {
+            jtok_xcode_cbor_head(enc, 0, magnitude);
+        }
+    }
+    else if (!negative || magnitude == 0)
+    {
+        if (magnitude <= 0x7f)
+        {
+            jtok_xcode_emit_be(enc, (uint8_t)magnitude, 0, 0);
+        }
+        else if (magnitude <= UINT8_MAX)
+        {
+            jtok_xcode_emit_be(enc, 0xcc, magnitude, 1);
+        }
+        else if (magnitude <= UINT16_MAX)
+        {
+            jtok_xcode_emit_be(enc, 0xcd, magnitude, 2);
+        }
+        else if (magnitude <= UINT32_MAX)
+        {
+            jtok_xcode_emit_be(enc, 0xce, magnitude, 4);
+        }
+        else
+        {
+            jtok_xcode_emit_be(enc, 0xcf, magnitude, 8);
+        }
+    }
+    else
+    {
+        /* Two's complement of the magnitude, truncated by emit_be */
+        uint64_t value = ~magnitude + 1;
+        if (magnitude <= 32)
+        {
+            jtok_xcode_emit_be(enc, (uint8_t)value, 0, 0);
+        }
+        else if (magnitude <= 0x80)
+        {
+            jtok_xcode_emit_be(enc, 0xd0, value, 1);
+        }
+        else if (magnitude <= 0x8000)
+        {
+            jtok_xcode_emit_be(enc, 0xd1, value, 2);
+        }
+        else if (magnitude <= 0x80000000)
+        {
+            jtok_xcode_emit_be(enc, 0xd2, value, 4);
+        }
+        else if (magnitude <= ((uint64_t)1 << 63))
+        {
+            jtok_xcode_emit_be(enc, 0xd3, value, 8);
+        }
+        else
+        {
+            jtok_xcode_double(enc, -(double)magnitude);
+        }
+    }
+}
+
+
+static void jtok_xcode_primitive(jtok_xcode_t *enc, const jtok_tkn_t *tkn)
+{
+    bool     negative;
+    uint64_t magnitude;
+    double   value;
+    if (!jtok_primitive_is_number(tkn))
+    {
+        /* The parser only lets true, false and null through */
+        static const uint8_t literals[][2] = {
+            {0xc3, 0xf5},
+            {0xc2, 0xf4},
+            {0xc0, 0xf6},
+        };
+        char first = tkn->json[tkn->start];
+        int  idx   = (first == 't') ? 0 : (first == 'f') ? 1 : 2;
+        jtok_xcode_emit(enc, &literals[idx][enc->format], 1);
+    }
+    else if (jtok_primitive_tointeger(tkn, &negative, &magnitude))
+    {
+        jtok_xcode_integer(enc, negative, magnitude);
+    }
+    else if (jtok_primitive_todouble(tkn, &value) && value - value == 0)
+    {
+        jtok_xcode_double(enc, value);
+    }
+    else
+    {
+        /* Not a number, or outside double range */
+        enc->status = JTOK_WRITE_STATUS_INVAL;
+    }
+}
+
+
+/**
+ * @brief Unescaped length of the rest of a string. Only the escapes are
+ * decoded: runs of plain text count as they are and are checked when they
+ * are copied out.
+ *
+ * @return false if an escape is invalid
+ */
+static bool jtok_xcode_unescaped_len(const char *pos, const char *end,
+                                     size_t *len)
+{
+    char        utf8[JTOK_STRING_UTF8_MAX];
+    const char *escape;
+    long        cp;
+
+    while (pos < end)
+    {
+        escape = memchr(pos, '\\', (size_t)(end - pos));
+        if (escape == NULL)
+        {
+            *len += (size_t)(end - pos);
+            break;
+        }
+        *len += (size_t)(escape - pos);
+        pos = escape;
+        cp  = jtok_string_next_cp(&pos, end);
+        if (cp < 0)
+        {
+            return false;
+        }
+        *len += (size_t)jtok_string_put_utf8(cp, utf8);
+    }
+    return true;
+}
+
+
+/**
+ * @brief Emit a string token as unescaped utf-8 with its length prefix
+ */
+static void jtok_xcode_string(jtok_xcode_t *enc, const jtok_tkn_t *tkn)
+{
+    char        out[JTOK_XCODE_STAGE];
+    size_t      len   = 0;
+    size_t      total = 0;
+    const char *start = &tkn->json[tkn->start];
+    const char *end   = &tkn->json[tkn->end];
+    const char *pos   = start;
+    long        cp    = 0;
+
+    if (NULL == memchr(start, '\\', (size_t)(end - start)))
+    {
+        /* Nothing to unescape so the token text is the string */
+        jtok_xcode_head(enc, JTOK_XCODE_STRING, (uint64_t)(end - start));
+        jtok_xcode_emit(enc, start, (size_t)(end - start));
+        return;
+    }
+
+    /* The prefix needs the decoded length. Most strings decode into the
+     * stage whole, and are written straight from it. */
+    while (len <= sizeof(out) - JTOK_STRING_UTF8_MAX &&
+           (cp = jtok_string_next_cp(&pos, end)) >= 0)
+    {
+        len += (size_t)jtok_string_put_utf8(cp, &out[len]);
+    }
+
+    /* A longer one has the rest measured, then decoded as it is written */
+    total = len;
+    if (cp == JTOK_STRING_INVALID ||
+        (cp >= 0 && !jtok_xcode_unescaped_len(pos, end, &total)))
+    {
+        enc->status = JTOK_WRITE_STATUS_INVAL;
+        return;
+    }
+    jtok_xcode_head(enc, JTOK_XCODE_STRING, total);
+    while (cp >= 0 && (cp = jtok_string_next_cp(&pos, end)) >= 0)
+    {
+        if (len > sizeof(out) - JTOK_STRING_UTF8_MAX)
+        {
+            jtok_xcode_emit(enc, out, len);
+            len = 0;
+        }
+        len += (size_t)jtok_string_put_utf8(cp, &out[len]);
+    }
+    if (cp == JTOK_STRING_INVALID)
+    {
+        enc->status = JTOK_WRITE_STATUS_INVAL;
+        return;
+    }
+    jtok_xcode_emit(enc, out, len);
+}
+
+
+static void jtok_xcode_value(jtok_xcode_t *enc, const jtok_tkn_t *tkn,
+                             int depth)
+{
+    const jtok_tkn_t *child;
+    if (enc->status != JTOK_WRITE_STATUS_OK)
+    {
+        return;
+    }
+    if (depth > JTOK_MAX_RECURSE_DEPTH)
+    {
+        enc->status = JTOK_WRITE_STATUS_NEST_DEPTH_EXCEEDED;
+        return;
+    }
+    if (tkn->json == NULL)
+    {
+        enc->status = JTOK_WRITE_STATUS_INVAL;
+        return;
+    }
+
+    switch (tkn->type)
+    {
+        case JTOK_OBJECT:
+        {
+            jtok_xcode_head(enc, JTOK_XCODE_MAP, (uint64_t)tkn->size);
+            child = (tkn->size > 0) ? tkn + 1 : NULL;
+            for (; child != NULL && enc->status == JTOK_WRITE_STATUS_OK;
+                 child = jtok_get_next_sibling(child))
+            {
+                jtok_xcode_string(enc, child);
+                jtok_xcode_value(enc, child + 1, depth + 1);
+            }
+        }
+        break;
+        case JTOK_ARRAY:
+        {
+            jtok_xcode_head(enc, JTOK_XCODE_ARRAY, (uint64_t)tkn->size);
+            child = (tkn->size > 0) ? tkn + 1 : NULL;
+            for (; child != NULL && enc->status == JTOK_WRITE_STATUS_OK;
+                 child = jtok_get_next_sibling(child))
+            {
+                jtok_xcode_value(enc, child, depth + 1);
+            }
+        }
+        break;
+        case JTOK_STRING:
+        {
+            jtok_xcode_string(enc, tkn);
+        }
+        break;
+        case JTOK_PRIMITIVE:
+        {
+            jtok_xcode_primitive(enc, tkn);
+        }
+        break;
+        default:
+        {
+            enc->status = JTOK_WRITE_STATUS_INVAL;
+        }
+        break;
+    }
+}
+
+
+static JTOK_WRITE_STATUS_t jtok_xcode_encode(JTOK_XCODE_FORMAT_t format,
+                                             const jtok_tkn_t *  tkn,
+                                             jtok_write_fn write, void *ctx)
+{
+    jtok_xcode_t enc;
+    if (tkn == NULL || write == NULL)
+    {
+        return JTOK_WRITE_STATUS_NULL_PARAM;
+    }
+    enc.format = format;
+    enc.write  = write;
+    enc.ctx    = ctx;
+    enc.status = JTOK_WRITE_STATUS_OK;
+    jtok_xcode_value(&enc, tkn, 0);
+    return enc.status;
+}
+
+
+JTOK_WRITE_STATUS_t jtok_to_msgpack(const jtok_tkn_t *tkn, jtok_write_fn write,
+                                    void *ctx)
+{
+    return jtok_xcode_encode(JTOK_XCODE_MSGPACK, tkn, write, ctx);
+}
+
+
+JTOK_WRITE_STATUS_t jtok_to_cbor(const jtok_tkn_t *tkn, jtok_write_fn write,
+                                 void *ctx)
+{
+    return jtok_xcode_encode(JTOK_XCODE_CBOR, tkn, write, ctx);
+}
+
+
+/**
+ * @brief Consume len bytes of input
+ *
+ * @return const uint8_t* the bytes, or NULL (and INVAL) if truncated
+ */
+static const uint8_t *jtok_xdec_take(jtok_xdec_t *dec, uint64_t len)
+{
+    const uint8_t *data = dec->pos;
+    if (dec->status != JTOK_WRITE_STATUS_OK)
+    {
+        return NULL;
+    }
+    if (len > (uint64_t)(dec->end - dec->pos))
+    {
+        dec->status = JTOK_WRITE_STATUS_INVAL;
+        return NULL;
+    }
+    dec->pos += len;
+    return data;
+}
+
+
+/**
+ * @brief Consume a big-endian unsigned integer of 1, 2, 4 or 8 bytes
+ */
+static uint64_t jtok_xdec_be(jtok_xdec_t *dec, int bytes)
+{
+    const uint8_t *data  = jtok_xdec_take(dec, (uint64_t)bytes);
+    uint64_t       value = 0;
+    int            i;
+    for (i = 0; data != NULL && i < bytes; i++)
+    {
+        value = (value << 8) | data[i];
+    }
+    return value;
+}
+
+
+static void jtok_xdec_float(jtok_xdec_t *dec, uint32_t bits)
+{
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    dec->status = jtok_writer_double(dec->writer, (double)value);
+}
+
+
+static void jtok_xdec_double(jtok_xdec_t *dec, uint64_t bits)
+{
+    double value;
+    memcpy(&value, &bits, sizeof(value));
+    dec->status = jtok_writer_double(dec->writer, value);
+}
+
+
+/**
+ * @brief Widen IEEE 754 half precision bits to single precision bits
+ */
+static uint32_t jtok_xdec_half_bits(uint16_t half)
+{
+    uint32_t sign = (uint32_t)(half & 0x8000) << 16;
+    int      exp  = (half >> 10) & 0x1f;
+    uint32_t mant = half & 0x3ff;
+    if (exp == 0x1f)
+    {
+        return sign | 0x7f800000 | (mant << 13);
+    }
+    if (exp == 0)
+    {
+        if (mant == 0)
+        {
+            return sign;
+        }
+        /* Subnormal halves are normal floats */
+        exp = 1;
+        while ((mant & 0x400) == 0)
+        {
+            mant <<= 1;
+            exp--;
+        }
+        mant &= 0x3ff;
+    }
+    return sign | ((uint32_t)(exp + 112) << 23) | (mant << 13);
+}
+
+
+/**
+ * @brief Emit a decoded string as an object key or a string value
+ */
+static void jtok_xdec_string(jtok_xdec_t *dec, uint64_t len, bool is_key)
+{
+    const uint8_t *data = jtok_xdec_take(dec, len);
+    if (data != NULL)
+    {
+        dec->status = is_key ? jtok_writer_key(dec->writer, (const char *)data,
+                                               (size_t)len)
+                             : jtok_writer_string(dec->writer,
+                                                  (const char *)data,
+                                                  (size_t)len);
+    }
+}
+
+
+static void jtok_xdec_msgpack(jtok_xdec_t *dec, int depth, bool is_key);
+
+
+static void jtok_xdec_msgpack_container(jtok_xdec_t *dec, uint64_t count,
+                                        bool is_map, int depth)
+{
+    uint64_t i;
+    dec->status = is_map ? jtok_writer_begin_object(dec->writer)
+                         : jtok_writer_begin_array(dec->writer);
+    for (i = 0; i < count && dec->status == JTOK_WRITE_STATUS_OK; i++)
+    {
+        if (is_map)
+        {
+            jtok_xdec_msgpack(dec, depth + 1, true);
+        }
+        jtok_xdec_msgpack(dec, depth + 1, false);
+    }
+    if (dec->status == JTOK_WRITE_STATUS_OK)
+    {
+        dec->status = is_map ? jtok_writer_end_object(dec->writer)
+                             : jtok_writer_end_array(dec->writer);
+    }
+}
+
+
+static void jtok_xdec_msgpack(jtok_xdec_t *dec, int depth, bool is_key)
+{
+    const uint8_t *marker;
+    uint8_t        b;
+    if (depth > JTOK_WRITER_MAX_DEPTH)
+    {
+        dec->status = JTOK_WRITE_STATUS_NEST_DEPTH_EXCEEDED;
+        return;
+    }
+    marker = jtok_xdec_take(dec, 1);
+    if (marker == NULL)
+    {
+        return;
+    }
+
+    b = *marker;
+    if (b >= 0xa0 && b <= 0xbf)
+    {
+        jtok_xdec_string(dec, b & 0x1f, is_key);
+    }
+    else if (b >= 0xd9 && b <= 0xdb)
+    {
+        jtok_xdec_string(dec, jtok_xdec_be(dec, 1 << (b - 0xd9)), is_key);
+    }
+    else if (is_key)
+    {
+        /* json keys can only be strings */
+        dec->status = JTOK_WRITE_STATUS_INVAL;
+    }
+    else if (b <= 0x7f)
+    {
+        dec->status = jtok_writer_uint(dec->writer, b);
+    }
+    else if (b >= 0xe0)
+    {
+        dec->status = jtok_writer_int(dec->writer, (int64_t)b - 0x100);
+    }
+    else if (b <= 0x8f)
+    {
+        jtok_xdec_msgpack_container(dec, b & 0x0f, true, depth);
+    }
+    else if (b <= 0x9f)
+    {
+        jtok_xdec_msgpack_container(dec, b & 0x0f, false, depth);
+    }
+    else
+    {
+        switch (b)
+        {
+            case 0xc0:
+            {
+                dec->status = jtok_writer_null(dec->writer);
+            }
+            break;
+            case 0xc2:
+            case 0xc3:
+            {
+                dec->status = jtok_writer_bool(dec->writer, b == 0xc3);
+            }
+            break;
+            case 0xca:
+            {
+                uint32_t bits = (uint32_t)jtok_xdec_be(dec, 4);
+                if (dec->status == JTOK_WRITE_STATUS_OK)
+                {
+                    jtok_xdec_float(dec, bits);
+                }
+            }
+            break;
+            case 0xcb:
+            {
+                uint64_t bits = jtok_xdec_be(dec, 8);
+                if (dec->status == JTOK_WRITE_STATUS_OK)
+                {
+                    jtok_xdec_double(dec, bits);
+                }
+            }
+            break;
+            case 0xcc:
+            case 0xcd:
+            case 0xce:
+            case 0xcf:
+            {
+                uint64_t value = jtok_xdec_be(dec, 1 << (b - 0xcc));
+                if (dec->status == JTOK_WRITE_STATUS_OK)
+                {
+                    dec->status = jtok_writer_uint(dec->writer, value);
+                }
+            }
+            break;
+            case 0xd0:
+            case 0xd1:
+            case 0xd2:
+            case 0xd3:
+            {
+                int      bytes = 1 << (b - 0xd0);
+                uint64_t value = jtok_xdec_be(dec, bytes);
+                uint64_t sign  = (uint64_t)1 << (bytes * 8 - 1);
+                if (dec->status == JTOK_WRITE_STATUS_OK)
+                {
+                    /* Sign-extend without implementation-defined casts */
+                    int64_t result = (int64_t)(value & (sign - 1));
+                    if (value & sign)
+                    {
+                        result = result - (int64_t)(sign - 1) - 1;
+                    }
+                    dec->status = jtok_writer_int(dec->writer, result);
+                }
+            }
+            break;
+            case 0xdc:
+            case 0xdd:
+            {
+                uint64_t count = jtok_xdec_be(dec, (b == 0xdc) ? 2 : 4);
+                if (dec->status == JTOK_WRITE_STATUS_OK)
+                {
+                    jtok_xdec_msgpack_container(dec, count, false, depth);
+                }
+            }
+            break;
+            case 0xde:
+            case 0xdf:
+            {
+                uint64_t count = jtok_xdec_be(dec, (b == 0xde) ? 2 : 4);
+                if (dec->status == JTOK_WRITE_STATUS_OK)
+                {
+                    jtok_xdec_msgpack_container(dec, count, true, depth);
+                }
+            }
+            break;
+            default:
+            {
+                /* bin, ext and the never-used marker */
+                dec->status = JTOK_WRITE_STATUS_INVAL;
+            }
+            break;
+        }
+    }
+}
+
+
+static void jtok_xdec_cbor(jtok_xdec_t *dec, int depth, bool is_key)
+{
+    const uint8_t *initial;
+    uint8_t        major;
+    uint8_t        info;
+    uint64_t       arg = 0;
+    uint64_t       i;
+    if (depth > JTOK_WRITER_MAX_DEPTH)
+    {
+        dec->status = JTOK_WRITE_STATUS_NEST_DEPTH_EXCEEDED;
+        return;
+    }
+    initial = jtok_xdec_take(dec, 1);
+    if (initial == NULL)
+    {
+        return;
+    }
+
+    major = *initial >> 5;
+    info  = *initial & 0x1f;
+    if (info < 24)
+    {
+        arg = info;
+    }
+    else if (info <= 27)
+    {
+        arg = jtok_xdec_be(dec, 1 << (info - 24));
+    }
+    else
+    {
+        /* Reserved values and indefinite lengths */
+        dec->status = JTOK_WRITE_STATUS_INVAL;
+    }
+    if (dec->status != JTOK_WRITE_STATUS_OK)
+    {
+        return;
+    }
+
+    if (is_key && major != 3 && major != 6)
+    {
+        dec->status = JTOK_WRITE_STATUS_INVAL; /* json keys are strings */
+        return;
+    }
+
+    switch (major)
+    {
+        case 0:
+        {
+            dec->status = jtok_writer_uint(dec->writer, arg);
+        }
+        break;
+        case 1:
+        {
+            /* The value is -1 - arg, which may not fit in an int64_t */
+            if (arg <= (uint64_t)INT64_MAX)
+            {
+                dec->status = jtok_writer_int(dec->writer, -1 - (int64_t)arg);
+            }
+            else
+            {
+                dec->status = jtok_writer_double(dec->writer,
+                                                 -1.0 - (double)arg);
+            }
+        }
+        break;
+        case 3:
+        {
+            jtok_xdec_string(dec, arg, is_key);
+        }
+        break;
+        case 4:
+        {
+            dec->status = jtok_writer_begin_array(dec->writer);
+            for (i = 0; i < arg && dec->status == JTOK_WRITE_STATUS_OK; i++)
+            {
+                jtok_xdec_cbor(dec, depth + 1, false);
+            }
+            if (dec->status == JTOK_WRITE_STATUS_OK)
+            {
+                dec->status = jtok_writer_end_array(dec->writer);
+            }
+        }
+        break;
+        case 5:
+        {
+            dec->status = jtok_writer_begin_object(dec->writer);
+            for (i = 0; i < arg && dec->status == JTOK_WRITE_STATUS_OK; i++)
+            {
+                jtok_xdec_cbor(dec, depth + 1, true);
+                jtok_xdec_cbor(dec, depth + 1, false);
+            }
+            if (dec->status == JTOK_WRITE_STATUS_OK)
+            {
+                dec->status = jtok_writer_end_object(dec->writer);
+            }
+        }
+        break;
+        case 6:
+        {
+            /* Tags only add meaning to the item that follows */
+            jtok_xdec_cbor(dec, depth + 1, is_key);
+        }
+        break;
+        case 7:
+        {
+            switch (info)
+            {
+                case 20:
+                case 21:
+                {
+                    dec->status = jtok_writer_bool(dec->writer, info == 21);
+                }
+                break;
+                case 22:
+                case 23:
+                {
+                    /* null and undefined */
+                    dec->status = jtok_writer_null(dec->writer);
+                }
+                break;
+                case 25:
+                {
+                    jtok_xdec_float(dec, jtok_xdec_half_bits((uint16_t)arg));
+                }
+                break;
+                case 26:
+                {
+                    jtok_xdec_float(dec, (uint32_t)arg);
+                }
+                break;
+                case 27:
+                {
+                    jtok_xdec_double(dec, arg);
+                }
+                break;
+                default:
+                {
+                    dec->status = JTOK_WRITE_STATUS_INVAL;
+                }
+                break;
+            }
+        }
+        break;
+        default:
+        {
+            /* Byte strings */
+            dec->status = JTOK_WRITE_STATUS_INVAL;
+        }
+        break;
+    }
+}
+
+
+static JTOK_WRITE_STATUS_t jtok_xdec_decode(JTOK_XCODE_FORMAT_t format,
+                                            const void *data, size_t len,
+                                            size_t *used, jtok_writer_t *writer)
+{
+    jtok_xdec_t dec;
+    if (data == NULL || writer == NULL)
+    {
+        return JTOK_WRITE_STATUS_NULL_PARAM;
+    }
+    dec.pos    = (const uint8_t *)data;
+    dec.end    = dec.pos + len;
+    dec.writer = writer;
+    dec.status = writer->status;
+    if (dec.status == JTOK_WRITE_STATUS_OK)
+    {
+        if (format == JTOK_XCODE_CBOR)
+        {
+            jtok_xdec_cbor(&dec, 0, false);
+        }
+        else
+        {
+            jtok_xdec_msgpack(&dec, 0, false);
+        }
+    }
+    if (used != NULL)
+    {
+        *used = (size_t)(dec.pos - (const uint8_t *)data);
+    }
+    return dec.status;
+}
+
+
+JTOK_WRITE_STATUS_t jtok_msgpack_to_json(const void *data, size_t len,
+                                         size_t *used, jtok_writer_t *writer)
+{
+    return jtok_xdec_decode(JTOK_XCODE_MSGPACK, data, len, used, writer);
+}
+
+
+JTOK_WRITE_STATUS_t jtok_cbor_to_json(const void *data, size_t len,
+                                      size_t *used, jtok_writer_t *writer)
+{
+    return jtok_xdec_decode(JTOK_XCODE_CBOR, data, len, used, writer);
+}
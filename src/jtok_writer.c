@@ -0,0 +1,526 @@
+/**
+ * @file jtok_writer.c
+ * @author Carl Mattatall (cmattatall2@gmail.com)
+ * @brief Source module for the streaming json writer
+ * @version 0.1
+ * @date 2021-05-01
+ *
+ * @copyright Copyright (c) 2021 Carl Mattatall
+ *
+ * @note The writer never allocates. Output accumulates in the caller's buffer
+ * and is handed to the flush callback whenever the buffer fills.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "jtok_writer.h"
+#include "jtok_dtoa.h"
+#include "jtok_swar.h"
+
+/* Per-level container state bits */
+#define JTOK_WRITER_OBJECT 0x01u    /* container is an object (else array) */
+#define JTOK_WRITER_HAS_ITEMS 0x02u /* next item needs a leading comma */
+#define JTOK_WRITER_AFTER_KEY 0x04u /* a key was written, value is pending */
+
+/* Enough for "-18446744073709551615" */
+#define JTOK_WRITER_NUMBER_MAX 32
+
+static const char jtok_writer_digit_pairs[] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536"
+    "37383940414243444546474849505152535455565758596061626364656667686970717273"
+    "7475767778798081828384858687888990919293949596979899";
+
+static const char jtok_writer_hex[] = "0123456789abcdef";
+
+
+static JTOK_WRITE_STATUS_t jtok_writer_put(jtok_writer_t *writer,
+                                           const char *data, size_t len)
+{
+    while (len > 0 && writer->status == JTOK_WRITE_STATUS_OK)
+    {
+        size_t space = writer->size - writer->len;
+        if (writer->len == 0 && len >= writer->size && writer->flush != NULL)
+        {
+            /* Large run with an empty buffer (or no buffer at all): skip the
+             * intermediate copy */
+            if (0 != writer->flush(writer->ctx, data, len))
+            {
+                writer->status = JTOK_WRITE_STATUS_SINK_ERROR;
+                break;
+            }
+            writer->total += len;
+            break;
+        }
+
+        if (space == 0)
+        {
+            if (writer->flush == NULL)
+            {
+                writer->status = JTOK_WRITE_STATUS_NOMEM;
+                break;
+            }
+            jtok_writer_flush(writer);
+            continue;
+        }
+
+        size_t count = (len < space) ? len : space;
+        memcpy(&writer->buf[writer->len], data, count);
+        writer->len += count;
+        writer->total += count;
+        data += count;
+        len -= count;
+    }
+    return writer->status;
+}
+
+
+static JTOK_WRITE_STATUS_t jtok_writer_putc(jtok_writer_t *writer, char c)
+{
+    if (writer->len < writer->size && writer->status == JTOK_WRITE_STATUS_OK)
+    {
+        writer->buf[writer->len++] = c;
+        writer->total++;
+        return JTOK_WRITE_STATUS_OK;
+    }
+    return jtok_writer_put(writer, &c, 1);
+}
+
+
+/* Emit the separator that must precede a value and update container state */
+static JTOK_WRITE_STATUS_t jtok_writer_begin_value(jtok_writer_t *writer)
+{
+    if (writer->status != JTOK_WRITE_STATUS_OK)
+    {
+        return writer->status;
+    }
+
+    if (writer->depth == 0)
+    {
+        if (writer->root_done)
+        {
+            /* Only one top-level value per document */
+            writer->status = JTOK_WRITE_STATUS_INVAL;
+        }
+    }
+    else
+    {
+        uint8_t *state = &writer->stack[writer->depth - 1];
+        if (*state & JTOK_WRITER_OBJECT)
+        {
+            if (!(*state & JTOK_WRITER_AFTER_KEY))
+            {
+                /* Object values must be preceded by a key */
+                writer->status = JTOK_WRITE_STATUS_INVAL;
+            }
+            *state = (uint8_t)((*state & ~JTOK_WRITER_AFTER_KEY) |
+                               JTOK_WRITER_HAS_ITEMS);
+        }
+        else
+        {
+            if (*state & JTOK_WRITER_HAS_ITEMS)
+            {
+                jtok_writer_putc(writer, ',');
+            }
+            *state |= JTOK_WRITER_HAS_ITEMS;
+        }
+    }
+    return writer->status;
+}
+
+
+static void jtok_writer_end_value(jtok_writer_t *writer)
+{
+    if (writer->depth == 0)
+    {
+        writer->root_done = true;
+    }
+}
+
+
+static JTOK_WRITE_STATUS_t jtok_writer_begin(jtok_writer_t *writer,
+                                             uint8_t type, char open)
+{
+    if (writer == NULL)
+    {
+        return JTOK_WRITE_STATUS_NULL_PARAM;
+    }
+
+    if (jtok_writer_begin_value(writer) == JTOK_WRITE_STATUS_OK)
+    {
+        if (writer->depth == JTOK_WRITER_MAX_DEPTH)
+        {
+            writer->status = JTOK_WRITE_STATUS_NEST_DEPTH_EXCEEDED;
+        }
+        else
+        {
+            writer->stack[writer->depth++] = type;
+            jtok_writer_putc(writer, open);
+        }
+    }
+    return writer->status;
+}
+
+
+static JTOK_WRITE_STATUS_t jtok_writer_end(jtok_writer_t *writer, uint8_t type,
+                                           char close)
+{
+    if (writer == NULL)
+    {
+        return JTOK_WRITE_STATUS_NULL_PARAM;
+    }
+
+    if (writer->status == JTOK_WRITE_STATUS_OK)
+    {
+        uint8_t state =
+            (writer->depth > 0) ? writer->stack[writer->depth - 1] : 0;
+        if (writer->depth == 0 || (state & JTOK_WRITER_OBJECT) != type ||
+            (state & JTOK_WRITER_AFTER_KEY))
+        {
+            writer->status = JTOK_WRITE_STATUS_INVAL;
+        }
+        else
+        {
+            writer->depth--;
+            jtok_writer_putc(writer, close);
+            jtok_writer_end_value(writer);
+        }
+    }
+    return writer->status;
+}
+
+
+/* Write str surrounded by quotes, escaping '"', '\\' and control characters */
+static JTOK_WRITE_STATUS_t jtok_writer_quoted(jtok_writer_t *writer,
+                                              const char *str, size_t len)
+{
+    size_t i   = 0;
+    size_t run = 0; /* start of the current run of bytes needing no escape */
+
+    jtok_writer_putc(writer, '\"');
+    while (i < len && writer->status == JTOK_WRITE_STATUS_OK)
+    {
+        /* Skip 8 clean bytes at a time */
+        while (i + 8 <= len)
+        {
+            uint64_t word = jtok_swar_load(&str[i]);
+            if (jtok_swar_lt_bytes(word, 0x20) |
+                jtok_swar_eq_bytes(word, '\"') |
+                jtok_swar_eq_bytes(word, '\\'))
+            {
+                break;
+            }
+            i += 8;
+        }
+
+        /* Something in the next 8 bytes (or the tail) may need escaping */
+        size_t stop = (i + 8 < len) ? i + 8 : len;
+        for (; i < stop; i++)
+        {
+            unsigned char c = (unsigned char)str[i];
+            if (c < 0x20 || c == '\"' || c == '\\')
+            {
+                char   esc[6]  = {'\\', (char)c, 0, 0, 0, 0};
+                size_t esc_len = 2;
+                switch (c)
+                {
+                    case '\"':
+                    case '\\':
+                    {
+                    }
+                    break;
+                    case '\b':
+                    {
+                        esc[1] = 'b';
+                    }
+                    break;
+                    case '\f':
+                    {
+                        esc[1] = 'f';
+                    }
+                    break;
+                    case '\n':
+                    {
+                        esc[1] = 'n';
+                    }
+                    break;
+                    case '\r':
+                    {
+                        esc[1] = 'r';
+                    }
+                    break;
+                    case '\t':
+                    {
+                        esc[1] = 't';
+                    }
+                    break;
+                    default:
+                    {
+                        esc[1]  = 'u';
+                        esc[2]  = '0';
+                        esc[3]  = '0';
+                        esc[4]  = jtok_writer_hex[c >> 4];
+                        esc[5]  = jtok_writer_hex[c & 0xF];
+                        esc_len = 6;
+                    }
+                    break;
+                }
+                jtok_writer_put(writer, &str[run], i - run);
+                jtok_writer_put(writer, esc, esc_len);
+                run = i + 1;
+            }
+        }
+    }
+    jtok_writer_put(writer, &str[run], len - run);
+    return jtok_writer_putc(writer, '\"');
+}
+
+
+/* Format value backwards into the end of buf, returning the first digit */
+static char *jtok_writer_format_uint(char *end, uint64_t value)
+{
+    char *p = end;
+    while (value >= 100)
+    {
+        unsigned int pair = (unsigned int)(value % 100) * 2;
+        value /= 100;
+        *--p = jtok_writer_digit_pairs[pair + 1];
+        *--p = jtok_writer_digit_pairs[pair];
+    }
+
+    if (value >= 10)
+    {
+        unsigned int pair = (unsigned int)value * 2;
+        *--p              = jtok_writer_digit_pairs[pair + 1];
+        *--p              = jtok_writer_digit_pairs[pair];
+    }
+    else
+    {
+        *--p = (char)('0' + value);
+    }
+    return p;
+}
+
+
+void jtok_writer_init(jtok_writer_t *writer, char *buf, size_t size,
+                      jtok_write_fn flush, void *ctx)
+{
+    if (writer != NULL)
+    {
+        writer->buf       = buf;
+        writer->size      = (buf != NULL) ? size : 0;
+        writer->len       = 0;
+        writer->total     = 0;
+        writer->flush     = flush;
+        writer->ctx       = ctx;
+        writer->depth     = 0;
+        writer->root_done = false;
+        writer->status    = JTOK_WRITE_STATUS_OK;
+        if (buf == NULL && flush == NULL)
+        {
+            writer->status = JTOK_WRITE_STATUS_NULL_PARAM;
+        }
+    }
+}
+
+
+JTOK_WRITE_STATUS_t jtok_writer_flush(jtok_writer_t *writer)
+{
+    if (writer == NULL)
+    {
+        return JTOK_WRITE_STATUS_NULL_PARAM;
+    }
+
+    if (writer->flush != NULL && writer->len > 0 &&
+        writer->status == JTOK_WRITE_STATUS_OK)
+    {
+        if (0 != writer->flush(writer->ctx, writer->buf, writer->len))
+        {
+            writer->status = JTOK_WRITE_STATUS_SINK_ERROR;
+        }
+        writer->len = 0;
+    }
+    return writer->status;
+}
+
+
+JTOK_WRITE_STATUS_t jtok_writer_begin_object(jtok_writer_t *writer)
+{
+    return jtok_writer_begin(writer, JTOK_WRITER_OBJECT, '{');
+}
+
+
+JTOK_WRITE_STATUS_t jtok_writer_end_object(jtok_writer_t *writer)
+{
+    return jtok_writer_end(writer, JTOK_WRITER_OBJECT, '}');
+}
+
+
+JTOK_WRITE_STATUS_t jtok_writer_begin_array(jtok_writer_t *writer)
+{
+    return jtok_writer_begin(writer, 0, '[');
+}
+
+
+JTOK_WRITE_STATUS_t jtok_writer_end_array(jtok_writer_t *writer)
+{
+    return jtok_writer_end(writer, 0, ']');
+}
+
+
+JTOK_WRITE_STATUS_t jtok_writer_key(jtok_writer_t *writer, const char *key,
+                                    size_t len)
+{
+    if (writer == NULL || (key == NULL && len > 0))
+    {
+        return JTOK_WRITE_STATUS_NULL_PARAM;
+    }
+
+    if (writer->status == JTOK_WRITE_STATUS_OK)
+    {
+        uint8_t *state =
+            (writer->depth > 0) ? &writer->stack[writer->depth - 1] : NULL;
+        if (state == NULL || !(*state & JTOK_WRITER_OBJECT) ||
+            (*state & JTOK_WRITER_AFTER_KEY))
+        {
+            writer->status = JTOK_WRITE_STATUS_INVAL;
+        }
+        else
+        {
+            if (*state & JTOK_WRITER_HAS_ITEMS)
+            {
+                jtok_writer_putc(writer, ',');
+            }
+            *state |= JTOK_WRITER_AFTER_KEY;
+            jtok_writer_quoted(writer, key, len);
+            jtok_writer_putc(writer, ':');
+        }
+    }
+    return writer->status;
+}
+
+
+JTOK_WRITE_STATUS_t jtok_writer_string(jtok_writer_t *writer, const char *str,
+                                       size_t len)
+{
+    if (writer == NULL || (str == NULL && len > 0))
+    {
+        return JTOK_WRITE_STATUS_NULL_PARAM;
+    }
+
+    if (jtok_writer_begin_value(writer) == JTOK_WRITE_STATUS_OK)
+    {
+        jtok_writer_quoted(writer, str, len);
+        jtok_writer_end_value(writer);
+    }
+    return writer->status;
+}
+
+
+JTOK_WRITE_STATUS_t jtok_writer_int(jtok_writer_t *writer, int64_t value)
+{
+    char  digits[JTOK_WRITER_NUMBER_MAX];
+    char *end = &digits[sizeof(digits)];
+    char *p;
+
+    /* Negate in unsigned space so INT64_MIN does not overflow */
+    if (value < 0)
+    {
+        p    = jtok_writer_format_uint(end, 0 - (uint64_t)value);
+        *--p = '-';
+    }
+    else
+    {
+        p = jtok_writer_format_uint(end, (uint64_t)value);
+    }
+    return jtok_writer_value(writer, p, (size_t)(end - p));
+}
+
+
+JTOK_WRITE_STATUS_t jtok_writer_uint(jtok_writer_t *writer, uint64_t value)
+{
+    char  digits[JTOK_WRITER_NUMBER_MAX];
+    char *end = &digits[sizeof(digits)];
+    char *p   = jtok_writer_format_uint(end, value);
+    return jtok_writer_value(writer, p, (size_t)(end - p));
+}
+
+
+JTOK_WRITE_STATUS_t jtok_writer_double(jtok_writer_t *writer, double value)
+{
+    char   text[JTOK_DTOA_FORMAT_MAX];
+    size_t len;
+
+    if (writer == NULL)
+    {
+        return JTOK_WRITE_STATUS_NULL_PARAM;
+    }
+
+    if (isnan(value) || isinf(value))
+    {
+        writer->status = JTOK_WRITE_STATUS_INVAL;
+        return writer->status;
+    }
+
+    if (value > -9007199254740992.0 && value < 9007199254740992.0 &&
+        value == (double)(int64_t)value)
+    {
+        /* Exactly representable integers take the fast integer path */
+        return jtok_writer_int(writer, (int64_t)value);
+    }
+
+    len = jtok_dtoa_format(value, text);
+    return jtok_writer_value(writer, text, len);
+}
+
+
+JTOK_WRITE_STATUS_t jtok_writer_bool(jtok_writer_t *writer, bool value)
+{
+    return value ? jtok_writer_value(writer, "true", 4)
+                 : jtok_writer_value(writer, "false", 5);
+}
+
+
+JTOK_WRITE_STATUS_t jtok_writer_null(jtok_writer_t *writer)
+{
+    return jtok_writer_value(writer, "null", 4);
+}
+
+
+JTOK_WRITE_STATUS_t jtok_writer_value(jtok_writer_t *writer, const char *json,
+                                      size_t len)
+{
+    if (writer == NULL || json == NULL)
+    {
+        return JTOK_WRITE_STATUS_NULL_PARAM;
+    }
+
+    if (jtok_writer_begin_value(writer) == JTOK_WRITE_STATUS_OK)
+    {
+        jtok_writer_put(writer, json, len);
+        jtok_writer_end_value(writer);
+    }
+    return writer->status;
+}
+
+
+JTOK_WRITE_STATUS_t jtok_writer_raw(jtok_writer_t *writer, const char *data,
+                                    size_t len)
+{
+    if (writer == NULL || (data == NULL && len > 0))
+    {
+        return JTOK_WRITE_STATUS_NULL_PARAM;
+    }
+    return jtok_writer_put(writer, data, len);
+}
+
+
+int jtok_writer_sink(void *writer, const char *data, size_t len)
+{
+    return (JTOK_WRITE_STATUS_OK ==
+            jtok_writer_raw((jtok_writer_t *)writer, data, len))
+               ? 0
+               : 1;
+}
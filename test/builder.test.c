@@ -0,0 +1,147 @@
+/**
+ * @file builder.test.c
+ * @author Carl Mattatall (cmattatall2@gmail.com)
+ * @brief Source module to test building documents straight into a token pool
+ * @version 0.1
+ * @date 2021-05-06
+ *
+ * @copyright Copyright (c) 2021 Carl Mattatall
+ *
+ */
+#include <stdio.h>
+#include <string.h>
+
+#include "jtok.h"
+#include "jtok_builder.h"
+
+#define TOKEN_MAX 200
+#define TEXT_MAX 512
+
+static jtok_tkn_t built[TOKEN_MAX];
+static jtok_tkn_t parsed[TOKEN_MAX];
+static char       text[TEXT_MAX];
+
+
+static int build_document(jtok_builder_t *b)
+{
+    jtok_builder_init(b, built, TOKEN_MAX, text, sizeof(text));
+    jtok_builder_begin_object(b);
+    jtok_builder_key(b, "id", 2);
+    jtok_builder_int(b, -7);
+    jtok_builder_key(b, "name", 4);
+    jtok_builder_string(b, "say \"hi\"", 8);
+    jtok_builder_key(b, "nested", 6);
+    jtok_builder_begin_object(b);
+    jtok_builder_key(b, "ok", 2);
+    jtok_builder_bool(b, true);
+    jtok_builder_key(b, "empty", 5);
+    jtok_builder_begin_array(b);
+    jtok_builder_end_array(b);
+    jtok_builder_end_object(b);
+    jtok_builder_key(b, "list", 4);
+    jtok_builder_begin_array(b);
+    jtok_builder_uint(b, 1);
+    jtok_builder_begin_object(b);
+    jtok_builder_key(b, "k", 1);
+    jtok_builder_null(b);
+    jtok_builder_end_object(b);
+    jtok_builder_string(b, "s", 1);
+    jtok_builder_double(b, 2.5);
+    jtok_builder_end_array(b);
+    jtok_builder_end_object(b);
+    return (jtok_builder_finish(b) == JTOK_WRITE_STATUS_OK) ? 0 : 1;
+}
+
+
+int main(void)
+{
+    jtok_builder_t b;
+    int            i;
+
+    printf("\nbuilding a document... ");
+    if (build_document(&b) != 0)
+    {
+        printf("failed with status %d\n", b.status);
+        return 1;
+    }
+    if (0 != strcmp(text, "{\"id\":-7,\"name\":\"say \\\"hi\\\"\",\"nested\":"
+                          "{\"ok\":true,\"empty\":[]},\"list\":[1,{\"k\":null},"
+                          "\"s\",2.5]}"))
+    {
+        printf("failed. text is %s\n", text);
+        return 1;
+    }
+    printf("passed.\n");
+
+    printf("\nchecking tokens match the parser's... ");
+    if (jtok_parse(text, parsed, TOKEN_MAX) != JTOK_PARSE_STATUS_OK)
+    {
+        printf("failed. text does not parse\n");
+        return 1;
+    }
+    for (i = 0; i < b.count; i++)
+    {
+        if (built[i].type != parsed[i].type ||
+            built[i].start != parsed[i].start ||
+            built[i].end != parsed[i].end || built[i].size != parsed[i].size ||
+            built[i].parent != parsed[i].parent ||
+            built[i].sibling != parsed[i].sibling)
+        {
+            printf("failed. token %d differs\n", i);
+            return 1;
+        }
+    }
+    if (parsed[b.count].type != JTOK_UNASSIGNED_TOKEN ||
+        built[b.count].type != JTOK_UNASSIGNED_TOKEN)
+    {
+        printf("failed. token count differs\n");
+        return 1;
+    }
+    if (!jtok_toktokcmp(built, parsed) ||
+        jtok_obj_has_key(built, "list") == NULL)
+    {
+        printf("failed. built pool is not usable\n");
+        return 1;
+    }
+    printf("passed.\n");
+
+    printf("\nchecking misuse is rejected... ");
+    jtok_builder_init(&b, built, TOKEN_MAX, text, sizeof(text));
+    if (jtok_builder_begin_array(&b) != JTOK_WRITE_STATUS_INVAL)
+    {
+        printf("failed. non-object root accepted\n");
+        return 1;
+    }
+    jtok_builder_init(&b, built, TOKEN_MAX, text, sizeof(text));
+    jtok_builder_begin_object(&b);
+    if (jtok_builder_int(&b, 1) != JTOK_WRITE_STATUS_INVAL)
+    {
+        printf("failed. value without key accepted\n");
+        return 1;
+    }
+    jtok_builder_init(&b, built, 2, text, sizeof(text));
+    jtok_builder_begin_object(&b);
+    jtok_builder_key(&b, "a", 1);
+    if (jtok_builder_int(&b, 1) != JTOK_WRITE_STATUS_NOMEM)
+    {
+        printf("failed. full pool not reported\n");
+        return 1;
+    }
+    jtok_builder_init(&b, built, TOKEN_MAX, text, 8);
+    jtok_builder_begin_object(&b);
+    jtok_builder_key(&b, "long key", 8);
+    if (jtok_builder_finish(&b) != JTOK_WRITE_STATUS_NOMEM)
+    {
+        printf("failed. full text arena not reported\n");
+        return 1;
+    }
+    jtok_builder_init(&b, built, TOKEN_MAX, text, sizeof(text));
+    jtok_builder_begin_object(&b);
+    if (jtok_builder_finish(&b) != JTOK_WRITE_STATUS_INVAL)
+    {
+        printf("failed. unfinished document accepted\n");
+        return 1;
+    }
+    printf("passed.\n");
+    return 0;
+}
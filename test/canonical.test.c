@@ -0,0 +1,125 @@
+/**
+ * @file canonical.test.c
+ * @author Carl Mattatall (cmattatall2@gmail.com)
+ * @brief Source module to test RFC 8785 canonical output
+ * @version 0.1
+ * @date 2021-05-07
+ *
+ * @copyright Copyright (c) 2021 Carl Mattatall
+ *
+ */
+#include <stdio.h>
+#include <string.h>
+
+#include "jtok.h"
+
+#define TOKEN_MAX 200
+#define OUTPUT_MAX 512
+
+/* clang-format off */
+static const struct
+{
+    char input[300];
+    char output[300];
+} canonical_table[] = {
+    {.input = "{ \"b\" : 1 , \"a\" : [ true , false , null ] }", .output = "{\"a\":[true,false,null],\"b\":1}"},
+    {.input = "{\"n\":[1e30, 4.50, 2e-3, 0.000001, 1e-7, -0, 1E21, 100000000000000000000, 333333333.33333329, -1.5e-9, 10]}",
+     .output = "{\"n\":[1e+30,4.5,0.002,0.000001,1e-7,0,1e+21,100000000000000000000,333333333.3333333,-1.5e-9,10]}"},
+    /* Subnormals, where fewer digits round-trip than at full precision */
+    {.input = "{\"n\":[4.9406564584124654e-324, -1e-323, 1.48e-323, 2.225073858507201e-308, 2.2250738585072014e-308, 1.7976931348623157e308]}",
+     .output = "{\"n\":[5e-324,-1e-323,1.5e-323,2.225073858507201e-308,2.2250738585072014e-308,1.7976931348623157e+308]}"},
+    {.input = "{\"s\":\"\\u0041\\/\\u001f\\u000c\\\"\\\\\\u00e9\"}", .output = "{\"s\":\"A/\\u001f\\f\\\"\\\\\xC3\xA9\"}"},
+    {.input = "{'single':'quote \"inside\"'}", .output = "{\"single\":\"quote \\\"inside\\\"\"}"},
+    {.input = "{\"z\":{\"y\":1,\"x\":2},\"aa\":0,\"a\":0}", .output = "{\"a\":0,\"aa\":0,\"z\":{\"x\":2,\"y\":1}}"},
+    /* RFC 8785 section 3.2.3 sorting example */
+    {.input = "{\"\\u20ac\":\"Euro Sign\",\"\\r\":\"Carriage Return\",\"\\ufb33\":\"Hebrew Letter Dalet With Dagesh\","
+              "\"1\":\"One\",\"\\ud83d\\ude00\":\"Emoji: Grinning Face\",\"\\u0080\":\"Control\",\"\\u00f6\":\"Latin Small Letter O With Diaeresis\"}",
+     .output = "{\"\\r\":\"Carriage Return\",\"1\":\"One\",\"\xC2\x80\":\"Control\",\"\xC3\xB6\":\"Latin Small Letter O With Diaeresis\","
+               "\"\xE2\x82\xAC\":\"Euro Sign\",\"\xF0\x9F\x98\x80\":\"Emoji: Grinning Face\",\"\xEF\xAC\xB3\":\"Hebrew Letter Dalet With Dagesh\"}"},
+};
+
+static const char invalid_table[][100] = {
+    "{\"a\":1,\"a\":2}",
+    "{\"a\":\"\\ud800\"}",
+    "{\"a\":\"\\udc00x\"}",
+    "{\"a\":1e400}",
+};
+/* clang-format on */
+
+static jtok_tkn_t tokens[TOKEN_MAX];
+static jtok_off_t scratch[TOKEN_MAX];
+
+static struct
+{
+    char   buf[OUTPUT_MAX];
+    size_t len;
+} output;
+
+
+static int collect(void *ctx, const char *data, size_t len)
+{
+    (void)ctx;
+    if (output.len + len >= sizeof(output.buf))
+    {
+        return 1;
+    }
+    memcpy(&output.buf[output.len], data, len);
+    output.len += len;
+    output.buf[output.len] = '\0';
+    return 0;
+}
+
+
+static JTOK_WRITE_STATUS_t canonicalize(jtok_off_t *canon_scratch,
+                                        size_t canon_scratch_len)
+{
+    output.len    = 0;
+    output.buf[0] = '\0';
+    return jtok_canonical(tokens, canon_scratch, canon_scratch_len, collect,
+                          NULL);
+}
+
+
+int main(void)
+{
+    unsigned long long i;
+    unsigned long long max_i = sizeof(canonical_table) /
+                               sizeof(*canonical_table);
+    for (i = 0; i < max_i; i++)
+    {
+        printf("\ncanonicalizing %s... ", canonical_table[i].input);
+        if (jtok_parse(canonical_table[i].input, tokens, TOKEN_MAX) !=
+            JTOK_PARSE_STATUS_OK)
+        {
+            printf("parse failed.\n");
+            return 1;
+        }
+
+        /* Once with an index array, once with the selection fallback */
+        if (canonicalize(scratch, TOKEN_MAX) != JTOK_WRITE_STATUS_OK ||
+            0 != strcmp(output.buf, canonical_table[i].output) ||
+            canonicalize(NULL, 0) != JTOK_WRITE_STATUS_OK ||
+            0 != strcmp(output.buf, canonical_table[i].output))
+        {
+            printf("failed. got %s\n", output.buf);
+            return 1;
+        }
+        printf("passed.\n");
+    }
+
+    max_i = sizeof(invalid_table) / sizeof(*invalid_table);
+    for (i = 0; i < max_i; i++)
+    {
+        printf("\nrejecting %s... ", invalid_table[i]);
+        if (jtok_parse(invalid_table[i], tokens, TOKEN_MAX) !=
+                JTOK_PARSE_STATUS_OK ||
+            canonicalize(scratch, TOKEN_MAX) != JTOK_WRITE_STATUS_INVAL ||
+            canonicalize(NULL, 0) != JTOK_WRITE_STATUS_INVAL)
+        {
+            printf("failed.\n");
+            return 1;
+        }
+        printf("passed.\n");
+    }
+    return 0;
+}
@@ -0,0 +1,380 @@
+/**
+ * @file coroutine_events.test.cpp
+ * @author Carl Mattatall (cmattatall2@gmail.com)
+ * @brief Source module to test the C++20 coroutine event generator
+ * @version 0.1
+ * @date 2021-05-14
+ *
+ * @copyright Copyright (c) 2021 Carl Mattatall
+ *
+ */
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <type_traits>
+
+#include "jtok.h"
+#include "jtok_events.h"
+#include "jtok_events.hpp"
+
+#if defined(__cpp_impl_coroutine) && __cpp_impl_coroutine >= 201902L
+
+#define EVENT_MAX 200
+#define SCRATCH 32
+#define BUF_SIZE 24
+
+static const char *documents[] = {
+    "{}",
+    "  {\"a\" : 1, \"b\":[true,false,null], \"c\":{\"d\":\"e\"}}",
+    "{\"list\":[{\"id\":1,\"tags\":[\"x\",\"y\"]},{\"id\":2,\"tags\":[]}],"
+    "\"n\":-12.5e+3,\"p\":+7,'single':'it\"s'}",
+    "{\"nested\":[[1,2],[[3],[4,5]],[]],\"esc\":\"a\\\"b\\u00e9\\\\\"}\n",
+};
+
+static jtok_event_t expected[EVENT_MAX];
+static char         scratch[SCRATCH];
+static char         buffer[BUF_SIZE];
+
+
+/* A stream whose reads complete later, a few bytes at a time, when the test
+ * loop gets round to them */
+class async_stream
+{
+  public:
+    struct read_op
+    {
+        async_stream *  stream;
+        std::span<char> dst;
+        std::size_t     got;
+
+        bool await_ready() const noexcept
+        {
+            return false;
+        }
+        void await_suspend(std::coroutine_handle<> waiter) noexcept
+        {
+            stream->pending = this;
+            stream->waiter  = waiter;
+        }
+        std::size_t await_resume() const noexcept
+        {
+            return got;
+        }
+    };
+
+    async_stream(const char *json) : data(json), len(std::strlen(json))
+    {
+    }
+
+    read_op read(std::span<char> dst) noexcept
+    {
+        return read_op{this, dst, 0};
+    }
+
+    /* Finish the outstanding read, if any */
+    bool complete()
+    {
+        read_op *               op = std::exchange(pending, nullptr);
+        std::coroutine_handle<> h  = std::exchange(waiter, nullptr);
+        if (op == nullptr)
+        {
+            return false;
+        }
+
+        std::size_t n = 1 + reads++ % 7;
+        n             = std::min({n, op->dst.size(), len - pos});
+        std::memcpy(op->dst.data(), &data[pos], n);
+        pos += n;
+        op->got = n;
+        h.resume();
+        return true;
+    }
+
+    std::size_t reads = 0;
+
+  private:
+    const char *            data;
+    std::size_t             len;
+    std::size_t             pos     = 0;
+    read_op *               pending = nullptr;
+    std::coroutine_handle<> waiter;
+};
+
+
+/* A stream whose reads are always ready */
+class sync_stream
+{
+  public:
+    struct read_op
+    {
+        std::size_t got;
+
+        bool await_ready() const noexcept
+        {
+            return true;
+        }
+        void await_suspend(std::coroutine_handle<>) const noexcept
+        {
+        }
+        std::size_t await_resume() const noexcept
+        {
+            return got;
+        }
+    };
+
+    sync_stream(const char *json) : data(json), len(std::strlen(json))
+    {
+    }
+
+    read_op read(std::span<char> dst) noexcept
+    {
+        std::size_t n = std::min(dst.size(), len - pos);
+        std::memcpy(dst.data(), &data[pos], n);
+        pos += n;
+        return read_op{n};
+    }
+
+  private:
+    const char *data;
+    std::size_t len;
+    std::size_t pos = 0;
+};
+
+
+/* Counts the coroutine frames the generator allocates */
+class counting_resource : public std::pmr::memory_resource
+{
+  public:
+    std::size_t allocations = 0;
+    std::size_t live        = 0;
+
+  private:
+    void *do_allocate(std::size_t bytes, std::size_t align) override
+    {
+        allocations++;
+        live++;
+        return std::pmr::new_delete_resource()->allocate(bytes, align);
+    }
+    void do_deallocate(void *p, std::size_t bytes, std::size_t align) override
+    {
+        live--;
+        std::pmr::new_delete_resource()->deallocate(p, bytes, align);
+    }
+    bool do_is_equal(const std::pmr::memory_resource &other) const
+        noexcept override
+    {
+        return this == &other;
+    }
+};
+
+
+/* A fire-and-forget coroutine that the test loop runs to completion */
+struct task
+{
+    struct promise_type
+    {
+        task get_return_object() noexcept
+        {
+            return task{std::coroutine_handle<promise_type>::from_promise(*this)};
+        }
+        std::suspend_never initial_suspend() const noexcept
+        {
+            return {};
+        }
+        std::suspend_always final_suspend() const noexcept
+        {
+            return {};
+        }
+        void return_void() const noexcept
+        {
+        }
+        void unhandled_exception() const noexcept
+        {
+            std::terminate();
+        }
+    };
+
+    task(task &&other) noexcept : handle(std::exchange(other.handle, nullptr))
+    {
+    }
+    ~task()
+    {
+        if (handle)
+        {
+            handle.destroy();
+        }
+    }
+    bool done() const noexcept
+    {
+        return handle.done();
+    }
+
+    std::coroutine_handle<promise_type> handle;
+
+  private:
+    explicit task(std::coroutine_handle<promise_type> h) noexcept : handle(h)
+    {
+    }
+};
+
+
+struct result
+{
+    std::size_t         count    = 0;
+    std::size_t         mismatch = 0;
+    JTOK_PARSE_STATUS_t status   = JTOK_PARSE_STATUS_UNKNOWN_ERROR;
+};
+
+
+static int record(void *ctx, const jtok_event_t *ev)
+{
+    std::size_t *count = static_cast<std::size_t *>(ctx);
+    if (*count < EVENT_MAX)
+    {
+        expected[*count] = *ev;
+    }
+    (*count)++;
+    return 0;
+}
+
+
+/* The generator must produce what jtok_events_parse does, minus the END */
+static task consume(jtok::event_stream events, const char *json, result &res)
+{
+    while (const jtok_event_t *ev = co_await events.next())
+    {
+        if (res.count >= EVENT_MAX)
+        {
+            res.mismatch++;
+            continue;
+        }
+        const jtok_event_t *want = &expected[res.count++];
+        if (ev->type != want->type ||
+            ev->depth != want->depth || ev->start != want->start ||
+            ev->end != want->end || ev->value_len != want->value_len ||
+            (ev->type == JTOK_EVENT_NUMBER && ev->number != want->number) ||
+            (ev->text != nullptr &&
+             0 != std::memcmp(ev->text, &json[ev->start], ev->end - ev->start)))
+        {
+            res.mismatch++;
+        }
+    }
+    res.status = events.status();
+}
+
+
+template <typename Stream>
+static result run(Stream &stream, const char *json, std::size_t buf_size,
+                  counting_resource &frames)
+{
+    result res;
+    task   t = consume(jtok::events(stream, std::span<char>(buffer, buf_size),
+                                    std::span<char>(scratch), &frames),
+                       json, res);
+    if constexpr (std::is_same_v<Stream, async_stream>)
+    {
+        while (!t.done() && stream.complete())
+        {
+        }
+    }
+    if (!t.done())
+    {
+        res.status = JTOK_PARSE_STATUS_UNKNOWN_ERROR;
+    }
+    return res;
+}
+
+
+int main(void)
+{
+    counting_resource frames;
+    std::size_t       count;
+    std::size_t       i;
+
+    for (i = 0; i < sizeof(documents) / sizeof(*documents); i++)
+    {
+        count = 0;
+        jtok_events_parse(documents[i], std::strlen(documents[i]), record,
+                          &count, scratch, sizeof(scratch));
+
+        std::printf("\nstreaming document %zu through the generator... ", i);
+        async_stream stream(documents[i]);
+        frames.allocations = 0;
+        result res         = run(stream, documents[i], BUF_SIZE, frames);
+        if (res.status != JTOK_PARSE_STATUS_OK || res.mismatch != 0 ||
+            res.count + 1 != count || stream.reads < 2)
+        {
+            std::printf("failed. %s after %zu of %zu events\n",
+                        jtok_jtokerr_messages(res.status), res.count, count);
+            return 1;
+        }
+        if (frames.allocations != 1 || frames.live != 0)
+        {
+            std::printf("failed. %zu frames allocated, %zu leaked\n",
+                        frames.allocations, frames.live);
+            return 1;
+        }
+        std::printf("passed.\n");
+
+        std::printf("reading document %zu without suspending... ", i);
+        sync_stream ready(documents[i]);
+        res = run(ready, documents[i], BUF_SIZE, frames);
+        if (res.status != JTOK_PARSE_STATUS_OK || res.mismatch != 0 ||
+            res.count + 1 != count)
+        {
+            std::printf("failed. %s after %zu of %zu events\n",
+                        jtok_jtokerr_messages(res.status), res.count, count);
+            return 1;
+        }
+        std::printf("passed.\n");
+    }
+
+    std::printf("\nrunning out of buffer... ");
+    count = 0;
+    jtok_events_parse(documents[2], std::strlen(documents[2]), record, &count,
+                      scratch, sizeof(scratch));
+    async_stream small(documents[2]);
+    result       res = run(small, documents[2], 8, frames);
+    if (res.status != JTOK_PARSE_STATUS_NOMEM || res.mismatch != 0 ||
+        frames.live != 0)
+    {
+        std::printf("failed. %s\n", jtok_jtokerr_messages(res.status));
+        return 1;
+    }
+    std::printf("passed.\n");
+
+    std::printf("\nreporting parse errors... ");
+    const char *bad = "{\"a\":1,\"b\" \"c\"}";
+    count           = 0;
+    jtok_events_parse(bad, std::strlen(bad), record, &count, scratch,
+                      sizeof(scratch));
+    async_stream broken(bad);
+    res = run(broken, bad, BUF_SIZE, frames);
+    if (res.status != JTOK_PARSE_STATUS_VAL_NO_COLON || res.mismatch != 0 ||
+        res.count != 4)
+    {
+        std::printf("failed. %s after %zu events\n",
+                    jtok_jtokerr_messages(res.status), res.count);
+        return 1;
+    }
+    async_stream truncated("{\"a\":[1,2");
+    res = run(truncated, "{\"a\":[1,2", BUF_SIZE, frames);
+    if (res.status != JTOK_PARSE_STATUS_PARTIAL_TOKEN || frames.live != 0)
+    {
+        std::printf("failed. %s for a truncated document\n",
+                    jtok_jtokerr_messages(res.status));
+        return 1;
+    }
+    std::printf("passed.\n");
+    return 0;
+}
+
+#else
+
+int main(void)
+{
+    std::printf("C++20 coroutines are not available. Nothing to test.\n");
+    return 0;
+}
+
+#endif /* __cpp_impl_coroutine */
@@ -0,0 +1,408 @@
+/**
+ * @file decompress.test.c
+ * @author Carl Mattatall (cmattatall2@gmail.com)
+ * @brief Source module to test event parsing of compressed json
+ * @version 0.1
+ * @date 2021-05-16
+ *
+ * @copyright Copyright (c) 2021 Carl Mattatall
+ *
+ */
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(JTOK_HAVE_ZLIB)
+#include <zlib.h>
+#endif /* #if defined(JTOK_HAVE_ZLIB) */
+
+#if defined(JTOK_HAVE_ZSTD)
+#include <zstd.h>
+#endif /* #if defined(JTOK_HAVE_ZSTD) */
+
+#include "jtok.h"
+#include "jtok_decompress.h"
+#include "jtok_events.h"
+
+#define EVENT_MAX 8192
+#define SCRATCH 256
+#define TEXT_MAX (64 * 1024)
+#define PACKED_MAX (2 * TEXT_MAX)
+#define IN_MAX 4096
+#define WINDOW_MAX 4096
+
+typedef struct
+{
+    JTOK_EVENT_t type;
+    int          depth;
+    size_t       start;
+    size_t       end;
+    uint32_t     value; /* hash of the decoded value */
+    double       number;
+} record_t;
+
+typedef struct
+{
+    record_t records[EVENT_MAX];
+    size_t   count;
+    size_t   stop_after; /* 0 to never stop */
+} log_t;
+
+/* The compressed stream, handed out a few bytes at a time */
+typedef struct
+{
+    const char *data;
+    size_t      len;
+    size_t      pos;
+    size_t      step;
+} reader_t;
+
+static char   text[TEXT_MAX];
+static size_t text_len;
+static char   in[IN_MAX];
+static char   window[WINDOW_MAX];
+static char   scratch[SCRATCH];
+static log_t  expected;
+static log_t  actual;
+
+#if defined(JTOK_HAVE_ZLIB) || defined(JTOK_HAVE_ZSTD)
+static char packed[PACKED_MAX];
+#endif /* #if defined(JTOK_HAVE_ZLIB) || defined(JTOK_HAVE_ZSTD) */
+
+
+static uint32_t hash(const char *data, size_t len)
+{
+    uint32_t h = 2166136261u;
+    size_t   i;
+    for (i = 0; data != NULL && i < len; i++)
+    {
+        h = (h ^ (uint8_t)data[i]) * 16777619u;
+    }
+    return h;
+}
+
+
+static int record(void *ctx, const jtok_event_t *ev)
+{
+    log_t *   log = (log_t *)ctx;
+    record_t *rec = &log->records[log->count % EVENT_MAX];
+    rec->type     = ev->type;
+    rec->depth    = ev->depth;
+    rec->start    = ev->start;
+    rec->end      = ev->end;
+    rec->value    = hash(ev->value, ev->value_len);
+    rec->number   = (ev->type == JTOK_EVENT_NUMBER) ? ev->number : 0;
+    log->count++;
+    return log->stop_after != 0 && log->count == log->stop_after;
+}
+
+
+static size_t read_some(void *ctx, char *buf, size_t len)
+{
+    reader_t *r = (reader_t *)ctx;
+    size_t    n = r->len - r->pos;
+    if (n > len)
+    {
+        n = len;
+    }
+    if (n > r->step)
+    {
+        n = r->step;
+    }
+    memcpy(buf, &r->data[r->pos], n);
+    r->pos += n;
+    return n;
+}
+
+
+static size_t make_document(char *buf)
+{
+    size_t   len = 0;
+    unsigned i;
+    len += (size_t)sprintf(&buf[len], "{\"records\":[");
+    for (i = 0; i < 300; i++)
+    {
+        len += (size_t)sprintf(&buf[len],
+                               "%s\n  {\"id\":%u,\"name\":\"item \\\"%u\\\"\","
+                               "\"score\":%u.25e-1,\"tags\":[\"t%u\",\"u%u\"],"
+                               "\"ok\":%s,\"none\":null,\"deep\":{\"a\":[[%u]]}}",
+                               (i > 0) ? "," : "", i, i * 7, i * 13, i % 5,
+                               i % 3, (i & 1) ? "true" : "false", i);
+    }
+    len += (size_t)sprintf(&buf[len], "],\"count\":300}\n");
+    return len;
+}
+
+
+static JTOK_PARSE_STATUS_t run(JTOK_CODEC_t codec, const char *data,
+                               size_t len, size_t step, size_t in_len,
+                               size_t window_len)
+{
+    jtok_decompress_config_t config;
+    reader_t                 reader;
+
+    config.codec       = codec;
+    config.in          = in;
+    config.in_len      = in_len;
+    config.window      = window;
+    config.window_len  = window_len;
+    config.scratch     = scratch;
+    config.scratch_len = SCRATCH;
+    reader.data        = data;
+    reader.len         = len;
+    reader.pos         = 0;
+    reader.step        = step;
+    actual.count       = 0;
+    return jtok_decompress_events(&config, read_some, &reader, record, &actual);
+}
+
+
+static int same(void)
+{
+    size_t i;
+    if (actual.count != expected.count)
+    {
+        printf("failed. %u events instead of %u\n", (unsigned)actual.count,
+               (unsigned)expected.count);
+        return 0;
+    }
+    for (i = 0; i < expected.count; i++)
+    {
+        const record_t *x = &expected.records[i];
+        const record_t *y = &actual.records[i];
+        if (x->type != y->type || x->depth != y->depth ||
+            x->start != y->start || x->end != y->end ||
+            x->value != y->value || x->number != y->number)
+        {
+            printf("failed. event %u differs\n", (unsigned)i);
+            return 0;
+        }
+    }
+    return 1;
+}
+
+
+/* Every reader step and buffer size must give the events of the plain text */
+static int sweep(const char *name, JTOK_CODEC_t codec, const char *data,
+                 size_t len)
+{
+    static const size_t steps[]   = {1, 7, 4096};
+    static const size_t windows[] = {64, 100, WINDOW_MAX};
+    static const size_t ins[]     = {JTOK_DECOMPRESS_MIN_IN, 9, IN_MAX};
+    JTOK_PARSE_STATUS_t status;
+    size_t              s;
+    size_t              w;
+    size_t              i;
+
+    for (s = 0; s < sizeof(steps) / sizeof(*steps); s++)
+    {
+        for (w = 0; w < sizeof(windows) / sizeof(*windows); w++)
+        {
+            for (i = 0; i < sizeof(ins) / sizeof(*ins); i++)
+            {
+                printf("\nparsing %s read %u at a time, %u byte input, "
+                       "%u byte window... ",
+                       name, (unsigned)steps[s], (unsigned)ins[i],
+                       (unsigned)windows[w]);
+                status = run(codec, data, len, steps[s], ins[i], windows[w]);
+                if (status != JTOK_PARSE_STATUS_OK)
+                {
+                    printf("failed. %s\n", jtok_jtokerr_messages(status));
+                    return 0;
+                }
+                if (!same())
+                {
+                    return 0;
+                }
+                printf("passed.\n");
+            }
+        }
+    }
+    return 1;
+}
+
+
+#if defined(JTOK_HAVE_ZLIB)
+/* gzip the text as one member per piece */
+static size_t gzip_pieces(char *dst, size_t dst_len, const char *src,
+                          size_t len, unsigned pieces)
+{
+    z_stream z;
+    size_t   out = 0;
+    unsigned p;
+    for (p = 0; p < pieces; p++)
+    {
+        size_t from = len * p / pieces;
+        size_t to   = len * (p + 1) / pieces;
+        memset(&z, 0, sizeof(z));
+        if (deflateInit2(&z, Z_BEST_COMPRESSION, Z_DEFLATED, MAX_WBITS + 16,
+                         8, Z_DEFAULT_STRATEGY) != Z_OK)
+        {
+            return 0;
+        }
+        z.next_in   = (Bytef *)&src[from];
+        z.avail_in  = (uInt)(to - from);
+        z.next_out  = (Bytef *)&dst[out];
+        z.avail_out = (uInt)(dst_len - out);
+        if (deflate(&z, Z_FINISH) != Z_STREAM_END)
+        {
+            deflateEnd(&z);
+            return 0;
+        }
+        out += z.total_out;
+        deflateEnd(&z);
+    }
+    return out;
+}
+#endif /* #if defined(JTOK_HAVE_ZLIB) */
+
+
+int main(void)
+{
+    JTOK_PARSE_STATUS_t      status;
+    jtok_decompress_config_t config;
+#if defined(JTOK_HAVE_ZLIB) || defined(JTOK_HAVE_ZSTD)
+    size_t packed_len;
+#endif /* #if defined(JTOK_HAVE_ZLIB) || defined(JTOK_HAVE_ZSTD) */
+
+    text_len = make_document(text);
+    status   = jtok_events_parse(text, text_len, record, &expected, scratch,
+                               SCRATCH);
+    if (status != JTOK_PARSE_STATUS_OK)
+    {
+        printf("could not parse the reference document\n");
+        return 1;
+    }
+
+    if (!sweep("plain json", JTOK_CODEC_NONE, text, text_len) ||
+        !sweep("plain json (detected)", JTOK_CODEC_AUTO, text, text_len))
+    {
+        return 1;
+    }
+
+#if defined(JTOK_HAVE_ZLIB)
+    packed_len = gzip_pieces(packed, PACKED_MAX, text, text_len, 1);
+    if (packed_len == 0 || !sweep("gzip", JTOK_CODEC_GZIP, packed, packed_len) ||
+        !sweep("gzip (detected)", JTOK_CODEC_AUTO, packed, packed_len))
+    {
+        return 1;
+    }
+
+    packed_len = gzip_pieces(packed, PACKED_MAX, text, text_len, 3);
+    if (packed_len == 0 ||
+        !sweep("three gzip members", JTOK_CODEC_AUTO, packed, packed_len))
+    {
+        return 1;
+    }
+
+    printf("\nreporting a gzip stream that is cut short... ");
+    packed_len = gzip_pieces(packed, PACKED_MAX, text, text_len, 1);
+    status     = run(JTOK_CODEC_AUTO, packed, packed_len / 2, 7, 64, 64);
+    if (status != JTOK_PARSE_STATUS_IO_ERROR)
+    {
+        printf("failed. %s\n", jtok_jtokerr_messages(status));
+        return 1;
+    }
+    printf("passed.\n");
+
+    printf("\nreporting a corrupt gzip stream... ");
+    packed[2] = 7; /* not deflate */
+    status    = run(JTOK_CODEC_AUTO, packed, packed_len, 7, 64, 64);
+    if (status != JTOK_PARSE_STATUS_IO_ERROR)
+    {
+        printf("failed. %s\n", jtok_jtokerr_messages(status));
+        return 1;
+    }
+    printf("passed.\n");
+#else
+    printf("\nrejecting gzip when it is not built in... ");
+    if (jtok_codec_available(JTOK_CODEC_GZIP) ||
+        run(JTOK_CODEC_GZIP, text, text_len, 7, 64, 64) !=
+            JTOK_PARSE_STATUS_INVAL)
+    {
+        printf("failed.\n");
+        return 1;
+    }
+    printf("passed.\n");
+#endif /* #if defined(JTOK_HAVE_ZLIB) */
+
+#if defined(JTOK_HAVE_ZSTD)
+    packed_len = ZSTD_compress(packed, PACKED_MAX, text, text_len / 2, 3);
+    packed_len += ZSTD_compress(&packed[packed_len], PACKED_MAX - packed_len,
+                                &text[text_len / 2], text_len - text_len / 2,
+                                19);
+    if (!sweep("zstd", JTOK_CODEC_ZSTD, packed, packed_len) ||
+        !sweep("zstd (detected)", JTOK_CODEC_AUTO, packed, packed_len))
+    {
+        return 1;
+    }
+
+    printf("\nreporting a zstd stream that is cut short... ");
+    status = run(JTOK_CODEC_AUTO, packed, packed_len - 3, 7, 64, 64);
+    if (status != JTOK_PARSE_STATUS_IO_ERROR)
+    {
+        printf("failed. %s\n", jtok_jtokerr_messages(status));
+        return 1;
+    }
+    printf("passed.\n");
+#else
+    printf("\nrejecting zstd when it is not built in... ");
+    if (jtok_codec_available(JTOK_CODEC_ZSTD) ||
+        run(JTOK_CODEC_ZSTD, text, text_len, 7, 64, 64) !=
+            JTOK_PARSE_STATUS_INVAL)
+    {
+        printf("failed.\n");
+        return 1;
+    }
+    printf("passed.\n");
+#endif /* #if defined(JTOK_HAVE_ZSTD) */
+
+    printf("\nreporting a value too long for the window... ");
+    status = run(JTOK_CODEC_NONE, text, text_len, 4096, IN_MAX, 8);
+    if (status != JTOK_PARSE_STATUS_NOMEM)
+    {
+        printf("failed. %s\n", jtok_jtokerr_messages(status));
+        return 1;
+    }
+    printf("passed.\n");
+
+    printf("\nreporting a document that is cut short... ");
+    status = run(JTOK_CODEC_NONE, text, text_len / 2, 7, 64, 64);
+    if (status != JTOK_PARSE_STATUS_PARTIAL_TOKEN)
+    {
+        printf("failed. %s\n", jtok_jtokerr_messages(status));
+        return 1;
+    }
+    printf("passed.\n");
+
+    printf("\nstopping early... ");
+    actual.stop_after = 10;
+    status            = run(JTOK_CODEC_NONE, text, text_len, 7, 64, 64);
+    actual.stop_after = 0;
+    if (status != JTOK_PARSE_STATUS_OK || actual.count != 10)
+    {
+        printf("failed. %s\n", jtok_jtokerr_messages(status));
+        return 1;
+    }
+    printf("passed.\n");
+
+    printf("\nrejecting bad configurations... ");
+    memset(&config, 0, sizeof(config));
+    config.in     = in;
+    config.window = window;
+    if (jtok_decompress_events(&config, read_some, NULL, record, &actual) !=
+            JTOK_PARSE_STATUS_INVAL ||
+        jtok_decompress_events(NULL, read_some, NULL, record, &actual) !=
+            JTOK_PARSE_STATUS_NULL_PARAM ||
+        jtok_decompress_events(&config, NULL, NULL, record, &actual) !=
+            JTOK_PARSE_STATUS_NULL_PARAM ||
+        jtok_decompress_events(&config, read_some, NULL, NULL, &actual) !=
+            JTOK_PARSE_STATUS_NULL_PARAM)
+    {
+        printf("failed.\n");
+        return 1;
+    }
+    printf("passed.\n");
+
+    return 0;
+}
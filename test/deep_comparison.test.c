@@ -0,0 +1,166 @@
+/**
+ * @file deep_comparison.test.c
+ * @author Carl Mattatall (cmattatall2@gmail.com)
+ * @brief Source module to test deep comparison of nested jtok documents
+ * @version 0.1
+ * @date 2021-04-10
+ *
+ * @copyright Copyright (c) 2021 Carl Mattatall
+ *
+ */
+#include <stdio.h>
+#include <string.h>
+
+#include "jtok.h"
+
+#define TOKEN_MAX 200
+#define BIG_KEY_COUNT 2000
+#define MID_KEY_COUNT 100 /* more than the old 64, fits the stack table */
+#define BIG_TOKEN_MAX (2 * BIG_KEY_COUNT + 1)
+#define BIG_JSON_LEN (BIG_KEY_COUNT * 24)
+
+/* clang-format off */
+static const struct
+{
+    char json1[250];
+    char json2[250];
+    bool equal;
+} cmp_table[] = {
+    {.json1 = "{}", .json2 = "{ }", .equal = true},
+    {.json1 = "{\"a\":{\"x\":1,\"y\":[1,2]},\"b\":2}", .json2 = "{\"b\":2,\"a\":{\"y\":[1,2],\"x\":1}}", .equal = true},
+    {.json1 = "{\"a\":[{\"k\":1,\"j\":2},{}]}", .json2 = "{\"a\":[{\"j\":2,\"k\":1},{}]}", .equal = true},
+    {.json1 = "{\"a\":[[1],[2,3]]}", .json2 = "{\"a\":[ [1], [2, 3] ]}", .equal = true},
+    {.json1 = "{\"a\":1.0}", .json2 = "{\"a\":1e0}", .equal = true},
+    {.json1 = "{\"a\":true,\"b\":null}", .json2 = "{\"b\":null,\"a\":true}", .equal = true},
+    {.json1 = "{\"a\":1,\"a\":2}", .json2 = "{\"a\":2,\"a\":1}", .equal = true},
+    {.json1 = "{\"a\":1,\"b\":[2],\"a\":1}", .json2 = "{\"a\":1,\"a\":1,\"b\":[2]}", .equal = true},
+
+    {.json1 = "{\"a\":1}", .json2 = "{\"a\":5}", .equal = false},
+    {.json1 = "{\"a\":1}", .json2 = "{\"b\":1}", .equal = false},
+    {.json1 = "{\"a\":1}", .json2 = "{\"a\":\"1\"}", .equal = false},
+    {.json1 = "{\"a\":true}", .json2 = "{\"a\":false}", .equal = false},
+    {.json1 = "{\"a\":[1,2]}", .json2 = "{\"a\":[2,1]}", .equal = false},
+    {.json1 = "{\"a\":[1,2]}", .json2 = "{\"a\":[1,2,3]}", .equal = false},
+    {.json1 = "{\"a\":{\"x\":1}}", .json2 = "{\"a\":{\"x\":1,\"y\":2}}", .equal = false},
+    {.json1 = "{\"a\":[{\"k\":1},{}]}", .json2 = "{\"a\":[{},{\"k\":1}]}", .equal = false},
+    {.json1 = "{\"a\":1,\"a\":2}", .json2 = "{\"a\":1}", .equal = false},
+    {.json1 = "{\"a\":1,\"a\":1}", .json2 = "{\"a\":1,\"b\":1}", .equal = false},
+    {.json1 = "{\"a\":1,\"a\":2}", .json2 = "{\"a\":1,\"a\":1}", .equal = false},
+    {.json1 = "{\"a\":{\"b\":{\"c\":[1,{\"d\":2}]}}}", .json2 = "{\"a\":{\"b\":{\"c\":[1,{\"d\":3}]}}}", .equal = false},
+};
+/* clang-format on */
+
+static jtok_tkn_t tokens1[TOKEN_MAX];
+static jtok_tkn_t tokens2[TOKEN_MAX];
+
+static char       big_json1[BIG_JSON_LEN];
+static char       big_json2[BIG_JSON_LEN];
+static jtok_tkn_t big_tokens1[BIG_TOKEN_MAX];
+static jtok_tkn_t big_tokens2[BIG_TOKEN_MAX];
+static jtok_off_t scratch[2 * BIG_KEY_COUNT];
+
+
+static void build_big_json(char *buf, int count, bool reversed,
+                           int changed_key)
+{
+    int    i;
+    size_t len = 0;
+    buf[len++] = '{';
+    for (i = 0; i < count; i++)
+    {
+        int key = reversed ? count - 1 - i : i;
+        len += sprintf(&buf[len], "%s\"key%d\":%d", (i > 0) ? "," : "", key,
+                       (key == changed_key) ? -1 : key);
+    }
+    buf[len++] = '}';
+    buf[len]   = '\0';
+}
+
+
+static int check_big(int count, int changed_key, bool expected)
+{
+    build_big_json(big_json1, count, false, -1);
+    build_big_json(big_json2, count, true, changed_key);
+    if (jtok_parse(big_json1, big_tokens1, BIG_TOKEN_MAX) !=
+            JTOK_PARSE_STATUS_OK ||
+        jtok_parse(big_json2, big_tokens2, BIG_TOKEN_MAX) !=
+            JTOK_PARSE_STATUS_OK)
+    {
+        printf("parse of large object failed\n");
+        return 1;
+    }
+
+    /* With a key table in caller scratch, with the default stack table,
+     * and with no scratch at all (the linear search) */
+    if (jtok_toktokcmp_scratch(big_tokens1, big_tokens2, scratch,
+                               sizeof(scratch) / sizeof(*scratch)) != expected)
+    {
+        printf("large object hashed comparison failed\n");
+        return 1;
+    }
+
+    if (jtok_toktokcmp(big_tokens1, big_tokens2) != expected ||
+        jtok_toktokcmp(big_tokens2, big_tokens1) != expected)
+    {
+        printf("large object default comparison failed\n");
+        return 1;
+    }
+
+    if (jtok_toktokcmp_scratch(big_tokens1, big_tokens2, NULL, 0) != expected)
+    {
+        printf("large object linear comparison failed\n");
+        return 1;
+    }
+    return 0;
+}
+
+
+int main(void)
+{
+    unsigned long long  i;
+    unsigned long long  max_i = sizeof(cmp_table) / sizeof(*cmp_table);
+    JTOK_PARSE_STATUS_t status;
+    for (i = 0; i < max_i; i++)
+    {
+        const char *json1 = cmp_table[i].json1;
+        const char *json2 = cmp_table[i].json2;
+        printf("\ncomparing %s and %s... ", json1, json2);
+
+        status = jtok_parse(json1, tokens1, TOKEN_MAX);
+        if (status != JTOK_PARSE_STATUS_OK)
+        {
+            printf("parse of %s failed with status %d\n", json1, status);
+            return 1;
+        }
+
+        status = jtok_parse(json2, tokens2, TOKEN_MAX);
+        if (status != JTOK_PARSE_STATUS_OK)
+        {
+            printf("parse of %s failed with status %d\n", json2, status);
+            return 1;
+        }
+
+        if (jtok_toktokcmp(tokens1, tokens2) != cmp_table[i].equal ||
+            jtok_toktokcmp(tokens2, tokens1) != cmp_table[i].equal ||
+            jtok_toktokcmp_scratch(tokens1, tokens2, NULL, 0) !=
+                cmp_table[i].equal ||
+            jtok_toktokcmp_scratch(tokens2, tokens1, NULL, 0) !=
+                cmp_table[i].equal)
+        {
+            printf("failed.\n");
+            return 1;
+        }
+        printf("passed.\n");
+    }
+
+    printf("\ncomparing large reordered objects... ");
+    if (check_big(MID_KEY_COUNT, -1, true) != 0 ||
+        check_big(MID_KEY_COUNT, MID_KEY_COUNT / 2, false) != 0 ||
+        check_big(BIG_KEY_COUNT, -1, true) != 0 ||
+        check_big(BIG_KEY_COUNT, BIG_KEY_COUNT / 2, false) != 0)
+    {
+        return 1;
+    }
+    printf("passed.\n");
+    return 0;
+}
@@ -0,0 +1,352 @@
+/**
+ * @file events.test.c
+ * @author Carl Mattatall (cmattatall2@gmail.com)
+ * @brief Source module to test event (SAX-style) parsing
+ * @version 0.1
+ * @date 2021-05-13
+ *
+ * @copyright Copyright (c) 2021 Carl Mattatall
+ *
+ */
+#include <stdio.h>
+#include <string.h>
+
+#include "jtok.h"
+#include "jtok_events.h"
+
+#define TOKEN_MAX 200
+#define EVENT_MAX 200
+#define SCRATCH 32
+
+static const char *documents[] = {
+    "{}",
+    "  {\"a\" : 1, \"b\":[true,false,null], \"c\":{\"d\":\"e\"}}",
+    "{\"list\":[{\"id\":1,\"tags\":[\"x\",\"y\"]},{\"id\":2,\"tags\":[]}],"
+    "\"n\":-12.5e+3,\"p\":+7,'single':'it\"s'}",
+    "{\"nested\":[[1,2],[[3],[4,5]],[]],\"esc\":\"a\\\"b\\u00e9\\\\\"}\n",
+};
+
+/* clang-format off */
+static const struct
+{
+    const char *        json;
+    JTOK_PARSE_STATUS_t status;
+} invalid[] = {
+    {"[1,2]",                JTOK_PARSE_STATUS_NON_OBJECT},
+    {"   ",                  JTOK_PARSE_STATUS_NON_OBJECT},
+    {"{\"a\":1,}",           JTOK_PARSE_STATUS_COMMA_NO_KEY},
+    {"{\"a\" \"b\"}",         JTOK_PARSE_STATUS_VAL_NO_COLON},
+    {"{\"a\"}",              JTOK_PARSE_STATUS_KEY_NO_VAL},
+    {"{\"\":1}",             JTOK_PARSE_STATUS_EMPTY_KEY},
+    {"{{}}",                 JTOK_PARSE_STATUS_OBJ_NOKEY},
+    {"{\"a\":[1,\"x\"]}",    JTOK_STATUS_MIXED_ARRAY},
+    {"{\"a\":[\"x\",1]}",    JTOK_STATUS_MIXED_ARRAY},
+    {"{\"a\":[1 2]}",        JTOK_PARSE_STATUS_STRAY_COMMA},
+    {"{\"a\":[x]}",          JTOK_PARSE_STATUS_INVAL},
+    {"{\"a\":[1,,2]}",       JTOK_PARSE_STATUS_STRAY_COMMA},
+    {"{\"a\":tru}",          JTOK_PARSE_STATUS_INVALID_PRIMITIVE},
+    {"{\"a\":1.}",           JTOK_PARSE_STATUS_INVALID_PRIMITIVE},
+    {"{\"a\":\"\\q\"}",      JTOK_PARSE_STATUS_INVAL},
+    {"{\"a\":\"\\u12g4\"}",  JTOK_PARSE_STATUS_INVAL},
+    {"{\"a\":1 \"b\":2}",    JTOK_PARSE_STATUS_VAL_NO_COMMA},
+    {"{\"a\":1 :2}",         JTOK_PARSE_STATUS_INVAL},
+    {"{\"a\":1",             JTOK_PARSE_STATUS_PARTIAL_TOKEN},
+    {"{\"a\":\"xyz",         JTOK_PARSE_STATUS_PARTIAL_TOKEN},
+};
+/* clang-format on */
+
+/* Documents the events parser must treat exactly as jtok_parse does */
+static const char *differential[] = {
+    "{\"a\":-}",      "{\"a\":+}",        "{\"a\":[1,-,2]}", "{\"a\":\v1}",
+    "{\"a\":\f1}",    "{\"a\":0x1F}",     "{\"a\":.5}",      "{\"a\":e9}",
+    "{\"a\":1e}",     "{\"a\":12true}",   "{\"a\":truex}",   "{\"a\":1.2.3}",
+    "{\"a\":1e+9.1}", "{\"a\":-e9}",      "{\"a\":1 2}",     "{\"a\" \"b\"}",
+    "{\"a\" ,}",      "{\"a\" 1}",        "{\"a\":,}",       "{\"a\":]}",
+    "{\"a\":1,,}",    "{123}",            "{,}",             "{:1}",
+    "{\"a\":1 {}}",   "{\"a\":[\"x\" 1]}", "{\"a\":[{} []]}", "\v{\"a\":1}\f",
+};
+
+static jtok_tkn_t   tokens[TOKEN_MAX];
+static jtok_event_t events[EVENT_MAX];
+static char         scratch[SCRATCH];
+
+
+static int record(void *ctx, const jtok_event_t *ev)
+{
+    size_t *count = (size_t *)ctx;
+    if (*count < EVENT_MAX)
+    {
+        events[*count] = *ev;
+    }
+    (*count)++;
+    return 0;
+}
+
+
+static int stop_at_third(void *ctx, const jtok_event_t *ev)
+{
+    (void)ev;
+    return ++*(size_t *)ctx == 3;
+}
+
+
+/* Events must describe exactly the tokens jtok_parsen builds */
+static bool matches_tokens(const char *json, size_t count)
+{
+    int    open[JTOK_MAX_RECURSE_DEPTH + 1];
+    int    depth = 0;
+    int    next  = 0;
+    size_t i;
+
+    if (jtok_parsen(json, strlen(json), tokens, TOKEN_MAX) !=
+            JTOK_PARSE_STATUS_OK ||
+        count == 0 || events[count - 1].type != JTOK_EVENT_END)
+    {
+        return false;
+    }
+    for (i = 0; i + 1 < count; i++)
+    {
+        const jtok_event_t *ev = &events[i];
+        const jtok_tkn_t *  tkn;
+        JTOK_TYPE_t         type;
+        switch (ev->type)
+        {
+            case JTOK_EVENT_OBJECT_END:
+            case JTOK_EVENT_ARRAY_END:
+            {
+                tkn = &tokens[open[--depth]];
+                if (ev->depth != depth || (size_t)tkn->start != ev->start ||
+                    (size_t)tkn->end != ev->end)
+                {
+                    return false;
+                }
+                continue;
+            }
+            break;
+            case JTOK_EVENT_OBJECT_START:
+            {
+                type = JTOK_OBJECT;
+            }
+            break;
+            case JTOK_EVENT_ARRAY_START:
+            {
+                type = JTOK_ARRAY;
+            }
+            break;
+            case JTOK_EVENT_KEY:
+            case JTOK_EVENT_STRING:
+            {
+                type = JTOK_STRING;
+            }
+            break;
+            default:
+            {
+                type = JTOK_PRIMITIVE;
+            }
+            break;
+        }
+
+        tkn = &tokens[next];
+        if (tkn->type != type || (size_t)tkn->start != ev->start ||
+            ev->depth != depth ||
+            (type != JTOK_OBJECT && type != JTOK_ARRAY &&
+             (size_t)tkn->end != ev->end) ||
+            (ev->type == JTOK_EVENT_KEY) != jtok_tokenIsKey(*tkn))
+        {
+            return false;
+        }
+        if (type == JTOK_OBJECT || type == JTOK_ARRAY)
+        {
+            open[depth++] = next;
+        }
+        next++;
+    }
+    return depth == 0 && tokens[next].type == JTOK_UNASSIGNED_TOKEN;
+}
+
+
+/* Feed the document one more byte at a time, giving the parser only the
+ * bytes it still needs */
+static bool matches_bytewise(const char *json, size_t count)
+{
+    jtok_events_t       parser;
+    jtok_event_t        ev;
+    JTOK_PARSE_STATUS_t status;
+    size_t              len = strlen(json);
+    size_t              avail;
+    size_t              i = 0;
+    size_t              from;
+
+    jtok_events_init(&parser, scratch, sizeof(scratch));
+    for (avail = 0; avail <= len; avail++)
+    {
+        from = jtok_events_offset(&parser);
+        jtok_events_input(&parser, &json[from], avail - from, avail == len);
+        while ((status = jtok_events_next(&parser, &ev)) ==
+               JTOK_PARSE_STATUS_OK)
+        {
+            if (i >= count || ev.type != events[i].type ||
+                ev.start != events[i].start || ev.end != events[i].end ||
+                ev.value_len != events[i].value_len)
+            {
+                return false;
+            }
+            if (ev.type == JTOK_EVENT_END)
+            {
+                return i + 1 == count;
+            }
+            i++;
+        }
+        if (status != JTOK_PARSE_STATUS_PARTIAL_TOKEN)
+        {
+            return false;
+        }
+    }
+    return false;
+}
+
+
+int main(void)
+{
+    jtok_events_t       parser;
+    jtok_event_t        ev;
+    JTOK_PARSE_STATUS_t status;
+    size_t              count;
+    size_t              i;
+    size_t              levels;
+    char                deep[6 * (JTOK_MAX_RECURSE_DEPTH + 2) + 2];
+
+    for (i = 0; i < sizeof(documents) / sizeof(*documents); i++)
+    {
+        printf("\nchecking events of document %zu against its tokens... ", i);
+        count  = 0;
+        status = jtok_events_parse(documents[i], strlen(documents[i]), record,
+                                   &count, scratch, sizeof(scratch));
+        if (status != JTOK_PARSE_STATUS_OK || count > EVENT_MAX ||
+            !matches_tokens(documents[i], count))
+        {
+            printf("failed. %s after %zu events\n",
+                   jtok_jtokerr_messages(status), count);
+            return 1;
+        }
+        printf("passed.\n");
+
+        printf("feeding document %zu one byte at a time... ", i);
+        if (!matches_bytewise(documents[i], count))
+        {
+            printf("failed.\n");
+            return 1;
+        }
+        printf("passed.\n");
+    }
+
+    printf("\ndecoding values... ");
+    count = 0;
+    jtok_events_parse(documents[3], strlen(documents[3]), record, &count,
+                      scratch, sizeof(scratch));
+    if (events[count - 3].type != JTOK_EVENT_STRING ||
+        events[count - 3].value_len != 6 ||
+        0 != memcmp(events[count - 3].value, "a\"b\xc3\xa9\\", 6) ||
+        events[count - 3].text !=
+            &documents[3][events[count - 3].start])
+    {
+        printf("failed. escaped string\n");
+        return 1;
+    }
+    count = 0;
+    jtok_events_parse(documents[3], strlen(documents[3]), record, &count,
+                      scratch, 4);
+    if (events[count - 3].value != NULL)
+    {
+        printf("failed. decoded into a scratch buffer that is too small\n");
+        return 1;
+    }
+    count = 0;
+    jtok_events_parse(documents[2], strlen(documents[2]), record, &count, NULL,
+                      0);
+    for (i = 0; i < count && events[i].type != JTOK_EVENT_NUMBER; i++)
+    {
+    }
+    if (i == count || events[i].number != 1 || events[i + 9].number != 2 ||
+        events[count - 7].number != -12500 || events[count - 5].number != 7 ||
+        events[count - 3].value_len != 4 ||
+        0 != memcmp(events[count - 3].value, "it\"s", 4))
+    {
+        printf("failed. numbers or unescaped strings\n");
+        return 1;
+    }
+    printf("passed.\n");
+
+    printf("\nrejecting invalid documents... ");
+    for (i = 0; i < sizeof(invalid) / sizeof(*invalid); i++)
+    {
+        jtok_events_init(&parser, NULL, 0);
+        jtok_events_input(&parser, invalid[i].json, strlen(invalid[i].json),
+                          true);
+        while ((status = jtok_events_next(&parser, &ev)) ==
+               JTOK_PARSE_STATUS_OK)
+        {
+        }
+        if (status != invalid[i].status ||
+            jtok_events_next(&parser, &ev) != invalid[i].status)
+        {
+            printf("failed. %s gave %s\n", invalid[i].json,
+                   jtok_jtokerr_messages(status));
+            return 1;
+        }
+    }
+    printf("passed.\n");
+
+    printf("\nreporting the statuses jtok_parse does... ");
+    for (i = 0; i < sizeof(differential) / sizeof(*differential); i++)
+    {
+        count  = 0;
+        status = jtok_events_parse(differential[i], strlen(differential[i]),
+                                   record, &count, NULL, 0);
+        if (status != jtok_parse(differential[i], tokens, TOKEN_MAX))
+        {
+            printf("failed. %s gave %s\n", differential[i],
+                   jtok_jtokerr_messages(status));
+            return 1;
+        }
+    }
+    printf("passed.\n");
+
+    printf("\nlimiting nesting as jtok_parse does... ");
+    for (levels = JTOK_MAX_RECURSE_DEPTH; levels <= JTOK_MAX_RECURSE_DEPTH + 2;
+         levels++)
+    {
+        size_t len = 0;
+        for (i = 0; i < levels; i++)
+        {
+            len += (size_t)sprintf(&deep[len], "{\"a\":");
+        }
+        deep[len++] = '1';
+        for (i = 0; i < levels; i++)
+        {
+            deep[len++] = '}';
+        }
+        count = 0;
+        if (jtok_events_parse(deep, len, record, &count, NULL, 0) !=
+            jtok_parsen(deep, len, tokens, TOKEN_MAX))
+        {
+            printf("failed. %zu levels\n", levels);
+            return 1;
+        }
+    }
+    printf("passed.\n");
+
+    printf("\nstopping early... ");
+    count = 0;
+    if (jtok_events_parse(documents[1], strlen(documents[1]), stop_at_third,
+                          &count, NULL, 0) != JTOK_PARSE_STATUS_OK ||
+        count != 3 ||
+        jtok_events_parse(NULL, 0, stop_at_third, &count, NULL, 0) !=
+            JTOK_PARSE_STATUS_NULL_PARAM)
+    {
+        printf("failed.\n");
+        return 1;
+    }
+    printf("passed.\n");
+    return 0;
+}
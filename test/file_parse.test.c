@@ -0,0 +1,151 @@
+/**
+ * @file file_parse.test.c
+ * @author Carl Mattatall (cmattatall2@gmail.com)
+ * @brief Source module to test parsing memory-mapped files
+ * @version 0.1
+ * @date 2021-05-14
+ *
+ * @copyright Copyright (c) 2021 Carl Mattatall
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(JTOK_HAVE_POSIX)
+#include <unistd.h>
+#endif /* #if defined(JTOK_HAVE_POSIX) */
+
+#include "jtok.h"
+#include "jtok_file.h"
+
+#define TOKEN_MAX 32
+
+static jtok_tkn_t tokens[TOKEN_MAX];
+static char       text[1 << 16];
+
+#if defined(JTOK_HAVE_POSIX)
+
+static char path[] = "/tmp/jtok_file_XXXXXX";
+
+
+/* Replace the test file's contents with exactly len bytes of text */
+static int put_file(size_t len)
+{
+    FILE *file = fopen(path, "wb");
+    if (file == NULL || fwrite(text, 1, len, file) != len)
+    {
+        return 1;
+    }
+    return fclose(file);
+}
+
+
+/* A document filling exactly len bytes, whose last value ends right before
+ * the closing brace on the last byte of the file */
+static size_t make_document(size_t len)
+{
+    size_t head = (size_t)sprintf(text, "{\"pad\":\"");
+    size_t tail = strlen("\",\"end\":12345}");
+    memset(&text[head], 'x', len - head - tail);
+    memcpy(&text[len - tail], "\",\"end\":12345}", tail);
+    return len;
+}
+
+#endif /* #if defined(JTOK_HAVE_POSIX) */
+
+
+int main(void)
+{
+    jtok_file_t file;
+
+#if defined(JTOK_HAVE_POSIX)
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    size_t len;
+    int    fd = mkstemp(path);
+    if (fd < 0 || page * 2 > sizeof(text))
+    {
+        printf("could not create %s\n", path);
+        return 1;
+    }
+    close(fd);
+
+    printf("\nparsing a file that fills its last page... ");
+    len = make_document(page * 2);
+    if (put_file(len) != 0 ||
+        jtok_parse_file(&file, path, tokens, TOKEN_MAX, 0) !=
+            JTOK_PARSE_STATUS_OK ||
+        file.len != len || file.json != file.map ||
+        !jtok_tokcmp("end", &tokens[3]) || !jtok_tokcmp("12345", &tokens[4]) ||
+        (size_t)tokens[4].end != len - 1 ||
+        tokens[2].end - tokens[2].start != (int)(len - 22) ||
+        0 != memcmp(file.json, text, len))
+    {
+        printf("failed.\n");
+        return 1;
+    }
+    jtok_file_close(&file);
+    if (file.map != NULL || file.json != NULL)
+    {
+        printf("failed. file still open after closing\n");
+        return 1;
+    }
+    printf("passed.\n");
+
+    printf("\nparsing with huge pages requested... ");
+    len = (size_t)sprintf(text, "{\"a\":[1,2,3],\"b\":{\"c\":null}}");
+    if (put_file(len) != 0 ||
+        jtok_parse_file(&file, path, tokens, TOKEN_MAX, JTOK_FILE_HUGEPAGES) !=
+            JTOK_PARSE_STATUS_OK ||
+        tokens[2].size != 3 || !jtok_tokcmp("null", &tokens[9]))
+    {
+        printf("failed.\n");
+        return 1;
+    }
+    jtok_file_close(&file);
+    printf("passed.\n");
+
+    printf("\nrejecting a document cut off at the end of the file... ");
+    len = make_document(page);
+    if (put_file(len - 1) != 0 ||
+        jtok_parse_file(&file, path, tokens, TOKEN_MAX, 0) !=
+            JTOK_PARSE_STATUS_PARTIAL_TOKEN ||
+        file.map != NULL || put_file(len - 3) != 0 ||
+        jtok_parse_file(&file, path, tokens, TOKEN_MAX, 0) ==
+            JTOK_PARSE_STATUS_OK ||
+        put_file(0) != 0 ||
+        jtok_parse_file(&file, path, tokens, TOKEN_MAX, 0) ==
+            JTOK_PARSE_STATUS_OK ||
+        file.map != NULL)
+    {
+        printf("failed.\n");
+        return 1;
+    }
+    printf("passed.\n");
+
+    printf("\nreporting files that cannot be opened... ");
+    unlink(path);
+    if (jtok_parse_file(&file, path, tokens, TOKEN_MAX, 0) !=
+            JTOK_PARSE_STATUS_IO_ERROR ||
+        jtok_parse_file(&file, NULL, tokens, TOKEN_MAX, 0) !=
+            JTOK_PARSE_STATUS_NULL_PARAM ||
+        jtok_parse_file(NULL, "/", tokens, TOKEN_MAX, 0) !=
+            JTOK_PARSE_STATUS_NULL_PARAM)
+    {
+        printf("failed.\n");
+        return 1;
+    }
+    printf("passed.\n");
+#else
+    (void)text;
+    printf("\nreporting that files cannot be mapped... ");
+    if (jtok_parse_file(&file, "/", tokens, TOKEN_MAX, 0) !=
+        JTOK_PARSE_STATUS_IO_ERROR)
+    {
+        printf("failed.\n");
+        return 1;
+    }
+    printf("passed.\n");
+#endif /* #if defined(JTOK_HAVE_POSIX) */
+    return 0;
+}
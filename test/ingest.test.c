@@ -0,0 +1,327 @@
+/**
+ * @file ingest.test.c
+ * @author Carl Mattatall (cmattatall2@gmail.com)
+ * @brief Source module to test reading and parsing NDJSON files in chunks
+ * @version 0.1
+ * @date 2021-05-16
+ *
+ * @copyright Copyright (c) 2021 Carl Mattatall
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(JTOK_HAVE_POSIX)
+#include <unistd.h>
+#endif /* #if defined(JTOK_HAVE_POSIX) */
+
+#include "jtok.h"
+#include "jtok_ingest.h"
+#include "jtok_lines.h"
+
+#define TOKEN_MAX 32
+#define RECORD_MAX 512
+#define FILE_COUNT 3
+#define CARRY 512
+#define CHUNK_MAX 4096
+#define DEPTH_MAX 8
+
+typedef struct
+{
+    size_t              file;
+    size_t              index;
+    size_t              line;
+    size_t              offset;
+    size_t              len;
+    JTOK_PARSE_STATUS_t status;
+    jtok_off_t          size; /* of the root object */
+} record_t;
+
+typedef struct
+{
+    record_t records[RECORD_MAX];
+    size_t   count;
+    size_t   stop_after; /* 0 to never stop */
+    size_t   file;       /* for jtok_parse_lines */
+} log_t;
+
+static log_t      expected;
+static log_t      actual;
+static jtok_tkn_t tokens[TOKEN_MAX];
+static char       text[FILE_COUNT][16 * 1024];
+static size_t     text_len[FILE_COUNT];
+static char       buffers[DEPTH_MAX * CHUNK_MAX];
+static char       carry[CARRY];
+
+#if defined(JTOK_HAVE_POSIX)
+static char        paths[FILE_COUNT][32];
+static const char *path_list[FILE_COUNT];
+#endif /* #if defined(JTOK_HAVE_POSIX) */
+
+
+static int record(log_t *log, size_t file, const jtok_line_t *line,
+                  jtok_tkn_t *tkns)
+{
+    record_t *rec = &log->records[log->count % RECORD_MAX];
+    rec->file     = file;
+    rec->index    = line->index;
+    rec->line     = line->line;
+    rec->offset   = line->offset;
+    rec->len      = line->len;
+    rec->status   = line->status;
+    rec->size     = (line->status == JTOK_PARSE_STATUS_OK) ? tkns[0].size : -1;
+    log->count++;
+    return log->stop_after != 0 && log->count == log->stop_after;
+}
+
+
+static int on_line(void *ctx, const jtok_line_t *line, jtok_tkn_t *tkns)
+{
+    log_t *log = (log_t *)ctx;
+    return record(log, log->file, line, tkns);
+}
+
+
+static int on_doc(void *ctx, size_t file, const jtok_line_t *line,
+                  jtok_tkn_t *tkns)
+{
+    return record((log_t *)ctx, file, line, tkns);
+}
+
+
+/* Lines of every length up to a few chunks, CRLF and blank lines, a bad
+ * document and an unterminated last line */
+static size_t make_lines(char *buf, unsigned count)
+{
+    size_t   len = 0;
+    unsigned i;
+    for (i = 0; i < count; i++)
+    {
+        len += (size_t)sprintf(&buf[len], "{\"id\":%u,\"pad\":\"", i);
+        memset(&buf[len], 'x', (i * 37) % 300);
+        len += (i * 37) % 300;
+        len += (size_t)sprintf(&buf[len], "\",\"ok\":true}");
+        if (i == 13)
+        {
+            len += (size_t)sprintf(&buf[len], "{\"bad\":}");
+        }
+        if (i % 5 == 0)
+        {
+            buf[len++] = '\r';
+        }
+        if (i + 1 < count)
+        {
+            buf[len++] = '\n';
+        }
+        if (i % 7 == 3)
+        {
+            len += (size_t)sprintf(&buf[len], "  \n");
+        }
+    }
+    return len;
+}
+
+
+#if defined(JTOK_HAVE_POSIX)
+static int same(const log_t *a, const log_t *b, bool nomem_ok)
+{
+    const record_t *x;
+    const record_t *y;
+    size_t          i;
+    if (a->count != b->count)
+    {
+        printf("failed. %u documents instead of %u\n", (unsigned)b->count,
+               (unsigned)a->count);
+        return 0;
+    }
+    for (i = 0; i < a->count; i++)
+    {
+        x = &a->records[i];
+        y = &b->records[i];
+        if (x->file != y->file || x->index != y->index ||
+            x->line != y->line || x->offset != y->offset)
+        {
+            printf("failed. document %u is misplaced\n", (unsigned)i);
+            return 0;
+        }
+        if (nomem_ok && y->status == JTOK_PARSE_STATUS_NOMEM)
+        {
+            continue;
+        }
+        if (x->len != y->len || x->status != y->status || x->size != y->size)
+        {
+            printf("failed. document %u differs\n", (unsigned)i);
+            return 0;
+        }
+    }
+    return 1;
+}
+#endif /* #if defined(JTOK_HAVE_POSIX) */
+
+
+int main(void)
+{
+    jtok_ingest_config_t config;
+    JTOK_PARSE_STATUS_t  status;
+    size_t               f;
+#if defined(JTOK_HAVE_POSIX)
+    unsigned depth;
+    size_t   chunk;
+    unsigned flags;
+#endif /* #if defined(JTOK_HAVE_POSIX) */
+
+    text_len[0] = make_lines(text[0], 40);
+    text_len[1] = 0;
+    text_len[2] = (size_t)sprintf(text[2], "{\"a\":[1,2]}\n\n{\"b\":{}}\n");
+
+    memset(&expected, 0, sizeof(expected));
+    for (f = 0; f < FILE_COUNT; f++)
+    {
+        expected.file = f;
+        jtok_parse_lines(text[f], text_len[f], tokens, TOKEN_MAX, on_line,
+                         &expected);
+    }
+
+    memset(&config, 0, sizeof(config));
+    config.buffers   = buffers;
+    config.carry     = carry;
+    config.carry_len = sizeof(carry);
+    config.tkns      = tokens;
+    config.size      = TOKEN_MAX;
+
+#if defined(JTOK_HAVE_POSIX)
+    for (f = 0; f < FILE_COUNT; f++)
+    {
+        FILE *file;
+        int   fd;
+        strcpy(paths[f], "/tmp/jtok_ingest_XXXXXX");
+        fd = mkstemp(paths[f]);
+        if (fd < 0)
+        {
+            printf("could not create %s\n", paths[f]);
+            return 1;
+        }
+        close(fd);
+        file = fopen(paths[f], "wb");
+        if (file == NULL ||
+            fwrite(text[f], 1, text_len[f], file) != text_len[f] ||
+            fclose(file) != 0)
+        {
+            printf("could not write %s\n", paths[f]);
+            return 1;
+        }
+        path_list[f] = paths[f];
+    }
+
+    for (flags = 0; flags <= JTOK_INGEST_NO_URING; flags++)
+    {
+        for (depth = 1; depth <= DEPTH_MAX; depth *= 2)
+        {
+            for (chunk = 16; chunk <= CHUNK_MAX; chunk *= 4)
+            {
+                printf("\ningesting with %u reads of %u bytes%s... ", depth,
+                       (unsigned)chunk, flags ? " (pread)" : "");
+                config.depth     = depth;
+                config.chunk_len = chunk;
+                config.flags     = flags;
+                memset(&actual, 0, sizeof(actual));
+                status = jtok_ingest_files(path_list, FILE_COUNT, &config,
+                                           on_doc, &actual);
+                if (status != JTOK_PARSE_STATUS_OK)
+                {
+                    printf("failed. %s\n", jtok_jtokerr_messages(status));
+                    goto fail;
+                }
+                if (!same(&expected, &actual, false))
+                {
+                    goto fail;
+                }
+                printf("passed.\n");
+            }
+        }
+    }
+
+    printf("\nreporting lines too long to gather... ");
+    config.depth     = 4;
+    config.chunk_len = 64;
+    config.flags     = 0;
+    config.carry_len = 100;
+    memset(&actual, 0, sizeof(actual));
+    status = jtok_ingest_files(path_list, FILE_COUNT, &config, on_doc, &actual);
+    config.carry_len = sizeof(carry);
+    if (status != JTOK_PARSE_STATUS_OK || !same(&expected, &actual, true))
+    {
+        printf("failed. %s\n", jtok_jtokerr_messages(status));
+        goto fail;
+    }
+    printf("passed.\n");
+
+    printf("\nstopping early... ");
+    memset(&actual, 0, sizeof(actual));
+    actual.stop_after = 5;
+    status = jtok_ingest_files(path_list, FILE_COUNT, &config, on_doc, &actual);
+    if (status != JTOK_PARSE_STATUS_OK || actual.count != 5)
+    {
+        printf("failed. %s\n", jtok_jtokerr_messages(status));
+        goto fail;
+    }
+    printf("passed.\n");
+
+    printf("\nreporting a file that cannot be opened... ");
+    memset(&actual, 0, sizeof(actual));
+    path_list[1] = "/nonexistent/jtok_ingest";
+    status = jtok_ingest_files(path_list, FILE_COUNT, &config, on_doc, &actual);
+    path_list[1] = paths[1];
+    expected.count -= 2; /* the documents of the last file */
+    if (status != JTOK_PARSE_STATUS_IO_ERROR ||
+        !same(&expected, &actual, false))
+    {
+        printf("failed. %s\n", jtok_jtokerr_messages(status));
+        goto fail;
+    }
+    printf("passed.\n");
+#else
+    printf("\nreporting that files cannot be read... ");
+    config.depth     = 1;
+    config.chunk_len = 16;
+    status = jtok_ingest_files(NULL, 0, &config, on_doc, &actual);
+    if (status != JTOK_PARSE_STATUS_IO_ERROR)
+    {
+        printf("failed. %s\n", jtok_jtokerr_messages(status));
+        return 1;
+    }
+    printf("passed.\n");
+#endif /* #if defined(JTOK_HAVE_POSIX) */
+
+    printf("\nrejecting bad configurations... ");
+    config.depth = 0;
+    if (jtok_ingest_files(NULL, 0, &config, on_doc, &actual) !=
+            JTOK_PARSE_STATUS_INVAL ||
+        jtok_ingest_files(NULL, 0, NULL, on_doc, &actual) !=
+            JTOK_PARSE_STATUS_NULL_PARAM ||
+        jtok_ingest_files(NULL, 1, &config, on_doc, &actual) !=
+            JTOK_PARSE_STATUS_NULL_PARAM)
+    {
+        printf("failed.\n");
+        goto fail;
+    }
+    printf("passed.\n");
+
+#if defined(JTOK_HAVE_POSIX)
+    for (f = 0; f < FILE_COUNT; f++)
+    {
+        unlink(paths[f]);
+    }
+#endif /* #if defined(JTOK_HAVE_POSIX) */
+    return 0;
+
+fail:
+#if defined(JTOK_HAVE_POSIX)
+    for (f = 0; f < FILE_COUNT; f++)
+    {
+        unlink(paths[f]);
+    }
+#endif /* #if defined(JTOK_HAVE_POSIX) */
+    return 1;
+}
@@ -0,0 +1,283 @@
+/**
+ * @file iov.test.c
+ * @author Carl Mattatall (cmattatall2@gmail.com)
+ * @brief Source module to test parsing documents split across segments
+ * @version 0.1
+ * @date 2021-05-16
+ *
+ * @copyright Copyright (c) 2021 Carl Mattatall
+ *
+ */
+#include <stdio.h>
+#include <string.h>
+
+#include "jtok.h"
+#include "jtok_iov.h"
+
+#define TOKEN_MAX 100
+#define SEGMENT_MAX 400
+#define STITCH 512
+
+/* As long as token offsets allow, up to 256 KB */
+#define LONG_VALUE                                                             \
+    (((size_t)JTOK_OFF_MAX < 256 * 1024) ? (size_t)JTOK_OFF_MAX - 16          \
+                                         : 256 * 1024)
+
+static const char *documents[] = {
+    "{}",
+    "  {\"a\" : 1, \"b\":[true,false,null], \"c\":{\"d\":\"e\"}}",
+    "{\"list\":[{\"id\":1,\"tags\":[\"x\",\"y\"]},{\"id\":2,\"tags\":[]}],"
+    "\"n\":-12.5e+3,\"p\":+7,'single':'it\"s'}",
+    "{\"nested\":[[1,2],[[3],[4,5]],[]],\"esc\":\"a\\\"b\\u00e9\\\\\"}\n",
+};
+
+static jtok_tkn_t expected[TOKEN_MAX];
+static jtok_tkn_t tokens[TOKEN_MAX];
+static jtok_iov_t segments[SEGMENT_MAX];
+static char       stitch[STITCH];
+static char       long_json[LONG_VALUE + 16];
+static char       long_stitch[LONG_VALUE + 16];
+
+
+/* Split json into segments of at most len bytes, with an empty segment
+ * after each one */
+static size_t split(const char *json, size_t len)
+{
+    size_t total = strlen(json);
+    size_t count = 0;
+    size_t pos;
+    for (pos = 0; pos < total && count + 1 < SEGMENT_MAX; pos += len)
+    {
+        segments[count].base = &json[pos];
+        segments[count].len  = (total - pos < len) ? total - pos : len;
+        count++;
+        segments[count].base = NULL;
+        segments[count].len  = 0;
+        count++;
+    }
+    return count;
+}
+
+
+/* The tokens must match jtok_parse's, wherever their text ended up */
+static int check(const char *json, size_t count)
+{
+    JTOK_PARSE_STATUS_t status;
+    size_t              seg;
+    size_t              off;
+    size_t              i;
+    size_t              base;
+
+    status = jtok_parse_iov(segments, count, tokens, TOKEN_MAX, stitch,
+                            sizeof(stitch));
+    if (status != JTOK_PARSE_STATUS_OK)
+    {
+        printf("failed. %s\n", jtok_jtokerr_messages(status));
+        return 1;
+    }
+    for (i = 0; expected[i].type != JTOK_UNASSIGNED_TOKEN; i++)
+    {
+        if (tokens[i].type != expected[i].type ||
+            tokens[i].size != expected[i].size ||
+            tokens[i].parent != expected[i].parent ||
+            tokens[i].sibling != expected[i].sibling ||
+            tokens[i].pool != tokens)
+        {
+            printf("failed. token %u is linked differently\n", (unsigned)i);
+            return 1;
+        }
+        if (tokens[i].json == NULL)
+        {
+            if (tokens[i].start != expected[i].start ||
+                tokens[i].end != expected[i].end)
+            {
+                printf("failed. token %u has the wrong span\n", (unsigned)i);
+                return 1;
+            }
+        }
+        else if (jtok_toklen(&tokens[i]) != jtok_toklen(&expected[i]) ||
+                 0 != memcmp(&tokens[i].json[tokens[i].start],
+                             &json[expected[i].start],
+                             jtok_toklen(&tokens[i])))
+        {
+            printf("failed. token %u has the wrong text\n", (unsigned)i);
+            return 1;
+        }
+
+        if (jtok_iov_locate(segments, count, &tokens[i], &seg, &off))
+        {
+            base = (size_t)((const char *)segments[seg].base - json);
+            if (base + off != (size_t)expected[i].start)
+            {
+                printf("failed. token %u is located wrongly\n", (unsigned)i);
+                return 1;
+            }
+        }
+        else if (tokens[i].json < stitch || tokens[i].json >= &stitch[STITCH])
+        {
+            printf("failed. token %u was not located\n", (unsigned)i);
+            return 1;
+        }
+    }
+    if (tokens[i].type != JTOK_UNASSIGNED_TOKEN ||
+        !jtok_toktokcmp(&tokens[0], &expected[0]))
+    {
+        printf("failed. the documents differ\n");
+        return 1;
+    }
+    return 0;
+}
+
+
+int main(void)
+{
+    JTOK_PARSE_STATUS_t status;
+    const char *        json;
+    size_t              i;
+    size_t              len;
+    size_t              k;
+
+    for (i = 0; i < sizeof(documents) / sizeof(*documents); i++)
+    {
+        json = documents[i];
+        len  = strlen(json);
+        printf("\n%s ... ", json);
+        if (jtok_parse(json, expected, TOKEN_MAX) != JTOK_PARSE_STATUS_OK)
+        {
+            printf("failed. the reference parse failed\n");
+            return 1;
+        }
+
+        /* One boundary, everywhere it can go */
+        for (k = 0; k <= len; k++)
+        {
+            segments[0].base = json;
+            segments[0].len  = k;
+            segments[1].base = &json[k];
+            segments[1].len  = len - k;
+            if (check(json, 2))
+            {
+                printf("split at %u\n", (unsigned)k);
+                return 1;
+            }
+        }
+
+        /* Many boundaries, down to one byte per segment */
+        for (k = 1; k <= 7; k++)
+        {
+            if (check(json, split(json, k)))
+            {
+                printf("segments of %u\n", (unsigned)k);
+                return 1;
+            }
+        }
+        printf("passed.\n");
+    }
+
+    printf("\nparsing primitives that end on a boundary without stitching... ");
+    json             = "{\"a\":12,\"b\":[true,null]}";
+    segments[0].base = json;
+    segments[0].len  = 7; /* {"a":12 */
+    segments[1].base = &json[7];
+    segments[1].len  = 10; /* ,"b":[true */
+    segments[2].base = &json[17];
+    segments[2].len  = strlen(json) - 17;
+    status = jtok_parse_iov(segments, 3, tokens, TOKEN_MAX, NULL, 0);
+    if (status != JTOK_PARSE_STATUS_OK || tokens[2].json != segments[0].base ||
+        tokens[5].json != segments[1].base || !jtok_tokcmp("12", &tokens[2]) ||
+        !jtok_tokcmp("true", &tokens[5]))
+    {
+        printf("failed. %s\n", jtok_jtokerr_messages(status));
+        return 1;
+    }
+    printf("passed.\n");
+
+    printf("\nstitching a long string across a boundary... ");
+    len = (size_t)sprintf(long_json, "{\"s\":\"");
+    memset(&long_json[len], 'x', LONG_VALUE);
+    len += LONG_VALUE;
+    len += (size_t)sprintf(&long_json[len], "\"}");
+    segments[0].base = long_json;
+    segments[0].len  = 16;
+    segments[1].base = &long_json[16];
+    segments[1].len  = len - 16;
+    status = jtok_parse_iov(segments, 2, tokens, TOKEN_MAX, long_stitch,
+                            sizeof(long_stitch));
+    if (status != JTOK_PARSE_STATUS_OK ||
+        jtok_toklen(&tokens[2]) != LONG_VALUE || tokens[2].json != long_stitch)
+    {
+        printf("failed. %s\n", jtok_jtokerr_messages(status));
+        return 1;
+    }
+    printf("passed.\n");
+
+    json = documents[2];
+    printf("\nstitching without room... ");
+    status = jtok_parse_iov(segments, split(json, 1), tokens, TOKEN_MAX, NULL,
+                            0);
+    if (status != JTOK_PARSE_STATUS_NOMEM)
+    {
+        printf("failed. %s\n", jtok_jtokerr_messages(status));
+        return 1;
+    }
+    status = jtok_parse_iov(segments, split(json, 1), tokens, TOKEN_MAX, stitch,
+                            4);
+    if (status != JTOK_PARSE_STATUS_NOMEM)
+    {
+        printf("failed. %s\n", jtok_jtokerr_messages(status));
+        return 1;
+    }
+    printf("passed.\n");
+
+    printf("\nrunning out of tokens... ");
+    status = jtok_parse_iov(segments, split(json, 3), tokens, 5, stitch,
+                            sizeof(stitch));
+    if (status != JTOK_PARSE_STATUS_NOMEM)
+    {
+        printf("failed. %s\n", jtok_jtokerr_messages(status));
+        return 1;
+    }
+    printf("passed.\n");
+
+    printf("\nparsing a truncated document... ");
+    json   = "{\"a\":[1,2],\"b\":\"xyz";
+    status = jtok_parse_iov(segments, split(json, 2), tokens, TOKEN_MAX,
+                            stitch, sizeof(stitch));
+    if (status != JTOK_PARSE_STATUS_PARTIAL_TOKEN)
+    {
+        printf("failed. %s\n", jtok_jtokerr_messages(status));
+        return 1;
+    }
+    printf("passed.\n");
+
+    printf("\nparsing an invalid document... ");
+    json   = "{\"a\":1,\"b\" \"c\"}";
+    status = jtok_parse_iov(segments, split(json, 3), tokens, TOKEN_MAX,
+                            stitch, sizeof(stitch));
+    if (status != JTOK_PARSE_STATUS_VAL_NO_COLON)
+    {
+        printf("failed. %s\n", jtok_jtokerr_messages(status));
+        return 1;
+    }
+    status = jtok_parse_iov(segments, 0, tokens, TOKEN_MAX, stitch,
+                            sizeof(stitch));
+    if (status != JTOK_PARSE_STATUS_NON_OBJECT)
+    {
+        printf("failed. %s\n", jtok_jtokerr_messages(status));
+        return 1;
+    }
+    printf("passed.\n");
+
+    printf("\npassing NULL... ");
+    if (jtok_parse_iov(NULL, 1, tokens, TOKEN_MAX, NULL, 0) !=
+            JTOK_PARSE_STATUS_NULL_PARAM ||
+        jtok_parse_iov(segments, 1, NULL, TOKEN_MAX, NULL, 0) !=
+            JTOK_PARSE_STATUS_NULL_PARAM ||
+        jtok_iov_locate(segments, 1, NULL, &len, &k))
+    {
+        printf("failed.\n");
+        return 1;
+    }
+    printf("passed.\n");
+    return 0;
+}
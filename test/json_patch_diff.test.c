@@ -0,0 +1,122 @@
+/**
+ * @file json_patch_diff.test.c
+ * @author Carl Mattatall (cmattatall2@gmail.com)
+ * @brief Source module to test RFC 6902 patch generation with jtok_diff
+ * @version 0.1
+ * @date 2021-04-24
+ *
+ * @copyright Copyright (c) 2021 Carl Mattatall
+ *
+ */
+#include <stdio.h>
+#include <string.h>
+
+#include "jtok.h"
+
+#define TOKEN_MAX 200
+#define PATCH_MAX 512
+
+/* clang-format off */
+static const struct
+{
+    char from[250];
+    char to[250];
+    char patch[250];
+} diff_table[] = {
+    {.from = "{\"a\":1}", .to = "{ \"a\" : 1 }", .patch = "[]"},
+    {.from = "{\"a\":1,\"b\":2}", .to = "{\"b\":2,\"a\":1.0}", .patch = "[]"},
+    {.from = "{\"a\":1}", .to = "{\"a\":2}", .patch = "[{\"op\":\"replace\",\"path\":\"/a\",\"value\":2}]"},
+    {.from = "{\"a\":1}", .to = "{\"a\":1,\"b\":\"x\"}", .patch = "[{\"op\":\"add\",\"path\":\"/b\",\"value\":\"x\"}]"},
+    {.from = "{\"a\":1,\"b\":[1]}", .to = "{\"a\":1}", .patch = "[{\"op\":\"remove\",\"path\":\"/b\"}]"},
+    {.from = "{\"a\":{\"b\":{\"c\":1}}}", .to = "{\"a\":{\"b\":{\"c\":true}}}", .patch = "[{\"op\":\"replace\",\"path\":\"/a/b/c\",\"value\":true}]"},
+    {.from = "{\"a\":[1,2,3]}", .to = "{\"a\":[1,5]}", .patch = "[{\"op\":\"replace\",\"path\":\"/a/1\",\"value\":5},{\"op\":\"remove\",\"path\":\"/a/2\"}]"},
+    {.from = "{\"a\":[1]}", .to = "{\"a\":[1,{\"k\":2},3]}", .patch = "[{\"op\":\"add\",\"path\":\"/a/-\",\"value\":{\"k\":2}},{\"op\":\"add\",\"path\":\"/a/-\",\"value\":3}]"},
+    {.from = "{\"a/b\":1,\"m~n\":2}", .to = "{\"a/b\":3,\"m~n\":2}", .patch = "[{\"op\":\"replace\",\"path\":\"/a~1b\",\"value\":3}]"},
+    {.from = "{\"m~n\":1}", .to = "{\"m~n\":2}", .patch = "[{\"op\":\"replace\",\"path\":\"/m~0n\",\"value\":2}]"},
+    {.from = "{\"p\\/q\":1}", .to = "{\"p\\/q\":2}", .patch = "[{\"op\":\"replace\",\"path\":\"/p~1q\",\"value\":2}]"},
+    {.from = "{\"a\\\\/b\":1}", .to = "{\"a\\\\/b\":2}", .patch = "[{\"op\":\"replace\",\"path\":\"/a\\\\~1b\",\"value\":2}]"},
+    {.from = "{\"x\\u002fy\":1}", .to = "{\"x\\u002fy\":2}", .patch = "[{\"op\":\"replace\",\"path\":\"/x~1y\",\"value\":2}]"},
+    {.from = "{\"\\u007e\":1}", .to = "{\"\\u007e\":2}", .patch = "[{\"op\":\"replace\",\"path\":\"/~0\",\"value\":2}]"},
+    {.from = "{\"a\\/b\":1,\"c\":1}", .to = "{\"a/b\":1,\"\\u0063\":2}", .patch = "[{\"op\":\"replace\",\"path\":\"/c\",\"value\":2}]"},
+    {.from = "{\"\\u0062\":1,\"a\":1,\"\\u00e9\":1}", .to = "{\"\xc3\xa9\":1,\"a\":2,\"b\":1}", .patch = "[{\"op\":\"replace\",\"path\":\"/a\",\"value\":2}]"},
+    {.from = "{\"a\":[]}", .to = "{\"a\":{}}", .patch = "[{\"op\":\"replace\",\"path\":\"/a\",\"value\":{}}]"},
+    {.from = "{\"a\":[{\"x\":1},{\"y\":2}]}", .to = "{\"a\":[{\"x\":1},{\"y\":3}]}", .patch = "[{\"op\":\"replace\",\"path\":\"/a/1/y\",\"value\":3}]"},
+};
+/* clang-format on */
+
+static jtok_tkn_t tokens1[TOKEN_MAX];
+static jtok_tkn_t tokens2[TOKEN_MAX];
+static jtok_off_t scratch[TOKEN_MAX];
+
+static struct
+{
+    char   buf[PATCH_MAX];
+    size_t len;
+} output;
+
+
+static int collect(void *ctx, const char *data, size_t len)
+{
+    (void)ctx;
+    if (output.len + len >= sizeof(output.buf))
+    {
+        return 1;
+    }
+    memcpy(&output.buf[output.len], data, len);
+    output.len += len;
+    output.buf[output.len] = '\0';
+    return 0;
+}
+
+
+static bool diff_matches(jtok_off_t *diff_scratch, size_t diff_scratch_len,
+                         const char *expected)
+{
+    output.len = 0;
+    if (jtok_diff(tokens1, tokens2, diff_scratch, diff_scratch_len, collect,
+                  NULL) != JTOK_WRITE_STATUS_OK)
+    {
+        return false;
+    }
+    return 0 == strcmp(output.buf, expected);
+}
+
+
+int main(void)
+{
+    unsigned long long i;
+    unsigned long long max_i = sizeof(diff_table) / sizeof(*diff_table);
+    for (i = 0; i < max_i; i++)
+    {
+        printf("\ndiffing %s against %s... ", diff_table[i].from,
+               diff_table[i].to);
+        if (jtok_parse(diff_table[i].from, tokens1, TOKEN_MAX) !=
+                JTOK_PARSE_STATUS_OK ||
+            jtok_parse(diff_table[i].to, tokens2, TOKEN_MAX) !=
+                JTOK_PARSE_STATUS_OK)
+        {
+            printf("parse failed.\n");
+            return 1;
+        }
+
+        /* Once with key sorting, once with the linear fallback */
+        if (!diff_matches(scratch, TOKEN_MAX, diff_table[i].patch) ||
+            !diff_matches(NULL, 0, diff_table[i].patch))
+        {
+            printf("failed. got %s\n", output.buf);
+            return 1;
+        }
+        printf("passed.\n");
+    }
+
+    printf("\nchecking sink failure is reported... ");
+    output.len = sizeof(output.buf);
+    if (jtok_diff(tokens1, tokens2, NULL, 0, collect, NULL) !=
+        JTOK_WRITE_STATUS_SINK_ERROR)
+    {
+        printf("failed.\n");
+        return 1;
+    }
+    printf("passed.\n");
+    return 0;
+}
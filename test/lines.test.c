@@ -0,0 +1,143 @@
+/**
+ * @file lines.test.c
+ * @author Carl Mattatall (cmattatall2@gmail.com)
+ * @brief Source module to test newline-delimited batch parsing
+ * @version 0.1
+ * @date 2021-05-09
+ *
+ * @copyright Copyright (c) 2021 Carl Mattatall
+ *
+ */
+#include <stdio.h>
+#include <string.h>
+
+#include "jtok.h"
+#include "jtok_lines.h"
+
+#define TOKEN_MAX 50
+#define RECORD_MAX 10
+
+static const char batch[] = "{\"id\":1,\"tags\":[\"a\",\"b\"]}\n"
+                            "\n"
+                            "   \t\n"
+                            "{\"id\":2}\r\n"
+                            "{\"id\":\n"
+                            "{\"id\":4,\"ok\":true}";
+
+/* clang-format off */
+static const jtok_line_t expected[] = {
+    {.index = 0, .line = 0, .offset = 0,  .len = 25, .status = JTOK_PARSE_STATUS_OK},
+    {.index = 1, .line = 3, .offset = 32, .len = 8,  .status = JTOK_PARSE_STATUS_OK},
+    {.index = 2, .line = 4, .offset = 42, .len = 6,  .status = JTOK_PARSE_STATUS_PARTIAL_TOKEN},
+    {.index = 3, .line = 5, .offset = 49, .len = 18, .status = JTOK_PARSE_STATUS_OK},
+};
+
+/* Neither is nul-terminated, so reading past the end is caught by asan */
+static const char cut_literal[] = {'{', '"', 'a', '"', ':', 't', 'r'};
+static const char whole[]       = {'{', '"', 'a', '"', ':', 'n', 'u', 'l', 'l', '}'};
+/* clang-format on */
+
+static jtok_tkn_t tokens[TOKEN_MAX];
+
+static struct
+{
+    jtok_line_t lines[RECORD_MAX];
+    int         ids[RECORD_MAX];
+    size_t      count;
+    size_t      stop_after;
+} record;
+
+
+static int collect(void *ctx, const jtok_line_t *line, jtok_tkn_t *tkns)
+{
+    (void)ctx;
+    if (record.count < RECORD_MAX)
+    {
+        record.lines[record.count] = *line;
+        record.ids[record.count]   = -1;
+        if (line->status == JTOK_PARSE_STATUS_OK &&
+            tkns[2].type == JTOK_PRIMITIVE)
+        {
+            record.ids[record.count] = tkns[2].json[tkns[2].start] - '0';
+        }
+        record.count++;
+    }
+    return record.count == record.stop_after;
+}
+
+
+int main(void)
+{
+    size_t i;
+    size_t count    = sizeof(expected) / sizeof(*expected);
+    size_t consumed;
+
+    printf("\nparsing a batch of documents... ");
+    record.count      = 0;
+    record.stop_after = 0;
+    consumed = jtok_parse_lines(batch, strlen(batch), tokens, TOKEN_MAX,
+                                collect, NULL);
+    if (consumed != strlen(batch) || record.count != count)
+    {
+        printf("failed. consumed %zu bytes, %zu documents\n", consumed,
+               record.count);
+        return 1;
+    }
+    for (i = 0; i < count; i++)
+    {
+        if (record.lines[i].index != expected[i].index ||
+            record.lines[i].line != expected[i].line ||
+            record.lines[i].offset != expected[i].offset ||
+            record.lines[i].len != expected[i].len ||
+            record.lines[i].status != expected[i].status)
+        {
+            printf("failed. document %zu differs\n", i);
+            return 1;
+        }
+    }
+    if (record.ids[0] != 1 || record.ids[1] != 2 || record.ids[3] != 4)
+    {
+        printf("failed. wrong token contents\n");
+        return 1;
+    }
+    printf("passed.\n");
+
+    printf("\nstopping a batch early... ");
+    record.count      = 0;
+    record.stop_after = 2;
+    consumed = jtok_parse_lines(batch, strlen(batch), tokens, TOKEN_MAX,
+                                collect, NULL);
+    if (record.count != 2 || consumed != expected[1].offset + 10)
+    {
+        printf("failed. consumed %zu bytes\n", consumed);
+        return 1;
+    }
+    printf("passed.\n");
+
+    printf("\nparsing text that is not nul-terminated... ");
+    if (jtok_parsen(cut_literal, sizeof(cut_literal), tokens, TOKEN_MAX) ==
+            JTOK_PARSE_STATUS_OK ||
+        jtok_parsen(whole, sizeof(whole), tokens, TOKEN_MAX) !=
+            JTOK_PARSE_STATUS_OK ||
+        !jtok_tokcmp("null", &tokens[2]) ||
+        jtok_parsen(whole, 0, tokens, TOKEN_MAX) !=
+            JTOK_PARSE_STATUS_NON_OBJECT)
+    {
+        printf("failed.\n");
+        return 1;
+    }
+    printf("passed.\n");
+
+    printf("\nreusing a pool for a smaller document... ");
+    if (jtok_parse("{\"a\":[1,2,3,4,5]}", tokens, TOKEN_MAX) !=
+            JTOK_PARSE_STATUS_OK ||
+        jtok_parse("{}", tokens, TOKEN_MAX) != JTOK_PARSE_STATUS_OK ||
+        tokens[1].type != JTOK_UNASSIGNED_TOKEN ||
+        jtok_parse("{}", tokens, 1) != JTOK_PARSE_STATUS_OK)
+    {
+        printf("failed.\n");
+        return 1;
+    }
+    printf("passed.\n");
+    return 0;
+}
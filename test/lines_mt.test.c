@@ -0,0 +1,258 @@
+/**
+ * @file lines_mt.test.c
+ * @author Carl Mattatall (cmattatall2@gmail.com)
+ * @brief Source module to test multi-threaded newline-delimited parsing
+ * @version 0.1
+ * @date 2021-05-09
+ *
+ * @copyright Copyright (c) 2021 Carl Mattatall
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "jtok.h"
+#include "jtok_lines.h"
+
+#define DOC_MAX 1500
+#define INPUT_MAX (DOC_MAX * 64)
+#define THREADS 4
+#define POOL_SIZE 40
+
+static char       input[INPUT_MAX];
+static size_t     input_len;
+static jtok_tkn_t pools[THREADS * POOL_SIZE];
+
+/* What the serial parser reports, one entry per document */
+static jtok_line_t expected[DOC_MAX];
+static long        expected_ids[DOC_MAX];
+static size_t      expected_tokens[DOC_MAX];
+static size_t      expected_count;
+
+static struct
+{
+    size_t count;
+    size_t stop_after;
+    int    errors;
+} ordered;
+
+static unsigned char seen[INPUT_MAX];
+
+
+/* The id of a parsed document, or -1 */
+static long doc_id(const jtok_line_t *line, const jtok_tkn_t *tkns)
+{
+    if (line->status != JTOK_PARSE_STATUS_OK || tkns[2].type != JTOK_PRIMITIVE)
+    {
+        return -1;
+    }
+    return strtol(&tkns[2].json[tkns[2].start], NULL, 10);
+}
+
+
+/* Tokens before the end-of-document marker, or to the end of the pool */
+static size_t doc_tokens(const jtok_line_t *line, const jtok_tkn_t *tkns)
+{
+    size_t left  = POOL_SIZE - (size_t)(tkns - pools) % POOL_SIZE;
+    size_t count = 0;
+    if (line->status != JTOK_PARSE_STATUS_OK)
+    {
+        return 0;
+    }
+    while (count < left && tkns[count].type != JTOK_UNASSIGNED_TOKEN)
+    {
+        count++;
+    }
+    return count;
+}
+
+
+static int record_serial(void *ctx, const jtok_line_t *line, jtok_tkn_t *tkns)
+{
+    (void)ctx;
+    expected[expected_count]          = *line;
+    expected_ids[expected_count]      = doc_id(line, tkns);
+    expected_tokens[expected_count++] = doc_tokens(line, tkns);
+    return 0;
+}
+
+
+static int check_ordered(void *ctx, const jtok_line_t *line, jtok_tkn_t *tkns)
+{
+    const jtok_line_t *want = &expected[ordered.count];
+    (void)ctx;
+    if (ordered.count >= expected_count || line->index != want->index ||
+        line->line != want->line || line->offset != want->offset ||
+        line->len != want->len || line->status != want->status ||
+        doc_id(line, tkns) != expected_ids[ordered.count] ||
+        doc_tokens(line, tkns) != expected_tokens[ordered.count])
+    {
+        ordered.errors++;
+    }
+    ordered.count++;
+    return ordered.count == ordered.stop_after;
+}
+
+
+/* A held document must end in the marker even when it exactly fills what
+ * is left of its pool, so fn can find its end without knowing the pool */
+static int check_marker(void *ctx, const jtok_line_t *line, jtok_tkn_t *tkns)
+{
+    size_t left = POOL_SIZE - (size_t)(tkns - pools) % POOL_SIZE;
+    (void)ctx;
+    if (line->status != JTOK_PARSE_STATUS_OK ||
+        (left < POOL_SIZE && doc_tokens(line, tkns) == left))
+    {
+        ordered.errors++;
+    }
+    ordered.count++;
+    return 0;
+}
+
+
+static int check_unordered(void *ctx, const jtok_line_t *line,
+                           jtok_tkn_t *tkns)
+{
+    (void)ctx;
+    (void)tkns;
+    /* Every call marks a different byte so no locking is needed */
+    if (line->offset < input_len && line->index == JTOK_LINES_UNKNOWN)
+    {
+        seen[line->offset]++;
+    }
+    return 0;
+}
+
+
+static void make_input(void)
+{
+    int i;
+    for (i = 0; i < DOC_MAX - 2; i++)
+    {
+        if (i % 50 == 7)
+        {
+            input_len += (size_t)sprintf(&input[input_len], "\n  \r\n");
+        }
+        else if (i % 97 == 13)
+        {
+            input_len += (size_t)sprintf(&input[input_len], "{\"id\":%d,\n", i);
+        }
+        else if (i % 31 == 5)
+        {
+            /* Too big to share a pool with anything else */
+            input_len += (size_t)sprintf(&input[input_len],
+                                         "{\"id\":%d,\"big\":[1,2,3,4,5,6,7,8,9,"
+                                         "10,11,12,13,14,15,16,17,18,19,20]}\r\n",
+                                         i);
+        }
+        else
+        {
+            input_len += (size_t)sprintf(&input[input_len],
+                                         "{\"id\":%d,\"v\":[%d,true]}\n", i,
+                                         i * 7);
+        }
+    }
+    input_len += (size_t)sprintf(&input[input_len], "{\"id\":%d}", i);
+}
+
+
+int main(void)
+{
+    jtok_lines_config_t config;
+    size_t              chunk_lens[] = {1, 113, 4096, 0};
+    size_t              i;
+    size_t              j;
+    size_t              docs;
+    char                fit[160];
+    size_t              fit_len;
+
+    make_input();
+    jtok_parse_lines(input, input_len, pools, POOL_SIZE, record_serial, NULL);
+
+    config.threads   = THREADS;
+    config.pools     = pools;
+    config.pool_size = POOL_SIZE;
+    for (i = 0; i < sizeof(chunk_lens) / sizeof(*chunk_lens); i++)
+    {
+        config.chunk_len = chunk_lens[i];
+
+        printf("\nordered parse with %zu-byte chunks... ", chunk_lens[i]);
+        config.ordered     = true;
+        ordered.count      = 0;
+        ordered.stop_after = 0;
+        ordered.errors     = 0;
+        docs = jtok_parse_lines_mt(input, input_len, &config, check_ordered,
+                                   NULL);
+        if (docs != expected_count || ordered.count != expected_count ||
+            ordered.errors != 0)
+        {
+            printf("failed. %zu of %zu documents, %d errors\n", docs,
+                   expected_count, ordered.errors);
+            return 1;
+        }
+        printf("passed.\n");
+
+        printf("\nunordered parse with %zu-byte chunks... ", chunk_lens[i]);
+        config.ordered = false;
+        memset(seen, 0, sizeof(seen));
+        docs = jtok_parse_lines_mt(input, input_len, &config, check_unordered,
+                                   NULL);
+        for (j = 0; j < expected_count && seen[expected[j].offset] == 1; j++)
+        {
+        }
+        if (docs != expected_count || j != expected_count)
+        {
+            printf("failed. %zu of %zu documents\n", docs, expected_count);
+            return 1;
+        }
+        printf("passed.\n");
+    }
+
+    printf("\nstopping an ordered parse early... ");
+    config.ordered     = true;
+    config.chunk_len   = 200;
+    ordered.count      = 0;
+    ordered.stop_after = 100;
+    ordered.errors     = 0;
+    docs = jtok_parse_lines_mt(input, input_len, &config, check_ordered, NULL);
+    if (docs != 100 || ordered.count != 100 || ordered.errors != 0)
+    {
+        printf("failed. %zu documents delivered\n", docs);
+        return 1;
+    }
+    printf("passed.\n");
+
+    printf("\nholding a document that exactly fills the pool... ");
+    /* Four documents of 7 tokens and their markers leave 8 tokens, which
+     * the last document fills without room for its marker */
+    fit_len = (size_t)sprintf(fit, "%s%s%s%s%s", "{\"id\":1,\"v\":[1,true]}\n",
+                              "{\"id\":2,\"v\":[2,true]}\n",
+                              "{\"id\":3,\"v\":[3,true]}\n",
+                              "{\"id\":4,\"v\":[4,true]}\n",
+                              "{\"id\":5,\"v\":[5,6,true]}\n");
+    config.threads   = 1;
+    config.chunk_len = 0;
+    ordered.count    = 0;
+    ordered.errors   = 0;
+    docs = jtok_parse_lines_mt(fit, fit_len, &config, check_marker, NULL);
+    if (docs != 5 || ordered.count != 5 || ordered.errors != 0)
+    {
+        printf("failed. %zu documents, %d without a marker\n", docs,
+               ordered.errors);
+        return 1;
+    }
+    printf("passed.\n");
+
+    printf("\nrejecting bad configurations... ");
+    config.threads = 0;
+    if (jtok_parse_lines_mt(input, input_len, &config, check_ordered, NULL) !=
+            0 ||
+        jtok_parse_lines_mt(input, input_len, NULL, check_ordered, NULL) != 0)
+    {
+        printf("failed.\n");
+        return 1;
+    }
+    printf("passed.\n");
+    return 0;
+}
@@ -0,0 +1,165 @@
+/**
+ * @file minify.test.c
+ * @author Carl Mattatall (cmattatall2@gmail.com)
+ * @brief Source module to test in-place json minification
+ * @version 0.1
+ * @date 2021-05-03
+ *
+ * @copyright Copyright (c) 2021 Carl Mattatall
+ *
+ */
+#include <stdio.h>
+#include <string.h>
+
+#include "jtok.h"
+
+#define TOKEN_MAX 200
+
+/* clang-format off */
+static const struct
+{
+    char input[250];
+    char output[250];
+} minify_table[] = {
+    {.input = "{}", .output = "{}"},
+    {.input = "  {\n\t\"a\" : 1 ,\r\n \"b\" : [ 1 , 2 ] }  ", .output = "{\"a\":1,\"b\":[1,2]}"},
+    {.input = "{\"a b\" : \"  spaced  value  \"}", .output = "{\"a b\":\"  spaced  value  \"}"},
+    {.input = "{ 'single quoted' : ' x \" y ' }", .output = "{'single quoted':' x \" y '}"},
+    {.input = "{\"esc\" : \"quote \\\" then  space\" , \"z\" : 0}", .output = "{\"esc\":\"quote \\\" then  space\",\"z\":0}"},
+    {.input = "{\"long\":\"abcdefghijklmnopqrstuvwxyz 0123456789 abcdefghijklmnop\",     \"n\":     123456789012345}", .output = "{\"long\":\"abcdefghijklmnopqrstuvwxyz 0123456789 abcdefghijklmnop\",\"n\":123456789012345}"},
+    {.input = "{\"u\" : \"\\u00e9\" , \"nested\" : { \"o\" : { } , \"a\" : [ [ ] ] } }", .output = "{\"u\":\"\\u00e9\",\"nested\":{\"o\":{},\"a\":[[]]}}"},
+    {.input = "\v\f{\"a\" :\v1 ,\f\"b\" : [\v2\f] }\v", .output = "{\"a\":1,\"b\":[2]}"},
+};
+
+static const struct
+{
+    char                input[100];
+    JTOK_PARSE_STATUS_t status;
+} invalid_table[] = {
+    {.input = "[1, 2]", .status = JTOK_PARSE_STATUS_NON_OBJECT},
+    {.input = "   ", .status = JTOK_PARSE_STATUS_NON_OBJECT},
+    {.input = "{\"a\":1} {}", .status = JTOK_PARSE_STATUS_INVALID_END},
+    {.input = "{\"a\":1}  trailing garbage", .status = JTOK_PARSE_STATUS_INVALID_END},
+    {.input = "{\"a\":[1}", .status = JTOK_PARSE_STATUS_INVAL},
+    {.input = "{\"a\":{\"b\":1}", .status = JTOK_PARSE_STATUS_PARTIAL_TOKEN},
+    {.input = "{\"a\":\"unterminated}", .status = JTOK_PARSE_STATUS_PARTIAL_TOKEN},
+    {.input = "{\"a\":\"bad \\q escape\"}", .status = JTOK_PARSE_STATUS_INVAL},
+    {.input = "{\"a\":\"\\u12G4\"}", .status = JTOK_PARSE_STATUS_INVAL},
+};
+/* clang-format on */
+
+static jtok_tkn_t tokens[TOKEN_MAX];
+
+
+static int test_minify(void)
+{
+    unsigned long long i;
+    unsigned long long max_i = sizeof(minify_table) / sizeof(*minify_table);
+    for (i = 0; i < max_i; i++)
+    {
+        char   buf[250];
+        size_t len;
+        printf("\nminifying %s... ", minify_table[i].input);
+
+        strcpy(buf, minify_table[i].input);
+        len = jtok_minify(buf, strlen(buf));
+        if (len != strlen(minify_table[i].output) ||
+            0 != strcmp(buf, minify_table[i].output))
+        {
+            printf("failed. got %s\n", buf);
+            return 1;
+        }
+
+        strcpy(buf, minify_table[i].input);
+        len = strlen(buf);
+        if (jtok_minify_validate(buf, &len) != JTOK_PARSE_STATUS_OK ||
+            0 != strcmp(buf, minify_table[i].output))
+        {
+            printf("failed. validating minify got %s\n", buf);
+            return 1;
+        }
+
+        if (jtok_parse(buf, tokens, TOKEN_MAX) != JTOK_PARSE_STATUS_OK)
+        {
+            printf("failed. minified text does not parse\n");
+            return 1;
+        }
+        printf("passed.\n");
+    }
+    return 0;
+}
+
+
+static int test_invalid(void)
+{
+    unsigned long long i;
+    unsigned long long max_i = sizeof(invalid_table) / sizeof(*invalid_table);
+    for (i = 0; i < max_i; i++)
+    {
+        char                buf[100];
+        size_t              len;
+        JTOK_PARSE_STATUS_t status;
+        printf("\nvalidating %s... ", invalid_table[i].input);
+        strcpy(buf, invalid_table[i].input);
+        len    = strlen(buf);
+        status = jtok_minify_validate(buf, &len);
+        if (status != invalid_table[i].status)
+        {
+            printf("failed. got %s\n", jtok_jtokerr_messages(status));
+            return 1;
+        }
+        printf("passed.\n");
+    }
+    return 0;
+}
+
+
+static int test_limits(void)
+{
+    char   buf[256];
+    size_t len;
+    int    depth;
+    printf("\nchecking length and nesting limits... ");
+
+    /* Bytes after len (and after a nul) are left alone */
+    strcpy(buf, "{ \"a\" : 1 }");
+    len = jtok_minify(buf, 5);
+    if (len != 4 || 0 != memcmp(buf, "{\"a\"", 4) || buf[4] != '\0')
+    {
+        printf("failed. length bound not honoured\n");
+        return 1;
+    }
+
+    len = 0;
+    for (depth = 0; depth <= JTOK_MAX_RECURSE_DEPTH; depth++)
+    {
+        buf[len++] = '{';
+        buf[len++] = '"';
+        buf[len++] = 'k';
+        buf[len++] = '"';
+        buf[len++] = ':';
+    }
+    buf[len++] = '{';
+    for (depth = 0; depth <= JTOK_MAX_RECURSE_DEPTH + 1; depth++)
+    {
+        buf[len++] = '}';
+    }
+    if (jtok_minify_validate(buf, &len) !=
+        JTOK_PARSE_STATUS_NEST_DEPTH_EXCEEDED)
+    {
+        printf("failed. nesting overflow not reported\n");
+        return 1;
+    }
+    printf("passed.\n");
+    return 0;
+}
+
+
+int main(void)
+{
+    if (test_minify() != 0 || test_invalid() != 0 || test_limits() != 0)
+    {
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,77 @@
+/**
+ * @file offset_width.test.c
+ * @author Carl Mattatall (cmattatall2@gmail.com)
+ * @brief Source module to test token offsets of JTOK_OFFSET_WIDTH bits and
+ * tokens longer than 64 KB
+ * @version 0.1
+ * @date 2021-05-15
+ *
+ * @copyright Copyright (c) 2021 Carl Mattatall
+ *
+ */
+#include <stdio.h>
+#include <string.h>
+
+#include "jtok.h"
+
+#define LONG_STRING 100000
+#define BIG_POOL 40000
+
+static char       json[LONG_STRING + 32];
+static char       copy[LONG_STRING + 1];
+static jtok_tkn_t tokens[BIG_POOL];
+
+
+int main(void)
+{
+    JTOK_PARSE_STATUS_t status;
+    size_t              len;
+
+    printf("\nchecking the width of token fields... ");
+    if (sizeof(tokens[0].start) * CHAR_BIT != JTOK_OFFSET_WIDTH ||
+        sizeof(tokens[0].sibling) != sizeof(jtok_off_t))
+    {
+        printf("failed.\n");
+        return 1;
+    }
+    printf("passed.\n");
+
+    printf("\nparsing a %d byte string... ", LONG_STRING);
+    len = (size_t)sprintf(json, "{\"long\":\"");
+    memset(&json[len], 'x', LONG_STRING);
+    len += LONG_STRING;
+    json[len - 1] = 'y';
+    len += (size_t)sprintf(&json[len], "\",\"n\":1}");
+    status = jtok_parsen(json, len, tokens, BIG_POOL);
+    if (len > (size_t)JTOK_OFF_MAX)
+    {
+        /* The document cannot be indexed, and must say so */
+        if (status != JTOK_PARSE_STATUS_INVAL)
+        {
+            printf("failed. %s\n", jtok_jtokerr_messages(status));
+            return 1;
+        }
+    }
+    else if (status != JTOK_PARSE_STATUS_OK ||
+             jtok_toklen(&tokens[2]) != LONG_STRING ||
+             jtok_tokcpy(copy, sizeof(copy), &tokens[2]) != copy ||
+             copy[LONG_STRING - 1] != 'y' ||
+             !jtok_tokncmp(copy, &tokens[2], LONG_STRING) ||
+             !jtok_tokcmp("n", &tokens[3]))
+    {
+        printf("failed. %s\n", jtok_jtokerr_messages(status));
+        return 1;
+    }
+    printf("passed.\n");
+
+    printf("\nparsing with a pool larger than JTOK_OFF_MAX... ");
+    status = jtok_parse("{\"a\":[1,2,3]}", tokens, (size_t)JTOK_OFF_MAX + 1);
+    if (status != JTOK_PARSE_STATUS_OK || tokens[2].size != 3 ||
+        tokens[6].type != JTOK_UNASSIGNED_TOKEN)
+    {
+        printf("failed. %s\n", jtok_jtokerr_messages(status));
+        return 1;
+    }
+    printf("passed.\n");
+    return 0;
+}
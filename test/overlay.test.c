@@ -0,0 +1,212 @@
+/**
+ * @file overlay.test.c
+ * @author Carl Mattatall (cmattatall2@gmail.com)
+ * @brief Source module to test copy-on-write edit overlays
+ * @version 0.1
+ * @date 2021-05-05
+ *
+ * @copyright Copyright (c) 2021 Carl Mattatall
+ *
+ */
+#include <stdio.h>
+#include <string.h>
+
+#include "jtok.h"
+#include "jtok_overlay.h"
+
+#define TOKEN_MAX 200
+#define OUTPUT_MAX 512
+#define EDIT_MAX 8
+
+static jtok_tkn_t  tokens[TOKEN_MAX];
+static jtok_edit_t edits[EDIT_MAX];
+
+static struct
+{
+    char   buf[OUTPUT_MAX];
+    size_t len;
+} output;
+
+
+static int collect(void *ctx, const char *data, size_t len)
+{
+    (void)ctx;
+    if (output.len + len >= sizeof(output.buf))
+    {
+        return 1;
+    }
+    memcpy(&output.buf[output.len], data, len);
+    output.len += len;
+    output.buf[output.len] = '\0';
+    return 0;
+}
+
+
+static int check(const char *what, const jtok_overlay_t *overlay,
+                 const char *expected)
+{
+    printf("\n%s... ", what);
+    output.len    = 0;
+    output.buf[0] = '\0';
+    if (jtok_overlay_serialize(overlay, collect, NULL) != JTOK_WRITE_STATUS_OK)
+    {
+        printf("failed. serialize returned an error\n");
+        return 1;
+    }
+    if (0 != strcmp(output.buf, expected))
+    {
+        printf("failed. got %s expected %s\n", output.buf, expected);
+        return 1;
+    }
+
+    /* The result must still be a valid document */
+    static jtok_tkn_t reparsed[TOKEN_MAX];
+    if (jtok_parse(output.buf, reparsed, TOKEN_MAX) != JTOK_PARSE_STATUS_OK)
+    {
+        printf("failed. output does not parse\n");
+        return 1;
+    }
+    printf("passed.\n");
+    return 0;
+}
+
+
+int main(void)
+{
+    static const char json[] = "{\"id\": 7, \"user\": {\"name\": \"old\", "
+                               "\"tags\": [\"a\", \"b\", \"c\"]}, "
+                               "\"blob\": {\"big\": [1, 2, 3]}}";
+    static char       original[sizeof(json)];
+    jtok_overlay_t    overlay;
+    memcpy(original, json, sizeof(json));
+    if (jtok_parse(original, tokens, TOKEN_MAX) != JTOK_PARSE_STATUS_OK)
+    {
+        printf("parse failed\n");
+        return 1;
+    }
+
+    /* tokens: 0 root, 1 id, 2 7, 3 user, 4 {...}, 5 name, 6 "old", 7 tags,
+     * 8 [...], 9 "a", 10 "b", 11 "c", 12 blob, 13 {...}, 14 big, 15 [...] */
+    jtok_overlay_init(&overlay, tokens, edits, EDIT_MAX);
+    if (check("serializing without edits", &overlay, json) != 0)
+    {
+        return 1;
+    }
+
+    jtok_overlay_set(&overlay, &tokens[6], "\"new\"", 5);
+    if (check("replacing a value", &overlay,
+              "{\"id\": 7, \"user\": {\"name\": \"new\", \"tags\": [\"a\", "
+              "\"b\", \"c\"]}, \"blob\": {\"big\": [1, 2, 3]}}") != 0)
+    {
+        return 1;
+    }
+
+    jtok_overlay_delete(&overlay, &tokens[10]);
+    jtok_overlay_append(&overlay, &tokens[8], "\"d\"", 3);
+    jtok_overlay_delete(&overlay, &tokens[1]);
+    jtok_overlay_insert(&overlay, &tokens[0], "added", 5, "{\"x\":null}", 10);
+    if (check("deleting, appending and inserting", &overlay,
+              "{\"user\": {\"name\": \"new\", \"tags\": [\"a\", \"c\", "
+              "\"d\"]}, \"blob\": {\"big\": [1, 2, 3]}, \"added\": "
+              "{\"x\":null}}") != 0)
+    {
+        return 1;
+    }
+
+    if (0 != memcmp(original, json, sizeof(json)) ||
+        tokens[10].type != JTOK_STRING)
+    {
+        printf("failed. source text or pool was modified\n");
+        return 1;
+    }
+
+    jtok_overlay_init(&overlay, tokens, edits, EDIT_MAX);
+    jtok_overlay_delete(&overlay, &tokens[14]);
+    jtok_overlay_set(&overlay, &tokens[0], "{}", 2);
+    if (check("replacing the root", &overlay, "{}") != 0)
+    {
+        return 1;
+    }
+
+    static const char pretty[] = "{\n    \"a\": 1,\n    \"b\\u0063\": [\n"
+                                 "        2\n    ]\n}";
+    static char       layout[sizeof(pretty)];
+    memcpy(layout, pretty, sizeof(pretty));
+    if (jtok_parse(layout, tokens, TOKEN_MAX) != JTOK_PARSE_STATUS_OK)
+    {
+        printf("parse failed\n");
+        return 1;
+    }
+
+    /* tokens: 0 root, 1 a, 2 1, 3 bc, 4 [...], 5 2 */
+    jtok_overlay_init(&overlay, tokens, edits, EDIT_MAX);
+    jtok_overlay_append(&overlay, &tokens[4], "3", 1);
+    jtok_overlay_insert(&overlay, &tokens[0], "q\"\\", 3, "true", 4);
+    if (check("keeping the layout and escaping inserted keys", &overlay,
+              "{\n    \"a\": 1,\n    \"b\\u0063\": [\n        2,\n        3\n"
+              "    ],\n    \"q\\\"\\\\\": true\n}") != 0)
+    {
+        return 1;
+    }
+
+    jtok_overlay_init(&overlay, tokens, edits, EDIT_MAX);
+    jtok_overlay_insert(&overlay, &tokens[0], "bc", 2, "0", 1);
+    jtok_overlay_insert(&overlay, &tokens[0], "new", 3, "1", 1);
+    jtok_overlay_insert(&overlay, &tokens[0], "new", 3, "2", 1);
+    if (check("replacing existing keys on insert", &overlay,
+              "{\n    \"a\": 1,\n    \"b\\u0063\": 0,\n    \"new\": 2\n}") != 0)
+    {
+        return 1;
+    }
+
+    jtok_overlay_init(&overlay, tokens, edits, EDIT_MAX);
+    jtok_overlay_delete(&overlay, &tokens[1]);
+    jtok_overlay_delete(&overlay, &tokens[3]);
+    jtok_overlay_insert(&overlay, &tokens[0], "a", 1, "3", 1);
+    if (check("inserting a deleted key", &overlay,
+              "{\n    \"a\": 3\n}") != 0)
+    {
+        return 1;
+    }
+
+    if (jtok_parse(original, tokens, TOKEN_MAX) != JTOK_PARSE_STATUS_OK)
+    {
+        printf("parse failed\n");
+        return 1;
+    }
+
+    printf("\nchecking misuse is rejected... ");
+    jtok_overlay_init(&overlay, tokens, edits, 1);
+    if (jtok_overlay_set(&overlay, &tokens[1], "1", 1) !=
+            JTOK_WRITE_STATUS_INVAL ||
+        jtok_overlay_delete(&overlay, &tokens[2]) != JTOK_WRITE_STATUS_INVAL ||
+        jtok_overlay_append(&overlay, &tokens[4], "1", 1) !=
+            JTOK_WRITE_STATUS_INVAL ||
+        jtok_overlay_insert(&overlay, &tokens[8], "k", 1, "1", 1) !=
+            JTOK_WRITE_STATUS_INVAL ||
+        jtok_overlay_set(&overlay, &tokens[2], "1", 1) !=
+            JTOK_WRITE_STATUS_OK ||
+        jtok_overlay_set(&overlay, &tokens[2], "2", 1) !=
+            JTOK_WRITE_STATUS_NOMEM)
+    {
+        printf("failed.\n");
+        return 1;
+    }
+
+    jtok_overlay_init(&overlay, NULL, edits, EDIT_MAX);
+    if (jtok_overlay_set(&overlay, &tokens[2], "1", 1) !=
+            JTOK_WRITE_STATUS_NULL_PARAM ||
+        jtok_overlay_delete(&overlay, &tokens[1]) !=
+            JTOK_WRITE_STATUS_NULL_PARAM ||
+        jtok_overlay_append(&overlay, &tokens[8], "1", 1) !=
+            JTOK_WRITE_STATUS_NULL_PARAM ||
+        jtok_overlay_insert(&overlay, &tokens[0], "k", 1, "1", 1) !=
+            JTOK_WRITE_STATUS_NULL_PARAM ||
+        overlay.count != 0)
+    {
+        printf("failed. an overlay without a root took an edit\n");
+        return 1;
+    }
+    printf("passed.\n");
+    return 0;
+}
@@ -0,0 +1,210 @@
+/**
+ * @file parse_mt.test.c
+ * @author Carl Mattatall (cmattatall2@gmail.com)
+ * @brief Source module to test parsing a single document on several threads
+ * @version 0.1
+ * @date 2021-05-10
+ *
+ * @copyright Copyright (c) 2021 Carl Mattatall
+ *
+ */
+#include <stdio.h>
+#include <string.h>
+
+#include "jtok.h"
+#include "jtok_parallel.h"
+
+#define INPUT_MAX (512 * 1024)
+#define TOKEN_MAX 120000
+#define THREADS 4
+#define POOL_SIZE 40000
+
+static char       input[INPUT_MAX];
+static size_t     input_len;
+static jtok_tkn_t expected[TOKEN_MAX];
+static jtok_tkn_t tokens[TOKEN_MAX];
+static jtok_tkn_t pools[(THREADS - 1) * POOL_SIZE];
+
+
+static void append(const char *text)
+{
+    size_t len = strlen(text);
+    memcpy(&input[input_len], text, len);
+    input_len += len;
+}
+
+
+/* A document whose arrays are big enough to be split, with strings full of
+ * characters that look like structure */
+static void make_input(int records, const char *element_kind)
+{
+    char record[256];
+    int  i;
+
+    input_len = 0;
+    append("{\"name\":\"big, [document]\",\"records\":[");
+    for (i = 0; i < records; i++)
+    {
+        if (0 == strcmp(element_kind, "object"))
+        {
+            sprintf(record,
+                    "%s{\"id\":%d,\"text\":\"a,b]\\\"c[{\",'alt':'x\\\\],',"
+                    "\"tags\":[\"t\",\"u,\"],\"m\":{\"k\":[%d,[true,null]]}}",
+                    (i == 0) ? "" : ",", i, i % 7);
+        }
+        else if (0 == strcmp(element_kind, "string"))
+        {
+            sprintf(record, "%s\"item %d, \\\\\\\" ] } [\"", (i == 0) ? "" : ",",
+                    i);
+        }
+        else
+        {
+            sprintf(record, "%s%d.25", (i == 0) ? "" : ",", i);
+        }
+        append(record);
+    }
+    append("],\"pairs\":[");
+    for (i = 0; i < records / 4; i++)
+    {
+        sprintf(record, "%s[%d,%d]", (i == 0) ? "" : ", ", i, -i);
+        append(record);
+    }
+    append("],\"done\":true}");
+}
+
+
+static int compare(const char *what, JTOK_PARSE_STATUS_t want,
+                   JTOK_PARSE_STATUS_t got)
+{
+    size_t i;
+    if (want != got)
+    {
+        printf("failed. %s: status %d, expected %d\n", what, got, want);
+        return 1;
+    }
+    for (i = 0; i < TOKEN_MAX && expected[i].type != JTOK_UNASSIGNED_TOKEN;
+         i++)
+    {
+        if (tokens[i].type != expected[i].type ||
+            tokens[i].start != expected[i].start ||
+            tokens[i].end != expected[i].end ||
+            tokens[i].size != expected[i].size ||
+            tokens[i].parent != expected[i].parent ||
+            tokens[i].sibling != expected[i].sibling ||
+            tokens[i].pool != tokens)
+        {
+            printf("failed. %s: token %zu differs\n", what, i);
+            return 1;
+        }
+    }
+    if (want == JTOK_PARSE_STATUS_OK && i < TOKEN_MAX &&
+        tokens[i].type != JTOK_UNASSIGNED_TOKEN)
+    {
+        printf("failed. %s: %zu tokens expected\n", what, i);
+        return 1;
+    }
+    return 0;
+}
+
+
+/* Parse input serially and in parallel and compare the results */
+static int check(const char *what, size_t token_max,
+                 const jtok_parse_mt_config_t *config)
+{
+    JTOK_PARSE_STATUS_t want;
+    JTOK_PARSE_STATUS_t got;
+
+    memset(expected, 0, sizeof(expected));
+    memset(tokens, 0xff, sizeof(tokens));
+    want = jtok_parsen(input, input_len, expected, token_max);
+    got  = jtok_parse_mt(input, input_len, tokens, token_max, config);
+    return compare(what, want, got);
+}
+
+
+int main(void)
+{
+    jtok_parse_mt_config_t config;
+    jtok_tkn_t             one;
+    const char *           kinds[] = {"object", "string", "number"};
+    size_t                 i;
+
+    config.threads   = THREADS;
+    config.pools     = pools;
+    config.pool_size = POOL_SIZE;
+
+    for (i = 0; i < sizeof(kinds) / sizeof(*kinds); i++)
+    {
+        printf("\nparsing a document of %s arrays... ", kinds[i]);
+        make_input((i == 0) ? 2500 : 12000, kinds[i]);
+        if (check(kinds[i], TOKEN_MAX, &config))
+        {
+            return 1;
+        }
+        printf("passed.\n");
+    }
+
+    printf("\nparsing with every thread count... ");
+    make_input(2500, "object");
+    for (config.threads = 1; config.threads <= THREADS; config.threads++)
+    {
+        if (check("thread count", TOKEN_MAX, &config))
+        {
+            return 1;
+        }
+    }
+    config.threads = THREADS;
+    printf("passed.\n");
+
+    printf("\nparsing with helper pools too small to use... ");
+    config.pool_size = 3;
+    if (check("small pools", TOKEN_MAX, &config))
+    {
+        return 1;
+    }
+    config.pool_size = POOL_SIZE;
+    printf("passed.\n");
+
+    printf("\nrunning out of tokens... ");
+    if (check("small pool", TOKEN_MAX / 4, &config))
+    {
+        return 1;
+    }
+    printf("passed.\n");
+
+    printf("\nparsing a truncated document... ");
+    input_len -= 1000;
+    if (check("truncated", TOKEN_MAX, &config))
+    {
+        return 1;
+    }
+    printf("passed.\n");
+
+    printf("\nparsing a document with a mixed array... ");
+    make_input(12000, "number");
+    memcpy(&input[input_len / 2], "{}", 2);
+    if (check("mixed", TOKEN_MAX, &config))
+    {
+        return 1;
+    }
+    make_input(2500, "object");
+    memcpy(&input[input_len / 2], "1,", 2);
+    if (check("mixed", TOKEN_MAX, &config))
+    {
+        return 1;
+    }
+    printf("passed.\n");
+
+    printf("\nrejecting bad configurations... ");
+    config.threads = 0;
+    if (jtok_parse_mt(input, input_len, &one, 1, NULL) !=
+            JTOK_PARSE_STATUS_NULL_PARAM ||
+        jtok_parse_mt(input, input_len, &one, 1, &config) !=
+            JTOK_PARSE_STATUS_INVAL)
+    {
+        printf("failed.\n");
+        return 1;
+    }
+    printf("passed.\n");
+    return 0;
+}
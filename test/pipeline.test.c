@@ -0,0 +1,310 @@
+/**
+ * @file pipeline.test.c
+ * @author Carl Mattatall (cmattatall2@gmail.com)
+ * @brief Source module to test the reader / parser / consumer pipeline
+ * @version 0.1
+ * @date 2021-05-12
+ *
+ * @copyright Copyright (c) 2021 Carl Mattatall
+ *
+ */
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include "jtok.h"
+#include "jtok_pool.h"
+#include "jtok_pipeline.h"
+
+#define DOCS 3000
+#define CONTEXTS 3
+#define TOKENS 16
+#define BUF_SIZE 256
+#define RING 8
+
+typedef struct
+{
+    const char *data;
+    size_t      len;
+    size_t      pos;
+    unsigned    seed;
+} stream_t;
+
+typedef struct
+{
+    const char *stream;
+    size_t      count;
+    size_t      errors;
+    size_t      nomem;
+    size_t      partial;
+    size_t      stop_after;
+    unsigned    seen[DOCS + 2];
+} results_t;
+
+static jtok_ctx_pool_t    pool;
+static jtok_ctx_t         ctxs[CONTEXTS];
+static jtok_tkn_t         arena[CONTEXTS * TOKENS];
+static char               buf[BUF_SIZE];
+static jtok_ring_cell_t   in_cells[RING];
+static jtok_ring_cell_t   out_cells[RING];
+static char               input[DOCS * 48];
+static results_t          results;
+static jtok_pipe_config_t config;
+
+
+/* Hand out the stream in small pieces of varying size */
+static size_t read_stream(void *ctx, char *dst, size_t len)
+{
+    stream_t *stream = (stream_t *)ctx;
+    size_t    n;
+
+    stream->seed = stream->seed * 1103515245u + 12345u;
+    n            = 1 + (stream->seed >> 16) % 61;
+    if (n > len)
+    {
+        n = len;
+    }
+    if (n > stream->len - stream->pos)
+    {
+        n = stream->len - stream->pos;
+    }
+    memcpy(dst, &stream->data[stream->pos], n);
+    stream->pos += n;
+    return n;
+}
+
+
+/* Documents are {"id":N,...} where N is the document index */
+static int check_doc(void *ctx, const jtok_pipe_item_t *doc)
+{
+    results_t *res = (results_t *)ctx;
+    char       id[24];
+
+    if (doc->index > DOCS + 1 || res->seen[doc->index]++ != 0)
+    {
+        res->errors++;
+        return 0;
+    }
+    res->count++;
+    if (doc->status == JTOK_PARSE_STATUS_NOMEM && doc->data == NULL)
+    {
+        res->nomem++;
+    }
+    else if (doc->status == JTOK_PARSE_STATUS_PARTIAL_TOKEN && doc->ctx == NULL)
+    {
+        res->partial++;
+    }
+    else
+    {
+        snprintf(id, sizeof(id), "%zu", doc->index);
+        if (doc->status != JTOK_PARSE_STATUS_OK || doc->ctx == NULL ||
+            memcmp(doc->data, &res->stream[doc->offset], doc->len) != 0 ||
+            !jtok_tokcmp(id, &doc->ctx->tkns[2]))
+        {
+            res->errors++;
+        }
+    }
+    return (res->stop_after != 0 && res->count == res->stop_after);
+}
+
+
+static size_t run(const char *data, size_t len, JTOK_PIPE_FRAMING_t framing,
+                  unsigned workers, size_t batch, size_t stop_after)
+{
+    stream_t stream;
+
+    stream.data = data;
+    stream.len  = len;
+    stream.pos  = 0;
+    stream.seed = (unsigned)len;
+
+    memset(&results, 0, sizeof(results));
+    results.stream     = data;
+    results.stop_after = stop_after;
+
+    config.framing   = framing;
+    config.workers   = workers;
+    config.batch     = batch;
+    config.buf       = buf;
+    config.buf_size  = sizeof(buf);
+    config.in_cells  = in_cells;
+    config.in_count  = RING;
+    config.out_cells = out_cells;
+    config.out_count = RING;
+    config.contexts  = &pool;
+    return jtok_pipe_run(&config, read_stream, &stream, check_doc, &results);
+}
+
+
+static size_t make_lines(void)
+{
+    size_t len = 0;
+    size_t i;
+    for (i = 0; i < DOCS; i++)
+    {
+        len += (size_t)sprintf(&input[len], "{\"id\":%zu,\"v\":[%zu,%zu]}%s", i,
+                               i * 7, i % 13,
+                               (i % 5 == 0) ? "\r\n" : (i % 7 == 0) ? "\n\n  \n" : "\n");
+    }
+    return len - 1; /* last line unterminated */
+}
+
+
+/* Append a length prefix claiming size bytes, then text */
+static size_t put_frame(size_t len, size_t size, const char *text)
+{
+    input[len]     = (char)(size >> 24);
+    input[len + 1] = (char)(size >> 16);
+    input[len + 2] = (char)(size >> 8);
+    input[len + 3] = (char)size;
+    strcpy(&input[len + 4], text);
+    return len + 4 + strlen(text);
+}
+
+
+static size_t make_frames(void)
+{
+    char   doc[48];
+    size_t len = 0;
+    size_t i;
+    for (i = 0; i < DOCS; i++)
+    {
+        sprintf(doc, "{\"id\":%zu,\"v\":[%zu]}", i, i);
+        len = put_frame(len, strlen(doc), doc);
+    }
+    return len;
+}
+
+
+int main(void)
+{
+    jtok_ring_t      ring;
+    jtok_pipe_item_t item;
+    size_t           len;
+    size_t           i;
+    unsigned         workers;
+
+    if (jtok_ctx_pool_init(&pool, ctxs, CONTEXTS, arena, TOKENS, NULL, 0) !=
+        JTOK_PARSE_STATUS_OK)
+    {
+        printf("could not set up the context pool\n");
+        return 1;
+    }
+
+    printf("\npushing and popping a ring... ");
+    if (jtok_ring_init(&ring, in_cells, 6) != JTOK_PARSE_STATUS_INVAL ||
+        jtok_ring_init(&ring, NULL, RING) != JTOK_PARSE_STATUS_NULL_PARAM ||
+        jtok_ring_init(&ring, in_cells, RING) != JTOK_PARSE_STATUS_OK ||
+        jtok_ring_pop(&ring, &item))
+    {
+        printf("failed.\n");
+        return 1;
+    }
+    memset(&item, 0, sizeof(item));
+    for (i = 0; i < RING; i++)
+    {
+        item.index = i;
+        if (!jtok_ring_push(&ring, &item))
+        {
+            printf("failed. ring full after %zu items\n", i);
+            return 1;
+        }
+    }
+    if (jtok_ring_push(&ring, &item))
+    {
+        printf("failed. pushed into a full ring\n");
+        return 1;
+    }
+    for (i = 0; i < RING + 3; i++)
+    {
+        if (!jtok_ring_pop(&ring, &item) || item.index != i)
+        {
+            printf("failed. item %zu out of order\n", i);
+            return 1;
+        }
+        item.index = RING + i;
+        jtok_ring_push(&ring, &item);
+    }
+    printf("passed.\n");
+
+    len = make_lines();
+    for (workers = 1; workers <= 4; workers++)
+    {
+        printf("\nstreaming %d lines through %u parsers... ", DOCS, workers);
+        if (run(input, len, JTOK_PIPE_NEWLINE, workers, workers, 0) != DOCS ||
+            results.errors != 0 || results.nomem != 0 || results.count != DOCS)
+        {
+            printf("failed. %zu delivered, %zu errors\n", results.count,
+                   results.errors);
+            return 1;
+        }
+        printf("passed.\n");
+    }
+
+    printf("\nstopping the pipeline early... ");
+    if (run(input, len, JTOK_PIPE_NEWLINE, 2, 4, 100) != 100 ||
+        results.count != 100 || results.errors != 0)
+    {
+        printf("failed. %zu delivered\n", results.count);
+        return 1;
+    }
+    printf("passed.\n");
+
+    printf("\ndropping a line longer than the buffer... ");
+    len = (size_t)sprintf(input, "{\"id\":0}\n{\"id\":1,\"pad\":\"");
+    memset(&input[len], 'x', 2 * BUF_SIZE);
+    len += 2 * BUF_SIZE;
+    len += (size_t)sprintf(&input[len], "\"}\n{\"id\":2}\n");
+    if (run(input, len, JTOK_PIPE_NEWLINE, 2, 0, 0) != 3 || results.errors != 0 ||
+        results.nomem != 1 || results.seen[1] != 1)
+    {
+        printf("failed. %zu delivered, %zu errors\n", results.count,
+               results.errors);
+        return 1;
+    }
+    printf("passed.\n");
+
+    len = make_frames();
+    printf("\nstreaming %d length-prefixed documents... ", DOCS);
+    if (run(input, len, JTOK_PIPE_LENGTH_PREFIX, 3, 8, 0) != DOCS ||
+        results.errors != 0)
+    {
+        printf("failed. %zu delivered, %zu errors\n", results.count,
+               results.errors);
+        return 1;
+    }
+    printf("passed.\n");
+
+    printf("\nframing oversized and truncated documents... ");
+    len = put_frame(0, 8, "{\"id\":0}");
+    len = put_frame(len, 4096, "");
+    memset(&input[len], ' ', 4096);
+    len = put_frame(len + 4096, 8, "{\"id\":2}");
+    len = put_frame(len, 32, "{\"id\":3");
+    if (run(input, len, JTOK_PIPE_LENGTH_PREFIX, 2, 2, 0) != 4 ||
+        results.errors != 0 || results.nomem != 1 || results.partial != 1)
+    {
+        printf("failed. %zu delivered, %zu errors\n", results.count,
+               results.errors);
+        return 1;
+    }
+    printf("passed.\n");
+
+    printf("\nrejecting bad configurations... ");
+    config.workers = 0;
+    if (jtok_pipe_run(&config, read_stream, NULL, check_doc, &results) != 0 ||
+        jtok_pipe_run(NULL, read_stream, NULL, check_doc, &results) != 0)
+    {
+        printf("failed.\n");
+        return 1;
+    }
+    config.workers  = 1;
+    config.in_count = 3;
+    if (jtok_pipe_run(&config, read_stream, NULL, check_doc, &results) != 0)
+    {
+        printf("failed.\n");
+        return 1;
+    }
+    printf("passed.\n");
+    return 0;
+}
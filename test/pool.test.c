@@ -0,0 +1,179 @@
+/**
+ * @file pool.test.c
+ * @author Carl Mattatall (cmattatall2@gmail.com)
+ * @brief Source module to test pools of parser contexts
+ * @version 0.1
+ * @date 2021-05-11
+ *
+ * @copyright Copyright (c) 2021 Carl Mattatall
+ *
+ */
+#include <stdio.h>
+#include <string.h>
+
+#if defined(JTOK_HAVE_THREADS) && defined(JTOK_HAVE_ATOMICS)
+#include <pthread.h>
+#endif /* #if defined(JTOK_HAVE_THREADS) && defined(JTOK_HAVE_ATOMICS) */
+
+#include "jtok.h"
+#include "jtok_pool.h"
+
+#define CONTEXTS 4
+#define TOKENS 16
+#define SCRATCH 32
+#define THREADS 8
+#define ROUNDS 20000
+
+static jtok_ctx_pool_t pool;
+static jtok_ctx_t      ctxs[CONTEXTS];
+static jtok_tkn_t      arena[CONTEXTS * TOKENS];
+static char            scratch[CONTEXTS * SCRATCH];
+
+static const char doc[] = "{\"id\":7,\"tags\":[\"a\",\"b\"]}";
+static const char big[] = "{\"a\":[1,2,3,4,5,6,7,8,9,10,11,12,13,14,15,16]}";
+
+
+#if defined(JTOK_HAVE_THREADS) && defined(JTOK_HAVE_ATOMICS)
+/* Acquire, use and release contexts as fast as possible, checking that no
+ * other thread holds the same context at the same time */
+static void *hammer(void *arg)
+{
+    char        id = (char)(size_t)arg;
+    jtok_ctx_t *ctx;
+    int         errors = 0;
+    int         i;
+
+    for (i = 0; i < ROUNDS; i++)
+    {
+        ctx = jtok_ctx_acquire(&pool);
+        if (ctx == NULL)
+        {
+            continue;
+        }
+        memset(ctx->scratch, id, ctx->scratch_len);
+        if (jtok_ctx_parse(ctx, doc, strlen(doc)) != JTOK_PARSE_STATUS_OK ||
+            !jtok_tokcmp("7", &ctx->tkns[2]))
+        {
+            errors++;
+        }
+        if (((char *)ctx->scratch)[0] != id ||
+            ((char *)ctx->scratch)[SCRATCH - 1] != id)
+        {
+            errors++;
+        }
+        jtok_ctx_release(ctx);
+    }
+    return (void *)(size_t)errors;
+}
+#endif /* #if defined(JTOK_HAVE_THREADS) && defined(JTOK_HAVE_ATOMICS) */
+
+
+int main(void)
+{
+    jtok_ctx_t *     held[CONTEXTS];
+    jtok_ctx_stats_t stats;
+    size_t           i;
+    size_t           j;
+
+    printf("\nsetting up a pool... ");
+    if (jtok_ctx_pool_init(&pool, ctxs, CONTEXTS, arena, TOKENS, scratch,
+                           SCRATCH) != JTOK_PARSE_STATUS_OK ||
+        jtok_ctx_pool_init(&pool, ctxs, 0, arena, TOKENS, NULL, 0) !=
+            JTOK_PARSE_STATUS_INVAL ||
+        jtok_ctx_pool_init(&pool, NULL, CONTEXTS, arena, TOKENS, NULL, 0) !=
+            JTOK_PARSE_STATUS_NULL_PARAM ||
+        jtok_ctx_pool_init(&pool, ctxs, CONTEXTS, arena, TOKENS, scratch,
+                           SCRATCH) != JTOK_PARSE_STATUS_OK)
+    {
+        printf("failed.\n");
+        return 1;
+    }
+    printf("passed.\n");
+
+    printf("\nhanding out every context once... ");
+    for (i = 0; i < CONTEXTS; i++)
+    {
+        held[i] = jtok_ctx_acquire(&pool);
+        if (held[i] == NULL || held[i]->size != TOKENS ||
+            held[i]->scratch_len != SCRATCH)
+        {
+            printf("failed. context %zu\n", i);
+            return 1;
+        }
+        for (j = 0; j < i; j++)
+        {
+            if (held[j] == held[i] || held[j]->tkns == held[i]->tkns ||
+                held[j]->scratch == held[i]->scratch)
+            {
+                printf("failed. contexts %zu and %zu overlap\n", j, i);
+                return 1;
+            }
+        }
+    }
+    if (jtok_ctx_acquire(&pool) != NULL)
+    {
+        printf("failed. pool did not run dry\n");
+        return 1;
+    }
+    printf("passed.\n");
+
+    printf("\nparsing and reusing a context... ");
+    if (jtok_ctx_parse(held[0], doc, strlen(doc)) != JTOK_PARSE_STATUS_OK ||
+        !jtok_tokcmp("7", &held[0]->tkns[2]) ||
+        jtok_ctx_parse(held[0], big, strlen(big)) != JTOK_PARSE_STATUS_NOMEM)
+    {
+        printf("failed.\n");
+        return 1;
+    }
+    jtok_ctx_release(held[0]);
+    if (jtok_ctx_acquire(&pool) != held[0] ||
+        held[0]->tkns[0].type != JTOK_UNASSIGNED_TOKEN ||
+        held[0]->stats.parses != 2 || held[0]->stats.nomem != 1)
+    {
+        printf("failed. context was not reset for reuse\n");
+        return 1;
+    }
+    for (i = 0; i < CONTEXTS; i++)
+    {
+        jtok_ctx_release(held[i]);
+    }
+    jtok_ctx_pool_stats(&pool, &stats);
+    if (stats.parses != 2 || stats.failures != 1 ||
+        stats.bytes != strlen(doc) + strlen(big))
+    {
+        printf("failed. wrong statistics\n");
+        return 1;
+    }
+    printf("passed.\n");
+
+#if defined(JTOK_HAVE_THREADS) && defined(JTOK_HAVE_ATOMICS)
+    printf("\nsharing %d contexts between %d threads... ", CONTEXTS, THREADS);
+    {
+        pthread_t threads[THREADS];
+        void *    errors;
+        size_t    total = 0;
+        for (i = 0; i < THREADS; i++)
+        {
+            pthread_create(&threads[i], NULL, hammer, (void *)(i + 1));
+        }
+        for (i = 0; i < THREADS; i++)
+        {
+            pthread_join(threads[i], &errors);
+            total += (size_t)errors;
+        }
+        for (i = 0; i < CONTEXTS; i++)
+        {
+            held[i] = jtok_ctx_acquire(&pool);
+        }
+        jtok_ctx_pool_stats(&pool, &stats);
+        if (total != 0 || held[CONTEXTS - 1] == NULL ||
+            jtok_ctx_acquire(&pool) != NULL || stats.failures != 1)
+        {
+            printf("failed. %zu errors\n", total);
+            return 1;
+        }
+    }
+    printf("passed.\n");
+#endif /* #if defined(JTOK_HAVE_THREADS) && defined(JTOK_HAVE_ATOMICS) */
+    return 0;
+}
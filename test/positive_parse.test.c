@@ -14,6 +14,7 @@
 #include <string.h>
 
 #include "jtok.h"
+#include "jtok_events.h"
 
 #define TKN_CNT 200
 
@@ -111,7 +112,17 @@ static const char *validJSON[] = {
 };
 
 static jtok_tkn_t tokens[TKN_CNT];
-int               main(void)
+
+
+static int ignore(void *ctx, const jtok_event_t *ev)
+{
+    (void)ctx;
+    (void)ev;
+    return 0;
+}
+
+
+int main(void)
 {
     unsigned long long i;
     unsigned long long max_i = sizeof(validJSON) / sizeof(*validJSON);
@@ -126,6 +137,15 @@ int               main(void)
             printf("failed with status %d.\n", status);
             return 1;
         }
+
+        /* The events parser must accept it too */
+        status = jtok_events_parse(validJSON[i], strlen(validJSON[i]), ignore,
+                                   NULL, NULL, 0);
+        if (status != JTOK_PARSE_STATUS_OK)
+        {
+            printf("failed with events status %d.\n", status);
+            return 1;
+        }
         else
         {
             printf("passed.\n");
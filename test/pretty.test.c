@@ -0,0 +1,159 @@
+/**
+ * @file pretty.test.c
+ * @author Carl Mattatall (cmattatall2@gmail.com)
+ * @brief Source module to test the token and streaming pretty-printers
+ * @version 0.1
+ * @date 2021-05-04
+ *
+ * @copyright Copyright (c) 2021 Carl Mattatall
+ *
+ */
+#include <stdio.h>
+#include <string.h>
+
+#include "jtok.h"
+#include "jtok_pretty.h"
+
+#define TOKEN_MAX 200
+#define OUTPUT_MAX 1024
+
+/* Deliberately tiny so that every test exercises the flush path */
+#define WRITER_BUF_SIZE 5
+
+/* clang-format off */
+static const struct
+{
+    char input[250];
+    char output[500];
+} pretty_table[] = {
+    {.input = "{}", .output = "{}"},
+    {.input = "{\"a\":1}", .output = "{\n  \"a\": 1\n}"},
+    {.input = " { \"a\" : [ 1 , true , null ] , \"b\" : { } , \"c\" : [ ] } ",
+     .output = "{\n  \"a\": [\n    1,\n    true,\n    null\n  ],\n  \"b\": {},\n  \"c\": []\n}"},
+    {.input = "{\"s\":\"a { b , c : d } \\\" e\",'q':'x,y'}",
+     .output = "{\n  \"s\": \"a { b , c : d } \\\" e\",\n  'q': 'x,y'\n}"},
+    /* Whitespace jtok_parse skips around the root, which isspace accepts */
+    {.input = "\v\f{\"a\":1}\f\v\r\n", .output = "{\n  \"a\": 1\n}"},
+    {.input = "{\"o\":{\"p\":[{\"x\":-1.5e3},[[]]]}}",
+     .output = "{\n  \"o\": {\n    \"p\": [\n      {\n        \"x\": -1.5e3\n      },\n      [\n        []\n      ]\n    ]\n  }\n}"},
+};
+/* clang-format on */
+
+static jtok_tkn_t tokens[TOKEN_MAX];
+
+static struct
+{
+    char   buf[OUTPUT_MAX];
+    size_t len;
+} output;
+
+
+static int collect(void *ctx, const char *data, size_t len)
+{
+    (void)ctx;
+    if (output.len + len >= sizeof(output.buf))
+    {
+        return 1;
+    }
+    memcpy(&output.buf[output.len], data, len);
+    output.len += len;
+    output.buf[output.len] = '\0';
+    return 0;
+}
+
+
+static int check(const char *what, const char *expected)
+{
+    if (0 != strcmp(output.buf, expected))
+    {
+        printf("failed. %s got\n%s\n", what, output.buf);
+        return 1;
+    }
+    return 0;
+}
+
+
+static int pretty_stream(const char *json, size_t chunk, unsigned int indent)
+{
+    char          buf[WRITER_BUF_SIZE];
+    jtok_writer_t w;
+    jtok_pretty_t pretty;
+    size_t        len = strlen(json);
+    size_t        pos;
+    output.len        = 0;
+    output.buf[0]     = '\0';
+    jtok_writer_init(&w, buf, sizeof(buf), collect, NULL);
+    jtok_pretty_init(&pretty, &w, indent);
+    for (pos = 0; pos < len; pos += chunk)
+    {
+        size_t count = (len - pos < chunk) ? len - pos : chunk;
+        jtok_pretty_feed(&pretty, &json[pos], count);
+    }
+    return (jtok_pretty_finish(&pretty) == JTOK_WRITE_STATUS_OK) ? 0 : 1;
+}
+
+
+int main(void)
+{
+    unsigned long long i;
+    unsigned long long max_i = sizeof(pretty_table) / sizeof(*pretty_table);
+    for (i = 0; i < max_i; i++)
+    {
+        char          buf[WRITER_BUF_SIZE];
+        jtok_writer_t w;
+        size_t        chunk;
+        printf("\npretty-printing %s... ", pretty_table[i].input);
+
+        if (jtok_parse(pretty_table[i].input, tokens, TOKEN_MAX) !=
+            JTOK_PARSE_STATUS_OK)
+        {
+            printf("parse failed.\n");
+            return 1;
+        }
+        output.len    = 0;
+        output.buf[0] = '\0';
+        jtok_writer_init(&w, buf, sizeof(buf), collect, NULL);
+        if (jtok_pretty_tokens(&w, tokens, 2) != JTOK_WRITE_STATUS_OK ||
+            jtok_writer_flush(&w) != JTOK_WRITE_STATUS_OK ||
+            check("token walk", pretty_table[i].output) != 0)
+        {
+            return 1;
+        }
+
+        /* Every chunking must give the same result */
+        for (chunk = 1; chunk <= strlen(pretty_table[i].input); chunk++)
+        {
+            if (pretty_stream(pretty_table[i].input, chunk, 2) != 0 ||
+                check("stream", pretty_table[i].output) != 0)
+            {
+                printf("chunk size was %zu\n", chunk);
+                return 1;
+            }
+        }
+        printf("passed.\n");
+    }
+
+    printf("\nchecking indent width and subtrees... ");
+    {
+        char          buf[WRITER_BUF_SIZE];
+        jtok_writer_t w;
+        jtok_parse("{\"a\":{\"b\":[1,2]}}", tokens, TOKEN_MAX);
+        output.len = 0;
+        jtok_writer_init(&w, buf, sizeof(buf), collect, NULL);
+        jtok_pretty_tokens(&w, &tokens[2], 0);
+        jtok_writer_flush(&w);
+        if (check("subtree", "{\n\"b\": [\n1,\n2\n]\n}") != 0)
+        {
+            return 1;
+        }
+    }
+
+    if (pretty_stream("{\"a\":\"open", 4, 2) == 0 ||
+        pretty_stream("{\"a\":[1", 4, 2) == 0)
+    {
+        printf("failed. truncated input not reported\n");
+        return 1;
+    }
+    printf("passed.\n");
+    return 0;
+}
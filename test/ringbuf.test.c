@@ -0,0 +1,263 @@
+/**
+ * @file ringbuf.test.c
+ * @author Carl Mattatall (cmattatall2@gmail.com)
+ * @brief Source module to test parsing messages in a ring buffer
+ * @version 0.1
+ * @date 2021-05-16
+ *
+ * @copyright Copyright (c) 2021 Carl Mattatall
+ *
+ */
+#include <stdio.h>
+#include <string.h>
+
+#include "jtok.h"
+#include "jtok_ringbuf.h"
+
+#define TOKEN_MAX 100
+#define RING_MAX 1024
+#define TEXT_MAX 128
+
+static const char *documents[] = {
+    "{}",
+    "  {\"a\" : 1, \"b\":[true,false,null], \"c\":{\"d\":\"e\"}}",
+    "{\"list\":[{\"id\":1,\"tags\":[\"x\",\"y\"]},{\"id\":2,\"tags\":[]}],"
+    "\"n\":-12.5e+3,\"p\":+7,'single':'it\"s'}",
+    "{\"nested\":[[1,2],[[3],[4,5]],[]],\"esc\":\"a\\\"b\\u00e9\\\\\"}\n",
+};
+
+static jtok_tkn_t expected[TOKEN_MAX];
+static jtok_tkn_t tokens[TOKEN_MAX];
+static jtok_tkn_t filled[TOKEN_MAX];
+static char       storage[RING_MAX];
+static char       text[TEXT_MAX];
+static char       copy[TEXT_MAX];
+static char       message[JTOK_RINGBUF_WINDOW + 2 * TEXT_MAX];
+static char       scratch[RING_MAX];
+
+
+/* Write a message into the ring at head, wrapping around its end */
+static void put(jtok_ringbuf_t *ring, const char *msg, size_t len, size_t head)
+{
+    size_t i;
+    memset(storage, '#', ring->capacity);
+    for (i = 0; i < len; i++)
+    {
+        storage[(head + i) % ring->capacity] = msg[i];
+    }
+    ring->head = head;
+    ring->tail = (head + len) % ring->capacity;
+}
+
+
+static int check(const jtok_ringbuf_t *ring, const char *json)
+{
+    JTOK_PARSE_STATUS_t status;
+    size_t              len;
+    size_t              i;
+
+    status = jtok_parse_ringbuf(ring, tokens, TOKEN_MAX);
+    if (status != JTOK_PARSE_STATUS_OK)
+    {
+        printf("failed. %s\n", jtok_jtokerr_messages(status));
+        return 1;
+    }
+    for (i = 0; expected[i].type != JTOK_UNASSIGNED_TOKEN; i++)
+    {
+        len = jtok_toklen(&expected[i]);
+        memcpy(text, &json[expected[i].start], len);
+        text[len] = '\0';
+        memset(copy, 0, sizeof(copy));
+
+        if (tokens[i].type != expected[i].type ||
+            tokens[i].size != expected[i].size ||
+            tokens[i].parent != expected[i].parent ||
+            tokens[i].sibling != expected[i].sibling ||
+            tokens[i].json != storage ||
+            (size_t)tokens[i].start % ring->capacity !=
+                (ring->head + (size_t)expected[i].start) % ring->capacity)
+        {
+            printf("failed. token %u differs\n", (unsigned)i);
+            return 1;
+        }
+        if (!jtok_ringbuf_tokcmp(ring, text, &tokens[i]) ||
+            jtok_ringbuf_tokcpy(ring, copy, sizeof(copy), &tokens[i]) != copy ||
+            0 != strcmp(copy, text))
+        {
+            printf("failed. token %u has the wrong text\n", (unsigned)i);
+            return 1;
+        }
+        if ((size_t)tokens[i].end <= ring->capacity &&
+            !jtok_tokcmp(text, &tokens[i]))
+        {
+            printf("failed. token %u is not contiguous\n", (unsigned)i);
+            return 1;
+        }
+    }
+    if (tokens[i].type != JTOK_UNASSIGNED_TOKEN)
+    {
+        printf("failed. there are too many tokens\n");
+        return 1;
+    }
+    return 0;
+}
+
+
+/* Fill the pool with tokens a failed parse must leave alone */
+static void prefill(void)
+{
+    size_t i;
+    for (i = 0; i < TOKEN_MAX; i++)
+    {
+        filled[i].type    = JTOK_STRING;
+        filled[i].start   = 1;
+        filled[i].end     = 2;
+        filled[i].size    = 0;
+        filled[i].parent  = JTOK_NO_PARENT_IDX;
+        filled[i].sibling = JTOK_NO_SIBLING_IDX;
+        filled[i].json    = text;
+    }
+    memcpy(tokens, filled, sizeof(tokens));
+}
+
+
+static int untouched(void)
+{
+    return memcmp(tokens, filled, sizeof(tokens)) == 0;
+}
+
+
+int main(void)
+{
+    JTOK_PARSE_STATUS_t status;
+    jtok_ringbuf_t      ring;
+    const char *        json;
+    size_t              len;
+    size_t              i;
+    size_t              head;
+
+    ring.base = storage;
+    for (i = 0; i < sizeof(documents) / sizeof(*documents); i++)
+    {
+        json = documents[i];
+        len  = strlen(json);
+        printf("\n%s ... ", json);
+        if (jtok_parse(json, expected, TOKEN_MAX) != JTOK_PARSE_STATUS_OK)
+        {
+            printf("failed. the reference parse failed\n");
+            return 1;
+        }
+
+        /* Wrapped at every byte of the message */
+        ring.capacity = len + 3;
+        for (head = 0; head < ring.capacity; head++)
+        {
+            put(&ring, json, len, head);
+            if (check(&ring, json))
+            {
+                printf("head at %u\n", (unsigned)head);
+                return 1;
+            }
+        }
+        printf("passed.\n");
+    }
+
+    json          = documents[1];
+    len           = strlen(json);
+    ring.capacity = RING_MAX;
+    printf("\nparsing a message still arriving... ");
+    put(&ring, json, len - 4, RING_MAX - 20);
+    status = jtok_parse_ringbuf(&ring, tokens, TOKEN_MAX);
+    if (status != JTOK_PARSE_STATUS_PARTIAL_TOKEN)
+    {
+        printf("failed. %s\n", jtok_jtokerr_messages(status));
+        return 1;
+    }
+    put(&ring, json, len, RING_MAX - 20);
+    if (jtok_parse(json, expected, TOKEN_MAX) != JTOK_PARSE_STATUS_OK ||
+        check(&ring, json))
+    {
+        return 1;
+    }
+    printf("passed.\n");
+
+    printf("\nwrapping a value longer than the window... ");
+    len = (size_t)sprintf(message, "{\"k\":\"");
+    memset(&message[len], 'v', JTOK_RINGBUF_WINDOW);
+    len += JTOK_RINGBUF_WINDOW;
+    len += (size_t)sprintf(&message[len], "\"}");
+    put(&ring, message, len, RING_MAX - 10);
+    status = jtok_parse_ringbuf(&ring, tokens, TOKEN_MAX);
+    if (status != JTOK_PARSE_STATUS_NOMEM)
+    {
+        printf("failed. %s\n", jtok_jtokerr_messages(status));
+        return 1;
+    }
+    printf("passed.\n");
+
+    printf("\nwrapping long keys and values through scratch... ");
+    len = (size_t)sprintf(message, "{\"");
+    memset(&message[len], 'k', JTOK_RINGBUF_WINDOW);
+    len += JTOK_RINGBUF_WINDOW;
+    len += (size_t)sprintf(&message[len], "\":\"");
+    memset(&message[len], 'v', TEXT_MAX);
+    len += TEXT_MAX;
+    len += (size_t)sprintf(&message[len], "\"}");
+    message[len] = '\0';
+    if (jtok_parse(message, expected, TOKEN_MAX) != JTOK_PARSE_STATUS_OK)
+    {
+        printf("failed. the reference parse failed\n");
+        return 1;
+    }
+    for (head = RING_MAX - len + 2; head < RING_MAX; head += 37)
+    {
+        put(&ring, message, len, head);
+        status = jtok_parse_ringbuf_scratch(&ring, tokens, TOKEN_MAX, scratch,
+                                            sizeof(scratch));
+        if (status != JTOK_PARSE_STATUS_OK ||
+            !jtok_ringbuf_tokcpy(&ring, text, sizeof(text), &tokens[2]) ||
+            jtok_toklen(&tokens[1]) != JTOK_RINGBUF_WINDOW ||
+            jtok_toklen(&tokens[2]) != TEXT_MAX || text[0] != 'v' ||
+            text[TEXT_MAX - 1] != 'v')
+        {
+            printf("failed. head at %u\n", (unsigned)head);
+            return 1;
+        }
+    }
+    printf("passed.\n");
+
+    printf("\nparsing an empty ring... ");
+    put(&ring, json, 0, 5);
+    prefill();
+    status = jtok_parse_ringbuf(&ring, tokens, TOKEN_MAX);
+    if (status != JTOK_PARSE_STATUS_NON_OBJECT || !untouched())
+    {
+        printf("failed. %s\n", jtok_jtokerr_messages(status));
+        return 1;
+    }
+    printf("passed.\n");
+
+    printf("\nparsing bad rings... ");
+    ring.head = RING_MAX;
+    prefill();
+    status = jtok_parse_ringbuf(&ring, tokens, TOKEN_MAX);
+    if (status != JTOK_PARSE_STATUS_INVAL || !untouched())
+    {
+        printf("failed. %s\n", jtok_jtokerr_messages(status));
+        return 1;
+    }
+    ring.head = 0;
+    ring.base = NULL;
+    status    = jtok_parse_ringbuf(&ring, tokens, TOKEN_MAX);
+    ring.base = storage;
+    if (status != JTOK_PARSE_STATUS_NULL_PARAM || !untouched() ||
+        jtok_parse_ringbuf(NULL, tokens, TOKEN_MAX) !=
+            JTOK_PARSE_STATUS_NULL_PARAM ||
+        jtok_ringbuf_tokcpy(&ring, NULL, 1, &tokens[0]) != NULL)
+    {
+        printf("failed.\n");
+        return 1;
+    }
+    printf("passed.\n");
+    return 0;
+}
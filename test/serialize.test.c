@@ -0,0 +1,139 @@
+/**
+ * @file serialize.test.c
+ * @author Carl Mattatall (cmattatall2@gmail.com)
+ * @brief Source module to test span-splicing re-serialization of subtrees
+ * @version 0.1
+ * @date 2021-05-02
+ *
+ * @copyright Copyright (c) 2021 Carl Mattatall
+ *
+ */
+#include <stdio.h>
+#include <string.h>
+
+#include "jtok.h"
+
+#define TOKEN_MAX 200
+#define OUTPUT_MAX 512
+
+static jtok_tkn_t tokens[TOKEN_MAX];
+
+static struct
+{
+    char   buf[OUTPUT_MAX];
+    size_t len;
+    int    writes;
+} output;
+
+
+static int collect(void *ctx, const char *data, size_t len)
+{
+    (void)ctx;
+    if (output.len + len >= sizeof(output.buf))
+    {
+        return 1;
+    }
+    memcpy(&output.buf[output.len], data, len);
+    output.len += len;
+    output.buf[output.len] = '\0';
+    output.writes++;
+    return 0;
+}
+
+
+static int check(const char *what, const jtok_tkn_t *tkn,
+                 const jtok_splice_t *splices, size_t count,
+                 const char *expected)
+{
+    printf("\n%s... ", what);
+    output.len    = 0;
+    output.writes = 0;
+    output.buf[0] = '\0';
+    if (jtok_serialize(tkn, splices, count, collect, NULL) !=
+        JTOK_WRITE_STATUS_OK)
+    {
+        printf("failed. serialize returned an error\n");
+        return 1;
+    }
+    if (0 != strcmp(output.buf, expected))
+    {
+        printf("failed. got %s expected %s\n", output.buf, expected);
+        return 1;
+    }
+    printf("passed.\n");
+    return 0;
+}
+
+
+int main(void)
+{
+    static const char json[] =
+        "{\"id\":7, \"name\":\"old\", \"body\":{\"x\":[1, 2, 3], \"y\":null}}";
+    if (jtok_parse(json, tokens, TOKEN_MAX) != JTOK_PARSE_STATUS_OK)
+    {
+        printf("parse failed\n");
+        return 1;
+    }
+
+    /* tokens: 0 root, 1 id, 2 7, 3 name, 4 "old", 5 body, 6 {...}, 7 x,
+     * 8 [...], 9 1, 10 2, 11 3, 12 y, 13 null */
+    if (check("forwarding a sub-object", &tokens[6], NULL, 0,
+              "{\"x\":[1, 2, 3], \"y\":null}") != 0)
+    {
+        return 1;
+    }
+    if (output.writes != 1)
+    {
+        printf("unspliced subtree took %d writes\n", output.writes);
+        return 1;
+    }
+
+    if (check("forwarding a string", &tokens[4], NULL, 0, "\"old\"") != 0)
+    {
+        return 1;
+    }
+
+    const jtok_splice_t edits[] = {
+        {.target = &tokens[13], .text = "false", .len = 5},
+        {.target = &tokens[4], .text = "\"new\"", .len = 5},
+        {.target = &tokens[8], .text = "[]", .len = 2},
+        {.target = &tokens[10], .text = "ignored", .len = 7},
+    };
+    if (check("splicing replacements", &tokens[0], edits,
+              sizeof(edits) / sizeof(*edits),
+              "{\"id\":7, \"name\":\"new\", \"body\":{\"x\":[], \"y\":false}}") !=
+        0)
+    {
+        return 1;
+    }
+
+    if (check("ignoring splices outside the subtree", &tokens[6], edits,
+              sizeof(edits) / sizeof(*edits),
+              "{\"x\":[], \"y\":false}") != 0)
+    {
+        return 1;
+    }
+
+    const jtok_splice_t whole = {.target = &tokens[6], .text = "0", .len = 1};
+    if (check("replacing the subtree root", &tokens[6], &whole, 1, "0") != 0)
+    {
+        return 1;
+    }
+
+    printf("\nchecking errors are reported... ");
+    jtok_tkn_t detached = tokens[0];
+    detached.json       = NULL;
+    output.len          = sizeof(output.buf);
+    if (jtok_serialize(&detached, NULL, 0, collect, NULL) !=
+            JTOK_WRITE_STATUS_INVAL ||
+        jtok_serialize(&tokens[0], NULL, 0, collect, NULL) !=
+            JTOK_WRITE_STATUS_SINK_ERROR ||
+        jtok_serialize(NULL, NULL, 0, collect, NULL) !=
+            JTOK_WRITE_STATUS_NULL_PARAM)
+    {
+        printf("failed.\n");
+        return 1;
+    }
+    printf("passed.\n");
+    return 0;
+}
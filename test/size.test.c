@@ -110,7 +110,7 @@ int main(void)
         {
             if (tokens[0].size != true_table[i].size)
             {
-                printf("failed. parsed size was %d\n", tokens[0].size);
+                printf("failed. parsed size was %d\n", (int)tokens[0].size);
                 return -1;
             }
             else
@@ -0,0 +1,90 @@
+/**
+ * @file subtree_hash.test.c
+ * @author Carl Mattatall (cmattatall2@gmail.com)
+ * @brief Source module to test structural hashing of jtok subtrees
+ * @version 0.1
+ * @date 2021-04-17
+ *
+ * @copyright Copyright (c) 2021 Carl Mattatall
+ *
+ */
+#include <stdio.h>
+
+#include "jtok.h"
+
+#define TOKEN_MAX 200
+
+/* clang-format off */
+static const struct
+{
+    char json1[250];
+    char json2[250];
+    bool equal;
+} hash_table[] = {
+    {.json1 = "{\"a\":1,\"b\":2}", .json2 = "{\"b\":2,\"a\":1}", .equal = true},
+    {.json1 = "{\"a\":1.0}", .json2 = "{ \"a\" : 1e0 }", .equal = true},
+    {.json1 = "{\"a\":-0}", .json2 = "{\"a\":0.0}", .equal = true},
+    {.json1 = "{\"a\":{\"x\":[1,{\"y\":2,\"z\":3}]}}", .json2 = "{\"a\":{\"x\":[1.0,{\"z\":3,\"y\":2}]}}", .equal = true},
+    {.json1 = "{\"a\":[],\"b\":{}}", .json2 = "{\"b\":{},\"a\":[]}", .equal = true},
+
+    {.json1 = "{\"a\":[1,2]}", .json2 = "{\"a\":[2,1]}", .equal = false},
+    {.json1 = "{\"a\":1}", .json2 = "{\"a\":\"1\"}", .equal = false},
+    {.json1 = "{\"a\":[]}", .json2 = "{\"a\":{}}", .equal = false},
+    {.json1 = "{\"a\":1,\"b\":2}", .json2 = "{\"a\":2,\"b\":1}", .equal = false},
+    {.json1 = "{\"a\":true}", .json2 = "{\"a\":null}", .equal = false},
+    {.json1 = "{\"a\":[[1],[2]]}", .json2 = "{\"a\":[[1,2]]}", .equal = false},
+};
+/* clang-format on */
+
+static jtok_tkn_t tokens1[TOKEN_MAX];
+static jtok_tkn_t tokens2[TOKEN_MAX];
+
+int main(void)
+{
+    unsigned long long i;
+    unsigned long long max_i = sizeof(hash_table) / sizeof(*hash_table);
+    for (i = 0; i < max_i; i++)
+    {
+        const char *json1 = hash_table[i].json1;
+        const char *json2 = hash_table[i].json2;
+        printf("\nhashing %s and %s... ", json1, json2);
+        if (jtok_parse(json1, tokens1, TOKEN_MAX) != JTOK_PARSE_STATUS_OK ||
+            jtok_parse(json2, tokens2, TOKEN_MAX) != JTOK_PARSE_STATUS_OK)
+        {
+            printf("parse failed.\n");
+            return 1;
+        }
+
+        bool hash_equal = (jtok_hash(tokens1) == jtok_hash(tokens2));
+        if (hash_equal != hash_table[i].equal ||
+            jtok_toktokcmp(tokens1, tokens2) != hash_table[i].equal)
+        {
+            printf("failed.\n");
+            return 1;
+        }
+        printf("passed.\n");
+    }
+
+    /* Same payload embedded in different envelopes hashes the same */
+    printf("\nhashing embedded payloads... ");
+    if (jtok_parse("{\"id\":1,\"payload\":{\"k\":[1,2,3]}}", tokens1,
+                   TOKEN_MAX) != JTOK_PARSE_STATUS_OK ||
+        jtok_parse("{\"payload\":{\"k\":[1,2,3]},\"id\":2}", tokens2,
+                   TOKEN_MAX) != JTOK_PARSE_STATUS_OK)
+    {
+        printf("parse failed.\n");
+        return 1;
+    }
+
+    jtok_tkn_t *payload1 = jtok_obj_has_key(tokens1, "payload");
+    jtok_tkn_t *payload2 = jtok_obj_has_key(tokens2, "payload");
+    if (payload1 == NULL || payload2 == NULL ||
+        jtok_hash(&payload1[1]) != jtok_hash(&payload2[1]) ||
+        jtok_hash(tokens1) == jtok_hash(tokens2))
+    {
+        printf("failed.\n");
+        return 1;
+    }
+    printf("passed.\n");
+    return 0;
+}
@@ -0,0 +1,319 @@
+/**
+ * @file tape.test.c
+ * @author Carl Mattatall (cmattatall2@gmail.com)
+ * @brief Source module to test relocatable binary tapes
+ * @version 0.1
+ * @date 2021-05-08
+ *
+ * @copyright Copyright (c) 2021 Carl Mattatall
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(JTOK_HAVE_POSIX)
+#include <unistd.h>
+#endif /* #if defined(JTOK_HAVE_POSIX) */
+
+#include "jtok.h"
+#include "jtok_tape.h"
+
+#define TOKEN_MAX 200
+#define TAPE_MAX 8192
+
+static jtok_tkn_t tokens[TOKEN_MAX];
+static jtok_tkn_t rebuilt[TOKEN_MAX];
+
+/* uint64_t storage keeps the tape 8-byte aligned */
+static struct
+{
+    uint64_t buf[TAPE_MAX / sizeof(uint64_t)];
+    size_t   len;
+} output;
+
+
+static int collect(void *ctx, const char *data, size_t len)
+{
+    (void)ctx;
+    if (output.len + len > sizeof(output.buf))
+    {
+        return 1;
+    }
+    memcpy((char *)output.buf + output.len, data, len);
+    output.len += len;
+    return 0;
+}
+
+
+static int check_navigation(const jtok_tape_t *tape)
+{
+    size_t      len;
+    double      value;
+    uint32_t    idx;
+    const char *text;
+
+    idx  = jtok_tape_obj_get(tape, 0, "name", 4);
+    text = jtok_tape_text(tape, idx, &len);
+    if (text == NULL || len != 5 || 0 != memcmp(text, "tapes", 5))
+    {
+        printf("failed. string lookup\n");
+        return 1;
+    }
+
+    idx = jtok_tape_obj_get(tape, 0, "list", 4);
+    idx = jtok_tape_array_get(tape, idx, 2);
+    if (!jtok_tape_number(tape, idx, &value) || value != -2.5e3)
+    {
+        printf("failed. number lookup\n");
+        return 1;
+    }
+
+    idx = jtok_tape_obj_get(tape, 0, "nested", 6);
+    idx = jtok_tape_obj_get(tape, idx, "deep", 4);
+    text = jtok_tape_text(tape, idx, &len);
+    if (text == NULL || len != 4 || 0 != memcmp(text, "true", 4) ||
+        jtok_tape_number(tape, idx, &value))
+    {
+        printf("failed. nested lookup\n");
+        return 1;
+    }
+
+    /* next skips whole subtrees */
+    idx = jtok_tape_obj_get(tape, 0, "list", 4);
+    if (jtok_tape_token(tape, idx)->next !=
+        jtok_tape_obj_get(tape, 0, "nested", 6) - 1)
+    {
+        printf("failed. subtree skip index\n");
+        return 1;
+    }
+
+    /* Every next is the first token that starts past the subtree */
+    for (idx = 0; idx < tape->header->token_count; idx++)
+    {
+        uint32_t owner = idx;
+        uint32_t end;
+        if (jtok_tokenIsKey(tokens[idx]))
+        {
+            owner = idx + 1; /* a key's subtree holds its value */
+        }
+        for (end = owner + 1; end < tape->header->token_count &&
+                              tape->tokens[end].start < tape->tokens[owner].end;
+             end++)
+        {
+        }
+        if (tape->tokens[idx].next != end)
+        {
+            printf("failed. next of token %u\n", (unsigned)idx);
+            return 1;
+        }
+    }
+
+    if (jtok_tape_obj_get(tape, 0, "missing", 7) != JTOK_TAPE_NONE ||
+        jtok_tape_array_get(tape, 0, 0) != JTOK_TAPE_NONE ||
+        jtok_tape_token(tape, 100000) != NULL)
+    {
+        printf("failed. missing items found\n");
+        return 1;
+    }
+    return 0;
+}
+
+
+typedef enum
+{
+    CORRUPT_PARENT,
+    CORRUPT_SIBLING,
+    CORRUPT_TYPE,
+    CORRUPT_SIZE,
+    CORRUPT_START,
+    CORRUPT_END,
+} corruption_t;
+
+
+/* Damage one field of token 3 ("list" in the test document), check that a
+ * pool cannot be rebuilt from it, then repair it */
+static int corrupt(const jtok_tape_t *tape, corruption_t field, int64_t value)
+{
+    jtok_tape_tkn_t *t    = (jtok_tape_tkn_t *)&tape->tokens[3];
+    jtok_tape_tkn_t  save = *t;
+    int              result;
+    switch (field)
+    {
+        case CORRUPT_PARENT:
+        {
+            t->parent = (int32_t)value;
+        }
+        break;
+        case CORRUPT_SIBLING:
+        {
+            t->sibling = (int32_t)value;
+        }
+        break;
+        case CORRUPT_TYPE:
+        {
+            t->type = (uint8_t)value;
+        }
+        break;
+        case CORRUPT_SIZE:
+        {
+            t->size = (int32_t)value;
+        }
+        break;
+        case CORRUPT_START:
+        {
+            t->start = (uint32_t)value;
+        }
+        break;
+        case CORRUPT_END:
+        {
+            t->end = (uint32_t)value;
+        }
+        break;
+    }
+    result = jtok_tape_to_pool(tape, rebuilt, TOKEN_MAX);
+    *t     = save;
+    if (result != JTOK_PARSE_STATUS_INVAL)
+    {
+        printf("failed. field %d set to %lld was accepted\n", (int)field,
+               (long long)value);
+        return 1;
+    }
+    return 0;
+}
+
+
+int main(void)
+{
+    static const char json[] = "{\"name\":\"tapes\",\"list\":[1, 2.0, -2.5e3, "
+                               "\"x\"],\"nested\":{\"deep\":true,\"n\":null}}";
+    jtok_tape_t       tape;
+    int               i;
+
+    printf("\nwriting and opening a tape... ");
+    if (jtok_parse(json, tokens, TOKEN_MAX) != JTOK_PARSE_STATUS_OK ||
+        jtok_tape_write(tokens, TOKEN_MAX, collect, NULL) !=
+            JTOK_WRITE_STATUS_OK ||
+        jtok_tape_open(&tape, output.buf, output.len) != JTOK_PARSE_STATUS_OK)
+    {
+        printf("failed.\n");
+        return 1;
+    }
+    if (tape.header->token_count != 15 || tape.header->number_count != 3 ||
+        0 != strcmp(tape.text, json) || check_navigation(&tape) != 0)
+    {
+        printf("failed. tape contents\n");
+        return 1;
+    }
+    printf("passed.\n");
+
+    printf("\nrebuilding a token pool from the tape... ");
+    if (jtok_tape_to_pool(&tape, rebuilt, TOKEN_MAX) != JTOK_PARSE_STATUS_OK ||
+        !jtok_toktokcmp(rebuilt, tokens))
+    {
+        printf("failed.\n");
+        return 1;
+    }
+    for (i = 0; i < 15; i++)
+    {
+        if (rebuilt[i].start != tokens[i].start ||
+            rebuilt[i].end != tokens[i].end ||
+            rebuilt[i].parent != tokens[i].parent ||
+            rebuilt[i].sibling != tokens[i].sibling)
+        {
+            printf("failed. token %d differs\n", i);
+            return 1;
+        }
+    }
+    printf("passed.\n");
+
+    printf("\nrejecting damaged tapes... ");
+    if (jtok_tape_open(&tape, output.buf, output.len - 8) !=
+            JTOK_PARSE_STATUS_INVAL ||
+        jtok_tape_open(&tape, (char *)output.buf + 8, output.len - 8) !=
+            JTOK_PARSE_STATUS_INVAL)
+    {
+        printf("failed. truncated or misaligned tape accepted\n");
+        return 1;
+    }
+    ((char *)output.buf)[0] = 'X';
+    if (jtok_tape_open(&tape, output.buf, output.len) !=
+        JTOK_PARSE_STATUS_INVAL)
+    {
+        printf("failed. bad magic accepted\n");
+        return 1;
+    }
+    ((char *)output.buf)[0] = JTOK_TAPE_MAGIC[0];
+    {
+        /* Offsets so large that offset + count * size wraps around */
+        jtok_tape_header_t *header = (jtok_tape_header_t *)output.buf;
+        jtok_tape_header_t  saved  = *header;
+        header->token_offset       = UINT64_MAX - 7;
+        header->token_count        = 2;
+        if (jtok_tape_open(&tape, output.buf, output.len) !=
+            JTOK_PARSE_STATUS_INVAL)
+        {
+            printf("failed. wrapped token section accepted\n");
+            return 1;
+        }
+        *header               = saved;
+        header->number_offset = UINT64_MAX - 7;
+        header->number_count  = 1;
+        if (jtok_tape_open(&tape, output.buf, output.len) !=
+            JTOK_PARSE_STATUS_INVAL)
+        {
+            printf("failed. wrapped number section accepted\n");
+            return 1;
+        }
+        *header = saved;
+    }
+    printf("passed.\n");
+
+    printf("\nrejecting corrupt tokens... ");
+    if (jtok_tape_open(&tape, output.buf, output.len) != JTOK_PARSE_STATUS_OK ||
+        corrupt(&tape, CORRUPT_PARENT, -2) ||
+        corrupt(&tape, CORRUPT_PARENT, 9) ||
+        corrupt(&tape, CORRUPT_SIBLING, -5) ||
+        corrupt(&tape, CORRUPT_SIBLING, 1) ||
+        corrupt(&tape, CORRUPT_TYPE, JTOK_UNASSIGNED_TOKEN) ||
+        corrupt(&tape, CORRUPT_TYPE, 77) ||
+        corrupt(&tape, CORRUPT_SIZE, 2) ||
+        corrupt(&tape, CORRUPT_SIZE, -1) ||
+        corrupt(&tape, CORRUPT_START, 60) ||
+        corrupt(&tape, CORRUPT_END, 1) ||
+        corrupt(&tape, CORRUPT_END, 1000))
+    {
+        return 1;
+    }
+    printf("passed.\n");
+
+#if defined(JTOK_HAVE_POSIX)
+    printf("\nmapping a tape file... ");
+    {
+        char  path[] = "/tmp/jtok_tape_XXXXXX";
+        int   fd     = mkstemp(path);
+        FILE *file   = (fd >= 0) ? fdopen(fd, "wb") : NULL;
+        if (file == NULL ||
+            fwrite(output.buf, 1, output.len, file) != output.len)
+        {
+            printf("failed. could not create %s\n", path);
+            return 1;
+        }
+        fclose(file);
+
+        int result = (jtok_tape_map(&tape, path) == JTOK_PARSE_STATUS_OK)
+                         ? check_navigation(&tape)
+                         : 1;
+        jtok_tape_unmap(&tape);
+        unlink(path);
+        if (result != 0 ||
+            jtok_tape_map(&tape, path) != JTOK_PARSE_STATUS_IO_ERROR)
+        {
+            printf("failed.\n");
+            return 1;
+        }
+    }
+    printf("passed.\n");
+#endif /* #if defined(JTOK_HAVE_POSIX) */
+    return 0;
+}
@@ -0,0 +1,247 @@
+/**
+ * @file transcode.test.c
+ * @author Carl Mattatall (cmattatall2@gmail.com)
+ * @brief Source module to test MessagePack and CBOR transcoding
+ * @version 0.1
+ * @date 2021-05-09
+ *
+ * @copyright Copyright (c) 2021 Carl Mattatall
+ *
+ */
+#include <stdio.h>
+#include <string.h>
+
+#include "jtok.h"
+#include "jtok_transcode.h"
+
+#define TOKEN_MAX 200
+#define OUTPUT_MAX 512
+
+/* clang-format off */
+static const struct
+{
+    char json[100];
+    char msgpack[40];
+    char cbor[40];
+    int  len;
+} vector_table[] = {
+    {.json = "{\"a\":1}", .msgpack = "\x81\xa1" "a\x01", .cbor = "\xa1\x61" "a\x01", .len = 4},
+    {.json = "{\"n\":[-1,-33,200]}",
+     .msgpack = "\x81\xa1n\x93\xff\xd0\xdf\xcc\xc8", .cbor = "\xa1\x61n\x83\x20\x38\x20\x18\xc8", .len = 9},
+    {.json = "{\"e\":\"\\u00e9\",\"t\":true,\"z\":null}",
+     .msgpack = "\x83\xa1" "e\xa2\xc3\xa9\xa1t\xc3\xa1z\xc0", .cbor = "\xa3\x61" "e\x62\xc3\xa9\x61t\xf5\x61z\xf6", .len = 12},
+};
+
+static const struct
+{
+    char input[200];
+    char output[200];
+} roundtrip_table[] = {
+    {.input = "{ \"a\" : [ 1, 2.5, -3, true, false, null ], \"b\" : { } }", .output = "{\"a\":[1,2.5,-3,true,false,null],\"b\":{}}"},
+    {.input = "{\"big\":[18446744073709551615,-9223372036854775808,-18446744073709551615,1e300,-0.125]}",
+     .output = "{\"big\":[18446744073709551615,-9223372036854775808,-18446744073709552000,1e+300,-0.125]}"},
+    {.input = "{\"s\":\"tab\\tquote\\\"slash\\/\\ud83d\\ude00\",\"nest\":[[[{\"deep\":[]}]]]}",
+     .output = "{\"s\":\"tab\\tquote\\\"slash/\xF0\x9F\x98\x80\",\"nest\":[[[{\"deep\":[]}]]]}"},
+    {.input = "{\"long string over thirty one bytes\":\"0123456789012345678901234567890123456789\"}",
+     .output = "{\"long string over thirty one bytes\":\"0123456789012345678901234567890123456789\"}"},
+};
+/* clang-format on */
+
+static jtok_tkn_t tokens[TOKEN_MAX];
+
+static struct
+{
+    char   buf[OUTPUT_MAX];
+    size_t len;
+} encoded;
+
+
+static int collect(void *ctx, const char *data, size_t len)
+{
+    (void)ctx;
+    if (encoded.len + len > sizeof(encoded.buf))
+    {
+        return 1;
+    }
+    memcpy(&encoded.buf[encoded.len], data, len);
+    encoded.len += len;
+    return 0;
+}
+
+
+typedef JTOK_WRITE_STATUS_t (*encode_fn)(const jtok_tkn_t *, jtok_write_fn,
+                                         void *);
+typedef JTOK_WRITE_STATUS_t (*decode_fn)(const void *, size_t, size_t *,
+                                         jtok_writer_t *);
+
+
+/* Decode data and compare the json it produces with expected */
+static int check_decode(decode_fn decode, const void *data, size_t len,
+                        const char *expected)
+{
+    char          json[OUTPUT_MAX];
+    size_t        used;
+    jtok_writer_t writer;
+    jtok_writer_init(&writer, json, sizeof(json), NULL, NULL);
+    if (decode(data, len, &used, &writer) != JTOK_WRITE_STATUS_OK ||
+        used != len || writer.len != strlen(expected) ||
+        0 != memcmp(json, expected, writer.len))
+    {
+        printf("failed. got %.*s\n", (int)writer.len, json);
+        return 1;
+    }
+    return 0;
+}
+
+
+static int check_roundtrip(encode_fn encode, decode_fn decode,
+                           const char *expected)
+{
+    encoded.len = 0;
+    if (encode(tokens, collect, NULL) != JTOK_WRITE_STATUS_OK)
+    {
+        printf("failed. encode error\n");
+        return 1;
+    }
+    return check_decode(decode, encoded.buf, encoded.len, expected);
+}
+
+
+static int check_rejected(decode_fn decode, const char *data, size_t len)
+{
+    char          json[OUTPUT_MAX];
+    jtok_writer_t writer;
+    jtok_writer_init(&writer, json, sizeof(json), NULL, NULL);
+    return decode(data, len, NULL, &writer) == JTOK_WRITE_STATUS_OK;
+}
+
+
+int main(void)
+{
+    unsigned long long i;
+    unsigned long long max_i = sizeof(vector_table) / sizeof(*vector_table);
+    char               input[OUTPUT_MAX];
+    char               output[OUTPUT_MAX];
+    size_t             in_len;
+    size_t             out_len;
+    for (i = 0; i < max_i; i++)
+    {
+        size_t len = (size_t)vector_table[i].len;
+        printf("\nencoding %s... ", vector_table[i].json);
+        if (jtok_parse(vector_table[i].json, tokens, TOKEN_MAX) !=
+            JTOK_PARSE_STATUS_OK)
+        {
+            printf("parse failed.\n");
+            return 1;
+        }
+
+        encoded.len = 0;
+        if (jtok_to_msgpack(tokens, collect, NULL) != JTOK_WRITE_STATUS_OK ||
+            encoded.len != len ||
+            0 != memcmp(encoded.buf, vector_table[i].msgpack, len))
+        {
+            printf("failed. msgpack bytes differ\n");
+            return 1;
+        }
+        encoded.len = 0;
+        if (jtok_to_cbor(tokens, collect, NULL) != JTOK_WRITE_STATUS_OK ||
+            encoded.len != len ||
+            0 != memcmp(encoded.buf, vector_table[i].cbor, len))
+        {
+            printf("failed. cbor bytes differ\n");
+            return 1;
+        }
+        printf("passed.\n");
+    }
+
+    max_i = sizeof(roundtrip_table) / sizeof(*roundtrip_table);
+    for (i = 0; i < max_i; i++)
+    {
+        printf("\nround-tripping %s... ", roundtrip_table[i].input);
+        if (jtok_parse(roundtrip_table[i].input, tokens, TOKEN_MAX) !=
+            JTOK_PARSE_STATUS_OK)
+        {
+            printf("parse failed.\n");
+            return 1;
+        }
+        if (check_roundtrip(jtok_to_msgpack, jtok_msgpack_to_json,
+                            roundtrip_table[i].output) != 0 ||
+            check_roundtrip(jtok_to_cbor, jtok_cbor_to_json,
+                            roundtrip_table[i].output) != 0)
+        {
+            return 1;
+        }
+        printf("passed.\n");
+    }
+
+    printf("\nround-tripping an escaped string longer than the stage... ");
+    /* Escapes before, across and after the end of the staged part */
+    in_len  = (size_t)sprintf(input, "{\"s\":\"");
+    out_len = (size_t)sprintf(output, "{\"s\":\"");
+    for (i = 0; i < 300; i++)
+    {
+        if (i % 50 == 49)
+        {
+            in_len += (size_t)sprintf(&input[in_len], "\\u00e9\\\"");
+            out_len += (size_t)sprintf(&output[out_len], "\xc3\xa9\\\"");
+        }
+        else
+        {
+            input[in_len++]   = (char)('a' + i % 26);
+            output[out_len++] = (char)('a' + i % 26);
+        }
+    }
+    sprintf(&input[in_len], "\"}");
+    sprintf(&output[out_len], "\"}");
+    if (jtok_parse(input, tokens, TOKEN_MAX) != JTOK_PARSE_STATUS_OK ||
+        check_roundtrip(jtok_to_msgpack, jtok_msgpack_to_json, output) != 0 ||
+        check_roundtrip(jtok_to_cbor, jtok_cbor_to_json, output) != 0)
+    {
+        printf("failed.\n");
+        return 1;
+    }
+    sprintf(&input[in_len], "\\ud800\"}");
+    if (jtok_parse(input, tokens, TOKEN_MAX) != JTOK_PARSE_STATUS_OK ||
+        jtok_to_msgpack(tokens, collect, NULL) != JTOK_WRITE_STATUS_INVAL)
+    {
+        printf("failed. lone surrogate after the stage encoded\n");
+        return 1;
+    }
+    printf("passed.\n");
+
+    printf("\ndecoding floats, tags and sized containers... ");
+    if (check_decode(jtok_msgpack_to_json, "\x81\xa1x\xca\x3f\xc0\x00\x00", 8,
+                     "{\"x\":1.5}") != 0 ||
+        check_decode(jtok_msgpack_to_json, "\xde\x00\x01\xd9\x01y\xdc\x00\x00",
+                     9, "{\"y\":[]}") != 0 ||
+        check_decode(jtok_cbor_to_json, "\xa1\x61h\xf9\x3e\x00", 6,
+                     "{\"h\":1.5}") != 0 ||
+        check_decode(jtok_cbor_to_json, "\xa1\x61t\xc1\x1a\x00\x01\x00\x00", 9,
+                     "{\"t\":65536}") != 0)
+    {
+        return 1;
+    }
+    printf("passed.\n");
+
+    printf("\nrejecting input without a json equivalent... ");
+    if (check_rejected(jtok_msgpack_to_json, "\x81\xa1", 2) ||
+        check_rejected(jtok_msgpack_to_json, "\x81\x01\x02", 3) ||
+        check_rejected(jtok_msgpack_to_json, "\xc4\x01x", 3) ||
+        check_rejected(jtok_cbor_to_json, "\xa1\x01\x02", 3) ||
+        check_rejected(jtok_cbor_to_json, "\x9f\xff", 2) ||
+        check_rejected(jtok_cbor_to_json, "\x42xy", 3) ||
+        check_rejected(jtok_cbor_to_json, "\x7a\xff\xff\xff\xff", 5))
+    {
+        printf("failed.\n");
+        return 1;
+    }
+    if (jtok_parse("{\"bad\":\"\\ud800\"}", tokens, TOKEN_MAX) !=
+            JTOK_PARSE_STATUS_OK ||
+        jtok_to_cbor(tokens, collect, NULL) != JTOK_WRITE_STATUS_INVAL)
+    {
+        printf("failed. lone surrogate encoded\n");
+        return 1;
+    }
+    printf("passed.\n");
+    return 0;
+}
@@ -0,0 +1,279 @@
+/**
+ * @file writer.test.c
+ * @author Carl Mattatall (cmattatall2@gmail.com)
+ * @brief Source module to test the streaming json writer
+ * @version 0.1
+ * @date 2021-05-01
+ *
+ * @copyright Copyright (c) 2021 Carl Mattatall
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "jtok.h"
+#include "jtok_writer.h"
+
+#define TOKEN_MAX 200
+#define OUTPUT_MAX 1024
+
+/* Deliberately tiny so that every test exercises the flush path */
+#define WRITER_BUF_SIZE 7
+
+static jtok_tkn_t tokens[TOKEN_MAX];
+
+static struct
+{
+    char   buf[OUTPUT_MAX];
+    size_t len;
+} output;
+
+
+static int collect(void *ctx, const char *data, size_t len)
+{
+    (void)ctx;
+    if (output.len + len >= sizeof(output.buf))
+    {
+        return 1;
+    }
+    memcpy(&output.buf[output.len], data, len);
+    output.len += len;
+    output.buf[output.len] = '\0';
+    return 0;
+}
+
+
+static int check(const char *what, const char *expected)
+{
+    printf("\n%s... ", what);
+    if (0 != strcmp(output.buf, expected))
+    {
+        printf("failed. got %s expected %s\n", output.buf, expected);
+        return 1;
+    }
+    printf("passed.\n");
+    return 0;
+}
+
+
+static int test_document(void)
+{
+    char          buf[WRITER_BUF_SIZE];
+    jtok_writer_t w;
+    output.len = 0;
+    jtok_writer_init(&w, buf, sizeof(buf), collect, NULL);
+
+    jtok_writer_begin_object(&w);
+    jtok_writer_key(&w, "name", 4);
+    jtok_writer_string(&w, "a \"quoted\"\tvalue\\ with a long clean tail", 40);
+    jtok_writer_key(&w, "ints", 4);
+    jtok_writer_begin_array(&w);
+    jtok_writer_int(&w, 0);
+    jtok_writer_int(&w, -42);
+    jtok_writer_int(&w, INT64_MIN);
+    jtok_writer_uint(&w, UINT64_MAX);
+    jtok_writer_end_array(&w);
+    jtok_writer_key(&w, "misc", 4);
+    jtok_writer_begin_array(&w);
+    jtok_writer_bool(&w, true);
+    jtok_writer_bool(&w, false);
+    jtok_writer_null(&w);
+    jtok_writer_begin_object(&w);
+    jtok_writer_end_object(&w);
+    jtok_writer_begin_array(&w);
+    jtok_writer_end_array(&w);
+    jtok_writer_string(&w, "\x01", 1);
+    jtok_writer_end_array(&w);
+    jtok_writer_key(&w, "raw", 3);
+    jtok_writer_value(&w, "{\"x\":1}", 7);
+    jtok_writer_end_object(&w);
+    if (jtok_writer_flush(&w) != JTOK_WRITE_STATUS_OK)
+    {
+        printf("writer failed with status %d\n", w.status);
+        return 1;
+    }
+
+    if (check("writing a document",
+              "{\"name\":\"a \\\"quoted\\\"\\tvalue\\\\ with a long clean "
+              "tail\",\"ints\":[0,-42,-9223372036854775808,"
+              "18446744073709551615],\"misc\":[true,false,null,{},[],"
+              "\"\\u0001\"],\"raw\":{\"x\":1}}") != 0)
+    {
+        return 1;
+    }
+
+    if (jtok_parse(output.buf, tokens, TOKEN_MAX) != JTOK_PARSE_STATUS_OK ||
+        w.total != output.len)
+    {
+        printf("writer output does not parse back\n");
+        return 1;
+    }
+    return 0;
+}
+
+
+static int test_doubles(void)
+{
+    static const double values[] = {
+        0.1, -2.5, 1.0 / 3.0, 1e300, 5e-324, 0.30000000000000004, 123456.0,
+        1e21, -0.0,
+    };
+    static const struct
+    {
+        double      value;
+        const char *text;
+    } shortest[] = {
+        {0.1, "0.1"},
+        {5e-324, "5e-324"},
+        {1e-7, "1e-7"},
+        {2.2250738585072009e-308, "2.225073858507201e-308"},
+        {1.7976931348623157e308, "1.7976931348623157e+308"},
+        {0.3, "0.3"},
+        {1.0 / 3.0, "0.3333333333333333"},
+        {9.5, "9.5"},
+        {1e23, "1e+23"},
+    };
+    size_t i;
+    printf("\nround-tripping doubles... ");
+    for (i = 0; i < sizeof(values) / sizeof(*values); i++)
+    {
+        char          buf[64];
+        jtok_writer_t w;
+        jtok_writer_init(&w, buf, sizeof(buf) - 1, NULL, NULL);
+        if (jtok_writer_double(&w, values[i]) != JTOK_WRITE_STATUS_OK)
+        {
+            printf("failed to write %g\n", values[i]);
+            return 1;
+        }
+        buf[w.len] = '\0';
+        if (strtod(buf, NULL) != values[i] || w.len > 24)
+        {
+            printf("failed. %s does not round trip\n", buf);
+            return 1;
+        }
+    }
+
+    for (i = 0; i < sizeof(shortest) / sizeof(*shortest); i++)
+    {
+        char          buf[32];
+        jtok_writer_t w;
+        jtok_writer_init(&w, buf, sizeof(buf) - 1, NULL, NULL);
+        jtok_writer_double(&w, shortest[i].value);
+        buf[w.len] = '\0';
+        if (0 != strcmp(buf, shortest[i].text))
+        {
+            printf("failed. got %s expected %s\n", buf, shortest[i].text);
+            return 1;
+        }
+    }
+    printf("passed.\n");
+    return 0;
+}
+
+
+static int test_unbuffered(void)
+{
+    jtok_writer_t w;
+    output.len    = 0;
+    output.buf[0] = '\0';
+    jtok_writer_init(&w, NULL, 0, collect, NULL);
+    jtok_writer_begin_array(&w);
+    jtok_writer_int(&w, 12);
+    jtok_writer_string(&w, "x", 1);
+    jtok_writer_end_array(&w);
+    if (jtok_writer_flush(&w) != JTOK_WRITE_STATUS_OK || w.len != 0 ||
+        w.total != output.len)
+    {
+        printf("\nwriting without a buffer... failed. status %d\n", w.status);
+        return 1;
+    }
+    return check("writing without a buffer", "[12,\"x\"]");
+}
+
+
+static int test_errors(void)
+{
+    char          buf[64];
+    jtok_writer_t w;
+    printf("\nchecking misuse is rejected... ");
+
+    jtok_writer_init(&w, buf, sizeof(buf), NULL, NULL);
+    jtok_writer_begin_object(&w);
+    if (jtok_writer_int(&w, 1) != JTOK_WRITE_STATUS_INVAL)
+    {
+        printf("failed. value without key accepted\n");
+        return 1;
+    }
+
+    jtok_writer_init(&w, buf, sizeof(buf), NULL, NULL);
+    jtok_writer_begin_array(&w);
+    if (jtok_writer_end_object(&w) != JTOK_WRITE_STATUS_INVAL)
+    {
+        printf("failed. mismatched close accepted\n");
+        return 1;
+    }
+
+    jtok_writer_init(&w, buf, sizeof(buf), NULL, NULL);
+    jtok_writer_begin_object(&w);
+    jtok_writer_key(&w, "k", 1);
+    if (jtok_writer_end_object(&w) != JTOK_WRITE_STATUS_INVAL)
+    {
+        printf("failed. key without value accepted\n");
+        return 1;
+    }
+
+    jtok_writer_init(&w, buf, 4, NULL, NULL);
+    if (jtok_writer_string(&w, "too long", 8) != JTOK_WRITE_STATUS_NOMEM)
+    {
+        printf("failed. overflow not reported\n");
+        return 1;
+    }
+
+    jtok_writer_init(&w, buf, sizeof(buf), NULL, NULL);
+    int depth;
+    for (depth = 0; depth < JTOK_WRITER_MAX_DEPTH; depth++)
+    {
+        jtok_writer_begin_array(&w);
+    }
+    if (jtok_writer_begin_array(&w) != JTOK_WRITE_STATUS_NEST_DEPTH_EXCEEDED)
+    {
+        printf("failed. nesting overflow not reported\n");
+        return 1;
+    }
+    printf("passed.\n");
+    return 0;
+}
+
+
+static int test_sink(void)
+{
+    char          buf[WRITER_BUF_SIZE];
+    jtok_writer_t w;
+    jtok_tkn_t    other[TOKEN_MAX];
+
+    if (jtok_parse("{\"a\":1}", tokens, TOKEN_MAX) != JTOK_PARSE_STATUS_OK ||
+        jtok_parse("{\"a\":2}", other, TOKEN_MAX) != JTOK_PARSE_STATUS_OK)
+    {
+        return 1;
+    }
+
+    output.len = 0;
+    jtok_writer_init(&w, buf, sizeof(buf), collect, NULL);
+    jtok_diff(tokens, other, NULL, 0, jtok_writer_sink, &w);
+    jtok_writer_flush(&w);
+    return check("streaming a diff through a writer",
+                 "[{\"op\":\"replace\",\"path\":\"/a\",\"value\":2}]");
+}
+
+
+int main(void)
+{
+    if (test_document() != 0 || test_doubles() != 0 ||
+        test_unbuffered() != 0 || test_errors() != 0 || test_sink() != 0)
+    {
+        return 1;
+    }
+    return 0;
+}